@@ -21,7 +21,7 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 
 #include <zebra.h>
 
-#include "hash.h"
+#include "ohash.h"
 #include "memory.h"
 #include "vector.h"
 #include "vty.h"
@@ -86,7 +86,7 @@ struct assegment_header
 };
 
 /* Hash for aspath.  This is the top level structure of AS path. */
-static struct hash *ashash;
+static struct ohash *ashash;
 
 /* Stream for SNMP. See aspath_snmp_pathseg */
 static struct stream *snmp_stream;
@@ -341,7 +341,7 @@ aspath_unintern (struct aspath **aspath)
   if (asp->refcnt == 0)
     {
       /* This aspath must exist in aspath hash table. */
-      ret = hash_release (ashash, asp);
+      ret = ohash_release (ashash, asp);
       assert (ret != NULL);
       aspath_free (asp);
       *aspath = NULL;
@@ -620,7 +620,7 @@ aspath_intern (struct aspath *aspath)
   assert (aspath->str);
 
   /* Check AS path hash. */
-  find = hash_get (ashash, aspath, hash_alloc_intern);
+  find = ohash_get (ashash, aspath, hash_alloc_intern);
   if (find != aspath)
     aspath_free (aspath);
 
@@ -803,7 +803,7 @@ aspath_parse (struct stream *s, size_t length, int use32bit)
     return NULL;
 
   /* If already same aspath exist then return it. */
-  find = hash_get (ashash, &as, aspath_hash_alloc);
+  find = ohash_get (ashash, &as, aspath_hash_alloc);
 
   /* bug! should not happen, let the daemon crash below */
   assert (find);
@@ -1856,13 +1856,14 @@ aspath_cmp (const void *arg1, const void *arg2)
 void
 aspath_init (void)
 {
-  ashash = hash_create_size (32767, aspath_key_make, aspath_cmp);
+  ashash = ohash_create_size (32767, aspath_key_make, aspath_cmp);
+  ohash_set_name (ashash, "BGP AS paths");
 }
 
 void
 aspath_finish (void)
 {
-  hash_free (ashash);
+  ohash_free (ashash);
   ashash = NULL;
   
   if (snmp_stream)
@@ -1896,7 +1897,7 @@ aspath_show_all_iterator (struct hash_backet *backet, struct vty *vty)
 
   as = (struct aspath *) backet->data;
 
-  vty_out (vty, "[%p:%u] (%ld) ", backet, backet->key, as->refcnt);
+  vty_out (vty, "[%p:%u] (%ld) ", as, backet->key, as->refcnt);
   vty_out (vty, "%s%s", as->str, VTY_NEWLINE);
 }
 
@@ -1905,8 +1906,8 @@ aspath_show_all_iterator (struct hash_backet *backet, struct vty *vty)
 void
 aspath_print_all_vty (struct vty *vty)
 {
-  hash_iterate (ashash, 
-		(void (*) (struct hash_backet *, void *))
-		aspath_show_all_iterator,
-		vty);
+  ohash_iterate (ashash, 
+		 (void (*) (struct hash_backet *, void *))
+		 aspath_show_all_iterator,
+		 vty);
 }
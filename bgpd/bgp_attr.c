@@ -27,7 +27,7 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 #include "vty.h"
 #include "stream.h"
 #include "log.h"
-#include "hash.h"
+#include "ohash.h"
 #include "jhash.h"
 
 #include "bgpd/bgpd.h"
@@ -75,7 +75,7 @@ static const struct message attr_flag_str[] =
 static const size_t attr_flag_str_max =
   sizeof (attr_flag_str) / sizeof (attr_flag_str[0]);
 
-static struct hash *cluster_hash;
+static struct ohash *cluster_hash;
 
 static void *
 cluster_hash_alloc (void *p)
@@ -109,7 +109,7 @@ cluster_parse (struct in_addr * pnt, int length)
   tmp.length = length;
   tmp.list = pnt;
 
-  cluster = hash_get (cluster_hash, &tmp, cluster_hash_alloc);
+  cluster = ohash_get (cluster_hash, &tmp, cluster_hash_alloc);
   cluster->refcnt++;
   return cluster;
 }
@@ -177,7 +177,7 @@ cluster_intern (struct cluster_list *cluster)
 {
   struct cluster_list *find;
 
-  find = hash_get (cluster_hash, cluster, cluster_hash_alloc);
+  find = ohash_get (cluster_hash, cluster, cluster_hash_alloc);
   find->refcnt++;
 
   return find;
@@ -191,7 +191,7 @@ cluster_unintern (struct cluster_list *cluster)
 
   if (cluster->refcnt == 0)
     {
-      hash_release (cluster_hash, cluster);
+      ohash_release (cluster_hash, cluster);
       cluster_free (cluster);
     }
 }
@@ -199,18 +199,19 @@ cluster_unintern (struct cluster_list *cluster)
 static void
 cluster_init (void)
 {
-  cluster_hash = hash_create (cluster_hash_key_make, cluster_hash_cmp);
+  cluster_hash = ohash_create (cluster_hash_key_make, cluster_hash_cmp);
+  ohash_set_name (cluster_hash, "BGP cluster lists");
 }
 
 static void
 cluster_finish (void)
 {
-  hash_free (cluster_hash);
+  ohash_free (cluster_hash);
   cluster_hash = NULL;
 }
 
 /* Unknown transit attribute. */
-static struct hash *transit_hash;
+static struct ohash *transit_hash;
 
 static void
 transit_free (struct transit *transit)
@@ -233,7 +234,7 @@ transit_intern (struct transit *transit)
 {
   struct transit *find;
 
-  find = hash_get (transit_hash, transit, transit_hash_alloc);
+  find = ohash_get (transit_hash, transit, transit_hash_alloc);
   if (find != transit)
     transit_free (transit);
   find->refcnt++;
@@ -249,7 +250,7 @@ transit_unintern (struct transit *transit)
 
   if (transit->refcnt == 0)
     {
-      hash_release (transit_hash, transit);
+      ohash_release (transit_hash, transit);
       transit_free (transit);
     }
 }
@@ -275,18 +276,22 @@ transit_hash_cmp (const void *p1, const void *p2)
 static void
 transit_init (void)
 {
-  transit_hash = hash_create (transit_hash_key_make, transit_hash_cmp);
+  transit_hash = ohash_create (transit_hash_key_make, transit_hash_cmp);
+  ohash_set_name (transit_hash, "BGP transitive attrs");
 }
 
 static void
 transit_finish (void)
 {
-  hash_free (transit_hash);
+  ohash_free (transit_hash);
   transit_hash = NULL;
 }
 
 /* Attribute hash routines. */
-static struct hash *attrhash;
+static struct ohash *attrhash;
+
+/* Numbers the interned attributes. */
+static unsigned long attr_id;
 
 static struct attr_extra *
 bgp_attr_extra_new (void)
@@ -436,13 +441,14 @@ attrhash_cmp (const void *p1, const void *p2)
 static void
 attrhash_init (void)
 {
-  attrhash = hash_create (attrhash_key_make, attrhash_cmp);
+  attrhash = ohash_create (attrhash_key_make, attrhash_cmp);
+  ohash_set_name (attrhash, "BGP attributes");
 }
 
 static void
 attrhash_finish (void)
 {
-  hash_free (attrhash);
+  ohash_free (attrhash);
   attrhash = NULL;
 }
 
@@ -458,10 +464,10 @@ attr_show_all_iterator (struct hash_backet *backet, struct vty *vty)
 void
 attr_show_all (struct vty *vty)
 {
-  hash_iterate (attrhash, 
-		(void (*)(struct hash_backet *, void *))
-		attr_show_all_iterator,
-		vty);
+  ohash_iterate (attrhash, 
+		 (void (*)(struct hash_backet *, void *))
+		 attr_show_all_iterator,
+		 vty);
 }
 
 static void *
@@ -478,6 +484,7 @@ bgp_attr_hash_alloc (void *p)
       *attr->extra = *val->extra;
     }
   attr->refcnt = 0;
+  attr->id = bgp_attr_id_new ();
   return attr;
 }
 
@@ -530,12 +537,30 @@ bgp_attr_intern (struct attr *attr)
         }
     }
   
-  find = (struct attr *) hash_get (attrhash, attr, bgp_attr_hash_alloc);
+  find = (struct attr *) ohash_get (attrhash, attr, bgp_attr_hash_alloc);
   find->refcnt++;
   
   return find;
 }
 
+/* A fresh attribute number. */
+unsigned long
+bgp_attr_id_new (void)
+{
+  return ++attr_id;
+}
+
+/* Route-map cache key of an attribute: the number of the interned one
+   equal to it, or 0 if there is none. */
+unsigned long
+bgp_attr_cache_key (struct attr *attr)
+{
+  struct attr *find;
+
+  find = ohash_lookup (attrhash, attr);
+  return find ? find->id : 0;
+}
+
 
 /* Make network statement's attribute. */
 struct attr *
@@ -677,7 +702,7 @@ bgp_attr_unintern (struct attr **pattr)
   /* If reference becomes zero then free attribute object. */
   if (attr->refcnt == 0)
     {
-      ret = hash_release (attrhash, attr);
+      ret = ohash_release (attrhash, attr);
       assert (ret != NULL);
       bgp_attr_extra_free (attr);
       XFREE (MTYPE_ATTR, attr);
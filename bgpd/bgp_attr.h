@@ -102,6 +102,10 @@ struct attr
   /* Reference count of this attribute. */
   unsigned long refcnt;
 
+  /* Number of the interned attribute or of the UPDATE it was received
+     in, never reused.  Copies carry it along even when changed. */
+  unsigned long id;
+
   /* Flag of attribute is set or not. */
   u_int32_t flag;
   
@@ -149,6 +153,8 @@ extern struct attr_extra *bgp_attr_extra_get (struct attr *);
 extern void bgp_attr_extra_free (struct attr *);
 extern void bgp_attr_dup (struct attr *, struct attr *);
 extern struct attr *bgp_attr_intern (struct attr *attr);
+extern unsigned long bgp_attr_id_new (void);
+extern unsigned long bgp_attr_cache_key (struct attr *);
 extern void bgp_attr_unintern_sub (struct attr *);
 extern void bgp_attr_unintern (struct attr **);
 extern void bgp_attr_flush (struct attr *);
@@ -23,6 +23,7 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 #include "command.h"
 #include "prefix.h"
 #include "memory.h"
+#include "routemap.h"
 
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_community.h"
@@ -255,6 +256,9 @@ community_list_delete (struct community_list *list)
     clist->head = list->next;
 
   community_list_free (list);
+
+  /* Route-map matches may have used it. */
+  route_map_cache_invalidate ();
 }
 
 static int
@@ -276,6 +280,8 @@ community_list_entry_add (struct community_list *list,
   else
     list->head = entry;
   list->tail = entry;
+
+  route_map_cache_invalidate ();
 }
 
 /* Delete community-list entry from the list.  */
@@ -297,6 +303,8 @@ community_list_entry_delete (struct community_list *list,
 
   if (community_list_empty_p (list))
     community_list_delete (list);
+  else
+    route_map_cache_invalidate ();
 }
 
 /* Lookup community-list entry from the list.  */
@@ -20,13 +20,13 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 
 #include <zebra.h>
 
-#include "hash.h"
+#include "ohash.h"
 #include "memory.h"
 
 #include "bgpd/bgp_community.h"
 
 /* Hash of community attribute. */
-static struct hash *comhash;
+static struct ohash *comhash;
 
 /* Allocate a new communities value.  */
 static struct community *
@@ -302,7 +302,7 @@ community_intern (struct community *com)
   assert (com->refcnt == 0);
 
   /* Lookup community hash. */
-  find = (struct community *) hash_get (comhash, com, hash_alloc_intern);
+  find = (struct community *) ohash_get (comhash, com, hash_alloc_intern);
 
   /* Arguemnt com is allocated temporary.  So when it is not used in
      hash, it should be freed.  */
@@ -332,7 +332,7 @@ community_unintern (struct community **com)
   if ((*com)->refcnt == 0)
     {
       /* Community value com must exist in hash. */
-      ret = (struct community *) hash_release (comhash, *com);
+      ret = (struct community *) ohash_release (comhash, *com);
       assert (ret != NULL);
 
       community_free (*com);
@@ -627,7 +627,7 @@ community_count (void)
 }
 
 /* Return communities hash.  */
-struct hash *
+struct ohash *
 community_hash (void)
 {
   return comhash;
@@ -637,13 +637,14 @@ community_hash (void)
 void
 community_init (void)
 {
-  comhash = hash_create ((unsigned int (*) (void *))community_hash_make,
-			 (int (*) (const void *, const void *))community_cmp);
+  comhash = ohash_create ((unsigned int (*) (void *))community_hash_make,
+			  (int (*) (const void *, const void *))community_cmp);
+  ohash_set_name (comhash, "BGP communities");
 }
 
 void
 community_finish (void)
 {
-  hash_free (comhash);
+  ohash_free (comhash);
   comhash = NULL;
 }
@@ -69,6 +69,6 @@ extern struct community *community_dup (struct community *);
 extern int community_include (struct community *, u_int32_t);
 extern void community_del_val (struct community *, u_int32_t *);
 extern unsigned long community_count (void);
-extern struct hash *community_hash (void);
+extern struct ohash *community_hash (void);
 
 #endif /* _QUAGGA_BGP_COMMUNITY_H */
@@ -192,15 +192,15 @@ bgp_dump_set_size (struct stream *s, int type)
   stream_putl_at (s, 8, stream_get_endp (s) - BGP_DUMP_HEADER_SIZE);
 }
 
-static void
-bgp_dump_routes_index_table(struct bgp *bgp)
+/* Puts the MRT peer index table of the instance into the stream,
+   numbering the peers for the RIB entries that follow it. */
+void
+bgp_dump_routes_index_table_put (struct stream *obuf, struct bgp *bgp)
 {
   struct peer *peer;
   struct listnode *node;
   uint16_t peerno = 0;
-  struct stream *obuf;
 
-  obuf = bgp_dump_obuf;
   stream_reset (obuf);
 
   /* MRT header */
@@ -265,18 +265,101 @@ bgp_dump_routes_index_table(struct bgp *bgp)
     }
 
   bgp_dump_set_size(obuf, MSG_TABLE_DUMP_V2);
+}
+
+static void
+bgp_dump_routes_index_table(struct bgp *bgp)
+{
+  struct stream *obuf;
+
+  obuf = bgp_dump_obuf;
+  bgp_dump_routes_index_table_put (obuf, bgp);
 
   fwrite (STREAM_DATA (obuf), stream_get_endp (obuf), 1, bgp_dump_routes.fp);
   fflush (bgp_dump_routes.fp);
 }
 
+/* Puts the MRT RIB entry of the node, with all its paths, into the
+   stream. */
+void
+bgp_dump_routes_node_put (struct stream *obuf, int afi, struct bgp_node *rn,
+                          unsigned int seq)
+{
+  struct bgp_info *info;
+
+  stream_reset(obuf);
+
+  /* MRT header */
+  if (afi == AFI_IP)
+    {
+      bgp_dump_header (obuf, MSG_TABLE_DUMP_V2, TABLE_DUMP_V2_RIB_IPV4_UNICAST);
+    }
+#ifdef HAVE_IPV6
+  else if (afi == AFI_IP6)
+    {
+      bgp_dump_header (obuf, MSG_TABLE_DUMP_V2, TABLE_DUMP_V2_RIB_IPV6_UNICAST);
+    }
+#endif /* HAVE_IPV6 */
+
+  /* Sequence number */
+  stream_putl(obuf, seq);
+
+  /* Prefix length */
+  stream_putc (obuf, rn->p.prefixlen);
+
+  /* Prefix */
+  if (afi == AFI_IP)
+    {
+      /* We'll dump only the useful bits (those not 0), but have to align on 8 bits */
+      stream_write(obuf, (u_char *)&rn->p.u.prefix4, (rn->p.prefixlen+7)/8);
+    }
+#ifdef HAVE_IPV6
+  else if (afi == AFI_IP6)
+    {
+      /* We'll dump only the useful bits (those not 0), but have to align on 8 bits */
+      stream_write (obuf, (u_char *)&rn->p.u.prefix6, (rn->p.prefixlen+7)/8);
+    }
+#endif /* HAVE_IPV6 */
+
+  /* Save where we are now, so we can overwride the entry count later */
+  int sizep = stream_get_endp(obuf);
+
+  /* Entry count */
+  uint16_t entry_count = 0;
+
+  /* Entry count, note that this is overwritten later */
+  stream_putw(obuf, 0);
+
+  for (info = rn->info; info; info = info->next)
+    {
+      entry_count++;
+
+      /* Peer index */
+      stream_putw(obuf, info->peer->table_dump_index);
+
+      /* Originated */
+#ifdef HAVE_CLOCK_MONOTONIC
+      stream_putl (obuf, time(NULL) - (bgp_clock() - info->uptime));
+#else
+      stream_putl (obuf, info->uptime);
+#endif /* HAVE_CLOCK_MONOTONIC */
+
+      /* Dump attribute. */
+      /* Skip prefix & AFI/SAFI for MP_NLRI */
+      bgp_dump_routes_attr (obuf, info->attr, &rn->p);
+    }
+
+  /* Overwrite the entry count, now that we know the right number */
+  stream_putw_at (obuf, sizep, entry_count);
+
+  bgp_dump_set_size(obuf, MSG_TABLE_DUMP_V2);
+}
 
 /* Runs under child process. */
 static unsigned int
 bgp_dump_routes_func (int afi, int first_run, unsigned int seq)
 {
   struct stream *obuf;
-  struct bgp_info *info;
   struct bgp_node *rn;
   struct bgp *bgp;
   struct bgp_table *table;
@@ -295,7 +378,6 @@ bgp_dump_routes_func (int afi, int first_run, unsigned int seq)
     bgp_dump_routes_index_table(bgp);
 
   obuf = bgp_dump_obuf;
-  stream_reset(obuf);
 
   /* Walk down each BGP route. */
   table = bgp->rib[afi][SAFI_UNICAST];
@@ -305,74 +387,9 @@ bgp_dump_routes_func (int afi, int first_run, unsigned int seq)
       if(!rn->info)
         continue;
 
-      stream_reset(obuf);
-
-      /* MRT header */
-      if (afi == AFI_IP)
-        {
-          bgp_dump_header (obuf, MSG_TABLE_DUMP_V2, TABLE_DUMP_V2_RIB_IPV4_UNICAST);
-        }
-#ifdef HAVE_IPV6
-      else if (afi == AFI_IP6)
-        {
-          bgp_dump_header (obuf, MSG_TABLE_DUMP_V2, TABLE_DUMP_V2_RIB_IPV6_UNICAST);
-        }
-#endif /* HAVE_IPV6 */
-
-      /* Sequence number */
-      stream_putl(obuf, seq);
-
-      /* Prefix length */
-      stream_putc (obuf, rn->p.prefixlen);
-
-      /* Prefix */
-      if (afi == AFI_IP)
-        {
-          /* We'll dump only the useful bits (those not 0), but have to align on 8 bits */
-          stream_write(obuf, (u_char *)&rn->p.u.prefix4, (rn->p.prefixlen+7)/8);
-        }
-#ifdef HAVE_IPV6
-      else if (afi == AFI_IP6)
-        {
-          /* We'll dump only the useful bits (those not 0), but have to align on 8 bits */
-          stream_write (obuf, (u_char *)&rn->p.u.prefix6, (rn->p.prefixlen+7)/8);
-        }
-#endif /* HAVE_IPV6 */
-
-      /* Save where we are now, so we can overwride the entry count later */
-      int sizep = stream_get_endp(obuf);
-
-      /* Entry count */
-      uint16_t entry_count = 0;
-
-      /* Entry count, note that this is overwritten later */
-      stream_putw(obuf, 0);
-
-      for (info = rn->info; info; info = info->next)
-        {
-          entry_count++;
-
-          /* Peer index */
-          stream_putw(obuf, info->peer->table_dump_index);
-
-          /* Originated */
-#ifdef HAVE_CLOCK_MONOTONIC
-          stream_putl (obuf, time(NULL) - (bgp_clock() - info->uptime));
-#else
-          stream_putl (obuf, info->uptime);
-#endif /* HAVE_CLOCK_MONOTONIC */
-
-          /* Dump attribute. */
-          /* Skip prefix & AFI/SAFI for MP_NLRI */
-          bgp_dump_routes_attr (obuf, info->attr, &rn->p);
-        }
-
-      /* Overwrite the entry count, now that we know the right number */
-      stream_putw_at (obuf, sizep, entry_count);
-
+      bgp_dump_routes_node_put (obuf, afi, rn, seq);
       seq++;
 
-      bgp_dump_set_size(obuf, MSG_TABLE_DUMP_V2);
       fwrite (STREAM_DATA (obuf), stream_get_endp (obuf), 1, bgp_dump_routes.fp);
 
     }
@@ -21,6 +21,8 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 #ifndef _QUAGGA_BGP_DUMP_H
 #define _QUAGGA_BGP_DUMP_H
 
+#include "bgp_table.h"
+
 /* MRT compatible packet dump values.  */
 /* type value */
 #define MSG_PROTOCOL_BGP4MP  16
@@ -51,5 +53,8 @@ extern void bgp_dump_init (void);
 extern void bgp_dump_finish (void);
 extern void bgp_dump_state (struct peer *, int, int);
 extern void bgp_dump_packet (struct peer *, int, struct stream *);
+extern void bgp_dump_routes_index_table_put (struct stream *, struct bgp *);
+extern void bgp_dump_routes_node_put (struct stream *, int,
+                                      struct bgp_node *, unsigned int);
 
 #endif /* _QUAGGA_BGP_DUMP_H */
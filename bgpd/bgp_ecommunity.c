@@ -20,7 +20,7 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 
 #include <zebra.h>
 
-#include "hash.h"
+#include "ohash.h"
 #include "memory.h"
 #include "prefix.h"
 #include "command.h"
@@ -30,7 +30,7 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 #include "bgpd/bgp_aspath.h"
 
 /* Hash of community attribute. */
-static struct hash *ecomhash;
+static struct ohash *ecomhash;
 
 /* Allocate a new ecommunities.  */
 static struct ecommunity *
@@ -195,7 +195,7 @@ ecommunity_intern (struct ecommunity *ecom)
 
   assert (ecom->refcnt == 0);
 
-  find = (struct ecommunity *) hash_get (ecomhash, ecom, hash_alloc_intern);
+  find = (struct ecommunity *) ohash_get (ecomhash, ecom, hash_alloc_intern);
 
   if (find != ecom)
     ecommunity_free (&ecom);
@@ -221,7 +221,7 @@ ecommunity_unintern (struct ecommunity **ecom)
   if ((*ecom)->refcnt == 0)
     {
       /* Extended community must be in the hash.  */
-      ret = (struct ecommunity *) hash_release (ecomhash, *ecom);
+      ret = (struct ecommunity *) ohash_release (ecomhash, *ecom);
       assert (ret != NULL);
 
       ecommunity_free (ecom);
@@ -268,13 +268,14 @@ ecommunity_cmp (const void *arg1, const void *arg2)
 void
 ecommunity_init (void)
 {
-  ecomhash = hash_create (ecommunity_hash_make, ecommunity_cmp);
+  ecomhash = ohash_create (ecommunity_hash_make, ecommunity_cmp);
+  ohash_set_name (ecomhash, "BGP ext communities");
 }
 
 void
 ecommunity_finish (void)
 {
-  hash_free (ecomhash);
+  ohash_free (ecomhash);
   ecomhash = NULL;
 }
 
@@ -40,6 +40,8 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 #include "bgpd/bgp_route.h"
 #include "bgpd/bgp_dump.h"
 #include "bgpd/bgp_open.h"
+#include "bgpd/bgp_updgrp.h"
+#include "bgpd/bgp_io.h"
 #ifdef HAVE_SNMP
 #include "bgpd/bgp_snmp.h"
 #endif /* HAVE_SNMP */
@@ -184,8 +186,9 @@ bgp_timer_set (struct peer *peer)
       BGP_TIMER_OFF (peer->t_connect);
 
       /* Same as OpenConfirm, if holdtime is zero then both holdtime
-         and keepalive must be turned off. */
-      if (peer->v_holdtime == 0)
+         and keepalive must be turned off.  The I/O pthread has them
+         if the session is with it. */
+      if (peer->v_holdtime == 0 || peer->io)
 	{
 	  BGP_TIMER_OFF (peer->t_holdtime);
 	  BGP_TIMER_OFF (peer->t_keepalive);
@@ -411,6 +414,7 @@ bgp_fsm_change_status (struct peer *peer, int status)
   /* Preserve old status and change into new status. */
   peer->ostatus = peer->status;
   peer->status = status;
+  bgp_update_group_changed (peer->bgp);
   
   if (BGP_DEBUG (normal, NORMAL))
     zlog_debug ("%s went from %s to %s",
@@ -497,6 +501,7 @@ bgp_stop (struct peer *peer)
     }
 
   /* Stop read and write threads when exists. */
+  bgp_io_peer_stop (peer);
   BGP_READ_OFF (peer->t_read);
   BGP_WRITE_OFF (peer->t_write);
 
@@ -792,6 +797,9 @@ bgp_establish (struct peer *peer)
   peer->established++;
   bgp_fsm_change_status (peer, Established);
 
+  /* Reading and writing go to the I/O pthread from now on. */
+  bgp_io_peer_start (peer);
+
   /* bgp log-neighbor-changes of neighbor Up */
   if (bgp_flag_check (peer->bgp, BGP_FLAG_LOG_NEIGHBOR_CHANGES))
     zlog_info ("%%ADJCHANGE: neighbor %s Up", peer->host);
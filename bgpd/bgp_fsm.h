@@ -35,10 +35,18 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
       THREAD_READ_OFF(T);			\
   } while (0)
 
+/* With the session in the I/O pthread, writing is only queueing to
+   it, and done soon rather than when the socket can take it: by a
+   timer, which BGP_EVENT_FLUSH leaves alone. */
 #define BGP_WRITE_ON(T,F,V)			\
   do {						\
     if (!(T) && (peer->status != Deleted))	\
-      THREAD_WRITE_ON(master,(T),(F),peer,(V)); \
+      {						\
+	if (peer->io)				\
+	  THREAD_TIMER_MSEC_ON(master,(T),(F),peer,0); \
+	else					\
+	  THREAD_WRITE_ON(master,(T),(F),peer,(V)); \
+      }						\
   } while (0)
     
 #define BGP_WRITE_OFF(T)			\
@@ -47,10 +55,12 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
       THREAD_WRITE_OFF(T);			\
   } while (0)
 
+/* Peer timers all have one second resolution, so use the cheaper
+   coarse timers. */
 #define BGP_TIMER_ON(T,F,V)			\
   do {						\
     if (!(T) && (peer->status != Deleted))	\
-      THREAD_TIMER_ON(master,(T),(F),peer,(V)); \
+      THREAD_TIMER_COARSE_ON(master,(T),(F),peer,(V)); \
   } while (0)
 
 #define BGP_TIMER_OFF(T)			\
@@ -0,0 +1,630 @@
+/* BGP I/O pthread
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "thread.h"
+#include "memory.h"
+#include "prefix.h"
+#include "vty.h"
+#include "stream.h"
+#include "network.h"
+#include "sockopt.h"
+#include "mpsc.h"
+#include "ringbuf.h"
+#include "log.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_fsm.h"
+#include "bgpd/bgp_packet.h"
+#include "bgpd/bgp_debug.h"
+#include "bgpd/bgp_io.h"
+
+/* What is read from a peer at once.  All whole messages in it are
+   handed on each time, so what is left is less than one. */
+#define BGP_IO_READ_SIZE	65536
+
+/* Above this many messages waiting for the main thread the peer is
+   not read from, so TCP holds it back; below the low mark it is again. */
+#define BGP_IO_READ_HIGH	1024
+#define BGP_IO_READ_LOW		256
+
+/* Below this many queued packets the main thread is asked for more. */
+#define BGP_IO_WRITE_LOW	BGP_WRITE_PACKET_MAX
+
+/* A message read from the peer, or an FSM event if size is 0. */
+struct bgp_io_msg
+{
+  struct mpsc_node node;
+  int event;
+  int error;			/* errno of TCP_fatal_error */
+  size_t size;
+  u_char data[1];
+};
+
+struct bgp_io
+{
+  /* Set by the main thread, peer is NULL once it took the session
+     back. */
+  struct peer *peer;
+  int fd;
+  u_int32_t v_holdtime;
+  u_int32_t v_keepalive;
+
+  /* The I/O pthread's own. */
+  struct ringbuf *ibuf;
+  time_t last_read;		/* last UPDATE or KEEPALIVE */
+  struct thread *t_read;
+  struct thread *t_write;
+  struct thread *t_holdtime;
+  struct thread *t_keepalive;
+  int failed;
+
+  /* Messages for the main thread, and whether bgp_io_process() has
+     been asked for. */
+  struct mpsc_queue in;
+  int queued;			/* messages in it */
+  int scheduled;
+  int processing;		/* main thread only */
+  int read_paused;		/* t_read is off for queued */
+
+  /* The rest under mtx. */
+  pthread_mutex_t mtx;
+  pthread_cond_t cond;
+  struct stream_fifo *obuf;
+  int more;			/* main thread has more to send */
+  int want_write;		/* ...and has been asked for it */
+  int write_posted;
+  int stopped;
+
+  /* Sent since the main thread last looked. */
+  u_int32_t update_out;
+  u_int32_t keepalive_out;
+  u_int32_t notify_out;
+  u_int32_t refresh_out;
+  u_int32_t dynamic_cap_out;
+};
+
+/* Whether the I/O pthread runs.  Until it does sessions stay on the
+   main thread. */
+static int bgp_io_running;
+
+static int bgp_io_process (struct thread *);
+
+static void
+bgp_io_free (struct bgp_io *io)
+{
+  struct mpsc_node *node;
+
+  while ((node = mpsc_pop (&io->in)) != NULL)
+    XFREE (MTYPE_BGP_IO_MSG, node);
+  ringbuf_free (io->ibuf);
+  stream_fifo_free (io->obuf);
+  pthread_mutex_destroy (&io->mtx);
+  pthread_cond_destroy (&io->cond);
+  XFREE (MTYPE_BGP_IO, io);
+}
+
+/* Have bgp_io_process() called on the main thread, if not already. */
+static void
+bgp_io_wake (struct bgp_io *io)
+{
+  if (! __atomic_exchange_n (&io->scheduled, 1, __ATOMIC_SEQ_CST))
+    thread_add_event_mt (bm->master, bgp_io_process, io, 0);
+}
+
+/* Hand on the first size bytes in the ring buffer, or the event. */
+static void
+bgp_io_push (struct bgp_io *io, int event, int error, size_t size)
+{
+  struct bgp_io_msg *msg;
+
+  msg = XMALLOC (MTYPE_BGP_IO_MSG, sizeof (struct bgp_io_msg) + size);
+  msg->node.next = NULL;
+  msg->event = event;
+  msg->error = error;
+  msg->size = size;
+  if (size)
+    ringbuf_get (io->ibuf, msg->data, size);
+  __atomic_add_fetch (&io->queued, 1, __ATOMIC_SEQ_CST);
+  mpsc_push (&io->in, &msg->node);
+}
+
+/* The session is over, as far as the I/O pthread goes. */
+static void
+bgp_io_fail (struct bgp_io *io, int event, int error)
+{
+  if (io->failed)
+    return;
+  io->failed = 1;
+
+  THREAD_OFF (io->t_read);
+  THREAD_OFF (io->t_write);
+  THREAD_OFF (io->t_holdtime);
+  THREAD_OFF (io->t_keepalive);
+
+  bgp_io_push (io, event, error, 0);
+  bgp_io_wake (io);
+}
+
+static int
+bgp_io_read (struct thread *thread)
+{
+  struct bgp_io *io = THREAD_ARG (thread);
+  u_char header[BGP_HEADER_SIZE];
+  bgp_size_t size;
+  ssize_t nbytes;
+  int count = 0;
+
+  io->t_read = NULL;
+
+  nbytes = ringbuf_read (io->ibuf, io->fd);
+  if (nbytes < 0 && ! ERRNO_IO_RETRY (errno))
+    {
+      bgp_io_fail (io, TCP_fatal_error, errno);
+      return 0;
+    }
+  if (nbytes == 0)
+    {
+      bgp_io_fail (io, TCP_connection_closed, 0);
+      return 0;
+    }
+
+  /* Hand on every whole message read.  One with a length that cannot
+     be is handed on as far as the header, for the main thread to send
+     the NOTIFICATION, and reading stops. */
+  while (ringbuf_peek (io->ibuf, 0, header, BGP_HEADER_SIZE)
+	 == BGP_HEADER_SIZE)
+    {
+      size = (header[BGP_MARKER_SIZE] << 8) | header[BGP_MARKER_SIZE + 1];
+      if (size < BGP_HEADER_SIZE || size > BGP_MAX_PACKET_SIZE)
+	{
+	  bgp_io_push (io, 0, 0, BGP_HEADER_SIZE);
+	  bgp_io_wake (io);
+	  return 0;
+	}
+      if (ringbuf_count (io->ibuf) < size)
+	break;
+
+      if (header[BGP_MARKER_SIZE + 2] == BGP_MSG_UPDATE
+	  || header[BGP_MARKER_SIZE + 2] == BGP_MSG_KEEPALIVE)
+	io->last_read = recent_relative_time ().tv_sec;
+
+      bgp_io_push (io, 0, 0, size);
+      count++;
+    }
+
+  if (count)
+    bgp_io_wake (io);
+
+  /* With too much waiting for the main thread stop reading, until
+     bgp_io_process() has it drained.  Whoever of the two takes
+     read_paused back re-arms the read. */
+  if (__atomic_load_n (&io->queued, __ATOMIC_SEQ_CST) >= BGP_IO_READ_HIGH)
+    {
+      __atomic_store_n (&io->read_paused, 1, __ATOMIC_SEQ_CST);
+      if (__atomic_load_n (&io->queued, __ATOMIC_SEQ_CST) > BGP_IO_READ_LOW
+	  || ! __atomic_exchange_n (&io->read_paused, 0, __ATOMIC_SEQ_CST))
+	return 0;
+    }
+  THREAD_READ_ON (bm->io_master, io->t_read, bgp_io_read, io, io->fd);
+  return 0;
+}
+
+static int
+bgp_io_resume_event (struct thread *thread)
+{
+  struct bgp_io *io = THREAD_ARG (thread);
+
+  if (! io->failed)
+    THREAD_READ_ON (bm->io_master, io->t_read, bgp_io_read, io, io->fd);
+  return 0;
+}
+
+static int
+bgp_io_write_ready (struct thread *thread)
+{
+  struct bgp_io *io = THREAD_ARG (thread);
+  struct stream *s;
+  ssize_t num;
+  int empty, wake = 0;
+
+  io->t_write = NULL;
+
+  pthread_mutex_lock (&io->mtx);
+  sockopt_cork (io->fd, 1);
+  num = stream_fifo_write (io->obuf, io->fd, 0);
+  if (num < 0 && ! ERRNO_IO_RETRY (errno))
+    {
+      int error = errno;
+
+      pthread_mutex_unlock (&io->mtx);
+      bgp_io_fail (io, TCP_fatal_error, error);
+      return 0;
+    }
+
+  /* Account for the packets sent in full.  */
+  while ((s = stream_fifo_head (io->obuf)) != NULL
+	 && STREAM_READABLE (s) == 0)
+    {
+      switch (stream_getc_from (s, BGP_MARKER_SIZE + 2))
+	{
+	case BGP_MSG_UPDATE:
+	  io->update_out++;
+	  break;
+	case BGP_MSG_NOTIFY:
+	  io->notify_out++;
+	  break;
+	case BGP_MSG_KEEPALIVE:
+	  io->keepalive_out++;
+	  break;
+	case BGP_MSG_ROUTE_REFRESH_NEW:
+	case BGP_MSG_ROUTE_REFRESH_OLD:
+	  io->refresh_out++;
+	  break;
+	case BGP_MSG_CAPABILITY:
+	  io->dynamic_cap_out++;
+	  break;
+	}
+      stream_free (stream_fifo_pop (io->obuf));
+    }
+
+  empty = (io->obuf->count == 0);
+  if (io->more && ! io->want_write && io->obuf->count < BGP_IO_WRITE_LOW)
+    {
+      io->want_write = 1;
+      wake = 1;
+    }
+  pthread_mutex_unlock (&io->mtx);
+
+  if (empty)
+    sockopt_cork (io->fd, 0);
+  else
+    THREAD_WRITE_ON (bm->io_master, io->t_write, bgp_io_write_ready, io,
+		     io->fd);
+  if (wake)
+    bgp_io_wake (io);
+  return 0;
+}
+
+static int
+bgp_io_holdtime (struct thread *thread)
+{
+  struct bgp_io *io = THREAD_ARG (thread);
+  time_t idle;
+
+  io->t_holdtime = NULL;
+
+  /* What the peer sent is not being read, by our doing. */
+  if (__atomic_load_n (&io->read_paused, __ATOMIC_SEQ_CST))
+    io->last_read = recent_relative_time ().tv_sec;
+
+  idle = recent_relative_time ().tv_sec - io->last_read;
+  if (idle >= io->v_holdtime)
+    {
+      bgp_io_fail (io, Hold_Timer_expired, 0);
+      return 0;
+    }
+  THREAD_TIMER_COARSE_ON (bm->io_master, io->t_holdtime, bgp_io_holdtime, io,
+			  io->v_holdtime - idle);
+  return 0;
+}
+
+static int
+bgp_io_keepalive (struct thread *thread)
+{
+  struct bgp_io *io = THREAD_ARG (thread);
+  struct stream *s;
+  int i;
+
+  io->t_keepalive = NULL;
+
+  s = stream_new (BGP_HEADER_SIZE);
+  for (i = 0; i < BGP_MARKER_SIZE; i++)
+    stream_putc (s, 0xff);
+  stream_putw (s, BGP_HEADER_SIZE);
+  stream_putc (s, BGP_MSG_KEEPALIVE);
+
+  pthread_mutex_lock (&io->mtx);
+  stream_fifo_push (io->obuf, s);
+  pthread_mutex_unlock (&io->mtx);
+
+  THREAD_WRITE_ON (bm->io_master, io->t_write, bgp_io_write_ready, io,
+		   io->fd);
+  THREAD_TIMER_COARSE_ON (bm->io_master, io->t_keepalive, bgp_io_keepalive,
+			  io, io->v_keepalive);
+  return 0;
+}
+
+static int
+bgp_io_start_event (struct thread *thread)
+{
+  struct bgp_io *io = THREAD_ARG (thread);
+
+  io->last_read = recent_relative_time ().tv_sec;
+  THREAD_READ_ON (bm->io_master, io->t_read, bgp_io_read, io, io->fd);
+
+  /* If the negotiated Hold Time value is zero, then the Hold Time
+     timer and KeepAlive timers are not started. */
+  if (io->v_holdtime)
+    {
+      THREAD_TIMER_COARSE_ON (bm->io_master, io->t_holdtime, bgp_io_holdtime,
+			      io, io->v_holdtime);
+      THREAD_TIMER_COARSE_ON (bm->io_master, io->t_keepalive,
+			      bgp_io_keepalive, io, io->v_keepalive);
+    }
+  return 0;
+}
+
+static int
+bgp_io_write_event (struct thread *thread)
+{
+  struct bgp_io *io = THREAD_ARG (thread);
+
+  pthread_mutex_lock (&io->mtx);
+  io->write_posted = 0;
+  pthread_mutex_unlock (&io->mtx);
+
+  if (! io->failed)
+    THREAD_WRITE_ON (bm->io_master, io->t_write, bgp_io_write_ready, io,
+		     io->fd);
+  return 0;
+}
+
+static int
+bgp_io_stop_event (struct thread *thread)
+{
+  struct bgp_io *io = THREAD_ARG (thread);
+
+  THREAD_OFF (io->t_read);
+  THREAD_OFF (io->t_write);
+  THREAD_OFF (io->t_holdtime);
+  THREAD_OFF (io->t_keepalive);
+
+  pthread_mutex_lock (&io->mtx);
+  io->stopped = 1;
+  pthread_cond_signal (&io->cond);
+  pthread_mutex_unlock (&io->mtx);
+  return 0;
+}
+
+/* Add what was sent to the peer's counts.  Called with mtx held. */
+static void
+bgp_io_count (struct peer *peer, struct bgp_io *io)
+{
+  peer->update_out += io->update_out;
+  peer->keepalive_out += io->keepalive_out;
+  peer->notify_out += io->notify_out;
+  peer->refresh_out += io->refresh_out;
+  peer->dynamic_cap_out += io->dynamic_cap_out;
+  io->update_out = io->keepalive_out = io->notify_out = 0;
+  io->refresh_out = io->dynamic_cap_out = 0;
+}
+
+/* On the main thread, take what the I/O pthread read. */
+static int
+bgp_io_process (struct thread *thread)
+{
+  struct bgp_io *io = THREAD_ARG (thread);
+  struct peer *peer = io->peer;
+  struct bgp_io_msg *msg;
+  u_int32_t quantum;
+  int want_write;
+
+  /* Before looking at the queue, so that anything pushed from now on
+     has this called again. */
+  __atomic_store_n (&io->scheduled, 0, __ATOMIC_SEQ_CST);
+
+  /* The session was taken back meanwhile. */
+  if (peer == NULL)
+    {
+      bgp_io_free (io);
+      return 0;
+    }
+
+  peer_lock (peer);
+  io->processing = 1;
+  for (quantum = peer->bgp->read_quantum; quantum; quantum--)
+    {
+      if (peer->io != io
+	  || (msg = (struct bgp_io_msg *) mpsc_pop (&io->in)) == NULL)
+	break;
+
+      if (msg->size)
+	bgp_read_message (peer, msg->data, msg->size);
+      else if (msg->event == Hold_Timer_expired)
+	{
+	  if (BGP_DEBUG (fsm, FSM))
+	    zlog (peer->log, LOG_DEBUG,
+		  "%s [FSM] Timer (holdtime timer expire)",
+		  peer->host);
+	  BGP_EVENT_ADD (peer, Hold_Timer_expired);
+	}
+      else
+	{
+	  if (msg->event == TCP_fatal_error)
+	    plog_err (peer->log, "%s [Error] bgp_read_packet error: %s",
+		      peer->host, safe_strerror (msg->error));
+	  else if (BGP_DEBUG (events, EVENTS))
+	    plog_debug (peer->log, "%s [Event] BGP connection closed fd %d",
+			peer->host, peer->fd);
+	  bgp_read_failed (peer, msg->event);
+	}
+      XFREE (MTYPE_BGP_IO_MSG, msg);
+      __atomic_sub_fetch (&io->queued, 1, __ATOMIC_SEQ_CST);
+    }
+  io->processing = 0;
+
+  /* Drained enough for the I/O pthread to read again.  Posted before
+     any bgp_io_stop_event(), so it still finds io. */
+  if (peer->io == io
+      && __atomic_load_n (&io->queued, __ATOMIC_SEQ_CST) <= BGP_IO_READ_LOW
+      && __atomic_exchange_n (&io->read_paused, 0, __ATOMIC_SEQ_CST))
+    thread_add_event_mt (bm->io_master, bgp_io_resume_event, io, 0);
+
+  /* Let the other peers have a turn before the rest. */
+  if (quantum == 0 && peer->io == io)
+    bgp_io_wake (io);
+
+  if (peer->io != io)
+    {
+      if (! io->scheduled)
+	bgp_io_free (io);
+    }
+  else
+    {
+      pthread_mutex_lock (&io->mtx);
+      bgp_io_count (peer, io);
+      want_write = io->want_write;
+      pthread_mutex_unlock (&io->mtx);
+
+      if (want_write)
+	BGP_WRITE_ON (peer->t_write, bgp_write, peer->fd);
+    }
+
+  peer_unlock (peer);
+  return 0;
+}
+
+/* Hand the Established session to the I/O pthread. */
+void
+bgp_io_peer_start (struct peer *peer)
+{
+  struct bgp_io *io;
+
+  if (! bgp_io_running || peer->io)
+    return;
+
+  io = XCALLOC (MTYPE_BGP_IO, sizeof (struct bgp_io));
+  io->peer = peer;
+  io->fd = peer->fd;
+  io->v_holdtime = peer->v_holdtime;
+  io->v_keepalive = peer->v_keepalive;
+  io->ibuf = ringbuf_new (BGP_IO_READ_SIZE);
+  io->obuf = stream_fifo_new ();
+  mpsc_init (&io->in);
+  pthread_mutex_init (&io->mtx, NULL);
+  pthread_cond_init (&io->cond, NULL);
+
+  /* The I/O pthread reads until there is no more and must not wait
+     on one peer; an accepted socket may still be blocking. */
+  set_nonblocking (peer->fd);
+
+  BGP_READ_OFF (peer->t_read);
+  BGP_WRITE_OFF (peer->t_write);
+  peer->io = io;
+  thread_add_event_mt (bm->io_master, bgp_io_start_event, io, 0);
+
+  /* What is queued already goes by the I/O pthread too. */
+  if (stream_fifo_head (peer->obuf))
+    BGP_WRITE_ON (peer->t_write, bgp_write, peer->fd);
+}
+
+/* Take the session back from the I/O pthread, dropping what it read
+   and what it has not written yet. */
+void
+bgp_io_peer_stop (struct peer *peer)
+{
+  struct bgp_io *io = peer->io;
+
+  if (io == NULL)
+    return;
+
+  pthread_mutex_lock (&io->mtx);
+  thread_add_event_mt (bm->io_master, bgp_io_stop_event, io, 0);
+  while (! io->stopped)
+    pthread_cond_wait (&io->cond, &io->mtx);
+  bgp_io_count (peer, io);
+  pthread_mutex_unlock (&io->mtx);
+
+  peer->io = NULL;
+  io->peer = NULL;
+
+  /* Still wanted by a bgp_io_process() to come, or the one running. */
+  if (! io->scheduled && ! io->processing)
+    bgp_io_free (io);
+}
+
+/* Queue the packets in peer->obuf to the I/O pthread.  more says the
+   main thread has more to send, to be asked for with bgp_write() once
+   the queue runs low. */
+void
+bgp_io_write (struct peer *peer, int more)
+{
+  struct bgp_io *io = peer->io;
+  struct stream *s;
+  int post;
+
+  pthread_mutex_lock (&io->mtx);
+  while ((s = stream_fifo_pop (peer->obuf)) != NULL)
+    stream_fifo_push (io->obuf, s);
+  io->more = more;
+  io->want_write = 0;
+  post = (io->obuf->count && ! io->write_posted);
+  if (post)
+    io->write_posted = 1;
+  pthread_mutex_unlock (&io->mtx);
+
+  if (post)
+    thread_add_event_mt (bm->io_master, bgp_io_write_event, io, 0);
+}
+
+/* Packets queued to the I/O pthread and not yet written. */
+unsigned long
+bgp_io_queued (struct peer *peer)
+{
+  struct bgp_io *io = peer->io;
+  unsigned long count;
+
+  if (io == NULL)
+    return 0;
+
+  pthread_mutex_lock (&io->mtx);
+  count = io->obuf->count;
+  pthread_mutex_unlock (&io->mtx);
+  return count;
+}
+
+void
+bgp_io_init (void)
+{
+  bm->io_master = thread_master_create ();
+}
+
+/* Start the I/O pthread.  Until then sessions stay on the main
+   thread as before. */
+void
+bgp_io_start (void)
+{
+  if (bm->io_master && ! bgp_io_running)
+    bgp_io_running = (thread_master_start (bm->io_master) == 0);
+}
+
+void
+bgp_io_finish (void)
+{
+  if (bgp_io_running)
+    thread_master_stop (bm->io_master);
+  bgp_io_running = 0;
+  if (bm->io_master)
+    thread_master_free (bm->io_master);
+  bm->io_master = NULL;
+}
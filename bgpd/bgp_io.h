@@ -0,0 +1,44 @@
+/* BGP I/O pthread
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _QUAGGA_BGP_IO_H
+#define _QUAGGA_BGP_IO_H
+
+/* Once a session is Established its socket is handed to the I/O
+   pthread, which reads whole messages off it for the main thread,
+   writes out what the main thread queues, sends the KEEPALIVEs and
+   watches the hold time.  So a main thread busy with a big table does
+   not let sessions time out, and the reads for all peers go on while
+   it works.  The main thread takes the socket back before it sends a
+   NOTIFICATION or closes it. */
+
+/* Packets a peer may have queued to the I/O pthread. */
+#define BGP_IO_WRITE_MAX	(4 * BGP_WRITE_PACKET_MAX)
+
+extern void bgp_io_init (void);
+extern void bgp_io_start (void);
+extern void bgp_io_finish (void);
+
+extern void bgp_io_peer_start (struct peer *);
+extern void bgp_io_peer_stop (struct peer *);
+extern void bgp_io_write (struct peer *, int);
+extern unsigned long bgp_io_queued (struct peer *);
+
+#endif /* _QUAGGA_BGP_IO_H */
@@ -36,19 +36,26 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 #include "filter.h"
 #include "plist.h"
 #include "stream.h"
+#include "linklist.h"
+#include "hash.h"
+#include "table.h"
 
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_attr.h"
 #include "bgpd/bgp_mplsvpn.h"
 #include "bgpd/bgp_aspath.h"
 #include "bgpd/bgp_dump.h"
+#include "bgpd/bgp_table.h"
 #include "bgpd/bgp_route.h"
+#include "bgpd/bgp_advertise.h"
 #include "bgpd/bgp_nexthop.h"
 #include "bgpd/bgp_regex.h"
 #include "bgpd/bgp_clist.h"
 #include "bgpd/bgp_debug.h"
 #include "bgpd/bgp_filter.h"
 #include "bgpd/bgp_zebra.h"
+#include "bgpd/bgp_io.h"
+#include "bgpd/bgp_select.h"
 
 /* bgpd options, we use GNU getopt library. */
 static const struct option longopts[] = 
@@ -236,6 +243,13 @@ bgp_exit (int status)
   for (ALL_LIST_ELEMENTS (bm->bgp, node, nnode, bgp))
     bgp_delete (bgp);
   list_free (bm->bgp);
+  bm->bgp = NULL;
+
+  /* reverse bgp_io_start/bgp_io_init */
+  bgp_io_finish ();
+
+  /* stop any selection pthreads */
+  bgp_select_finish ();
 
   /* reverse bgp_master_init */
   for (ALL_LIST_ELEMENTS_RO(bm->listen_sockets, node, socket))
@@ -258,7 +272,7 @@ bgp_exit (int status)
 
       if_delete (ifp);
     }
-  list_free (iflist);
+  if_terminate ();
 
   /* reverse bgp_attr_init */
   bgp_attr_finish ();
@@ -337,6 +351,18 @@ main (int argc, char **argv)
   zlog_default = openzlog (progname, ZLOG_BGP,
 			   LOG_CONS|LOG_NDELAY|LOG_PID, LOG_DAEMON);
 
+  /* Objects that come and go by the million with a full table are
+     carved out of slab pools, see memory_pool_init(). */
+  memory_pool_init (MTYPE_BGP_NODE, sizeof (struct bgp_node));
+  memory_pool_init (MTYPE_BGP_ROUTE, sizeof (struct bgp_info));
+  memory_pool_init (MTYPE_BGP_ADJ_IN, sizeof (struct bgp_adj_in));
+  memory_pool_init (MTYPE_BGP_ADJ_OUT, sizeof (struct bgp_adj_out));
+  memory_pool_init (MTYPE_BGP_ADVERTISE, sizeof (struct bgp_advertise));
+  memory_pool_init (MTYPE_ROUTE_NODE, sizeof (struct route_node));
+  memory_pool_init (MTYPE_HASH_BACKET, sizeof (struct hash_backet));
+  memory_pool_init (MTYPE_LINK_NODE, sizeof (struct listnode));
+  memory_pool_init (MTYPE_THREAD, sizeof (struct thread));
+
   /* BGP master init. */
   bgp_master_init ();
 
@@ -452,6 +478,9 @@ main (int argc, char **argv)
   /* Process ID file creation. */
   pid_output (pid_file);
 
+  /* Start the pthread sessions are read and written by. */
+  bgp_io_start ();
+
   /* Make bgp vty socket. */
   vty_serv_sock (vty_addr, vty_port, BGP_VTYSH_PATH);
 
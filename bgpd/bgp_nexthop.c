@@ -38,6 +38,9 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 #include "bgpd/bgp_nexthop.h"
 #include "bgpd/bgp_debug.h"
 #include "bgpd/bgp_damp.h"
+#include "bgpd/bgp_packet.h"
+#include "bgpd/bgp_updgrp.h"
+#include "bgpd/bgp_zebra.h"
 #include "zebra/rib.h"
 #include "zebra/zserv.h"	/* For ZEBRA_SERV_PATH. */
 
@@ -60,8 +63,6 @@ static int bgp_import_interval;
 
 /* Route table for next-hop lookup cache. */
 static struct bgp_table *bgp_nexthop_cache_table[AFI_MAX];
-static struct bgp_table *cache1_table[AFI_MAX];
-static struct bgp_table *cache2_table[AFI_MAX];
 
 /* Route table for connected route. */
 static struct bgp_table *bgp_connected_table[AFI_MAX];
@@ -122,6 +123,13 @@ bgp_nexthop_same (struct nexthop *next1, struct nexthop *next2)
       if (! IPV4_ADDR_SAME (&next1->gate.ipv4, &next2->gate.ipv4))
 	return 0;
       break;
+    case ZEBRA_NEXTHOP_IPV4_IFINDEX:
+    case ZEBRA_NEXTHOP_IPV4_IFNAME:
+      if (! IPV4_ADDR_SAME (&next1->gate.ipv4, &next2->gate.ipv4))
+	return 0;
+      if (next1->ifindex != next2->ifindex)
+	return 0;
+      break;
     case ZEBRA_NEXTHOP_IFINDEX:
     case ZEBRA_NEXTHOP_IFNAME:
       if (next1->ifindex != next2->ifindex)
@@ -214,176 +222,346 @@ bgp_nexthop_onlink (afi_t afi, struct attr *attr)
   return 0;
 }
 
-#ifdef HAVE_IPV6
-/* Check specified next-hop is reachable or not. */
+/* Whether the nexthop of a path from the peer has to be on a connected
+   network, as for a directly connected EBGP peer. */
 static int
-bgp_nexthop_lookup_ipv6 (struct peer *peer, struct bgp_info *ri, int *changed,
-			 int *metricchanged)
+bgp_nexthop_connected_check (struct peer *peer)
 {
-  struct bgp_node *rn;
-  struct prefix p;
-  struct bgp_nexthop_cache *bnc;
-  struct attr *attr;
-  
-  /* If lookup is not enabled, return valid. */
-  if (zlookup->sock < 0)
-    {
-      if (ri->extra)
-        ri->extra->igpmetric = 0;
-      return 1;
-    }
-  
-  /* Only check IPv6 global address only nexthop. */
-  attr = ri->attr;
+  return (peer->sort == BGP_PEER_EBGP && peer->ttl == 1
+	  && ! CHECK_FLAG (peer->flags, PEER_FLAG_DISABLE_CONNECTED_CHECK));
+}
 
-  if (attr->extra->mp_nexthop_len != 16 
-      || IN6_IS_ADDR_LINKLOCAL (&attr->extra->mp_nexthop_global))
-    return 1;
+/* Whether the path is valid as far as its nexthop goes.  For a
+   directly connected EBGP peer that is the nexthop being on a connected
+   network, whatever else zebra resolves it by. */
+static int
+bgp_nexthop_path_valid (afi_t afi, struct bgp_nexthop_cache *bnc,
+			struct bgp_info *ri)
+{
+  if (bgp_nexthop_connected_check (ri->peer))
+    return bgp_nexthop_onlink (afi, ri->attr);
+  return bnc->valid;
+}
 
-  memset (&p, 0, sizeof (struct prefix));
-  p.family = AF_INET6;
-  p.prefixlen = IPV6_MAX_BITLEN;
-  p.u.prefix6 = attr->extra->mp_nexthop_global;
+/* No path goes through the nexthop any more: forget it, and have zebra
+   stop tracking it. */
+static void
+bnc_release (struct bgp_nexthop_cache *bnc)
+{
+  struct bgp_node *rn = bnc->node;
 
-  /* IBGP or ebgp-multihop */
-  rn = bgp_node_get (bgp_nexthop_cache_table[AFI_IP6], &p);
+  bgp_zebra_nexthop_register (&rn->p, 0);
+  bnc_free (bnc);
+  rn->info = NULL;
+  bgp_unlock_node (rn);
+}
 
+/* Get the cache entry for the address of p.  A new one is looked up
+   in zebra, and zebra is asked to tell of changes to it from then
+   on. */
+static struct bgp_nexthop_cache *
+bnc_get (afi_t afi, struct prefix *p)
+{
+  struct bgp_node *rn;
+  struct bgp_nexthop_cache *bnc;
+
+  rn = bgp_node_get (bgp_nexthop_cache_table[afi], p);
   if (rn->info)
     {
-      bnc = rn->info;
       bgp_unlock_node (rn);
+      return rn->info;
+    }
+
+  /* If lookup is not enabled, take it as valid until zebra tells
+     otherwise. */
+  if (zlookup->sock < 0)
+    {
+      bnc = bnc_new ();
+      bnc->valid = 1;
     }
   else
     {
-      if (NULL == (bnc = zlookup_query_ipv6 (&attr->extra->mp_nexthop_global)))
-	bnc = bnc_new ();
+#ifdef HAVE_IPV6
+      if (afi == AFI_IP6)
+	bnc = zlookup_query_ipv6 (&p->u.prefix6);
       else
-	{
-	  if (changed)
-	    {
-	      struct bgp_table *old;
-	      struct bgp_node *oldrn;
+#endif /* HAVE_IPV6 */
+	bnc = zlookup_query (p->u.prefix4);
+      if (bnc == NULL)
+	bnc = bnc_new ();
+      bnc->unconfirmed = 1;
+    }
 
-	      if (bgp_nexthop_cache_table[AFI_IP6] == cache1_table[AFI_IP6])
-		old = cache2_table[AFI_IP6];
-	      else
-		old = cache1_table[AFI_IP6];
+  bnc->node = rn;
+  rn->info = bnc;
+  bgp_zebra_nexthop_register (&rn->p, 1);
 
-	      oldrn = bgp_node_lookup (old, &p);
-	      if (oldrn)
-		{
-		  struct bgp_nexthop_cache *oldbnc = oldrn->info;
+  return bnc;
+}
 
-		  bnc->changed = bgp_nexthop_cache_different (bnc, oldbnc);
+/* The path no longer goes through the nexthop it was tracked with. */
+void
+bgp_nexthop_untrack (struct bgp_info *ri)
+{
+  struct bgp_info_extra *extra = ri->extra;
+  struct bgp_nexthop_cache *bnc;
 
-		  if (bnc->metric != oldbnc->metric)
-		    bnc->metricchanged = 1;
+  if (! extra || (bnc = extra->bnc) == NULL)
+    return;
 
-                  bgp_unlock_node (oldrn);
-		}
-	    }
-	}
-      rn->info = bnc;
-    }
+  if (extra->bnc_next)
+    extra->bnc_next->extra->bnc_prev = extra->bnc_prev;
+  if (extra->bnc_prev)
+    extra->bnc_prev->extra->bnc_next = extra->bnc_next;
+  else
+    bnc->paths = extra->bnc_next;
 
-  if (changed)
-    *changed = bnc->changed;
+  extra->bnc = NULL;
+  extra->bnc_next = extra->bnc_prev = NULL;
+  extra->rn = NULL;
 
-  if (metricchanged)
-    *metricchanged = bnc->metricchanged;
+  if (--bnc->path_count == 0)
+    bnc_release (bnc);
+}
 
-  if (bnc->valid && bnc->metric)
-    (bgp_info_extra_get (ri))->igpmetric = bnc->metric;
-  else if (ri->extra)
-    ri->extra->igpmetric = 0;
+static void
+bnc_path_add (struct bgp_nexthop_cache *bnc, struct bgp_node *rn,
+	      struct bgp_info *ri)
+{
+  struct bgp_info_extra *extra = bgp_info_extra_get (ri);
 
-  return bnc->valid;
+  if (extra->bnc != bnc)
+    {
+      bgp_nexthop_untrack (ri);
+
+      extra->bnc = bnc;
+      extra->bnc_prev = NULL;
+      extra->bnc_next = bnc->paths;
+      if (bnc->paths)
+	bnc->paths->extra->bnc_prev = ri;
+      bnc->paths = ri;
+      bnc->path_count++;
+    }
+  extra->rn = rn;
 }
-#endif /* HAVE_IPV6 */
 
-/* Check specified next-hop is reachable or not. */
+/* Check specified next-hop is reachable or not, and track it for the
+   path from now on. */
 int
-bgp_nexthop_lookup (afi_t afi, struct peer *peer, struct bgp_info *ri,
-		    int *changed, int *metricchanged)
+bgp_nexthop_lookup (afi_t afi, struct bgp_node *rn, struct bgp_info *ri)
 {
-  struct bgp_node *rn;
   struct prefix p;
   struct bgp_nexthop_cache *bnc;
-  struct in_addr addr;
-  
-  /* If lookup is not enabled, return valid. */
-  if (zlookup->sock < 0)
-    {
-      if (ri->extra)
-        ri->extra->igpmetric = 0;
-      return 1;
-    }
-  
+  struct attr *attr;
+
+  attr = ri->attr;
+  memset (&p, 0, sizeof (struct prefix));
+
 #ifdef HAVE_IPV6
   if (afi == AFI_IP6)
-    return bgp_nexthop_lookup_ipv6 (peer, ri, changed, metricchanged);
+    {
+      /* Only check IPv6 global address only nexthop.  The others are
+	 on link. */
+      if (attr->extra->mp_nexthop_len != 16 
+	  || IN6_IS_ADDR_LINKLOCAL (&attr->extra->mp_nexthop_global))
+	{
+	  bgp_nexthop_untrack (ri);
+	  return 1;
+	}
+
+      p.family = AF_INET6;
+      p.prefixlen = IPV6_MAX_BITLEN;
+      p.u.prefix6 = attr->extra->mp_nexthop_global;
+    }
+  else
 #endif /* HAVE_IPV6 */
+    {
+      p.family = AF_INET;
+      p.prefixlen = IPV4_MAX_BITLEN;
+      p.u.prefix4 = attr->nexthop;
+    }
 
-  addr = ri->attr->nexthop;
+  bnc = bnc_get (afi, &p);
+  bnc_path_add (bnc, rn, ri);
 
-  memset (&p, 0, sizeof (struct prefix));
-  p.family = AF_INET;
-  p.prefixlen = IPV4_MAX_BITLEN;
-  p.u.prefix4 = addr;
+  if (bnc->valid && bnc->metric)
+    ri->extra->igpmetric = bnc->metric;
+  else
+    ri->extra->igpmetric = 0;
 
-  /* IBGP or ebgp-multihop */
-  rn = bgp_node_get (bgp_nexthop_cache_table[AFI_IP], &p);
+  return bgp_nexthop_path_valid (afi, bnc, ri);
+}
 
-  if (rn->info)
-    {
-      bnc = rn->info;
-      bgp_unlock_node (rn);
-    }
+/* The nexthop of the path resolves differently now. */
+static void
+bgp_nexthop_path_update (struct bgp_nexthop_cache *bnc, struct bgp_info *ri,
+			 int changed)
+{
+  struct bgp_node *rn = ri->extra->rn;
+  struct bgp *bgp = ri->peer->bgp;
+  afi_t afi = rn->table->afi;
+  safi_t safi = rn->table->safi;
+  int valid, current;
+
+  if (CHECK_FLAG (ri->flags, BGP_INFO_REMOVED))
+    return;
+
+  /* Cleared once zebra has been told, see bgp_process_main(). */
+  if (changed)
+    SET_FLAG (ri->flags, BGP_INFO_IGP_CHANGED);
+
+  if (bnc->valid && bnc->metric)
+    ri->extra->igpmetric = bnc->metric;
   else
+    ri->extra->igpmetric = 0;
+
+  valid = bgp_nexthop_path_valid (afi, bnc, ri);
+  current = CHECK_FLAG (ri->flags, BGP_INFO_VALID) ? 1 : 0;
+  if (valid != current)
     {
-      if (NULL == (bnc = zlookup_query (addr)))
-	bnc = bnc_new ();
+      if (CHECK_FLAG (ri->flags, BGP_INFO_VALID))
+	{
+	  bgp_aggregate_decrement (bgp, &rn->p, ri, afi, safi);
+	  bgp_info_unset_flag (rn, ri, BGP_INFO_VALID);
+	}
       else
 	{
-	  if (changed)
-	    {
-	      struct bgp_table *old;
-	      struct bgp_node *oldrn;
+	  bgp_info_set_flag (rn, ri, BGP_INFO_VALID);
+	  bgp_aggregate_increment (bgp, &rn->p, ri, afi, safi);
+	}
+    }
 
-	      if (bgp_nexthop_cache_table[AFI_IP] == cache1_table[AFI_IP])
-		old = cache2_table[AFI_IP];
-	      else
-		old = cache1_table[AFI_IP];
+  bgp_process (bgp, rn, afi, safi);
+}
 
-	      oldrn = bgp_node_lookup (old, &p);
-	      if (oldrn)
-		{
-		  struct bgp_nexthop_cache *oldbnc = oldrn->info;
+/* Zebra tells what a tracked nexthop resolves to, as it has changed
+   or as it was registered.  Only the paths through it are looked at
+   again. */
+int
+bgp_nexthop_update (int command, struct zclient *zclient, uint16_t length)
+{
+  struct stream *s;
+  struct prefix p;
+  struct bgp_node *rn;
+  struct bgp_nexthop_cache *bnc, *new;
+  struct nexthop *nexthop;
+  struct bgp_info *ri;
+  afi_t afi;
+  int i, changed, update;
 
-		  bnc->changed = bgp_nexthop_cache_different (bnc, oldbnc);
+  s = zclient->ibuf;
+  memset (&p, 0, sizeof (struct prefix));
+  p.family = stream_getc (s);
+  switch (p.family)
+    {
+    case AF_INET:
+      afi = AFI_IP;
+      p.prefixlen = IPV4_MAX_BITLEN;
+      break;
+#ifdef HAVE_IPV6
+    case AF_INET6:
+      afi = AFI_IP6;
+      p.prefixlen = IPV6_MAX_BITLEN;
+      break;
+#endif /* HAVE_IPV6 */
+    default:
+      return -1;
+    }
+  stream_get (&p.u.prefix, s, prefix_blen (&p));
 
-		  if (bnc->metric != oldbnc->metric)
-		    bnc->metricchanged = 1;
+  /* No longer tracked, the unregister crossing this. */
+  rn = bgp_node_lookup (bgp_nexthop_cache_table[afi], &p);
+  if (! rn)
+    return 0;
+  bgp_unlock_node (rn);
+  if ((bnc = rn->info) == NULL)
+    return 0;
 
-                  bgp_unlock_node (oldrn);
-		}
-	    }
+  new = bnc_new ();
+  new->metric = stream_getl (s);
+  new->nexthop_num = stream_getc (s);
+  new->valid = new->nexthop_num ? 1 : 0;
+  for (i = 0; i < new->nexthop_num; i++)
+    {
+      nexthop = XCALLOC (MTYPE_NEXTHOP, sizeof (struct nexthop));
+      nexthop->type = stream_getc (s);
+      switch (nexthop->type)
+	{
+	case ZEBRA_NEXTHOP_IPV4:
+	  nexthop->gate.ipv4.s_addr = stream_get_ipv4 (s);
+	  break;
+	case ZEBRA_NEXTHOP_IPV4_IFINDEX:
+	case ZEBRA_NEXTHOP_IPV4_IFNAME:
+	  nexthop->gate.ipv4.s_addr = stream_get_ipv4 (s);
+	  nexthop->ifindex = stream_getl (s);
+	  break;
+#ifdef HAVE_IPV6
+	case ZEBRA_NEXTHOP_IPV6:
+	  stream_get (&nexthop->gate.ipv6, s, 16);
+	  break;
+	case ZEBRA_NEXTHOP_IPV6_IFINDEX:
+	case ZEBRA_NEXTHOP_IPV6_IFNAME:
+	  stream_get (&nexthop->gate.ipv6, s, 16);
+	  nexthop->ifindex = stream_getl (s);
+	  break;
+#endif /* HAVE_IPV6 */
+	case ZEBRA_NEXTHOP_IFINDEX:
+	case ZEBRA_NEXTHOP_IFNAME:
+	  nexthop->ifindex = stream_getl (s);
+	  break;
+	default:
+	  /* do nothing */
+	  break;
 	}
-      rn->info = bnc;
+      bnc_nexthop_add (new, nexthop);
     }
 
-  if (changed)
-    *changed = bnc->changed;
+  /* Only what the lookup could tell may have changed since it. */
+  changed = bnc->unconfirmed ? 0 : bgp_nexthop_cache_different (bnc, new);
+  bnc->unconfirmed = 0;
+  update = (changed || bnc->valid != new->valid || bnc->metric != new->metric);
 
-  if (metricchanged)
-    *metricchanged = bnc->metricchanged;
+  bnc_nexthop_free (bnc);
+  bnc->valid = new->valid;
+  bnc->metric = new->metric;
+  bnc->nexthop_num = new->nexthop_num;
+  bnc->nexthop = new->nexthop;
+  new->nexthop = NULL;
+  bnc_free (new);
+
+  if (! update)
+    return 0;
 
-  if (bnc->valid && bnc->metric)
-    (bgp_info_extra_get(ri))->igpmetric = bnc->metric;
-  else if (ri->extra)
-    ri->extra->igpmetric = 0;
+  if (BGP_DEBUG (events, EVENTS))
+    {
+      char buf[INET6_ADDRSTRLEN];
 
-  return bnc->valid;
+      zlog_debug ("nexthop %s %s [IGP metric %u], %lu paths to update",
+		  inet_ntop (p.family, &p.u.prefix, buf, sizeof (buf)),
+		  bnc->valid ? "valid" : "invalid", bnc->metric,
+		  bnc->path_count);
+    }
+
+  for (ri = bnc->paths; ri; ri = ri->extra->bnc_next)
+    bgp_nexthop_path_update (bnc, ri, changed);
+
+  return 0;
+}
+
+/* Have zebra track all the nexthops again, as when connected anew.  It
+   tells of each in return, so any changes meanwhile are caught up. */
+void
+bgp_nexthop_register_all (void)
+{
+  struct bgp_node *rn;
+  afi_t afi;
+
+  for (afi = AFI_IP; afi < AFI_MAX; afi++)
+    if (bgp_nexthop_cache_table[afi])
+      for (rn = bgp_table_top (bgp_nexthop_cache_table[afi]); rn;
+	   rn = bgp_route_next (rn))
+	if (rn->info)
+	  bgp_zebra_nexthop_register (&rn->p, 1);
 }
 
 /* Reset and free all BGP nexthop cache. */
@@ -392,16 +570,26 @@ bgp_nexthop_cache_reset (struct bgp_table *table)
 {
   struct bgp_node *rn;
   struct bgp_nexthop_cache *bnc;
+  struct bgp_info *ri, *next;
 
   for (rn = bgp_table_top (table); rn; rn = bgp_route_next (rn))
     if ((bnc = rn->info) != NULL)
       {
+	for (ri = bnc->paths; ri; ri = next)
+	  {
+	    next = ri->extra->bnc_next;
+	    ri->extra->bnc = NULL;
+	    ri->extra->bnc_next = ri->extra->bnc_prev = NULL;
+	    ri->extra->rn = NULL;
+	  }
 	bnc_free (bnc);
 	rn->info = NULL;
 	bgp_unlock_node (rn);
       }
 }
 
+/* What is left of the scan, now that the nexthops are tracked: the
+   maximum prefix check, and the dampening of paths. */
 static void
 bgp_scan (afi_t afi, safi_t safi)
 {
@@ -411,16 +599,7 @@ bgp_scan (afi_t afi, safi_t safi)
   struct bgp_info *next;
   struct peer *peer;
   struct listnode *node, *nnode;
-  int valid;
-  int current;
-  int changed;
-  int metricchanged;
-
-  /* Change cache. */
-  if (bgp_nexthop_cache_table[afi] == cache1_table[afi])
-    bgp_nexthop_cache_table[afi] = cache2_table[afi];
-  else
-    bgp_nexthop_cache_table[afi] = cache1_table[afi];
+  int damped;
 
   /* Get default bgp. */
   bgp = bgp_get_default ();
@@ -441,64 +620,31 @@ bgp_scan (afi_t afi, safi_t safi)
 	bgp_maximum_prefix_overflow (peer, afi, SAFI_MPLS_VPN, 1);
     }
 
+  /* Only dampening still has the table walked. */
+  if (! CHECK_FLAG (bgp->af_flags[afi][SAFI_UNICAST], BGP_CONFIG_DAMPENING))
+    return;
+
   for (rn = bgp_table_top (bgp->rib[afi][SAFI_UNICAST]); rn;
        rn = bgp_route_next (rn))
     {
+      damped = 0;
       for (bi = rn->info; bi; bi = next)
 	{
 	  next = bi->next;
 
-	  if (bi->type == ZEBRA_ROUTE_BGP && bi->sub_type == BGP_ROUTE_NORMAL)
+	  if (bi->type == ZEBRA_ROUTE_BGP && bi->sub_type == BGP_ROUTE_NORMAL
+	      && bi->extra && bi->extra->damp_info)
 	    {
-	      changed = 0;
-	      metricchanged = 0;
-
-	      if (bi->peer->sort == BGP_PEER_EBGP && bi->peer->ttl == 1)
-		valid = bgp_nexthop_onlink (afi, bi->attr);
-	      else
-		valid = bgp_nexthop_lookup (afi, bi->peer, bi,
-					    &changed, &metricchanged);
-
-	      current = CHECK_FLAG (bi->flags, BGP_INFO_VALID) ? 1 : 0;
-
-	      if (changed)
-		SET_FLAG (bi->flags, BGP_INFO_IGP_CHANGED);
-	      else
-		UNSET_FLAG (bi->flags, BGP_INFO_IGP_CHANGED);
-
-	      if (valid != current)
-		{
-		  if (CHECK_FLAG (bi->flags, BGP_INFO_VALID))
-		    {
-		      bgp_aggregate_decrement (bgp, &rn->p, bi,
-					       afi, SAFI_UNICAST);
-		      bgp_info_unset_flag (rn, bi, BGP_INFO_VALID);
-		    }
-		  else
-		    {
-		      bgp_info_set_flag (rn, bi, BGP_INFO_VALID);
-		      bgp_aggregate_increment (bgp, &rn->p, bi,
-					       afi, SAFI_UNICAST);
-		    }
-		}
-
-              if (CHECK_FLAG (bgp->af_flags[afi][SAFI_UNICAST],
-		  BGP_CONFIG_DAMPENING)
-                  &&  bi->extra && bi->extra->damp_info )
-                if (bgp_damp_scan (bi, afi, SAFI_UNICAST))
-		  bgp_aggregate_increment (bgp, &rn->p, bi,
-					   afi, SAFI_UNICAST);
+	      damped = 1;
+	      if (bgp_damp_scan (bi, afi, SAFI_UNICAST))
+		bgp_aggregate_increment (bgp, &rn->p, bi,
+					 afi, SAFI_UNICAST);
 	    }
 	}
-      bgp_process (bgp, rn, afi, SAFI_UNICAST);
+      if (damped)
+	bgp_process (bgp, rn, afi, SAFI_UNICAST);
     }
 
-  /* Flash old cache. */
-  if (bgp_nexthop_cache_table[afi] == cache1_table[afi])
-    bgp_nexthop_cache_reset (cache2_table[afi]);
-  else
-    bgp_nexthop_cache_reset (cache1_table[afi]);
-
   if (BGP_DEBUG (events, EVENTS))
     {
       if (afi == AFI_IP)
@@ -508,7 +654,8 @@ bgp_scan (afi_t afi, safi_t safi)
     }
 }
 
-/* BGP scan thread.  This thread check nexthop reachability. */
+/* BGP scan thread.  Nexthop reachability is tracked by zebra, this
+   thread only sees to the rest of bgp_scan(). */
 static int
 bgp_scan_timer (struct thread *t)
 {
@@ -571,6 +718,7 @@ bgp_address_init (void)
 {
   bgp_address_hash = hash_create (bgp_address_hash_key_make,
                                   bgp_address_hash_cmp);
+  hash_set_name (bgp_address_hash, "BGP local addresses");
 }
 
 static void
@@ -609,6 +757,33 @@ struct bgp_connected_ref
   unsigned int refcnt;
 };
 
+/* A connected network came or went.  The paths that need their nexthop
+   on one, with a nexthop in it, are looked at again. */
+static void
+bgp_connected_recheck (afi_t afi, struct prefix *p)
+{
+  struct bgp_node *top, *rn;
+  struct bgp_nexthop_cache *bnc;
+  struct bgp_info *ri;
+  int current;
+
+  if (bgp_nexthop_cache_table[afi] == NULL)
+    return;
+
+  top = bgp_node_get (bgp_nexthop_cache_table[afi], p);
+  for (rn = bgp_lock_node (top); rn; rn = bgp_route_next_until (rn, top))
+    if ((bnc = rn->info) != NULL)
+      for (ri = bnc->paths; ri; ri = ri->extra->bnc_next)
+	{
+	  if (! bgp_nexthop_connected_check (ri->peer))
+	    continue;
+	  current = CHECK_FLAG (ri->flags, BGP_INFO_VALID) ? 1 : 0;
+	  if (bgp_nexthop_onlink (afi, ri->attr) != current)
+	    bgp_nexthop_path_update (bnc, ri, 0);
+	}
+  bgp_unlock_node (top);
+}
+
 void
 bgp_connected_add (struct connected *ifc)
 {
@@ -637,6 +812,7 @@ bgp_connected_add (struct connected *ifc)
 	return;
 
       bgp_address_add (addr);
+      bgp_update_group_changed (NULL);
 
       rn = bgp_node_get (bgp_connected_table[AFI_IP], (struct prefix *) &p);
       if (rn->info)
@@ -650,6 +826,7 @@ bgp_connected_add (struct connected *ifc)
 	  bc->refcnt = 1;
 	  rn->info = bc;
 	}
+      bgp_connected_recheck (AFI_IP, &p);
     }
 #ifdef HAVE_IPV6
   else if (addr->family == AF_INET6)
@@ -675,6 +852,7 @@ bgp_connected_add (struct connected *ifc)
 	  bc->refcnt = 1;
 	  rn->info = bc;
 	}
+      bgp_connected_recheck (AFI_IP6, &p);
     }
 #endif /* HAVE_IPV6 */
 }
@@ -704,6 +882,7 @@ bgp_connected_delete (struct connected *ifc)
 	return;
 
       bgp_address_del (addr);
+      bgp_update_group_changed (NULL);
 
       rn = bgp_node_lookup (bgp_connected_table[AFI_IP], &p);
       if (! rn)
@@ -718,6 +897,7 @@ bgp_connected_delete (struct connected *ifc)
 	}
       bgp_unlock_node (rn);
       bgp_unlock_node (rn);
+      bgp_connected_recheck (AFI_IP, &p);
     }
 #ifdef HAVE_IPV6
   else if (addr->family == AF_INET6)
@@ -744,6 +924,7 @@ bgp_connected_delete (struct connected *ifc)
 	}
       bgp_unlock_node (rn);
       bgp_unlock_node (rn);
+      bgp_connected_recheck (AFI_IP6, &p);
     }
 #endif /* HAVE_IPV6 */
 }
@@ -1213,6 +1394,31 @@ bgp_multiaccess_check_v4 (struct in_addr nexthop, char *peer)
 
   return 0;
 }
+
+/* Whether peers a and b are on the same connected network, or neither
+   is on one, so that bgp_multiaccess_check_v4() answers the same for
+   them whatever the next hop.  */
+int
+bgp_multiaccess_same_v4 (char *a, char *b)
+{
+  struct bgp_node *rn1 = NULL;
+  struct bgp_node *rn2 = NULL;
+  struct prefix p;
+
+  memset (&p, 0, sizeof (struct prefix));
+  p.family = AF_INET;
+  p.prefixlen = IPV4_MAX_BITLEN;
+
+  if (inet_aton (a, &p.u.prefix4)
+      && (rn1 = bgp_node_match (bgp_connected_table[AFI_IP], &p)) != NULL)
+    bgp_unlock_node (rn1);
+  if (inet_aton (b, &p.u.prefix4)
+      && (rn2 = bgp_node_match (bgp_connected_table[AFI_IP], &p)) != NULL)
+    bgp_unlock_node (rn2);
+
+  /* Only the pointers are compared, as above. */
+  return rn1 == rn2;
+}
 
 DEFUN (bgp_scan_time,
        bgp_scan_time_cmd,
@@ -1265,8 +1471,9 @@ show_ip_bgp_scan_tables (struct vty *vty, const char detail)
 {
   struct bgp_node *rn;
   struct bgp_nexthop_cache *bnc;
+  struct nexthop *nexthop;
   char buf[INET6_ADDRSTRLEN];
-  u_char i;
+  afi_t afi;
 
   if (bgp_scan_thread)
     vty_out (vty, "BGP scan is running%s", VTY_NEWLINE);
@@ -1275,65 +1482,50 @@ show_ip_bgp_scan_tables (struct vty *vty, const char detail)
   vty_out (vty, "BGP scan interval is %d%s", bgp_scan_interval, VTY_NEWLINE);
 
   vty_out (vty, "Current BGP nexthop cache:%s", VTY_NEWLINE);
-  for (rn = bgp_table_top (bgp_nexthop_cache_table[AFI_IP]); rn; rn = bgp_route_next (rn))
-    if ((bnc = rn->info) != NULL)
-      {
-	if (bnc->valid)
-	{
-	  vty_out (vty, " %s valid [IGP metric %d]%s",
-		   inet_ntop (AF_INET, &rn->p.u.prefix4, buf, INET6_ADDRSTRLEN), bnc->metric, VTY_NEWLINE);
-	  if (detail)
-	    for (i = 0; i < bnc->nexthop_num; i++)
-	      switch (bnc->nexthop[i].type)
+  for (afi = AFI_IP; afi < AFI_MAX; afi++)
+    if (bgp_nexthop_cache_table[afi])
+      for (rn = bgp_table_top (bgp_nexthop_cache_table[afi]); rn;
+	   rn = bgp_route_next (rn))
+	if ((bnc = rn->info) != NULL)
+	  {
+	    inet_ntop (rn->p.family, &rn->p.u.prefix, buf, INET6_ADDRSTRLEN);
+	    if (bnc->valid)
 	      {
-	      case NEXTHOP_TYPE_IPV4:
-		vty_out (vty, "  gate %s%s", inet_ntop (AF_INET, &bnc->nexthop[i].gate.ipv4, buf, INET6_ADDRSTRLEN), VTY_NEWLINE);
-		break;
-	      case NEXTHOP_TYPE_IFINDEX:
-		vty_out (vty, "  ifidx %u%s", bnc->nexthop[i].ifindex, VTY_NEWLINE);
-		break;
-	      default:
-		vty_out (vty, "  invalid nexthop type %u%s", bnc->nexthop[i].type, VTY_NEWLINE);
-	      }
-	}
-	else
-	  vty_out (vty, " %s invalid%s",
-		   inet_ntop (AF_INET, &rn->p.u.prefix4, buf, INET6_ADDRSTRLEN), VTY_NEWLINE);
-      }
-
+		vty_out (vty, " %s valid [IGP metric %d], %lu paths%s",
+			 buf, bnc->metric, bnc->path_count, VTY_NEWLINE);
+		if (detail)
+		  for (nexthop = bnc->nexthop; nexthop; nexthop = nexthop->next)
+		    switch (nexthop->type)
+		      {
+		      case NEXTHOP_TYPE_IPV4:
+		      case NEXTHOP_TYPE_IPV4_IFINDEX:
+		      case NEXTHOP_TYPE_IPV4_IFNAME:
+			vty_out (vty, "  gate %s%s",
+				 inet_ntop (AF_INET, &nexthop->gate.ipv4, buf,
+					    INET6_ADDRSTRLEN), VTY_NEWLINE);
+			break;
 #ifdef HAVE_IPV6
-  {
-    for (rn = bgp_table_top (bgp_nexthop_cache_table[AFI_IP6]); 
-         rn; 
-         rn = bgp_route_next (rn))
-      if ((bnc = rn->info) != NULL)
-	{
-	  if (bnc->valid)
-	  {
-	    vty_out (vty, " %s valid [IGP metric %d]%s",
-		     inet_ntop (AF_INET6, &rn->p.u.prefix6, buf, INET6_ADDRSTRLEN),
-		     bnc->metric, VTY_NEWLINE);
-	    if (detail)
-	      for (i = 0; i < bnc->nexthop_num; i++)
-		switch (bnc->nexthop[i].type)
-		{
-		case NEXTHOP_TYPE_IPV6:
-		  vty_out (vty, "  gate %s%s", inet_ntop (AF_INET6, &bnc->nexthop[i].gate.ipv6, buf, INET6_ADDRSTRLEN), VTY_NEWLINE);
-		  break;
-		case NEXTHOP_TYPE_IFINDEX:
-		  vty_out (vty, "  ifidx %u%s", bnc->nexthop[i].ifindex, VTY_NEWLINE);
-		  break;
-		default:
-		  vty_out (vty, "  invalid nexthop type %u%s", bnc->nexthop[i].type, VTY_NEWLINE);
-		}
-	  }
-	  else
-	    vty_out (vty, " %s invalid%s",
-		     inet_ntop (AF_INET6, &rn->p.u.prefix6, buf, INET6_ADDRSTRLEN),
-		     VTY_NEWLINE);
-	}
-  }
+		      case NEXTHOP_TYPE_IPV6:
+		      case NEXTHOP_TYPE_IPV6_IFINDEX:
+		      case NEXTHOP_TYPE_IPV6_IFNAME:
+			vty_out (vty, "  gate %s%s",
+				 inet_ntop (AF_INET6, &nexthop->gate.ipv6, buf,
+					    INET6_ADDRSTRLEN), VTY_NEWLINE);
+			break;
 #endif /* HAVE_IPV6 */
+		      case NEXTHOP_TYPE_IFINDEX:
+			vty_out (vty, "  ifidx %u%s", nexthop->ifindex,
+				 VTY_NEWLINE);
+			break;
+		      default:
+			vty_out (vty, "  invalid nexthop type %u%s",
+				 nexthop->type, VTY_NEWLINE);
+		      }
+	      }
+	    else
+	      vty_out (vty, " %s invalid, %lu paths%s",
+		       buf, bnc->path_count, VTY_NEWLINE);
+	  }
 
   vty_out (vty, "BGP connected route:%s", VTY_NEWLINE);
   for (rn = bgp_table_top (bgp_connected_table[AFI_IP]); 
@@ -1400,16 +1592,12 @@ bgp_scan_init (void)
   bgp_scan_interval = BGP_SCAN_INTERVAL_DEFAULT;
   bgp_import_interval = BGP_IMPORT_INTERVAL_DEFAULT;
 
-  cache1_table[AFI_IP] = bgp_table_init (AFI_IP, SAFI_UNICAST);
-  cache2_table[AFI_IP] = bgp_table_init (AFI_IP, SAFI_UNICAST);
-  bgp_nexthop_cache_table[AFI_IP] = cache1_table[AFI_IP];
+  bgp_nexthop_cache_table[AFI_IP] = bgp_table_init (AFI_IP, SAFI_UNICAST);
 
   bgp_connected_table[AFI_IP] = bgp_table_init (AFI_IP, SAFI_UNICAST);
 
 #ifdef HAVE_IPV6
-  cache1_table[AFI_IP6] = bgp_table_init (AFI_IP6, SAFI_UNICAST);
-  cache2_table[AFI_IP6] = bgp_table_init (AFI_IP6, SAFI_UNICAST);
-  bgp_nexthop_cache_table[AFI_IP6] = cache1_table[AFI_IP6];
+  bgp_nexthop_cache_table[AFI_IP6] = bgp_table_init (AFI_IP6, SAFI_UNICAST);
   bgp_connected_table[AFI_IP6] = bgp_table_init (AFI_IP6, SAFI_UNICAST);
 #endif /* HAVE_IPV6 */
 
@@ -1432,27 +1620,19 @@ bgp_scan_init (void)
 void
 bgp_scan_finish (void)
 {
-  /* Only the current one needs to be reset. */
   bgp_nexthop_cache_reset (bgp_nexthop_cache_table[AFI_IP]);
 
-  bgp_table_unlock (cache1_table[AFI_IP]);
-  cache1_table[AFI_IP] = NULL;
-
-  bgp_table_unlock (cache2_table[AFI_IP]);
-  cache2_table[AFI_IP] = NULL;
+  bgp_table_unlock (bgp_nexthop_cache_table[AFI_IP]);
+  bgp_nexthop_cache_table[AFI_IP] = NULL;
 
   bgp_table_unlock (bgp_connected_table[AFI_IP]);
   bgp_connected_table[AFI_IP] = NULL;
 
 #ifdef HAVE_IPV6
-  /* Only the current one needs to be reset. */
   bgp_nexthop_cache_reset (bgp_nexthop_cache_table[AFI_IP6]);
 
-  bgp_table_unlock (cache1_table[AFI_IP6]);
-  cache1_table[AFI_IP6] = NULL;
-
-  bgp_table_unlock (cache2_table[AFI_IP6]);
-  cache2_table[AFI_IP6] = NULL;
+  bgp_table_unlock (bgp_nexthop_cache_table[AFI_IP6]);
+  bgp_nexthop_cache_table[AFI_IP6] = NULL;
 
   bgp_table_unlock (bgp_connected_table[AFI_IP6]);
   bgp_connected_table[AFI_IP6] = NULL;
@@ -22,37 +22,50 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 #define _QUAGGA_BGP_NEXTHOP_H
 
 #include "if.h"
+#include "zclient.h"
 
 #define BGP_SCAN_INTERVAL_DEFAULT   60
 #define BGP_IMPORT_INTERVAL_DEFAULT 15
 
-/* BGP nexthop cache value structure. */
+/* BGP nexthop cache value structure.  One is kept for each address
+   that paths in the RIB have as their nexthop, for as long as any do,
+   and zebra is asked to track it.  Zebra tells of changes to what the
+   address resolves to as they happen, and only the paths through it
+   are looked at again. */
 struct bgp_nexthop_cache
 {
   /* This nexthop exists in IGP. */
   u_char valid;
 
-  /* Nexthop is changed. */
-  u_char changed;
-
-  /* Nexthop is changed. */
-  u_char metricchanged;
-
   /* IGP route's metric. */
   u_int32_t metric;
 
   /* Nexthop number and nexthop linked list.*/
   u_char nexthop_num;
   struct nexthop *nexthop;
+
+  /* Looked up, and not yet heard of from zebra since.  The lookup
+     gives less of the nexthops than zebra's word on them. */
+  u_char unconfirmed;
+
+  /* Node in the cache table, with the address. */
+  struct bgp_node *node;
+
+  /* The paths through this nexthop, linked through their extra. */
+  struct bgp_info *paths;
+  unsigned long path_count;
 };
 
 extern void bgp_scan_init (void);
 extern void bgp_scan_finish (void);
-extern int bgp_nexthop_lookup (afi_t, struct peer *peer, struct bgp_info *,
-			int *, int *);
+extern int bgp_nexthop_lookup (afi_t, struct bgp_node *, struct bgp_info *);
+extern void bgp_nexthop_untrack (struct bgp_info *);
+extern int bgp_nexthop_update (int, struct zclient *, uint16_t);
+extern void bgp_nexthop_register_all (void);
 extern void bgp_connected_add (struct connected *c);
 extern void bgp_connected_delete (struct connected *c);
 extern int bgp_multiaccess_check_v4 (struct in_addr, char *);
+extern int bgp_multiaccess_same_v4 (char *, char *);
 extern int bgp_config_write_scan_time (struct vty *);
 extern int bgp_nexthop_onlink (afi_t, struct attr *);
 extern int bgp_nexthop_self (struct attr *);
@@ -47,6 +47,8 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 #include "bgpd/bgp_mplsvpn.h"
 #include "bgpd/bgp_advertise.h"
 #include "bgpd/bgp_vty.h"
+#include "bgpd/bgp_updgrp.h"
+#include "bgpd/bgp_io.h"
 
 int stream_put_prefix (struct stream *, struct prefix *);
 
@@ -137,6 +139,63 @@ bgp_connect_check (struct peer *peer)
     }
 }
 
+/* Queue up a packet made for another member of the peer's update
+   group, taking its prefixes off the peer's FIFO as it was made from
+   them.  */
+static struct stream *
+bgp_update_packet_shared (struct peer *peer, afi_t afi, safi_t safi,
+			  struct update_packet *up)
+{
+  struct update_group *group = peer->update_group[afi][safi];
+  struct bgp_synchronize *sync = peer->sync[afi][safi];
+  struct bgp_advertise *adv;
+  struct bgp_adj_out *adj;
+  struct bgp_node *rn;
+  unsigned int i;
+
+  adv = up->withdraw ? FIFO_HEAD (&sync->withdraw) : FIFO_HEAD (&sync->update);
+  for (i = 0; i < up->count; i++)
+    {
+      rn = adv->rn;
+      adj = adv->adj;
+      assert (rn == up->rn[i]);
+
+      if (BGP_DEBUG (update, UPDATE_OUT))
+        {
+          char buf[INET6_BUFSIZ];
+
+          zlog (peer->log, LOG_DEBUG, "%s send UPDATE %s/%d%s (shared)",
+                peer->host,
+                inet_ntop (rn->p.family, &(rn->p.u.prefix), buf, INET6_BUFSIZ),
+                rn->p.prefixlen, up->withdraw ? " -- unreachable" : "");
+        }
+
+      if (up->withdraw)
+	{
+	  peer->scount[afi][safi]--;
+	  bgp_adj_out_remove (rn, adj, peer, afi, safi);
+	  bgp_unlock_node (rn);
+	  adv = FIFO_HEAD (&sync->withdraw);
+	}
+      else
+	{
+	  if (adj->attr)
+	    bgp_attr_unintern (&adj->attr);
+	  else
+	    peer->scount[afi][safi]++;
+	  adj->attr = bgp_attr_intern (adv->baa->attr);
+	  adv = bgp_advertise_clean (peer, adj, afi, safi);
+	}
+    }
+
+  group->shared++;
+  group->shared_bytes += stream_get_endp (up->s);
+  stream_fifo_push_ref (peer->obuf, up->s);
+  if (! up->withdraw)
+    BGP_WRITE_ON (peer->t_write, bgp_write, peer->fd);
+  return peer->obuf->tail;
+}
+
 /* Make BGP update packet.  */
 static struct stream *
 bgp_update_packet (struct peer *peer, afi_t afi, safi_t safi)
@@ -149,6 +208,17 @@ bgp_update_packet (struct peer *peer, afi_t afi, safi_t safi)
   struct bgp_info *binfo = NULL;
   bgp_size_t total_attr_len = 0;
   unsigned long pos;
+  struct update_group *group = peer->update_group[afi][safi];
+  struct update_packet *up;
+  struct bgp_node *taken[BGP_MAX_PACKET_SIZE];
+  struct attr *attr = NULL;
+  struct bgp_info *first = NULL;
+  unsigned int i, count = 0;
+
+  /* Another member of the group may have made it already. */
+  if (group
+      && (up = update_group_packet_lookup (group, peer->sync[afi][safi], 0)))
+    return bgp_update_packet_shared (peer, afi, safi, up);
 
   s = peer->work;
   stream_reset (s);
@@ -192,10 +262,20 @@ bgp_update_packet (struct peer *peer, afi_t afi, safi_t safi)
 	                                         &rn->p, afi, safi, 
 	                                         from, prd, tag);
 	  stream_putw_at (s, pos, total_attr_len);
+
+	  /* What the packet is kept for the group by. */
+	  if (group)
+	    {
+	      attr = bgp_attr_intern (adv->baa->attr);
+	      if (adv->binfo)
+		first = bgp_info_lock (adv->binfo);
+	    }
 	}
 
       if (afi == AFI_IP && safi == SAFI_UNICAST)
 	stream_put_prefix (s, &rn->p);
+      if (group)
+	taken[count++] = bgp_lock_node (rn);
       
       if (BGP_DEBUG (update, UPDATE_OUT))
         {
@@ -228,9 +308,20 @@ bgp_update_packet (struct peer *peer, afi_t afi, safi_t safi)
       bgp_packet_add (peer, packet);
       BGP_WRITE_ON (peer->t_write, bgp_write, peer->fd);
       stream_reset (s);
-      return packet;
     }
-  return NULL;
+  else
+    packet = NULL;
+
+  if (group && packet)
+    {
+      update_group_packet_add (group, packet, 0, attr, first, taken, count);
+      bgp_attr_unintern (&attr);
+      if (first)
+	bgp_info_unlock (first);
+      for (i = 0; i < count; i++)
+	bgp_unlock_node (taken[i]);
+    }
+  return packet;
 }
 
 static struct stream *
@@ -288,6 +379,14 @@ bgp_withdraw_packet (struct peer *peer, afi_t afi, safi_t safi)
   unsigned long pos;
   bgp_size_t unfeasible_len;
   bgp_size_t total_attr_len;
+  struct update_group *group = peer->update_group[afi][safi];
+  struct update_packet *up;
+  struct bgp_node *taken[BGP_MAX_PACKET_SIZE];
+  unsigned int i, count = 0;
+
+  if (group
+      && (up = update_group_packet_lookup (group, peer->sync[afi][safi], 1)))
+    return bgp_update_packet_shared (peer, afi, safi, up);
 
   s = peer->work;
   stream_reset (s);
@@ -324,6 +423,8 @@ bgp_withdraw_packet (struct peer *peer, afi_t afi, safi_t safi)
 	  /* Set total path attribute length. */
 	  stream_putw_at (s, pos, total_attr_len);
 	}
+      if (group)
+	taken[count++] = bgp_lock_node (rn);
 
       if (BGP_DEBUG (update, UPDATE_OUT))
         {
@@ -357,10 +458,15 @@ bgp_withdraw_packet (struct peer *peer, afi_t afi, safi_t safi)
       packet = stream_dup (s);
       bgp_packet_add (peer, packet);
       stream_reset (s);
-      return packet;
     }
+  else
+    packet = NULL;
 
-  return NULL;
+  if (group && packet)
+    update_group_packet_add (group, packet, 1, NULL, NULL, taken, count);
+  for (i = 0; i < count; i++)
+    bgp_unlock_node (taken[i]);
+  return packet;
 }
 
 void
@@ -509,7 +615,8 @@ bgp_default_withdraw_send (struct peer *peer, afi_t afi, safi_t safi)
   BGP_WRITE_ON (peer->t_write, bgp_write, peer->fd);
 }
 
-/* Get next packet to be written.  */
+/* Make the next packet to be written and queue it on obuf, NULL if
+   there is nothing more to send right now.  */
 static struct stream *
 bgp_write_packet (struct peer *peer)
 {
@@ -518,10 +625,6 @@ bgp_write_packet (struct peer *peer)
   struct stream *s = NULL;
   struct bgp_advertise *adv;
 
-  s = stream_fifo_head (peer->obuf);
-  if (s)
-    return s;
-
   for (afi = AFI_IP; afi < AFI_MAX; afi++)
     for (safi = SAFI_UNICAST; safi < SAFI_MAX; safi++)
       {
@@ -607,8 +710,8 @@ bgp_write (struct thread *thread)
   struct peer *peer;
   u_char type;
   struct stream *s; 
-  int num;
-  unsigned int count = 0;
+  ssize_t num;
+  unsigned int count;
 
   /* Yes first of all get peer pointer. */
   peer = THREAD_ARG (thread);
@@ -621,42 +724,48 @@ bgp_write (struct thread *thread)
       return 0;
     }
 
-  s = bgp_write_packet (peer);
-  if (!s)
+  /* Keep the I/O pthread's queue topped up.  */
+  if (peer->io)
+    {
+      while (peer->obuf->count + bgp_io_queued (peer) < BGP_IO_WRITE_MAX
+	     && bgp_write_packet (peer) != NULL)
+	;
+      bgp_io_write (peer, bgp_write_proceed (peer));
+      return 0;
+    }
+
+  /* Queue up to BGP_WRITE_PACKET_MAX packets and hand them to the
+     kernel in one go.  */
+  while (peer->obuf->count < BGP_WRITE_PACKET_MAX
+	 && bgp_write_packet (peer) != NULL)
+    ;
+  if (peer->obuf->count == 0)
     return 0;	/* nothing to send */
 
+  /* Nothing may follow a NOTIFICATION.  */
+  for (count = 0, s = stream_fifo_head (peer->obuf); s; s = s->next)
+    {
+      count++;
+      if (stream_getc_from (s, BGP_MARKER_SIZE + 2) == BGP_MSG_NOTIFY)
+	break;
+    }
+
   sockopt_cork (peer->fd, 1);
 
   /* Nonblocking write until TCP output buffer is full.  */
-  do
+  num = stream_fifo_write (peer->obuf, peer->fd, count);
+  if (num < 0 && !ERRNO_IO_RETRY (errno))
     {
-      int writenum;
-
-      /* Number of bytes to be sent.  */
-      writenum = stream_get_endp (s) - stream_get_getp (s);
-
-      /* Call write() system call.  */
-      num = write (peer->fd, STREAM_PNT (s), writenum);
-      if (num < 0)
-	{
-	  /* write failed either retry needed or error */
-	  if (ERRNO_IO_RETRY(errno))
-		break;
-
-          BGP_EVENT_ADD (peer, TCP_fatal_error);
-	  return 0;
-	}
-
-      if (num != writenum)
-	{
-	  /* Partial write */
-	  stream_forward_getp (s, num);
-	  break;
-	}
+      BGP_EVENT_ADD (peer, TCP_fatal_error);
+      return 0;
+    }
 
+  /* Account for the packets sent in full.  */
+  while ((s = stream_fifo_head (peer->obuf)) != NULL
+	 && STREAM_READABLE (s) == 0)
+    {
       /* Retrieve BGP packet type. */
-      stream_set_getp (s, BGP_MARKER_SIZE + 2);
-      type = stream_getc (s);
+      type = stream_getc_from (s, BGP_MARKER_SIZE + 2);
 
       switch (type)
 	{
@@ -693,8 +802,6 @@ bgp_write (struct thread *thread)
       /* OK we send packet so delete it. */
       bgp_packet_delete (peer);
     }
-  while (++count < BGP_WRITE_PACKET_MAX &&
-	 (s = bgp_write_packet (peer)) != NULL);
   
   if (bgp_write_proceed (peer))
     BGP_WRITE_ON (peer->t_write, bgp_write, peer->fd);
@@ -712,6 +819,9 @@ bgp_write_notify (struct peer *peer)
   u_char type;
   struct stream *s; 
 
+  /* Take the socket back from the I/O pthread. */
+  bgp_io_peer_stop (peer);
+
   /* There should be at least one packet. */
   s = stream_fifo_head (peer->obuf);
   if (!s)
@@ -1545,6 +1655,7 @@ bgp_update_receive (struct peer *peer, bgp_size_t size)
   memset (&mp_update, 0, sizeof (struct bgp_nlri));
   memset (&mp_withdraw, 0, sizeof (struct bgp_nlri));
   attr.extra = &extra;
+  attr.id = bgp_attr_id_new ();
 
   s = peer->ibuf;
   end = stream_pnt (s) + size;
@@ -2231,6 +2342,7 @@ bgp_capability_msg_parse (struct peer *peer, u_char *pnt, bgp_size_t length)
                        ? "Advertising" : "Removing",
                        ntohs(mpc.afi) , mpc.safi);
               
+          bgp_update_group_changed (peer->bgp);
           if (action == CAPABILITY_ACTION_SET)
             {
               peer->afc_recv[afi][safi] = 1;
@@ -2300,6 +2412,25 @@ bgp_capability_receive (struct peer *peer, bgp_size_t size)
   return bgp_capability_msg_parse (peer, pnt, size);
 }
 
+/* The connection to the peer failed, or was closed if event is
+   TCP_connection_closed. */
+void
+bgp_read_failed (struct peer *peer, int event)
+{
+  if (peer->status == Established) 
+    {
+      if (CHECK_FLAG (peer->sflags, PEER_STATUS_NSF_MODE))
+	{
+	  peer->last_reset = PEER_DOWN_NSF_CLOSE_SESSION;
+	  SET_FLAG (peer->sflags, PEER_STATUS_NSF_WAIT);
+	}
+      else
+	peer->last_reset = PEER_DOWN_CLOSE_SESSION;
+    }
+
+  BGP_EVENT_ADD (peer, event);
+}
+
 /* BGP read utility function. */
 static int
 bgp_read_packet (struct peer *peer)
@@ -2326,18 +2457,7 @@ bgp_read_packet (struct peer *peer)
       plog_err (peer->log, "%s [Error] bgp_read_packet error: %s",
 		 peer->host, safe_strerror (errno));
 
-      if (peer->status == Established) 
-	{
-	  if (CHECK_FLAG (peer->sflags, PEER_STATUS_NSF_MODE))
-	    {
-	      peer->last_reset = PEER_DOWN_NSF_CLOSE_SESSION;
-	      SET_FLAG (peer->sflags, PEER_STATUS_NSF_WAIT);
-	    }
-	  else
-	    peer->last_reset = PEER_DOWN_CLOSE_SESSION;
-	}
-
-      BGP_EVENT_ADD (peer, TCP_fatal_error);
+      bgp_read_failed (peer, TCP_fatal_error);
       return -1;
     }  
 
@@ -2348,18 +2468,7 @@ bgp_read_packet (struct peer *peer)
 	plog_debug (peer->log, "%s [Event] BGP connection closed fd %d",
 		   peer->host, peer->fd);
 
-      if (peer->status == Established) 
-	{
-	  if (CHECK_FLAG (peer->sflags, PEER_STATUS_NSF_MODE))
-	    {
-	      peer->last_reset = PEER_DOWN_NSF_CLOSE_SESSION;
-	      SET_FLAG (peer->sflags, PEER_STATUS_NSF_WAIT);
-	    }
-	  else
-	    peer->last_reset = PEER_DOWN_CLOSE_SESSION;
-	}
-
-      BGP_EVENT_ADD (peer, TCP_connection_closed);
+      bgp_read_failed (peer, TCP_connection_closed);
       return -1;
     }
 
@@ -2383,116 +2492,88 @@ bgp_marker_all_one (struct stream *s, int length)
   return 1;
 }
 
-/* Starting point of packet process function. */
-int
-bgp_read (struct thread *thread)
+/* Check the header at the start of peer->ibuf, sending NOTIFICATION
+   and returning -1 if it is bad.  Otherwise sets peer->packet_size to
+   the length of the message. */
+static int
+bgp_read_header (struct peer *peer)
 {
-  int ret;
   u_char type = 0;
-  struct peer *peer;
   bgp_size_t size;
   char notify_data_length[2];
 
-  /* Yes first of all get peer pointer. */
-  peer = THREAD_ARG (thread);
-  peer->t_read = NULL;
+  /* Get size and type. */
+  stream_forward_getp (peer->ibuf, BGP_MARKER_SIZE);
+  memcpy (notify_data_length, stream_pnt (peer->ibuf), 2);
+  size = stream_getw (peer->ibuf);
+  type = stream_getc (peer->ibuf);
 
-  /* For non-blocking IO check. */
-  if (peer->status == Connect)
+  if (BGP_DEBUG (normal, NORMAL) && type != 2 && type != 0)
+    zlog_debug ("%s rcv message type %d, length (excl. header) %d",
+	       peer->host, type, size - BGP_HEADER_SIZE);
+
+  /* Marker check */
+  if (((type == BGP_MSG_OPEN) || (type == BGP_MSG_KEEPALIVE))
+      && ! bgp_marker_all_one (peer->ibuf, BGP_MARKER_SIZE))
     {
-      bgp_connect_check (peer);
-      goto done;
+      bgp_notify_send (peer,
+		       BGP_NOTIFY_HEADER_ERR, 
+		       BGP_NOTIFY_HEADER_NOT_SYNC);
+      return -1;
     }
-  else
+
+  /* BGP type check. */
+  if (type != BGP_MSG_OPEN && type != BGP_MSG_UPDATE 
+      && type != BGP_MSG_NOTIFY && type != BGP_MSG_KEEPALIVE 
+      && type != BGP_MSG_ROUTE_REFRESH_NEW
+      && type != BGP_MSG_ROUTE_REFRESH_OLD
+      && type != BGP_MSG_CAPABILITY)
     {
-      if (peer->fd < 0)
-	{
-	  zlog_err ("bgp_read peer's fd is negative value %d", peer->fd);
-	  return -1;
-	}
-      BGP_READ_ON (peer->t_read, bgp_read, peer->fd);
+      if (BGP_DEBUG (normal, NORMAL))
+	plog_debug (peer->log,
+		  "%s unknown message type 0x%02x",
+		  peer->host, type);
+      bgp_notify_send_with_data (peer,
+				 BGP_NOTIFY_HEADER_ERR,
+				 BGP_NOTIFY_HEADER_BAD_MESTYPE,
+				 &type, 1);
+      return -1;
     }
-
-  /* Read packet header to determine type of the packet */
-  if (peer->packet_size == 0)
-    peer->packet_size = BGP_HEADER_SIZE;
-
-  if (stream_get_endp (peer->ibuf) < BGP_HEADER_SIZE)
+  /* Mimimum packet length check. */
+  if ((size < BGP_HEADER_SIZE)
+      || (size > BGP_MAX_PACKET_SIZE)
+      || (type == BGP_MSG_OPEN && size < BGP_MSG_OPEN_MIN_SIZE)
+      || (type == BGP_MSG_UPDATE && size < BGP_MSG_UPDATE_MIN_SIZE)
+      || (type == BGP_MSG_NOTIFY && size < BGP_MSG_NOTIFY_MIN_SIZE)
+      || (type == BGP_MSG_KEEPALIVE && size != BGP_MSG_KEEPALIVE_MIN_SIZE)
+      || (type == BGP_MSG_ROUTE_REFRESH_NEW && size < BGP_MSG_ROUTE_REFRESH_MIN_SIZE)
+      || (type == BGP_MSG_ROUTE_REFRESH_OLD && size < BGP_MSG_ROUTE_REFRESH_MIN_SIZE)
+      || (type == BGP_MSG_CAPABILITY && size < BGP_MSG_CAPABILITY_MIN_SIZE))
     {
-      ret = bgp_read_packet (peer);
-
-      /* Header read error or partial read packet. */
-      if (ret < 0) 
-	goto done;
-
-      /* Get size and type. */
-      stream_forward_getp (peer->ibuf, BGP_MARKER_SIZE);
-      memcpy (notify_data_length, stream_pnt (peer->ibuf), 2);
-      size = stream_getw (peer->ibuf);
-      type = stream_getc (peer->ibuf);
-
-      if (BGP_DEBUG (normal, NORMAL) && type != 2 && type != 0)
-	zlog_debug ("%s rcv message type %d, length (excl. header) %d",
-		   peer->host, type, size - BGP_HEADER_SIZE);
-
-      /* Marker check */
-      if (((type == BGP_MSG_OPEN) || (type == BGP_MSG_KEEPALIVE))
-	  && ! bgp_marker_all_one (peer->ibuf, BGP_MARKER_SIZE))
-	{
-	  bgp_notify_send (peer,
-			   BGP_NOTIFY_HEADER_ERR, 
-			   BGP_NOTIFY_HEADER_NOT_SYNC);
-	  goto done;
-	}
-
-      /* BGP type check. */
-      if (type != BGP_MSG_OPEN && type != BGP_MSG_UPDATE 
-	  && type != BGP_MSG_NOTIFY && type != BGP_MSG_KEEPALIVE 
-	  && type != BGP_MSG_ROUTE_REFRESH_NEW
-	  && type != BGP_MSG_ROUTE_REFRESH_OLD
-	  && type != BGP_MSG_CAPABILITY)
-	{
-	  if (BGP_DEBUG (normal, NORMAL))
-	    plog_debug (peer->log,
-		      "%s unknown message type 0x%02x",
-		      peer->host, type);
-	  bgp_notify_send_with_data (peer,
-				     BGP_NOTIFY_HEADER_ERR,
-			 	     BGP_NOTIFY_HEADER_BAD_MESTYPE,
-				     &type, 1);
-	  goto done;
-	}
-      /* Mimimum packet length check. */
-      if ((size < BGP_HEADER_SIZE)
-	  || (size > BGP_MAX_PACKET_SIZE)
-	  || (type == BGP_MSG_OPEN && size < BGP_MSG_OPEN_MIN_SIZE)
-	  || (type == BGP_MSG_UPDATE && size < BGP_MSG_UPDATE_MIN_SIZE)
-	  || (type == BGP_MSG_NOTIFY && size < BGP_MSG_NOTIFY_MIN_SIZE)
-	  || (type == BGP_MSG_KEEPALIVE && size != BGP_MSG_KEEPALIVE_MIN_SIZE)
-	  || (type == BGP_MSG_ROUTE_REFRESH_NEW && size < BGP_MSG_ROUTE_REFRESH_MIN_SIZE)
-	  || (type == BGP_MSG_ROUTE_REFRESH_OLD && size < BGP_MSG_ROUTE_REFRESH_MIN_SIZE)
-	  || (type == BGP_MSG_CAPABILITY && size < BGP_MSG_CAPABILITY_MIN_SIZE))
-	{
-	  if (BGP_DEBUG (normal, NORMAL))
-	    plog_debug (peer->log,
-		      "%s bad message length - %d for %s",
-		      peer->host, size, 
-		      type == 128 ? "ROUTE-REFRESH" :
-		      bgp_type_str[(int) type]);
-	  bgp_notify_send_with_data (peer,
-				     BGP_NOTIFY_HEADER_ERR,
-			  	     BGP_NOTIFY_HEADER_BAD_MESLEN,
-				     (u_char *) notify_data_length, 2);
-	  goto done;
-	}
-
-      /* Adjust size to message length. */
-      peer->packet_size = size;
+      if (BGP_DEBUG (normal, NORMAL))
+	plog_debug (peer->log,
+		  "%s bad message length - %d for %s",
+		  peer->host, size, 
+		  type == 128 ? "ROUTE-REFRESH" :
+		  bgp_type_str[(int) type]);
+      bgp_notify_send_with_data (peer,
+				 BGP_NOTIFY_HEADER_ERR,
+				 BGP_NOTIFY_HEADER_BAD_MESLEN,
+				 (u_char *) notify_data_length, 2);
+      return -1;
     }
 
-  ret = bgp_read_packet (peer);
-  if (ret < 0) 
-    goto done;
+  /* Adjust size to message length. */
+  peer->packet_size = size;
+  return 0;
+}
+
+/* Take the whole message in peer->ibuf. */
+static void
+bgp_read_dispatch (struct peer *peer)
+{
+  u_char type;
+  bgp_size_t size;
 
   /* Get size and type again. */
   size = stream_getw_from (peer->ibuf, BGP_MARKER_SIZE);
@@ -2536,6 +2617,66 @@ bgp_read (struct thread *thread)
   peer->packet_size = 0;
   if (peer->ibuf)
     stream_reset (peer->ibuf);
+}
+
+/* Take a whole message the I/O pthread read from the peer. */
+void
+bgp_read_message (struct peer *peer, u_char *data, size_t size)
+{
+  stream_reset (peer->ibuf);
+  stream_put (peer->ibuf, data, size);
+  if (bgp_read_header (peer) == 0)
+    bgp_read_dispatch (peer);
+}
+
+/* Starting point of packet process function. */
+int
+bgp_read (struct thread *thread)
+{
+  int ret;
+  struct peer *peer;
+
+  /* Yes first of all get peer pointer. */
+  peer = THREAD_ARG (thread);
+  peer->t_read = NULL;
+
+  /* For non-blocking IO check. */
+  if (peer->status == Connect)
+    {
+      bgp_connect_check (peer);
+      goto done;
+    }
+  else
+    {
+      if (peer->fd < 0)
+	{
+	  zlog_err ("bgp_read peer's fd is negative value %d", peer->fd);
+	  return -1;
+	}
+      BGP_READ_ON (peer->t_read, bgp_read, peer->fd);
+    }
+
+  /* Read packet header to determine type of the packet */
+  if (peer->packet_size == 0)
+    peer->packet_size = BGP_HEADER_SIZE;
+
+  if (stream_get_endp (peer->ibuf) < BGP_HEADER_SIZE)
+    {
+      ret = bgp_read_packet (peer);
+
+      /* Header read error or partial read packet. */
+      if (ret < 0) 
+	goto done;
+
+      if (bgp_read_header (peer) < 0)
+	goto done;
+    }
+
+  ret = bgp_read_packet (peer);
+  if (ret < 0) 
+    goto done;
+
+  bgp_read_dispatch (peer);
 
  done:
   if (CHECK_FLAG (peer->sflags, PEER_STATUS_ACCEPT_PEER))
@@ -40,6 +40,8 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 /* Packet send and receive function prototypes. */
 extern int bgp_read (struct thread *);
 extern int bgp_write (struct thread *);
+extern void bgp_read_message (struct peer *, u_char *, size_t);
+extern void bgp_read_failed (struct peer *, int);
 
 extern void bgp_keepalive_send (struct peer *);
 extern void bgp_open_send (struct peer *);
@@ -55,6 +55,9 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 #include "bgpd/bgp_zebra.h"
 #include "bgpd/bgp_vty.h"
 #include "bgpd/bgp_mpath.h"
+#include "bgpd/bgp_dump.h"
+#include "bgpd/bgp_updgrp.h"
+#include "bgpd/bgp_select.h"
 
 /* Extern from bgp_dump.c */
 extern const char *bgp_origin_str[];
@@ -140,6 +143,7 @@ bgp_info_free (struct bgp_info *binfo)
   if (binfo->attr)
     bgp_attr_unintern (&binfo->attr);
   
+  bgp_nexthop_untrack (binfo);
   bgp_info_extra_free (&binfo->extra);
   bgp_info_mpath_free (&binfo->mpath);
 
@@ -667,6 +671,23 @@ bgp_cluster_filter (struct peer *peer, struct attr *attr)
   return 0;
 }
 
+/* Route-map cache key of a route: routes with equal attributes share
+   the results of the match clauses which look at nothing else. */
+static unsigned long
+bgp_info_cache_key (void *object)
+{
+  return bgp_attr_cache_key (((struct bgp_info *) object)->attr);
+}
+
+/* The same for a route as received, whose attributes are a copy of
+   those of its UPDATE, or of the interned ones for soft
+   reconfiguration, with only the weight set since. */
+static unsigned long
+bgp_info_received_key (void *object)
+{
+  return ((struct bgp_info *) object)->attr->id;
+}
+
 static int
 bgp_input_modifier (struct peer *peer, struct prefix *p, struct attr *attr,
 		    afi_t afi, safi_t safi)
@@ -691,7 +712,8 @@ bgp_input_modifier (struct peer *peer, struct prefix *p, struct attr *attr,
       SET_FLAG (peer->rmap_type, PEER_RMAP_TYPE_IN); 
 
       /* Apply BGP route map to the attribute. */
-      ret = route_map_apply (ROUTE_MAP_IN (filter), p, RMAP_BGP, &info);
+      ret = route_map_apply_cached (ROUTE_MAP_IN (filter), p, RMAP_BGP,
+				    &info, bgp_info_received_key);
 
       peer->rmap_type = 0;
 
@@ -725,7 +747,8 @@ bgp_export_modifier (struct peer *rsclient, struct peer *peer,
       SET_FLAG (rsclient->rmap_type, PEER_RMAP_TYPE_EXPORT);
 
       /* Apply BGP route map to the attribute. */
-      ret = route_map_apply (ROUTE_MAP_EXPORT (filter), p, RMAP_BGP, &info);
+      ret = route_map_apply_cached (ROUTE_MAP_EXPORT (filter), p, RMAP_BGP,
+				    &info, bgp_info_cache_key);
 
       rsclient->rmap_type = 0;
 
@@ -763,7 +786,8 @@ bgp_import_modifier (struct peer *rsclient, struct peer *peer,
       SET_FLAG (peer->rmap_type, PEER_RMAP_TYPE_IMPORT);
 
       /* Apply BGP route map to the attribute. */
-      ret = route_map_apply (ROUTE_MAP_IMPORT (filter), p, RMAP_BGP, &info);
+      ret = route_map_apply_cached (ROUTE_MAP_IMPORT (filter), p, RMAP_BGP,
+				    &info, bgp_info_cache_key);
 
       peer->rmap_type = 0;
 
@@ -777,33 +801,19 @@ bgp_import_modifier (struct peer *rsclient, struct peer *peer,
   return RMAP_PERMIT;
 }
 
+/* The checks of bgp_announce_check() on what tells the members of an
+   update group apart.  They only ever hold the route back. */
 static int
-bgp_announce_check (struct bgp_info *ri, struct peer *peer, struct prefix *p,
-		    struct attr *attr, afi_t afi, safi_t safi)
+bgp_announce_check_peer (struct bgp_info *ri, struct peer *peer,
+			 struct prefix *p, afi_t afi, safi_t safi)
 {
-  int ret;
   char buf[SU_ADDRSTRLEN];
-  struct bgp_filter *filter;
-  struct peer *from;
-  struct bgp *bgp;
-  int transparent;
-  int reflect;
   struct attr *riattr;
 
-  from = ri->peer;
-  filter = &peer->filter[afi][safi];
-  bgp = peer->bgp;
   riattr = bgp_info_mpath_count (ri) ? bgp_info_mpath_attr (ri) : ri->attr;
-  
-  if (DISABLE_BGP_ANNOUNCE)
-    return 0;
-
-  /* Do not send announces to RS-clients from the 'normal' bgp_table. */
-  if (CHECK_FLAG(peer->af_flags[afi][safi], PEER_FLAG_RSERVER_CLIENT))
-    return 0;
 
   /* Do not send back route to sender. */
-  if (from == peer)
+  if (ri->peer == peer)
     return 0;
 
   /* If peer's id and route's nexthop are same. draft-ietf-idr-bgp4-23 5.1.3 */
@@ -816,11 +826,6 @@ bgp_announce_check (struct bgp_info *ri, struct peer *peer, struct prefix *p,
     return 0;
 #endif
 
-  /* Aggregate-address suppress check. */
-  if (ri->extra && ri->extra->suppress)
-    if (! UNSUPPRESS_MAP_NAME (filter))
-      return 0;
-
   /* Default route check.  */
   if (CHECK_FLAG (peer->af_sflags[afi][safi], PEER_STATUS_DEFAULT_ORIGINATE))
     {
@@ -832,17 +837,6 @@ bgp_announce_check (struct bgp_info *ri, struct peer *peer, struct prefix *p,
 #endif /* HAVE_IPV6 */
     }
 
-  /* Transparency check. */
-  if (CHECK_FLAG (peer->af_flags[afi][safi], PEER_FLAG_RSERVER_CLIENT)
-      && CHECK_FLAG (from->af_flags[afi][safi], PEER_FLAG_RSERVER_CLIENT))
-    transparent = 1;
-  else
-    transparent = 0;
-
-  /* If community is not disabled check the no-export and local. */
-  if (! transparent && bgp_community_filter (peer, riattr))
-    return 0;
-
   /* If the attribute has originator-id and it is same as remote
      peer's id. */
   if (riattr->flag & ATTR_FLAG_BIT (BGP_ATTR_ORIGINATOR_ID))
@@ -868,6 +862,45 @@ bgp_announce_check (struct bgp_info *ri, struct peer *peer, struct prefix *p,
 	if (prefix_list_apply (peer->orf_plist[afi][safi], p) == PREFIX_DENY)
           return 0;
       }
+  return 1;
+}
+
+/* The rest of bgp_announce_check(), run once for an update group
+   against its first member.  */
+static int
+bgp_announce_check_policy (struct bgp_info *ri, struct peer *peer,
+			   struct prefix *p, struct attr *attr,
+			   afi_t afi, safi_t safi)
+{
+  int ret;
+  char buf[SU_ADDRSTRLEN];
+  struct bgp_filter *filter;
+  struct peer *from;
+  struct bgp *bgp;
+  int transparent;
+  int reflect;
+  struct attr *riattr;
+
+  from = ri->peer;
+  filter = &peer->filter[afi][safi];
+  bgp = peer->bgp;
+  riattr = bgp_info_mpath_count (ri) ? bgp_info_mpath_attr (ri) : ri->attr;
+
+  /* Aggregate-address suppress check. */
+  if (ri->extra && ri->extra->suppress)
+    if (! UNSUPPRESS_MAP_NAME (filter))
+      return 0;
+
+  /* Transparency check. */
+  if (CHECK_FLAG (peer->af_flags[afi][safi], PEER_FLAG_RSERVER_CLIENT)
+      && CHECK_FLAG (from->af_flags[afi][safi], PEER_FLAG_RSERVER_CLIENT))
+    transparent = 1;
+  else
+    transparent = 0;
+
+  /* If community is not disabled check the no-export and local. */
+  if (! transparent && bgp_community_filter (peer, riattr))
+    return 0;
 
   /* Output filter check. */
   if (bgp_output_filter (peer, p, riattr, afi, safi) == FILTER_DENY)
@@ -1071,9 +1104,11 @@ bgp_announce_check (struct bgp_info *ri, struct peer *peer, struct prefix *p,
       SET_FLAG (peer->rmap_type, PEER_RMAP_TYPE_OUT); 
 
       if (ri->extra && ri->extra->suppress)
-	ret = route_map_apply (UNSUPPRESS_MAP (filter), p, RMAP_BGP, &info);
+	ret = route_map_apply_cached (UNSUPPRESS_MAP (filter), p, RMAP_BGP,
+				      &info, bgp_info_cache_key);
       else
-	ret = route_map_apply (ROUTE_MAP_OUT (filter), p, RMAP_BGP, &info);
+	ret = route_map_apply_cached (ROUTE_MAP_OUT (filter), p, RMAP_BGP,
+				      &info, bgp_info_cache_key);
 
       peer->rmap_type = 0;
 
@@ -1086,6 +1121,22 @@ bgp_announce_check (struct bgp_info *ri, struct peer *peer, struct prefix *p,
   return 1;
 }
 
+static int
+bgp_announce_check (struct bgp_info *ri, struct peer *peer, struct prefix *p,
+		    struct attr *attr, afi_t afi, safi_t safi)
+{
+  if (DISABLE_BGP_ANNOUNCE)
+    return 0;
+
+  /* Do not send announces to RS-clients from the 'normal' bgp_table. */
+  if (CHECK_FLAG(peer->af_flags[afi][safi], PEER_FLAG_RSERVER_CLIENT))
+    return 0;
+
+  if (! bgp_announce_check_peer (ri, peer, p, afi, safi))
+    return 0;
+  return bgp_announce_check_policy (ri, peer, p, attr, afi, safi);
+}
+
 static int
 bgp_announce_check_rsclient (struct bgp_info *ri, struct peer *rsclient,
         struct prefix *p, struct attr *attr, afi_t afi, safi_t safi)
@@ -1268,9 +1319,11 @@ bgp_announce_check_rsclient (struct bgp_info *ri, struct peer *rsclient,
       SET_FLAG (rsclient->rmap_type, PEER_RMAP_TYPE_OUT);
 
       if (ri->extra && ri->extra->suppress)
-        ret = route_map_apply (UNSUPPRESS_MAP (filter), p, RMAP_BGP, &info);
+        ret = route_map_apply_cached (UNSUPPRESS_MAP (filter), p, RMAP_BGP,
+				      &info, bgp_info_cache_key);
       else
-        ret = route_map_apply (ROUTE_MAP_OUT (filter), p, RMAP_BGP, &info);
+        ret = route_map_apply_cached (ROUTE_MAP_OUT (filter), p, RMAP_BGP,
+				      &info, bgp_info_cache_key);
 
       rsclient->rmap_type = 0;
 
@@ -1290,10 +1343,14 @@ struct bgp_info_pair
   struct bgp_info *new;
 };
 
+/* Selects the best path of the node, and its multipaths.  With ahead
+   set this may run in a selection pthread (bgp_select.h), so touches
+   nothing but the node's paths: reaping and the multipath aggregate
+   are left to bgp_best_selection_finish() on the main thread. */
 static void
-bgp_best_selection (struct bgp *bgp, struct bgp_node *rn,
-		    struct bgp_maxpaths_cfg *mpath_cfg,
-		    struct bgp_info_pair *result)
+bgp_best_selection_run (struct bgp *bgp, struct bgp_node *rn,
+			struct bgp_maxpaths_cfg *mpath_cfg,
+			struct bgp_info_pair *result, int ahead)
 {
   struct bgp_info *new_select;
   struct bgp_info *old_select;
@@ -1374,7 +1431,7 @@ bgp_best_selection (struct bgp *bgp, struct bgp_node *rn,
            * selected route must stay for a while longer though
            */
           if (CHECK_FLAG (ri->flags, BGP_INFO_REMOVED)
-              && (ri != old_select))
+              && (ri != old_select) && ! ahead)
               bgp_info_reap (rn, ri);
           
           continue;
@@ -1413,7 +1470,8 @@ bgp_best_selection (struct bgp *bgp, struct bgp_node *rn,
   if (!bgp_flag_check (bgp, BGP_FLAG_DETERMINISTIC_MED))
     bgp_info_mpath_update (rn, new_select, old_select, &mp_list, mpath_cfg);
 
-  bgp_info_mpath_aggregate_update (new_select, old_select);
+  if (! ahead)
+    bgp_info_mpath_aggregate_update (new_select, old_select);
   bgp_mp_list_clear (&mp_list);
 
   result->old = old_select;
@@ -1422,6 +1480,32 @@ bgp_best_selection (struct bgp *bgp, struct bgp_node *rn,
   return;
 }
 
+/* The rest of a selection made ahead. */
+static void
+bgp_best_selection_finish (struct bgp_node *rn, struct bgp_info_pair *result)
+{
+  struct bgp_info *ri;
+  struct bgp_info *nextri;
+
+  for (ri = rn->info; ri; ri = nextri)
+    {
+      nextri = ri->next;
+      if (BGP_INFO_HOLDDOWN (ri) && CHECK_FLAG (ri->flags, BGP_INFO_REMOVED)
+	  && ri != result->old)
+	bgp_info_reap (rn, ri);
+    }
+
+  bgp_info_mpath_aggregate_update (result->new, result->old);
+}
+
+static void
+bgp_best_selection (struct bgp *bgp, struct bgp_node *rn,
+		    struct bgp_maxpaths_cfg *mpath_cfg,
+		    struct bgp_info_pair *result)
+{
+  bgp_best_selection_run (bgp, rn, mpath_cfg, result, 0);
+}
+
 static int
 bgp_process_announce_selected (struct peer *peer, struct bgp_info *selected,
                                struct bgp_node *rn, afi_t afi, safi_t safi)
@@ -1472,14 +1556,101 @@ bgp_process_announce_selected (struct peer *peer, struct bgp_info *selected,
   return 0;
 }
 
+/* bgp_process_announce_selected() for the members of an update group,
+   running the policy once, against the first of them. */
+static void
+bgp_process_announce_group (struct update_group *group,
+			    struct bgp_info *selected, struct bgp_node *rn,
+			    afi_t afi, safi_t safi)
+{
+  struct listnode *node, *nnode;
+  struct peer *peer;
+  struct prefix *p;
+  struct attr attr;
+  struct attr_extra extra;
+  int announce = 0;
+
+  p = &rn->p;
+  attr.extra = &extra;
+
+  if (selected && ! DISABLE_BGP_ANNOUNCE)
+    {
+      announce = bgp_announce_check_policy (selected, group->conf, p, &attr,
+					    afi, safi);
+      group->policy++;
+      group->spared += listcount (group->peer) - 1;
+    }
+
+  for (ALL_LIST_ELEMENTS (group->peer, node, nnode, peer))
+    {
+      if (peer->status != Established
+	  || ! peer->afc_nego[afi][safi]
+	  || CHECK_FLAG (peer->af_sflags[afi][safi],
+			 PEER_STATUS_ORF_WAIT_REFRESH))
+	continue;
+
+      if (announce && bgp_announce_check_peer (selected, peer, p, afi, safi))
+	bgp_adj_out_set (rn, peer, p, &attr, afi, safi, selected);
+      else
+	bgp_adj_out_unset (rn, peer, p, afi, safi);
+    }
+
+  /* What no member interned. */
+  if (announce)
+    bgp_attr_flush (&attr);
+}
+
 struct bgp_process_queue 
 {
   struct bgp *bgp;
   struct bgp_node *rn;
   afi_t afi;
   safi_t safi;
+
+  /* Made ahead, good while rn has BGP_NODE_PROCESS_SELECTED.  The
+     node may be queued more than once, the first of them has it. */
+  int ahead;
+  struct bgp_info_pair selected;
 };
 
+/* Nodes at the head of the process queue selected ahead at once. */
+#define BGP_PROCESS_AHEAD	4096
+
+/* Runs in a selection pthread, or the main thread. */
+static void
+bgp_process_select (void *data)
+{
+  struct bgp_process_queue *pq = data;
+
+  bgp_best_selection_run (pq->bgp, pq->rn,
+			  &pq->bgp->maxpaths[pq->afi][pq->safi],
+			  &pq->selected, 1);
+}
+
+/* Selects the best paths of the nodes at the head of the queue not
+   yet selected, shared out between the selection pthreads.  Each node
+   just the once, so no two pthreads have the same one. */
+static void
+bgp_process_select_ahead (struct work_queue *wq)
+{
+  void *items[BGP_PROCESS_AHEAD];
+  struct bgp_process_queue *pq;
+  unsigned int count, n, i;
+
+  count = work_queue_peek (wq, items, BGP_PROCESS_AHEAD);
+  for (i = n = 0; i < count; i++)
+    {
+      pq = items[i];
+      if (CHECK_FLAG (pq->rn->flags, BGP_NODE_PROCESS_SELECTED))
+	continue;
+      SET_FLAG (pq->rn->flags, BGP_NODE_PROCESS_SELECTED);
+      pq->ahead = 1;
+      items[n++] = pq;
+    }
+
+  bgp_select_run (items, n, bgp_process_select);
+}
+
 static wq_item_status
 bgp_process_rsclient (struct work_queue *wq, void *data)
 {
@@ -1556,9 +1727,21 @@ bgp_process_main (struct work_queue *wq, void *data)
   struct bgp_info_pair old_and_new;
   struct listnode *node, *nnode;
   struct peer *peer;
+  struct update_group *group;
   
-  /* Best path selection. */
-  bgp_best_selection (bgp, rn, &bgp->maxpaths[afi][safi], &old_and_new);
+  /* Best path selection, perhaps made ahead. */
+  if (bgp_select_threads ()
+      && ! CHECK_FLAG (rn->flags, BGP_NODE_PROCESS_SELECTED))
+    bgp_process_select_ahead (wq);
+
+  if (pq->ahead && CHECK_FLAG (rn->flags, BGP_NODE_PROCESS_SELECTED))
+    {
+      old_and_new = pq->selected;
+      bgp_best_selection_finish (rn, &old_and_new);
+      UNSET_FLAG (rn->flags, BGP_NODE_PROCESS_SELECTED);
+    }
+  else
+    bgp_best_selection (bgp, rn, &bgp->maxpaths[afi][safi], &old_and_new);
   old_select = old_and_new.old;
   new_select = old_and_new.new;
 
@@ -1571,6 +1754,7 @@ bgp_process_main (struct work_queue *wq, void *data)
 	      CHECK_FLAG (old_select->flags, BGP_INFO_MULTIPATH_CHG))
             bgp_zebra_announce (p, old_select, bgp, safi);
           
+	  UNSET_FLAG (old_select->flags, BGP_INFO_IGP_CHANGED);
 	  UNSET_FLAG (old_select->flags, BGP_INFO_MULTIPATH_CHG);
           UNSET_FLAG (rn->flags, BGP_NODE_PROCESS_SCHEDULED);
           return WQ_SUCCESS;
@@ -1583,15 +1767,20 @@ bgp_process_main (struct work_queue *wq, void *data)
     {
       bgp_info_set_flag (rn, new_select, BGP_INFO_SELECTED);
       bgp_info_unset_flag (rn, new_select, BGP_INFO_ATTR_CHANGED);
+      UNSET_FLAG (new_select->flags, BGP_INFO_IGP_CHANGED);
       UNSET_FLAG (new_select->flags, BGP_INFO_MULTIPATH_CHG);
     }
 
 
-  /* Check each BGP peer. */
+  /* Check each BGP peer, those in update groups a group at a time. */
+  bgp_update_groups_sync (bgp);
   for (ALL_LIST_ELEMENTS (bgp->peer, node, nnode, peer))
     {
-      bgp_process_announce_selected (peer, new_select, rn, afi, safi);
+      if (! peer->update_group[afi][safi])
+	bgp_process_announce_selected (peer, new_select, rn, afi, safi);
     }
+  for (ALL_LIST_ELEMENTS (bgp->update_groups[afi][safi], node, nnode, group))
+    bgp_process_announce_group (group, new_select, rn, afi, safi);
 
   /* FIB update. */
   if ((safi == SAFI_UNICAST || safi == SAFI_MULTICAST) && (! bgp->name &&
@@ -1660,6 +1849,9 @@ bgp_process (struct bgp *bgp, struct bgp_node *rn, afi_t afi, safi_t safi)
 {
   struct bgp_process_queue *pqnode;
   
+  /* Anything selected ahead is out of date now. */
+  UNSET_FLAG (rn->flags, BGP_NODE_PROCESS_SELECTED);
+
   /* already scheduled for processing? */
   if (CHECK_FLAG (rn->flags, BGP_NODE_PROCESS_SCHEDULED))
     return;
@@ -2268,21 +2460,22 @@ bgp_update_main (struct peer *peer, struct prefix *p, struct attr *attr,
 	    }
 	}
 
-      /* Nexthop reachability check. */
+      /* Nexthop reachability check, or for a directly connected EBGP
+	 peer whether it is on a connected network.  Either is looked at
+	 again as it changes. */
       if ((afi == AFI_IP || afi == AFI_IP6)
-	  && safi == SAFI_UNICAST 
-	  && (peer->sort == BGP_PEER_IBGP
-              || peer->sort == BGP_PEER_CONFED
-	      || (peer->sort == BGP_PEER_EBGP && peer->ttl != 1)
-	      || CHECK_FLAG (peer->flags, PEER_FLAG_DISABLE_CONNECTED_CHECK)))
+	  && safi == SAFI_UNICAST)
 	{
-	  if (bgp_nexthop_lookup (afi, peer, ri, NULL, NULL))
+	  if (bgp_nexthop_lookup (afi, rn, ri))
 	    bgp_info_set_flag (rn, ri, BGP_INFO_VALID);
 	  else
 	    bgp_info_unset_flag (rn, ri, BGP_INFO_VALID);
 	}
       else
-        bgp_info_set_flag (rn, ri, BGP_INFO_VALID);
+        {
+          bgp_nexthop_untrack (ri);
+          bgp_info_set_flag (rn, ri, BGP_INFO_VALID);
+        }
 
       /* Process change. */
       bgp_aggregate_increment (bgp, p, ri, afi, safi);
@@ -2314,15 +2507,11 @@ bgp_update_main (struct peer *peer, struct prefix *p, struct attr *attr,
   if (safi == SAFI_MPLS_VPN)
     memcpy ((bgp_info_extra_get (new))->tag, tag, 3);
 
-  /* Nexthop reachability check. */
+  /* Nexthop reachability check, as above. */
   if ((afi == AFI_IP || afi == AFI_IP6)
-      && safi == SAFI_UNICAST
-      && (peer->sort == BGP_PEER_IBGP
-          || peer->sort == BGP_PEER_CONFED
-	  || (peer->sort == BGP_PEER_EBGP && peer->ttl != 1)
-	  || CHECK_FLAG (peer->flags, PEER_FLAG_DISABLE_CONNECTED_CHECK)))
+      && safi == SAFI_UNICAST)
     {
-      if (bgp_nexthop_lookup (afi, peer, new, NULL, NULL))
+      if (bgp_nexthop_lookup (afi, rn, new))
 	bgp_info_set_flag (rn, new, BGP_INFO_VALID);
       else
         bgp_info_unset_flag (rn, new, BGP_INFO_VALID);
@@ -5681,6 +5870,61 @@ route_vty_out (struct vty *vty, struct prefix *p,
   vty_out (vty, "%s", VTY_NEWLINE);
 }  
 
+/* Prints the path as a JSON object, for "show ip bgp json". */
+static void
+route_vty_out_json (struct vty *vty, struct prefix *p, struct bgp_info *binfo)
+{
+  struct attr *attr = binfo->attr;
+  char buf[INET6_ADDRSTRLEN];
+
+  /* The states only when they are so. */
+  vty_out (vty, "{");
+  if (CHECK_FLAG (binfo->flags, BGP_INFO_VALID))
+    vty_out (vty, "\"valid\":true,");
+  if (CHECK_FLAG (binfo->flags, BGP_INFO_SELECTED))
+    vty_out (vty, "\"best\":true,");
+  if (binfo->peer->as && binfo->peer->as == binfo->peer->local_as)
+    vty_out (vty, "\"internal\":true,");
+  if (CHECK_FLAG (binfo->flags, BGP_INFO_MULTIPATH))
+    vty_out (vty, "\"multipath\":true,");
+  if (binfo->extra && binfo->extra->suppress)
+    vty_out (vty, "\"suppressed\":true,");
+  if (CHECK_FLAG (binfo->flags, BGP_INFO_DAMPED))
+    vty_out (vty, "\"damped\":true,");
+  if (CHECK_FLAG (binfo->flags, BGP_INFO_HISTORY))
+    vty_out (vty, "\"history\":true,");
+  if (CHECK_FLAG (binfo->flags, BGP_INFO_STALE))
+    vty_out (vty, "\"stale\":true,");
+  if (CHECK_FLAG (binfo->flags, BGP_INFO_REMOVED))
+    vty_out (vty, "\"removed\":true,");
+
+  vty_out (vty, "\"peer\":\"%s\"", binfo->peer->host);
+
+  if (attr)
+    {
+      if (p->family == AF_INET)
+	vty_out (vty, ",\"nexthop\":\"%s\"", inet_ntoa (attr->nexthop));
+#ifdef HAVE_IPV6
+      else if (p->family == AF_INET6 && attr->extra)
+	vty_out (vty, ",\"nexthop\":\"%s\"",
+		 inet_ntop (AF_INET6, &attr->extra->mp_nexthop_global,
+			    buf, sizeof (buf)));
+#endif /* HAVE_IPV6 */
+
+      if (attr->flag & ATTR_FLAG_BIT (BGP_ATTR_MULTI_EXIT_DISC))
+	vty_out (vty, ",\"med\":%u", attr->med);
+      if (attr->flag & ATTR_FLAG_BIT (BGP_ATTR_LOCAL_PREF))
+	vty_out (vty, ",\"localPref\":%u", attr->local_pref);
+
+      /* AS paths are digits, spaces and brackets, nothing to escape. */
+      vty_out (vty, ",\"weight\":%u,\"path\":\"%s\",\"origin\":\"%s\"",
+	       (attr->extra ? attr->extra->weight : 0),
+	       attr->aspath ? aspath_print (attr->aspath) : "",
+	       bgp_origin_long_str[attr->origin]);
+    }
+  vty_out (vty, "}");
+}
+
 /* called from terminal list command */
 void
 route_vty_out_tmp (struct vty *vty, struct prefix *p,
@@ -6124,23 +6368,65 @@ enum bgp_show_type
   bgp_show_type_damp_neighbor
 };
 
+/* Where "show ip bgp" is in the table between the pieces of output. */
+struct bgp_show_cursor
+{
+  struct bgp_table *table;
+  struct bgp_node *rn;		/* next to show, locked */
+  struct in_addr router_id;
+  enum bgp_show_type type;
+  void *output_arg;
+
+  /* Copy of what output_arg points to, when that is kept here. */
+  union
+  {
+    struct prefix p;
+    union sockunion su;
+  } arg;
+
+  int header;
+  unsigned long output_count;
+
+  /* For "show ip bgp binary". */
+  struct bgp *bgp;		/* locked */
+  afi_t afi;
+  struct stream *s;		/* MRT record being given */
+  unsigned int peer_version;	/* of the peer index table given */
+};
+
+static void
+bgp_show_cursor_free (void *arg)
+{
+  struct bgp_show_cursor *cursor = arg;
+
+  if (cursor->rn)
+    bgp_unlock_node (cursor->rn);
+  bgp_table_unlock (cursor->table);
+  if (cursor->bgp)
+    bgp_unlock (cursor->bgp);
+  if (cursor->s)
+    stream_free (cursor->s);
+  XFREE (MTYPE_BGP_SHOW, cursor);
+}
+
+/* Shows the routes of the next VTY_OUTPUT_ENTRIES prefixes, returning 1
+   while there are more. */
 static int
-bgp_show_table (struct vty *vty, struct bgp_table *table, struct in_addr *router_id,
-	  enum bgp_show_type type, void *output_arg)
+bgp_show_table_next (struct vty *vty, void *arg)
 {
+  struct bgp_show_cursor *cursor = arg;
+  enum bgp_show_type type = cursor->type;
+  void *output_arg = cursor->output_arg;
   struct bgp_info *ri;
   struct bgp_node *rn;
-  int header = 1;
   int display;
-  unsigned long output_count;
-
-  /* This is first entry point, so reset total line. */
-  output_count = 0;
+  int entries = 0;
 
-  /* Start processing of routes. */
-  for (rn = bgp_table_top (table); rn; rn = bgp_route_next (rn)) 
+  for (rn = cursor->rn; rn && entries < VTY_OUTPUT_ENTRIES;
+       rn = bgp_route_next (rn))
     if (rn->info != NULL)
       {
+	entries++;
 	display = 0;
 
 	for (ri = rn->info; ri; ri = ri->next)
@@ -6289,9 +6575,9 @@ bgp_show_table (struct vty *vty, struct bgp_table *table, struct in_addr *router
 		  continue;
 	      }
 
-	    if (header)
+	    if (cursor->header)
 	      {
-		vty_out (vty, "BGP table version is 0, local router ID is %s%s", inet_ntoa (*router_id), VTY_NEWLINE);
+		vty_out (vty, "BGP table version is 0, local router ID is %s%s", inet_ntoa (cursor->router_id), VTY_NEWLINE);
 		vty_out (vty, BGP_SHOW_SCODE_HEADER, VTY_NEWLINE, VTY_NEWLINE);
 		vty_out (vty, BGP_SHOW_OCODE_HEADER, VTY_NEWLINE, VTY_NEWLINE);
 		if (type == bgp_show_type_dampend_paths
@@ -6310,7 +6596,7 @@ bgp_show_table (struct vty *vty, struct bgp_table *table, struct in_addr *router
 		  vty_out (vty, BGP_SHOW_FLAP_HEADER, VTY_NEWLINE);
 		else
 		  vty_out (vty, BGP_SHOW_HEADER, VTY_NEWLINE);
-		header = 0;
+		cursor->header = 0;
 	      }
 
 	    if (type == bgp_show_type_dampend_paths
@@ -6332,19 +6618,74 @@ bgp_show_table (struct vty *vty, struct bgp_table *table, struct in_addr *router
 	    display++;
 	  }
 	if (display)
-	  output_count++;
+	  cursor->output_count++;
       }
 
+  cursor->rn = rn;
+  if (rn)
+    return 1;
+
   /* No route is displayed */
-  if (output_count == 0)
+  if (cursor->output_count == 0)
     {
       if (type == bgp_show_type_normal)
 	vty_out (vty, "No BGP network exists%s", VTY_NEWLINE);
     }
   else
     vty_out (vty, "%sTotal number of prefixes %ld%s",
-	     VTY_NEWLINE, output_count, VTY_NEWLINE);
+	     VTY_NEWLINE, cursor->output_count, VTY_NEWLINE);
+
+  return 0;
+}
+
+static int
+bgp_show_table (struct vty *vty, struct bgp_table *table, struct in_addr *router_id,
+	  enum bgp_show_type type, void *output_arg)
+{
+  struct bgp_show_cursor *cursor;
+
+  cursor = XCALLOC (MTYPE_BGP_SHOW, sizeof (struct bgp_show_cursor));
+  bgp_table_lock (table);
+  cursor->table = table;
+  cursor->rn = bgp_table_top (table);
+  cursor->router_id = *router_id;
+  cursor->type = type;
+  cursor->output_arg = output_arg;
+  cursor->header = 1;
+
+  switch (type)
+    {
+    case bgp_show_type_normal:
+    case bgp_show_type_cidr_only:
+    case bgp_show_type_community_all:
+    case bgp_show_type_flap_statistics:
+    case bgp_show_type_flap_cidr_only:
+    case bgp_show_type_dampend_paths:
+      break;
+    case bgp_show_type_prefix_longer:
+    case bgp_show_type_flap_address:
+    case bgp_show_type_flap_prefix:
+    case bgp_show_type_flap_prefix_longer:
+      prefix_copy (&cursor->arg.p, output_arg);
+      cursor->output_arg = &cursor->arg.p;
+      break;
+    case bgp_show_type_neighbor:
+    case bgp_show_type_flap_neighbor:
+    case bgp_show_type_damp_neighbor:
+      cursor->arg.su = *(union sockunion *) output_arg;
+      cursor->output_arg = &cursor->arg.su;
+      break;
+    default:
+      /* The regular expressions, communities and lists the rest go by
+	 are freed or may be deleted once this returns, show them now. */
+      while (bgp_show_table_next (vty, cursor))
+	;
+      bgp_show_cursor_free (cursor);
+      return CMD_SUCCESS;
+    }
 
+  /* Show the table a piece at a time as the vty takes it. */
+  vty_output_set (vty, bgp_show_table_next, bgp_show_cursor_free, cursor);
   return CMD_SUCCESS;
 }
 
@@ -6370,6 +6711,130 @@ bgp_show (struct vty *vty, struct bgp *bgp, afi_t afi, safi_t safi,
   return bgp_show_table (vty, table, &bgp->router_id, type, output_arg);
 }
 
+/* Gives the paths of the next VTY_OUTPUT_ENTRIES prefixes as members of
+   the "routes" object, keyed by prefix, returning 1 while there are
+   more. */
+static int
+bgp_show_json_next (struct vty *vty, void *arg)
+{
+  struct bgp_show_cursor *cursor = arg;
+  struct bgp_info *ri;
+  struct bgp_node *rn;
+  char buf[INET6_ADDRSTRLEN];
+  int entries = 0;
+
+  for (rn = cursor->rn; rn && entries < VTY_OUTPUT_ENTRIES;
+       rn = bgp_route_next (rn))
+    if (rn->info != NULL)
+      {
+	entries++;
+	vty_out (vty, "%s%s\"%s/%d\":[", cursor->output_count ? "," : "",
+		 VTY_NEWLINE,
+		 inet_ntop (rn->p.family, &rn->p.u.prefix, buf, sizeof (buf)),
+		 rn->p.prefixlen);
+	for (ri = rn->info; ri; ri = ri->next)
+	  {
+	    if (ri != rn->info)
+	      vty_out (vty, ",");
+	    route_vty_out_json (vty, &rn->p, ri);
+	  }
+	vty_out (vty, "]");
+	cursor->output_count++;
+      }
+
+  cursor->rn = rn;
+  if (rn)
+    return 1;
+
+  vty_out (vty, "%s},\"totalPrefixes\":%lu}%s", VTY_NEWLINE,
+	   cursor->output_count, VTY_NEWLINE);
+  return 0;
+}
+
+/* Gives the next VTY_OUTPUT_ENTRIES prefixes as MRT TABLE_DUMP_V2 RIB
+   entries, a frame each, returning 1 while there are more.  A peer
+   index table goes first, and again should peers come or go, so the
+   peer numbers of the entries are always those of the last one. */
+static int
+bgp_show_binary_next (struct vty *vty, void *arg)
+{
+  struct bgp_show_cursor *cursor = arg;
+  struct bgp_node *rn;
+  int entries = 0;
+
+  if (cursor->header || cursor->bgp->peer_version != cursor->peer_version)
+    {
+      bgp_dump_routes_index_table_put (cursor->s, cursor->bgp);
+      vty_out_binary (vty, STREAM_DATA (cursor->s),
+		      stream_get_endp (cursor->s));
+      cursor->peer_version = cursor->bgp->peer_version;
+      cursor->header = 0;
+    }
+
+  for (rn = cursor->rn; rn && entries < VTY_OUTPUT_ENTRIES;
+       rn = bgp_route_next (rn))
+    if (rn->info != NULL)
+      {
+	entries++;
+	bgp_dump_routes_node_put (cursor->s, cursor->afi, rn,
+				  cursor->output_count++);
+	vty_out_binary (vty, STREAM_DATA (cursor->s),
+			stream_get_endp (cursor->s));
+      }
+
+  cursor->rn = rn;
+  if (rn)
+    return 1;
+
+  vty_out_binary_end (vty);
+  return 0;
+}
+
+/* "show ip bgp json" and "show ip bgp binary", the whole unicast table
+   of the default instance straight from the table. */
+static int
+bgp_show_structured (struct vty *vty, afi_t afi, enum vty_format format)
+{
+  struct bgp_show_cursor *cursor;
+  struct bgp *bgp;
+
+  bgp = bgp_get_default ();
+  if (bgp == NULL)
+    {
+      vty_out (vty, "No BGP process is configured%s", VTY_NEWLINE);
+      return CMD_WARNING;
+    }
+  if (format == VTY_FORMAT_BINARY && ! vty_binary_ok (vty))
+    return CMD_WARNING;
+
+  cursor = XCALLOC (MTYPE_BGP_SHOW, sizeof (struct bgp_show_cursor));
+  cursor->table = bgp->rib[afi][SAFI_UNICAST];
+  bgp_table_lock (cursor->table);
+  cursor->rn = bgp_table_top (cursor->table);
+  cursor->router_id = bgp->router_id;
+  cursor->type = bgp_show_type_normal;
+  cursor->header = 1;
+  cursor->afi = afi;
+
+  if (format == VTY_FORMAT_JSON)
+    {
+      vty_out (vty, "{\"routerId\":\"%s\",\"localAs\":%u,\"routes\":{",
+	       inet_ntoa (bgp->router_id), bgp->as);
+      vty_output_set (vty, bgp_show_json_next, bgp_show_cursor_free, cursor);
+    }
+  else
+    {
+      /* The peer index table is of the instance, keep it about. */
+      bgp_lock (bgp);
+      cursor->bgp = bgp;
+      cursor->s = stream_new (BGP_MAX_PACKET_SIZE + BGP_DUMP_MSG_HEADER
+			      + BGP_DUMP_HEADER_SIZE);
+      vty_output_set (vty, bgp_show_binary_next, bgp_show_cursor_free,
+		      cursor);
+    }
+  return CMD_SUCCESS;
+}
+
 /* Header of detailed BGP route information */
 static void
 route_vty_out_detail_header (struct vty *vty, struct bgp *bgp,
@@ -6592,6 +7057,19 @@ DEFUN (show_ip_bgp,
   return bgp_show (vty, NULL, AFI_IP, SAFI_UNICAST, bgp_show_type_normal, NULL);
 }
 
+DEFUN (show_ip_bgp_format,
+       show_ip_bgp_format_cmd,
+       "show ip bgp (json|binary)",
+       SHOW_STR
+       IP_STR
+       BGP_STR
+       "Give the table as JSON\n"
+       "Give the table as framed MRT TABLE_DUMP_V2 records\n")
+{
+  return bgp_show_structured (vty, AFI_IP, strcmp (argv[0], "json") == 0
+			      ? VTY_FORMAT_JSON : VTY_FORMAT_BINARY);
+}
+
 DEFUN (show_ip_bgp_ipv4,
        show_ip_bgp_ipv4_cmd,
        "show ip bgp ipv4 (unicast|multicast)",
@@ -6832,6 +7310,18 @@ ALIAS (show_bgp,
        BGP_STR
        "Address family\n")
 
+DEFUN (show_bgp_format,
+       show_bgp_format_cmd,
+       "show bgp (json|binary)",
+       SHOW_STR
+       BGP_STR
+       "Give the table as JSON\n"
+       "Give the table as framed MRT TABLE_DUMP_V2 records\n")
+{
+  return bgp_show_structured (vty, AFI_IP6, strcmp (argv[0], "json") == 0
+			      ? VTY_FORMAT_JSON : VTY_FORMAT_BINARY);
+}
+
 DEFUN (show_bgp_ipv6_safi,
        show_bgp_ipv6_safi_cmd,
        "show bgp ipv6 (unicast|multicast)",
@@ -12453,6 +12943,7 @@ bgp_route_init (void)
   install_element (BGP_IPV4M_NODE, &no_aggregate_address_mask_summary_as_set_cmd);
 
   install_element (VIEW_NODE, &show_ip_bgp_cmd);
+  install_element (VIEW_NODE, &show_ip_bgp_format_cmd);
   install_element (VIEW_NODE, &show_ip_bgp_ipv4_cmd);
   install_element (VIEW_NODE, &show_bgp_ipv4_safi_cmd);
   install_element (VIEW_NODE, &show_ip_bgp_route_cmd);
@@ -12586,6 +13077,7 @@ bgp_route_init (void)
   install_element (RESTRICTED_NODE, &show_bgp_view_ipv4_safi_rsclient_prefix_cmd);
 
   install_element (ENABLE_NODE, &show_ip_bgp_cmd);
+  install_element (ENABLE_NODE, &show_ip_bgp_format_cmd);
   install_element (ENABLE_NODE, &show_ip_bgp_ipv4_cmd);
   install_element (ENABLE_NODE, &show_bgp_ipv4_safi_cmd);
   install_element (ENABLE_NODE, &show_ip_bgp_route_cmd);
@@ -12713,6 +13205,7 @@ bgp_route_init (void)
   install_element (BGP_NODE, &old_no_ipv6_aggregate_address_summary_only_cmd);
 
   install_element (VIEW_NODE, &show_bgp_cmd);
+  install_element (VIEW_NODE, &show_bgp_format_cmd);
   install_element (VIEW_NODE, &show_bgp_ipv6_cmd);
   install_element (VIEW_NODE, &show_bgp_ipv6_safi_cmd);
   install_element (VIEW_NODE, &show_bgp_route_cmd);
@@ -12837,6 +13330,7 @@ bgp_route_init (void)
   install_element (RESTRICTED_NODE, &show_bgp_view_ipv6_safi_rsclient_prefix_cmd);
 
   install_element (ENABLE_NODE, &show_bgp_cmd);
+  install_element (ENABLE_NODE, &show_bgp_format_cmd);
   install_element (ENABLE_NODE, &show_bgp_ipv6_cmd);
   install_element (ENABLE_NODE, &show_bgp_ipv6_safi_cmd);
   install_element (ENABLE_NODE, &show_bgp_route_cmd);
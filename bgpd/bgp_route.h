@@ -40,6 +40,13 @@ struct bgp_info_extra
 
   /* MPLS label.  */
   u_char tag[3];  
+
+  /* Nexthop tracked for this route, the other routes through it, and
+     the node of this route, for when the nexthop changes.  */
+  struct bgp_nexthop_cache *bnc;
+  struct bgp_info *bnc_next;
+  struct bgp_info *bnc_prev;
+  struct bgp_node *rn;
 };
 
 struct bgp_info
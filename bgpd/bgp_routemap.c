@@ -52,6 +52,8 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 #include "bgpd/bgp_mplsvpn.h"
 #include "bgpd/bgp_ecommunity.h"
 #include "bgpd/bgp_vty.h"
+#include "bgpd/bgp_packet.h"
+#include "bgpd/bgp_updgrp.h"
 
 /* Memo of route-map commands.
 
@@ -290,7 +292,8 @@ struct route_map_rule_cmd route_match_ip_next_hop_cmd =
   "ip next-hop",
   route_match_ip_next_hop,
   route_match_ip_next_hop_compile,
-  route_match_ip_next_hop_free
+  route_match_ip_next_hop_free,
+  1
 };
 
 /* `match ip route-source ACCESS-LIST' */
@@ -435,7 +438,8 @@ struct route_map_rule_cmd route_match_ip_next_hop_prefix_list_cmd =
   "ip next-hop prefix-list",
   route_match_ip_next_hop_prefix_list,
   route_match_ip_next_hop_prefix_list_compile,
-  route_match_ip_next_hop_prefix_list_free
+  route_match_ip_next_hop_prefix_list_free,
+  1
 };
 
 /* `match ip route-source prefix-list PREFIX_LIST' */
@@ -553,7 +557,8 @@ struct route_map_rule_cmd route_match_metric_cmd =
   "metric",
   route_match_metric,
   route_match_metric_compile,
-  route_match_metric_free
+  route_match_metric_free,
+  1
 };
 
 /* `match as-path ASPATH' */
@@ -601,7 +606,8 @@ struct route_map_rule_cmd route_match_aspath_cmd =
   "as-path",
   route_match_aspath,
   route_match_aspath_compile,
-  route_match_aspath_free
+  route_match_aspath_free,
+  1
 };
 
 /* `match community COMMUNIY' */
@@ -685,7 +691,8 @@ struct route_map_rule_cmd route_match_community_cmd =
   "community",
   route_match_community,
   route_match_community_compile,
-  route_match_community_free
+  route_match_community_free,
+  1
 };
 
 /* Match function for extcommunity match. */
@@ -734,7 +741,8 @@ struct route_map_rule_cmd route_match_ecommunity_cmd =
   "extcommunity",
   route_match_ecommunity,
   route_match_ecommunity_compile,
-  route_match_ecommunity_free
+  route_match_ecommunity_free,
+  1
 };
 
 /* `match nlri` and `set nlri` are replaced by `address-family ipv4`
@@ -790,7 +798,8 @@ struct route_map_rule_cmd route_match_origin_cmd =
   "origin",
   route_match_origin,
   route_match_origin_compile,
-  route_match_origin_free
+  route_match_origin_free,
+  1
 };
 
 /* match probability  { */
@@ -1912,7 +1921,8 @@ struct route_map_rule_cmd route_match_ipv6_next_hop_cmd =
   "ipv6 next-hop",
   route_match_ipv6_next_hop,
   route_match_ipv6_next_hop_compile,
-  route_match_ipv6_next_hop_free
+  route_match_ipv6_next_hop_free,
+  1
 };
 
 /* `match ipv6 address prefix-list PREFIX_LIST' */
@@ -2289,9 +2299,21 @@ bgp_route_set_delete (struct vty *vty, struct route_map_index *index,
   return CMD_SUCCESS;
 }
 
+/* Look up the map of a reference by name again if it is to the map
+   changed, NULL for any. */
+static void
+bgp_route_map_relookup (const char *changed, const char *name,
+			struct route_map **map)
+{
+  if (name == NULL)
+    *map = NULL;
+  else if (changed == NULL || strcmp (name, changed) == 0)
+    *map = route_map_lookup_by_name (name);
+}
+
 /* Hook function for updating route_map assignment. */
 static void
-bgp_route_map_update (const char *unused)
+bgp_route_map_update (const char *changed)
 {
   int i;
   afi_t afi;
@@ -2306,6 +2328,9 @@ bgp_route_map_update (const char *unused)
   struct bgp_node *bn;
   struct bgp_static *bgp_static;
 
+  /* What the map matches on may keep peers out of update groups. */
+  bgp_update_group_changed (NULL);
+
   /* For neighbor route-map updates. */
   for (ALL_LIST_ELEMENTS (bm->bgp, mnode, mnnode, bgp))
     {
@@ -2317,18 +2342,11 @@ bgp_route_map_update (const char *unused)
 		filter = &peer->filter[afi][safi];
 	  
                for (direct = RMAP_IN; direct < RMAP_MAX; direct++)
-		  {
-		    if (filter->map[direct].name)
-		      filter->map[direct].map = 
-			route_map_lookup_by_name (filter->map[direct].name);
-		    else
-		      filter->map[direct].map = NULL;
-		  }
-
-		if (filter->usmap.name)
-		  filter->usmap.map = route_map_lookup_by_name (filter->usmap.name);
-		else
-		  filter->usmap.map = NULL;
+		  bgp_route_map_relookup (changed, filter->map[direct].name,
+					  &filter->map[direct].map);
+
+		bgp_route_map_relookup (changed, filter->usmap.name,
+					&filter->usmap.map);
 	      }
 	}
       for (ALL_LIST_ELEMENTS (bgp->group, node, nnode, group))
@@ -2339,18 +2357,11 @@ bgp_route_map_update (const char *unused)
 		filter = &group->conf->filter[afi][safi];
 	  
                for (direct = RMAP_IN; direct < RMAP_MAX; direct++)
-		  {
-		    if (filter->map[direct].name)
-		      filter->map[direct].map = 
-			route_map_lookup_by_name (filter->map[direct].name);
-		    else
-		      filter->map[direct].map = NULL;
-		  }
-
-		if (filter->usmap.name)
-		  filter->usmap.map = route_map_lookup_by_name (filter->usmap.name);
-		else
-		  filter->usmap.map = NULL;
+		  bgp_route_map_relookup (changed, filter->map[direct].name,
+					  &filter->map[direct].map);
+
+		bgp_route_map_relookup (changed, filter->usmap.name,
+					&filter->usmap.map);
 	      }
 	}
     }
@@ -2362,13 +2373,9 @@ bgp_route_map_update (const char *unused)
 	{
 	  for (afi = AFI_IP; afi < AFI_MAX; afi++)
 	    for (safi = SAFI_UNICAST; safi < SAFI_MAX; safi++)
-	      {
-		if (peer->default_rmap[afi][safi].name)
-		  peer->default_rmap[afi][safi].map =
-		    route_map_lookup_by_name (peer->default_rmap[afi][safi].name);
-		else
-		  peer->default_rmap[afi][safi].map = NULL;
-	      }
+	      bgp_route_map_relookup (changed,
+				      peer->default_rmap[afi][safi].name,
+				      &peer->default_rmap[afi][safi].map);
 	}
     }
 
@@ -2380,13 +2387,8 @@ bgp_route_map_update (const char *unused)
 	  for (bn = bgp_table_top (bgp->route[afi][safi]); bn;
 	       bn = bgp_route_next (bn))
 	    if ((bgp_static = bn->info) != NULL)
-	      {
-		if (bgp_static->rmap.name)
-		  bgp_static->rmap.map =
-			 route_map_lookup_by_name (bgp_static->rmap.name);
-		else
-		  bgp_static->rmap.map = NULL;
-	      }
+	      bgp_route_map_relookup (changed, bgp_static->rmap.name,
+				      &bgp_static->rmap.map);
     }
 
   /* For redistribute route-map updates. */
@@ -2395,17 +2397,38 @@ bgp_route_map_update (const char *unused)
       for (i = 0; i < ZEBRA_ROUTE_MAX; i++)
 	{
 	  if (bgp->rmap[ZEBRA_FAMILY_IPV4][i].name)
-	    bgp->rmap[ZEBRA_FAMILY_IPV4][i].map = 
-	      route_map_lookup_by_name (bgp->rmap[ZEBRA_FAMILY_IPV4][i].name);
+	    bgp_route_map_relookup (changed,
+				    bgp->rmap[ZEBRA_FAMILY_IPV4][i].name,
+				    &bgp->rmap[ZEBRA_FAMILY_IPV4][i].map);
 #ifdef HAVE_IPV6
 	  if (bgp->rmap[ZEBRA_FAMILY_IPV6][i].name)
-	    bgp->rmap[ZEBRA_FAMILY_IPV6][i].map =
-	      route_map_lookup_by_name (bgp->rmap[ZEBRA_FAMILY_IPV6][i].name);
+	    bgp_route_map_relookup (changed,
+				    bgp->rmap[ZEBRA_FAMILY_IPV6][i].name,
+				    &bgp->rmap[ZEBRA_FAMILY_IPV6][i].map);
 #endif /* HAVE_IPV6 */
 	}
     }
 }
-
+
+/* A "match peer" may have been added or taken out of a map, which
+   keeps peers out of update groups or lets them in. */
+static void
+bgp_route_map_event (route_map_event_t event, const char *name)
+{
+  switch (event)
+    {
+    case RMAP_EVENT_MATCH_ADDED:
+    case RMAP_EVENT_MATCH_DELETED:
+    case RMAP_EVENT_MATCH_REPLACED:
+    case RMAP_EVENT_INDEX_ADDED:
+    case RMAP_EVENT_INDEX_DELETED:
+      bgp_update_group_changed (NULL);
+      break;
+    default:
+      break;
+    }
+}
+
 DEFUN (match_peer,
        match_peer_cmd,
        "match peer (A.B.C.D|X:X::X:X)",
@@ -3839,6 +3862,7 @@ bgp_route_map_init (void)
   route_map_init_vty ();
   route_map_add_hook (bgp_route_map_update);
   route_map_delete_hook (bgp_route_map_update);
+  route_map_event_hook (bgp_route_map_event);
 
   route_map_install_match (&route_match_peer_cmd);
   route_map_install_match (&route_match_ip_address_cmd);
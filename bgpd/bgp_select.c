@@ -0,0 +1,177 @@
+/* BGP best path selection pthreads
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "thread.h"
+#include "memory.h"
+#include "log.h"
+
+#include "bgpd/bgp_select.h"
+
+/* A share of the items of a bgp_select_run(), every stride'th from
+   first on. */
+struct bgp_select_job
+{
+  void **items;
+  unsigned int count;
+  unsigned int first;
+  unsigned int stride;
+  void (*func) (void *);
+};
+
+static struct
+{
+  /* Wanted by the configuration, and running now.  The pthreads are
+     started by the first run after a change, so not before bgpd has
+     become a daemon. */
+  unsigned int wanted;
+  unsigned int running;
+  struct thread_master **masters;
+
+  /* Jobs not yet done, under mtx. */
+  pthread_mutex_t mtx;
+  pthread_cond_t cond;
+  unsigned int pending;
+} pool = { 0, 0, NULL, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0 };
+
+static void
+bgp_select_job_do (struct bgp_select_job *job)
+{
+  unsigned int i;
+
+  for (i = job->first; i < job->count; i += job->stride)
+    job->func (job->items[i]);
+}
+
+/* Runs in a selection pthread. */
+static int
+bgp_select_job_event (struct thread *thread)
+{
+  bgp_select_job_do (THREAD_ARG (thread));
+
+  pthread_mutex_lock (&pool.mtx);
+  if (--pool.pending == 0)
+    pthread_cond_signal (&pool.cond);
+  pthread_mutex_unlock (&pool.mtx);
+  return 0;
+}
+
+static void
+bgp_select_stop (void)
+{
+  unsigned int i;
+
+  for (i = 0; i < pool.running; i++)
+    {
+      thread_master_stop (pool.masters[i]);
+      thread_master_free (pool.masters[i]);
+    }
+  if (pool.masters)
+    XFREE (MTYPE_BGP_SELECT, pool.masters);
+  pool.masters = NULL;
+  pool.running = 0;
+}
+
+static void
+bgp_select_start (void)
+{
+  unsigned int i;
+
+  pool.masters = XCALLOC (MTYPE_BGP_SELECT,
+			  pool.wanted * sizeof (struct thread_master *));
+  for (i = 0; i < pool.wanted; i++)
+    {
+      pool.masters[i] = thread_master_create ();
+      if (thread_master_start (pool.masters[i]) < 0)
+	{
+	  thread_master_free (pool.masters[i]);
+	  break;
+	}
+      pool.running++;
+    }
+  if (pool.running < pool.wanted)
+    zlog_warn ("%s: only %u of %u pthreads started", __func__,
+	       pool.running, pool.wanted);
+}
+
+/* Select with this many pthreads besides the main thread, none to
+   select on the main thread alone. */
+void
+bgp_select_threads_set (unsigned int threads)
+{
+  if (threads > BGP_SELECT_THREADS_MAX)
+    threads = BGP_SELECT_THREADS_MAX;
+  pool.wanted = threads;
+
+  /* Any started again by the next run. */
+  if (pool.running != pool.wanted)
+    bgp_select_stop ();
+}
+
+unsigned int
+bgp_select_threads (void)
+{
+  return pool.wanted;
+}
+
+/* Calls func on each of the items, shared out between the pthreads
+   and the main thread, and returns once all are done. */
+void
+bgp_select_run (void **items, unsigned int count, void (*func) (void *))
+{
+  struct bgp_select_job jobs[BGP_SELECT_THREADS_MAX + 1];
+  unsigned int stride, i;
+
+  if (pool.masters == NULL && pool.wanted)
+    bgp_select_start ();
+
+  /* No more pthreads than would each have a few items. */
+  stride = pool.running + 1;
+  if (stride > count / 8 + 1)
+    stride = count / 8 + 1;
+
+  for (i = 0; i < stride; i++)
+    {
+      jobs[i].items = items;
+      jobs[i].count = count;
+      jobs[i].first = i;
+      jobs[i].stride = stride;
+      jobs[i].func = func;
+    }
+
+  pool.pending = stride - 1;
+  for (i = 1; i < stride; i++)
+    thread_add_event_mt (pool.masters[i - 1], bgp_select_job_event,
+			 &jobs[i], 0);
+  bgp_select_job_do (&jobs[0]);
+
+  pthread_mutex_lock (&pool.mtx);
+  while (pool.pending)
+    pthread_cond_wait (&pool.cond, &pool.mtx);
+  pthread_mutex_unlock (&pool.mtx);
+}
+
+void
+bgp_select_finish (void)
+{
+  bgp_select_stop ();
+  pool.wanted = 0;
+}
@@ -0,0 +1,39 @@
+/* BGP best path selection pthreads
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _QUAGGA_BGP_SELECT_H
+#define _QUAGGA_BGP_SELECT_H
+
+/* With "bgp process-threads" set, the process queue selects the best
+   paths of the nodes at its head ahead of time, shared out between
+   that many pthreads and the main thread, while the main thread waits.
+   Selection touches nothing but the node's own paths, so the nodes go
+   in any order.  The main thread then takes the nodes one at a time as
+   before, announcing, updating zebra and reaping, so those stay in
+   queue order. */
+
+#define BGP_SELECT_THREADS_MAX	64
+
+extern void bgp_select_threads_set (unsigned int);
+extern unsigned int bgp_select_threads (void);
+extern void bgp_select_run (void **, unsigned int, void (*) (void *));
+extern void bgp_select_finish (void);
+
+#endif /* _QUAGGA_BGP_SELECT_H */
@@ -21,6 +21,7 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 #include <zebra.h>
 
 #include "prefix.h"
+#include "table.h"
 #include "memory.h"
 #include "sockunion.h"
 #include "vty.h"
@@ -150,6 +151,9 @@ bgp_table_free (struct bgp_table *rt)
  
   assert (rt->count == 0);
 
+  if (rt->jump)
+    XFREE (MTYPE_ROUTE_JUMP, rt->jump);
+
   if (rt->owner)
     {
       peer_unlock (rt->owner);
@@ -210,6 +214,108 @@ set_link (struct bgp_node *node, struct bgp_node *new)
   new->parent = node;
 }
 
+/* Jump index slot of a prefix.  */
+static inline unsigned int
+bgp_jump_index (const u_char *prefix)
+{
+  return (prefix[0] << 8 | prefix[1]) >> (16 - ROUTE_JUMP_BITS);
+}
+
+/* Point the jump slots covered by a new node at it, unless they already
+   point further down.  */
+static void
+bgp_jump_add (struct bgp_table *table, struct bgp_node *node)
+{
+  struct bgp_node **slot;
+  unsigned int i, n;
+
+  if (table->jump == NULL || node->p.prefixlen > ROUTE_JUMP_BITS)
+    return;
+
+  slot = &table->jump[bgp_jump_index (&node->p.u.prefix)];
+  n = 1 << (ROUTE_JUMP_BITS - node->p.prefixlen);
+  for (i = 0; i < n; i++)
+    if (slot[i] == NULL || slot[i]->p.prefixlen < node->p.prefixlen)
+      slot[i] = node;
+}
+
+/* Hand the jump slots of a node about to be deleted to its parent.  */
+static void
+bgp_jump_delete (struct bgp_table *table, struct bgp_node *node)
+{
+  struct bgp_node **slot;
+  unsigned int i, n;
+
+  if (table->jump == NULL || node->p.prefixlen > ROUTE_JUMP_BITS)
+    return;
+
+  slot = &table->jump[bgp_jump_index (&node->p.u.prefix)];
+  n = 1 << (ROUTE_JUMP_BITS - node->p.prefixlen);
+  for (i = 0; i < n; i++)
+    if (slot[i] == node)
+      slot[i] = node->parent;
+}
+
+/* Build the jump index from the nodes of at most ROUTE_JUMP_BITS,
+   parents before children so the deepest one ends up in each slot.  */
+static void
+bgp_jump_build (struct bgp_table *table)
+{
+  struct bgp_node *node;
+
+  table->jump = XCALLOC (MTYPE_ROUTE_JUMP,
+			 sizeof (struct bgp_node *) << ROUTE_JUMP_BITS);
+
+  node = table->top;
+  while (node)
+    {
+      bgp_jump_add (table, node);
+
+      /* Children are longer, only look at them if they may fit. */
+      if (node->p.prefixlen < ROUTE_JUMP_BITS && node->l_left)
+	{
+	  node = node->l_left;
+	  continue;
+	}
+      if (node->p.prefixlen < ROUTE_JUMP_BITS && node->l_right)
+	{
+	  node = node->l_right;
+	  continue;
+	}
+
+      while (node->parent)
+	{
+	  if (node->parent->l_left == node && node->parent->l_right)
+	    break;
+	  node = node->parent;
+	}
+      node = node->parent ? node->parent->l_right : NULL;
+    }
+}
+
+/* Node to start walking down from when looking for p.  */
+static inline struct bgp_node *
+bgp_jump (const struct bgp_table *table, const struct prefix *p)
+{
+  struct bgp_node *node;
+
+  if (table->jump && p->prefixlen >= ROUTE_JUMP_BITS
+      && (node = table->jump[bgp_jump_index (&p->u.prefix)]) != NULL)
+    return node;
+  return table->top;
+}
+
+/* Account for a node just linked into the table.  */
+static void
+bgp_node_added (struct bgp_table *table, struct bgp_node *node)
+{
+  table->count++;
+  if (table->jump)
+    bgp_jump_add (table, node);
+  else if (table->count >= ROUTE_JUMP_NODES)
+    bgp_jump_build (table);
+}
+
 /* Lock node. */
 struct bgp_node *
 bgp_lock_node (struct bgp_node *node)
@@ -234,10 +340,11 @@ struct bgp_node *
 bgp_node_match (const struct bgp_table *table, struct prefix *p)
 {
   struct bgp_node *node;
+  struct bgp_node *start;
   struct bgp_node *matched;
 
   matched = NULL;
-  node = table->top;
+  node = start = bgp_jump (table, p);
 
   /* Walk down tree.  If there is matched route then store it to
      matched. */
@@ -249,6 +356,15 @@ bgp_node_match (const struct bgp_table *table, struct prefix *p)
       node = node->link[prefix_bit(&p->u.prefix, node->p.prefixlen)];
     }
 
+  /* Started below the top, the match may be further up. */
+  if (! matched && start)
+    for (node = start->parent; node; node = node->parent)
+      if (node->info)
+	{
+	  matched = node;
+	  break;
+	}
+
   /* If matched route found, return it. */
   if (matched)
     return bgp_lock_node (matched);
@@ -292,7 +408,7 @@ bgp_node_lookup (const struct bgp_table *table, struct prefix *p)
   u_char prefixlen = p->prefixlen;
   const u_char *prefix = &p->u.prefix;
 
-  node = table->top;
+  node = bgp_jump (table, p);
 
   while (node && node->p.prefixlen <= prefixlen &&
 	 prefix_match (&node->p, p))
@@ -317,7 +433,7 @@ bgp_node_get (struct bgp_table *const table, struct prefix *p)
   const u_char *prefix = &p->u.prefix;
 
   match = NULL;
-  node = table->top;
+  node = bgp_jump (table, p);
   while (node && node->p.prefixlen <= prefixlen &&
 	 prefix_match (&node->p, p))
     {
@@ -337,6 +453,7 @@ bgp_node_get (struct bgp_table *const table, struct prefix *p)
 	set_link (match, new);
       else
 	table->top = new;
+      bgp_node_added (table, new);
     }
   else
     {
@@ -350,16 +467,16 @@ bgp_node_get (struct bgp_table *const table, struct prefix *p)
 	set_link (match, new);
       else
 	table->top = new;
+      bgp_node_added (table, new);
 
       if (new->p.prefixlen != prefixlen)
 	{
 	  match = new;
 	  new = bgp_node_set (table, p);
 	  set_link (match, new);
-	  table->count++;
+	  bgp_node_added (table, new);
 	}
     }
-  table->count++;
   bgp_lock_node (new);
   
   return new;
@@ -385,6 +502,8 @@ bgp_node_delete (struct bgp_node *node)
 
   parent = node->parent;
 
+  bgp_jump_delete (node->table, node);
+
   if (child)
     child->parent = parent;
 
@@ -399,6 +518,11 @@ bgp_node_delete (struct bgp_node *node)
     node->table->top = child;
   
   node->table->count--;
+  if (node->table->jump && node->table->count < ROUTE_JUMP_NODES / 4)
+    {
+      XFREE (MTYPE_ROUTE_JUMP, node->table->jump);
+      node->table->jump = NULL;
+    }
   
   bgp_node_free (node);
 
@@ -43,6 +43,10 @@ struct bgp_table
   struct bgp_node *top;
   
   unsigned long count;
+
+  /* Level compressed top of the tree as in lib/table.h, NULL for small
+     tables. */
+  struct bgp_node **jump;
 };
 
 struct bgp_node
@@ -67,6 +71,7 @@ struct bgp_node
 
   u_char flags;
 #define BGP_NODE_PROCESS_SCHEDULED	(1 << 0)
+#define BGP_NODE_PROCESS_SELECTED	(1 << 1)	/* ahead, see bgp_select.h */
 };
 
 extern struct bgp_table *bgp_table_init (afi_t, safi_t);
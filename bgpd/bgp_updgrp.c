@@ -0,0 +1,468 @@
+/* BGP update groups
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "command.h"
+#include "memory.h"
+#include "prefix.h"
+#include "linklist.h"
+#include "stream.h"
+#include "sockunion.h"
+#include "routemap.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_table.h"
+#include "bgpd/bgp_route.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_advertise.h"
+#include "bgpd/bgp_packet.h"
+#include "bgpd/bgp_nexthop.h"
+#include "bgpd/bgp_vty.h"
+#include "bgpd/bgp_updgrp.h"
+
+/* The flags that change what is sent to a peer.  */
+#define UPDATE_GROUP_FLAGS	PEER_FLAG_LOCAL_AS_NO_PREPEND
+#define UPDATE_GROUP_AF_FLAGS						\
+  (PEER_FLAG_SEND_COMMUNITY | PEER_FLAG_SEND_EXT_COMMUNITY		\
+   | PEER_FLAG_NEXTHOP_SELF | PEER_FLAG_REFLECTOR_CLIENT		\
+   | PEER_FLAG_RSERVER_CLIENT | PEER_FLAG_AS_PATH_UNCHANGED		\
+   | PEER_FLAG_NEXTHOP_UNCHANGED | PEER_FLAG_MED_UNCHANGED		\
+   | PEER_FLAG_REMOVE_PRIVATE_AS | PEER_FLAG_NEXTHOP_LOCAL_UNCHANGED)
+#define UPDATE_GROUP_CAP	PEER_CAP_AS4_RCV
+
+/* Ask for the groups of the instance, or of every instance if bgp is
+   NULL, to be worked out again.  None are left once bgp_exit() has
+   deleted them. */
+void
+bgp_update_group_changed (struct bgp *bgp)
+{
+  struct listnode *node;
+
+  if (bgp)
+    bgp->update_groups_changed = 1;
+  else if (bm->bgp)
+    for (ALL_LIST_ELEMENTS_RO (bm->bgp, node, bgp))
+      bgp->update_groups_changed = 1;
+}
+
+static int
+update_group_name_same (const char *a, const char *b)
+{
+  if (a == NULL || b == NULL)
+    return a == b;
+  return strcmp (a, b) == 0;
+}
+
+/* Whether peers a and b get the same from bgp_announce_check(), but
+   for the checks of bgp_announce_check_peer(), and the same UPDATEs
+   from bgp_packet_attribute().  */
+static int
+update_group_same (struct peer *a, struct peer *b, afi_t afi, safi_t safi)
+{
+  struct bgp_filter *fa = &a->filter[afi][safi];
+  struct bgp_filter *fb = &b->filter[afi][safi];
+
+  if (peer_sort (a) != peer_sort (b)
+      || a->as != b->as
+      || a->local_as != b->local_as
+      || a->change_local_as != b->change_local_as)
+    return 0;
+
+  if ((a->flags & UPDATE_GROUP_FLAGS) != (b->flags & UPDATE_GROUP_FLAGS)
+      || ((a->af_flags[afi][safi] & UPDATE_GROUP_AF_FLAGS)
+	  != (b->af_flags[afi][safi] & UPDATE_GROUP_AF_FLAGS))
+      || (a->cap & UPDATE_GROUP_CAP) != (b->cap & UPDATE_GROUP_CAP))
+    return 0;
+
+  if (! update_group_name_same (DISTRIBUTE_OUT_NAME (fa),
+				DISTRIBUTE_OUT_NAME (fb))
+      || ! update_group_name_same (PREFIX_LIST_OUT_NAME (fa),
+				   PREFIX_LIST_OUT_NAME (fb))
+      || ! update_group_name_same (FILTER_LIST_OUT_NAME (fa),
+				   FILTER_LIST_OUT_NAME (fb))
+      || ! update_group_name_same (ROUTE_MAP_OUT_NAME (fa),
+				   ROUTE_MAP_OUT_NAME (fb))
+      || ! update_group_name_same (UNSUPPRESS_MAP_NAME (fa),
+				   UNSUPPRESS_MAP_NAME (fb)))
+    return 0;
+
+  /* The next hops they are given, and "set ip next-hop peer-address". */
+  if (! IPV4_ADDR_SAME (&a->nexthop.v4, &b->nexthop.v4)
+      || a->shared_network != b->shared_network)
+    return 0;
+#ifdef HAVE_IPV6
+  if (! IPV6_ADDR_SAME (&a->nexthop.v6_global, &b->nexthop.v6_global)
+      || ! IPV6_ADDR_SAME (&a->nexthop.v6_local, &b->nexthop.v6_local))
+    return 0;
+#endif /* HAVE_IPV6 */
+  if (a->su_local == NULL || b->su_local == NULL
+      ? a->su_local != b->su_local
+      : ! sockunion_same (a->su_local, b->su_local))
+    return 0;
+
+  /* Third party next hops to EBGP peers. */
+  if (peer_sort (a) == BGP_PEER_EBGP
+      && ! bgp_multiaccess_same_v4 (a->host, b->host))
+    return 0;
+
+  return 1;
+}
+
+/* Can the peer be in a group of the family at all?  An ORF prefix-list
+   is the peer's own, route server clients are given what their own
+   tables have, and "match peer" tells members apart.  */
+static int
+update_group_eligible (struct peer *peer, afi_t afi, safi_t safi)
+{
+  struct bgp_filter *filter = &peer->filter[afi][safi];
+
+  if (peer->status != Established || ! peer->afc_nego[afi][safi])
+    return 0;
+  if (CHECK_FLAG (peer->af_flags[afi][safi], PEER_FLAG_RSERVER_CLIENT))
+    return 0;
+  if (CHECK_FLAG (peer->af_cap[afi][safi], PEER_CAP_ORF_PREFIX_RM_ADV)
+      && (CHECK_FLAG (peer->af_cap[afi][safi], PEER_CAP_ORF_PREFIX_SM_RCV)
+	  || CHECK_FLAG (peer->af_cap[afi][safi],
+			 PEER_CAP_ORF_PREFIX_SM_OLD_RCV)))
+    return 0;
+  if ((ROUTE_MAP_OUT (filter)
+       && route_map_has_match (ROUTE_MAP_OUT (filter), "peer"))
+      || (UNSUPPRESS_MAP (filter)
+	  && route_map_has_match (UNSUPPRESS_MAP (filter), "peer")))
+    return 0;
+  return 1;
+}
+
+static void
+update_packet_free (struct update_packet *up)
+{
+  unsigned int i;
+
+  stream_free (up->s);
+  for (i = 0; i < up->count; i++)
+    bgp_unlock_node (up->rn[i]);
+  if (up->attr)
+    bgp_attr_unintern (&up->attr);
+  if (up->binfo)
+    bgp_info_unlock (up->binfo);
+  XFREE (MTYPE_BGP_UPDATE_PACKET, up);
+}
+
+static struct update_group *
+update_group_new (struct bgp *bgp, afi_t afi, safi_t safi)
+{
+  struct update_group *group;
+
+  group = XCALLOC (MTYPE_BGP_UPDATE_GROUP, sizeof (struct update_group));
+  group->bgp = bgp;
+  group->afi = afi;
+  group->safi = safi;
+  group->id = ++bgp->update_group_id;
+  group->uptime = bgp_clock ();
+  group->peer = list_new ();
+  listnode_add (bgp->update_groups[afi][safi], group);
+  return group;
+}
+
+static void
+update_group_free (struct update_group *group)
+{
+  unsigned int i;
+
+  for (i = 0; i < UPDATE_GROUP_PACKETS; i++)
+    if (group->packets[i])
+      update_packet_free (group->packets[i]);
+  listnode_delete (group->bgp->update_groups[group->afi][group->safi], group);
+  list_delete (group->peer);
+  XFREE (MTYPE_BGP_UPDATE_GROUP, group);
+}
+
+static void
+update_group_join (struct update_group *group, struct peer *peer)
+{
+  listnode_add (group->peer, peer_lock (peer)); /* group member reference */
+  peer->update_group[group->afi][group->safi] = group;
+  if (group->conf == NULL)
+    group->conf = peer;
+}
+
+static void
+update_group_leave (struct peer *peer, afi_t afi, safi_t safi)
+{
+  struct update_group *group = peer->update_group[afi][safi];
+
+  peer->update_group[afi][safi] = NULL;
+  listnode_delete (group->peer, peer);
+  peer_unlock (peer); /* group member reference */
+
+  if (listcount (group->peer) == 0)
+    update_group_free (group);
+  else if (group->conf == peer)
+    group->conf = listgetdata (listhead (group->peer));
+}
+
+/* Take the peer out of all its groups, as it goes away. */
+void
+bgp_update_group_leave_all (struct peer *peer)
+{
+  afi_t afi;
+  safi_t safi;
+
+  for (afi = AFI_IP; afi < AFI_MAX; afi++)
+    for (safi = SAFI_UNICAST; safi < SAFI_MAX; safi++)
+      if (peer->update_group[afi][safi])
+	update_group_leave (peer, afi, safi);
+}
+
+static void
+update_groups_sync_family (struct bgp *bgp, afi_t afi, safi_t safi)
+{
+  struct list *groups = bgp->update_groups[afi][safi];
+  struct listnode *node, *nnode, *gnode, *mnode, *mnnode;
+  struct update_group *group, *old, *into;
+  struct peer *peer;
+
+  /* Members no longer the same as the first of their group split off,
+     joining a group they are the same as or starting one. */
+  for (ALL_LIST_ELEMENTS (bgp->peer, node, nnode, peer))
+    {
+      old = peer->update_group[afi][safi];
+
+      if (! update_group_eligible (peer, afi, safi))
+	{
+	  if (old)
+	    update_group_leave (peer, afi, safi);
+	  continue;
+	}
+      if (old && (old->conf == peer
+		  || update_group_same (old->conf, peer, afi, safi)))
+	continue;
+
+      for (ALL_LIST_ELEMENTS_RO (groups, gnode, group))
+	if (group != old && update_group_same (group->conf, peer, afi, safi))
+	  break;
+
+      if (old)
+	update_group_leave (peer, afi, safi);
+      if (group == NULL)
+	{
+	  group = update_group_new (bgp, afi, safi);
+	  if (old)
+	    bgp->update_group_splits++;
+	}
+      update_group_join (group, peer);
+    }
+
+  /* Groups whose firsts have come to be the same merge. */
+  for (ALL_LIST_ELEMENTS (groups, node, nnode, group))
+    for (ALL_LIST_ELEMENTS_RO (groups, gnode, into))
+      {
+	if (into == group)
+	  break;
+	if (! update_group_same (into->conf, group->conf, afi, safi))
+	  continue;
+
+	for (ALL_LIST_ELEMENTS (group->peer, mnode, mnnode, peer))
+	  {
+	    peer_lock (peer);
+	    update_group_leave (peer, afi, safi);
+	    update_group_join (into, peer);
+	    peer_unlock (peer);
+	  }
+	bgp->update_group_merges++;
+	break;
+      }
+}
+
+/* Work the groups out again if anything they depend on has changed.
+   Called before they are used.  */
+void
+bgp_update_groups_sync (struct bgp *bgp)
+{
+  afi_t afi;
+  safi_t safi;
+
+  if (! bgp->update_groups_changed)
+    return;
+  bgp->update_groups_changed = 0;
+
+  for (afi = AFI_IP; afi < AFI_MAX; afi++)
+    for (safi = SAFI_UNICAST; safi < SAFI_MAX; safi++)
+      update_groups_sync_family (bgp, afi, safi);
+}
+
+/* Does the FIFO of the member begin with the prefixes of the packet,
+   in the order bgp_update_packet() or bgp_withdraw_packet() would take
+   them?  */
+static int
+update_packet_match (struct update_packet *up, struct bgp_advertise *head,
+		     struct bgp_synchronize *sync)
+{
+  struct bgp_advertise *adv;
+  unsigned int i;
+
+  if (head->rn != up->rn[0])
+    return 0;
+
+  if (up->withdraw)
+    {
+      adv = head;
+      for (i = 1; i < up->count; i++)
+	{
+	  adv = (struct bgp_advertise *) adv->fifo.next;
+	  if ((void *) adv == (void *) &sync->withdraw || adv->rn != up->rn[i])
+	    return 0;
+	}
+      return 1;
+    }
+
+  /* The head, then the others of its attribute, newest first. */
+  if (head->baa->attr != up->attr || head->binfo != up->binfo)
+    return 0;
+  adv = head->baa->adv;
+  for (i = 1; i < up->count; i++)
+    {
+      if (adv == head)
+	adv = adv->next;
+      if (adv == NULL || adv->rn != up->rn[i])
+	return 0;
+      adv = adv->next;
+    }
+  return 1;
+}
+
+/* A packet made for another member that may be sent to the one with
+   sync, as the next of its withdrawals or announcements.  */
+struct update_packet *
+update_group_packet_lookup (struct update_group *group,
+			    struct bgp_synchronize *sync, int withdraw)
+{
+  struct bgp_advertise_fifo *fifo;
+  struct bgp_advertise *head;
+  struct update_packet *up;
+  unsigned int i;
+
+  fifo = withdraw ? &sync->withdraw : &sync->update;
+  head = FIFO_HEAD (fifo);
+  if (head == NULL)
+    return NULL;
+
+  for (i = 0; i < UPDATE_GROUP_PACKETS; i++)
+    if ((up = group->packets[i]) != NULL
+	&& up->withdraw == withdraw
+	&& update_packet_match (up, head, sync))
+      return up;
+
+  return NULL;
+}
+
+/* Keep packet s, just made for a member, for the others.  */
+void
+update_group_packet_add (struct update_group *group, struct stream *s,
+			 int withdraw, struct attr *attr,
+			 struct bgp_info *binfo, struct bgp_node **rn,
+			 unsigned int count)
+{
+  struct update_packet *up;
+  unsigned int i;
+
+  group->encoded++;
+  if (listcount (group->peer) < 2 || count == 0)
+    return;
+
+  up = XMALLOC (MTYPE_BGP_UPDATE_PACKET, sizeof (struct update_packet)
+		+ (count - 1) * sizeof (struct bgp_node *));
+  up->s = stream_ref (s);
+  up->withdraw = withdraw;
+  up->attr = attr ? bgp_attr_intern (attr) : NULL;
+  up->binfo = binfo ? bgp_info_lock (binfo) : NULL;
+  up->count = count;
+  for (i = 0; i < count; i++)
+    up->rn[i] = bgp_lock_node (rn[i]);
+
+  if (group->packets[group->packet_next])
+    update_packet_free (group->packets[group->packet_next]);
+  group->packets[group->packet_next] = up;
+  group->packet_next = (group->packet_next + 1) % UPDATE_GROUP_PACKETS;
+}
+
+static void
+update_group_show (struct vty *vty, struct update_group *group)
+{
+  char timebuf[BGP_UPTIME_LEN];
+  struct listnode *node;
+  struct peer *peer;
+
+  vty_out (vty, "Update group %u, %s, up %s%s", group->id,
+	   afi_safi_print (group->afi, group->safi),
+	   peer_uptime (group->uptime, timebuf, BGP_UPTIME_LEN), VTY_NEWLINE);
+  vty_out (vty, "  Outbound policy runs %lu, spared members %lu%s",
+	   group->policy, group->spared, VTY_NEWLINE);
+  vty_out (vty, "  Packets made %lu, handed on %lu (%lu bytes)%s",
+	   group->encoded, group->shared, group->shared_bytes, VTY_NEWLINE);
+  vty_out (vty, "  %d members:%s", listcount (group->peer), VTY_NEWLINE);
+  for (ALL_LIST_ELEMENTS_RO (group->peer, node, peer))
+    vty_out (vty, "    %s%s%s", peer->host,
+	     peer == group->conf ? " (policy)" : "", VTY_NEWLINE);
+}
+
+DEFUN (show_bgp_update_groups,
+       show_bgp_update_groups_cmd,
+       "show bgp update-groups",
+       SHOW_STR
+       BGP_STR
+       "Update groups of peers\n")
+{
+  struct bgp *bgp;
+  struct listnode *node;
+  struct update_group *group;
+  afi_t afi;
+  safi_t safi;
+  unsigned int count = 0;
+
+  bgp = bgp_get_default ();
+  if (bgp == NULL)
+    {
+      vty_out (vty, "No BGP process is configured%s", VTY_NEWLINE);
+      return CMD_WARNING;
+    }
+  bgp_update_groups_sync (bgp);
+
+  for (afi = AFI_IP; afi < AFI_MAX; afi++)
+    for (safi = SAFI_UNICAST; safi < SAFI_MAX; safi++)
+      for (ALL_LIST_ELEMENTS_RO (bgp->update_groups[afi][safi], node, group))
+	{
+	  update_group_show (vty, group);
+	  count++;
+	}
+
+  vty_out (vty, "%sTotal number of update groups %u, "
+	   "%lu split off, %lu merged%s", count ? VTY_NEWLINE : "", count,
+	   bgp->update_group_splits, bgp->update_group_merges, VTY_NEWLINE);
+  return CMD_SUCCESS;
+}
+
+void
+bgp_update_group_init (void)
+{
+  install_element (VIEW_NODE, &show_bgp_update_groups_cmd);
+  install_element (ENABLE_NODE, &show_bgp_update_groups_cmd);
+}
@@ -0,0 +1,88 @@
+/* BGP update groups
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _QUAGGA_BGP_UPDGRP_H
+#define _QUAGGA_BGP_UPDGRP_H
+
+/* Established peers of an address family whose outbound policy and
+   UPDATE encoding come out the same are put in an update group: the
+   policy is run once for the group, against its first member, and a
+   packet made for one member is handed to the others as it is.  Which
+   peers go together is worked out again after anything they are
+   compared on may have changed; bgp_update_group_changed() asks for
+   that.  */
+
+/* Packets kept by a group for the members to come to.  */
+#define UPDATE_GROUP_PACKETS	(4 * BGP_WRITE_PACKET_MAX)
+
+/* A packet made for a member, with what went into it.  */
+struct update_packet
+{
+  struct stream *s;
+
+  /* Withdrawals, or announcements of attr from binfo.  */
+  int withdraw;
+  struct attr *attr;
+  struct bgp_info *binfo;
+
+  /* The prefixes, in the order they were taken.  */
+  unsigned int count;
+  struct bgp_node *rn[1];
+};
+
+struct update_group
+{
+  struct bgp *bgp;
+  afi_t afi;
+  safi_t safi;
+  unsigned int id;
+  time_t uptime;
+
+  /* Members.  The first is the one the others are compared with and
+     policy is run against.  */
+  struct list *peer;
+  struct peer *conf;
+
+  /* Recent packets, a ring.  */
+  struct update_packet *packets[UPDATE_GROUP_PACKETS];
+  unsigned int packet_next;
+
+  /* Statistics. */
+  unsigned long policy;		/* outbound policy runs */
+  unsigned long spared;		/* runs the other members were spared */
+  unsigned long encoded;	/* packets made */
+  unsigned long shared;		/* packets handed on to another member */
+  unsigned long shared_bytes;
+};
+
+extern void bgp_update_group_changed (struct bgp *);
+extern void bgp_update_groups_sync (struct bgp *);
+extern void bgp_update_group_leave_all (struct peer *);
+
+extern struct update_packet *
+update_group_packet_lookup (struct update_group *, struct bgp_synchronize *,
+			    int);
+extern void update_group_packet_add (struct update_group *, struct stream *,
+				     int, struct attr *, struct bgp_info *,
+				     struct bgp_node **, unsigned int);
+
+extern void bgp_update_group_init (void);
+
+#endif /* _QUAGGA_BGP_UPDGRP_H */
@@ -49,6 +49,8 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 #include "bgpd/bgp_table.h"
 #include "bgpd/bgp_vty.h"
 #include "bgpd/bgp_mpath.h"
+#include "bgpd/bgp_io.h"
+#include "bgpd/bgp_select.h"
 
 extern struct in_addr router_id_zebra;
 
@@ -286,6 +288,40 @@ DEFUN (no_bgp_config_type,
   return CMD_SUCCESS;
 }
 
+DEFUN (bgp_process_threads,
+       bgp_process_threads_cmd,
+       "bgp process-threads <1-64>",
+       BGP_STR
+       "Select best paths ahead in pthreads of their own\n"
+       "Number of pthreads\n")
+{
+  u_int32_t threads;
+
+  VTY_GET_INTEGER_RANGE ("process-threads", threads, argv[0], 1,
+			 BGP_SELECT_THREADS_MAX);
+  bgp_select_threads_set (threads);
+  return CMD_SUCCESS;
+}
+
+DEFUN (no_bgp_process_threads,
+       no_bgp_process_threads_cmd,
+       "no bgp process-threads",
+       NO_STR
+       BGP_STR
+       "Select best paths ahead in pthreads of their own\n")
+{
+  bgp_select_threads_set (0);
+  return CMD_SUCCESS;
+}
+
+ALIAS (no_bgp_process_threads,
+       no_bgp_process_threads_val_cmd,
+       "no bgp process-threads <1-64>",
+       NO_STR
+       BGP_STR
+       "Select best paths ahead in pthreads of their own\n"
+       "Number of pthreads\n")
+
 DEFUN (no_synchronization,
        no_synchronization_cmd,
        "no synchronization",
@@ -1390,6 +1426,47 @@ ALIAS (no_bgp_default_local_preference,
        "local preference (higher=more preferred)\n"
        "Configure default local preference value\n")
 
+DEFUN (bgp_read_quantum,
+       bgp_read_quantum_cmd,
+       "bgp read-quantum <1-10000>",
+       "BGP specific commands\n"
+       "Messages taken from a peer before others get a turn\n"
+       "Number of messages\n")
+{
+  struct bgp *bgp;
+  u_int32_t quantum;
+
+  bgp = vty->index;
+
+  VTY_GET_INTEGER_RANGE ("read quantum", quantum, argv[0], 1, 10000);
+
+  bgp_read_quantum_set (bgp, quantum);
+
+  return CMD_SUCCESS;
+}
+
+DEFUN (no_bgp_read_quantum,
+       no_bgp_read_quantum_cmd,
+       "no bgp read-quantum",
+       NO_STR
+       "BGP specific commands\n"
+       "Messages taken from a peer before others get a turn\n")
+{
+  struct bgp *bgp;
+
+  bgp = vty->index;
+  bgp_read_quantum_unset (bgp);
+  return CMD_SUCCESS;
+}
+
+ALIAS (no_bgp_read_quantum,
+       no_bgp_read_quantum_val_cmd,
+       "no bgp read-quantum <1-10000>",
+       NO_STR
+       "BGP specific commands\n"
+       "Messages taken from a peer before others get a turn\n"
+       "Number of messages\n")
+
 static int
 peer_remote_as_vty (struct vty *vty, const char *peer_str, 
                     const char *as_str, afi_t afi, safi_t safi)
@@ -6934,7 +7011,8 @@ bgp_show_summary (struct vty *vty, struct bgp *bgp, int afi, int safi)
 		   peer->open_out + peer->update_out + peer->keepalive_out
 		   + peer->notify_out + peer->refresh_out
 		   + peer->dynamic_cap_out,
-		   0, 0, (unsigned long) peer->obuf->count);
+		   0, 0, (unsigned long) peer->obuf->count
+		   + bgp_io_queued (peer));
 
 	  vty_out (vty, "%8s", 
 		   peer_uptime (peer->uptime, timebuf, BGP_UPTIME_LEN));
@@ -6966,6 +7044,63 @@ bgp_show_summary (struct vty *vty, struct bgp *bgp, int afi, int safi)
   return CMD_SUCCESS;
 }
 
+/* Gives the summary as JSON, the peers keyed by address, the uptime in
+   seconds and 0 when never up. */
+static int
+bgp_show_summary_json (struct vty *vty, afi_t afi, safi_t safi)
+{
+  struct bgp *bgp;
+  struct peer *peer;
+  struct listnode *node, *nnode;
+  unsigned int count = 0;
+  const char *state;
+
+  bgp = bgp_get_default ();
+  if (bgp == NULL)
+    {
+      vty_out (vty, "No BGP process is configured%s", VTY_NEWLINE);
+      return CMD_WARNING;
+    }
+
+  vty_out (vty, "{\"routerId\":\"%s\",\"localAs\":%u,"
+	   "\"ribEntries\":%lu,\"peers\":{",
+	   inet_ntoa (bgp->router_id), bgp->as,
+	   bgp_table_count (bgp->rib[afi][safi]));
+
+  for (ALL_LIST_ELEMENTS (bgp->peer, node, nnode, peer))
+    {
+      if (! peer->afc[afi][safi])
+	continue;
+
+      if (CHECK_FLAG (peer->flags, PEER_FLAG_SHUTDOWN))
+	state = "Idle (Admin)";
+      else if (CHECK_FLAG (peer->sflags, PEER_STATUS_PREFIX_OVERFLOW))
+	state = "Idle (PfxCt)";
+      else
+	state = LOOKUP (bgp_status_msg, peer->status);
+
+      vty_out (vty, "%s%s\"%s\":{\"remoteAs\":%u,\"msgRcvd\":%u,"
+	       "\"msgSent\":%u,\"outQ\":%lu,\"uptime\":%ld,"
+	       "\"state\":\"%s\"",
+	       count ? "," : "", VTY_NEWLINE, peer->host, peer->as,
+	       peer->open_in + peer->update_in + peer->keepalive_in
+	       + peer->notify_in + peer->refresh_in + peer->dynamic_cap_in,
+	       peer->open_out + peer->update_out + peer->keepalive_out
+	       + peer->notify_out + peer->refresh_out + peer->dynamic_cap_out,
+	       (unsigned long) peer->obuf->count + bgp_io_queued (peer),
+	       peer->uptime ? (long) (bgp_clock () - peer->uptime) : 0L,
+	       state);
+      if (peer->status == Established)
+	vty_out (vty, ",\"prefixReceived\":%lu", peer->pcount[afi][safi]);
+      vty_out (vty, "}");
+      count++;
+    }
+
+  vty_out (vty, "%s},\"totalPeers\":%u}%s", VTY_NEWLINE, count,
+	   VTY_NEWLINE);
+  return CMD_SUCCESS;
+}
+
 static int 
 bgp_show_summary_vty (struct vty *vty, const char *name, 
                       afi_t afi, safi_t safi)
@@ -7006,6 +7141,18 @@ DEFUN (show_ip_bgp_summary,
   return bgp_show_summary_vty (vty, NULL, AFI_IP, SAFI_UNICAST);
 }
 
+DEFUN (show_ip_bgp_summary_json,
+       show_ip_bgp_summary_json_cmd,
+       "show ip bgp summary json",
+       SHOW_STR
+       IP_STR
+       BGP_STR
+       "Summary of BGP neighbor status\n"
+       "Give the summary as JSON\n")
+{
+  return bgp_show_summary_json (vty, AFI_IP, SAFI_UNICAST);
+}
+
 DEFUN (show_ip_bgp_instance_summary,
        show_ip_bgp_instance_summary_cmd,
        "show ip bgp view WORD summary",
@@ -7125,6 +7272,17 @@ DEFUN (show_bgp_summary,
   return bgp_show_summary_vty (vty, NULL, AFI_IP6, SAFI_UNICAST);
 }
 
+DEFUN (show_bgp_summary_json,
+       show_bgp_summary_json_cmd,
+       "show bgp summary json",
+       SHOW_STR
+       BGP_STR
+       "Summary of BGP neighbor status\n"
+       "Give the summary as JSON\n")
+{
+  return bgp_show_summary_json (vty, AFI_IP6, SAFI_UNICAST);
+}
+
 DEFUN (show_bgp_instance_summary,
        show_bgp_instance_summary_cmd,
        "show bgp view WORD summary",
@@ -7714,7 +7872,8 @@ bgp_show_peer (struct vty *vty, struct peer *p)
   /* Packet counts. */
   vty_out (vty, "  Message statistics:%s", VTY_NEWLINE);
   vty_out (vty, "    Inq depth is 0%s", VTY_NEWLINE);
-  vty_out (vty, "    Outq depth is %lu%s", (unsigned long) p->obuf->count, VTY_NEWLINE);
+  vty_out (vty, "    Outq depth is %lu%s",
+	   (unsigned long) p->obuf->count + bgp_io_queued (p), VTY_NEWLINE);
   vty_out (vty, "                         Sent       Rcvd%s", VTY_NEWLINE);
   vty_out (vty, "    Opens:         %10d %10d%s", p->open_out, p->open_in, VTY_NEWLINE);
   vty_out (vty, "    Notifications: %10d %10d%s", p->notify_out, p->notify_in, VTY_NEWLINE);
@@ -7836,10 +7995,13 @@ bgp_show_peer (struct vty *vty, struct peer *p)
     vty_out (vty, "Next connect timer due in %ld seconds%s",
 	     thread_timer_remain_second (p->t_connect), VTY_NEWLINE);
   
-  vty_out (vty, "Read thread: %s  Write thread: %s%s", 
-	   p->t_read ? "on" : "off",
-	   p->t_write ? "on" : "off",
-	   VTY_NEWLINE);
+  if (p->io)
+    vty_out (vty, "Read and write by the I/O pthread%s", VTY_NEWLINE);
+  else
+    vty_out (vty, "Read thread: %s  Write thread: %s%s", 
+	     p->t_read ? "on" : "off",
+	     p->t_write ? "on" : "off",
+	     VTY_NEWLINE);
 
   if (p->notify.code == BGP_NOTIFY_OPEN_ERR
       && p->notify.subcode == BGP_NOTIFY_OPEN_UNSUP_CAPBL)
@@ -8149,7 +8311,7 @@ DEFUN (show_ip_bgp_ipv4_paths,
   return CMD_SUCCESS;
 }
 
-#include "hash.h"
+#include "ohash.h"
 
 static void
 community_show_all_iterator (struct hash_backet *backet, struct vty *vty)
@@ -8157,7 +8319,7 @@ community_show_all_iterator (struct hash_backet *backet, struct vty *vty)
   struct community *com;
 
   com = (struct community *) backet->data;
-  vty_out (vty, "[%p] (%ld) %s%s", backet, com->refcnt,
+  vty_out (vty, "[%p] (%ld) %s%s", com, com->refcnt,
 	   community_str (com), VTY_NEWLINE);
 }
 
@@ -8172,10 +8334,10 @@ DEFUN (show_ip_bgp_community_info,
 {
   vty_out (vty, "Address Refcnt Community%s", VTY_NEWLINE);
 
-  hash_iterate (community_hash (), 
-		(void (*) (struct hash_backet *, void *))
-		community_show_all_iterator,
-		vty);
+  ohash_iterate (community_hash (), 
+		 (void (*) (struct hash_backet *, void *))
+		 community_show_all_iterator,
+		 vty);
 
   return CMD_SUCCESS;
 }
@@ -9047,6 +9209,11 @@ bgp_vty_init (void)
   install_element (CONFIG_NODE, &bgp_config_type_cmd);
   install_element (CONFIG_NODE, &no_bgp_config_type_cmd);
 
+  /* "bgp process-threads" commands. */
+  install_element (CONFIG_NODE, &bgp_process_threads_cmd);
+  install_element (CONFIG_NODE, &no_bgp_process_threads_cmd);
+  install_element (CONFIG_NODE, &no_bgp_process_threads_val_cmd);
+
   /* Dummy commands (Currently not supported) */
   install_element (BGP_NODE, &no_synchronization_cmd);
   install_element (BGP_NODE, &no_auto_summary_cmd);
@@ -9162,6 +9329,11 @@ bgp_vty_init (void)
   install_element (BGP_NODE, &no_bgp_default_local_preference_cmd);
   install_element (BGP_NODE, &no_bgp_default_local_preference_val_cmd);
 
+  /* "bgp read-quantum" commands. */
+  install_element (BGP_NODE, &bgp_read_quantum_cmd);
+  install_element (BGP_NODE, &no_bgp_read_quantum_cmd);
+  install_element (BGP_NODE, &no_bgp_read_quantum_val_cmd);
+
   /* "neighbor remote-as" commands. */
   install_element (BGP_NODE, &neighbor_remote_as_cmd);
   install_element (BGP_NODE, &no_neighbor_cmd);
@@ -9952,6 +10124,7 @@ bgp_vty_init (void)
 
   /* "show ip bgp summary" commands. */
   install_element (VIEW_NODE, &show_ip_bgp_summary_cmd);
+  install_element (VIEW_NODE, &show_ip_bgp_summary_json_cmd);
   install_element (VIEW_NODE, &show_ip_bgp_instance_summary_cmd);
   install_element (VIEW_NODE, &show_ip_bgp_ipv4_summary_cmd);
   install_element (VIEW_NODE, &show_bgp_ipv4_safi_summary_cmd);
@@ -9961,6 +10134,7 @@ bgp_vty_init (void)
   install_element (VIEW_NODE, &show_ip_bgp_vpnv4_rd_summary_cmd);
 #ifdef HAVE_IPV6
   install_element (VIEW_NODE, &show_bgp_summary_cmd);
+  install_element (VIEW_NODE, &show_bgp_summary_json_cmd);
   install_element (VIEW_NODE, &show_bgp_instance_summary_cmd);
   install_element (VIEW_NODE, &show_bgp_ipv6_summary_cmd);
   install_element (VIEW_NODE, &show_bgp_ipv6_safi_summary_cmd);
@@ -9968,6 +10142,7 @@ bgp_vty_init (void)
   install_element (VIEW_NODE, &show_bgp_instance_ipv6_safi_summary_cmd);
 #endif /* HAVE_IPV6 */
   install_element (RESTRICTED_NODE, &show_ip_bgp_summary_cmd);
+  install_element (RESTRICTED_NODE, &show_ip_bgp_summary_json_cmd);
   install_element (RESTRICTED_NODE, &show_ip_bgp_instance_summary_cmd);
   install_element (RESTRICTED_NODE, &show_ip_bgp_ipv4_summary_cmd);
   install_element (RESTRICTED_NODE, &show_bgp_ipv4_safi_summary_cmd);
@@ -9977,6 +10152,7 @@ bgp_vty_init (void)
   install_element (RESTRICTED_NODE, &show_ip_bgp_vpnv4_rd_summary_cmd);
 #ifdef HAVE_IPV6
   install_element (RESTRICTED_NODE, &show_bgp_summary_cmd);
+  install_element (RESTRICTED_NODE, &show_bgp_summary_json_cmd);
   install_element (RESTRICTED_NODE, &show_bgp_instance_summary_cmd);
   install_element (RESTRICTED_NODE, &show_bgp_ipv6_summary_cmd);
   install_element (RESTRICTED_NODE, &show_bgp_ipv6_safi_summary_cmd);
@@ -9984,6 +10160,7 @@ bgp_vty_init (void)
   install_element (RESTRICTED_NODE, &show_bgp_instance_ipv6_safi_summary_cmd);
 #endif /* HAVE_IPV6 */
   install_element (ENABLE_NODE, &show_ip_bgp_summary_cmd);
+  install_element (ENABLE_NODE, &show_ip_bgp_summary_json_cmd);
   install_element (ENABLE_NODE, &show_ip_bgp_instance_summary_cmd);
   install_element (ENABLE_NODE, &show_ip_bgp_ipv4_summary_cmd);
   install_element (ENABLE_NODE, &show_bgp_ipv4_safi_summary_cmd);
@@ -9993,6 +10170,7 @@ bgp_vty_init (void)
   install_element (ENABLE_NODE, &show_ip_bgp_vpnv4_rd_summary_cmd);
 #ifdef HAVE_IPV6
   install_element (ENABLE_NODE, &show_bgp_summary_cmd);
+  install_element (ENABLE_NODE, &show_bgp_summary_json_cmd);
   install_element (ENABLE_NODE, &show_bgp_instance_summary_cmd);
   install_element (ENABLE_NODE, &show_bgp_ipv6_summary_cmd);
   install_element (ENABLE_NODE, &show_bgp_ipv6_safi_summary_cmd);
@@ -97,7 +97,7 @@ bgp_interface_delete (int command, struct zclient *zclient,
 
   s = zclient->ibuf;
   ifp = zebra_interface_state_read (s);
-  ifp->ifindex = IFINDEX_INTERNAL;
+  if_set_index (ifp, IFINDEX_INTERNAL);
 
   if (BGP_DEBUG(zebra, ZEBRA))
     zlog_debug("Zebra rcvd: interface delete %s", ifp->name);
@@ -813,6 +813,32 @@ bgp_zebra_announce (struct prefix *p, struct bgp_info *info, struct bgp *bgp, sa
 #endif /* HAVE_IPV6 */
 }
 
+/* Ask zebra to track the address of p as a nexthop, or no longer. */
+void
+bgp_zebra_nexthop_register (struct prefix *p, int reg)
+{
+  if (zclient == NULL || zclient->sock < 0)
+    return;
+
+  if (BGP_DEBUG(zebra, ZEBRA))
+    {
+      char buf[INET6_ADDRSTRLEN];
+      zlog_debug("Zebra send: nexthop %s %s",
+		 reg ? "register" : "unregister",
+		 inet_ntop(p->family, &p->u.prefix, buf, sizeof(buf)));
+    }
+
+  zebra_nexthop_send (reg ? ZEBRA_NEXTHOP_REGISTER : ZEBRA_NEXTHOP_UNREGISTER,
+		      zclient, p);
+}
+
+/* Connected again, zebra tracks none of the nexthops yet. */
+static void
+bgp_zebra_connected (struct zclient *zclient)
+{
+  bgp_nexthop_register_all ();
+}
+
 void
 bgp_zebra_withdraw (struct prefix *p, struct bgp_info *info, safi_t safi)
 {
@@ -1081,6 +1107,8 @@ bgp_zebra_init (void)
   zclient->ipv6_route_add = zebra_read_ipv6;
   zclient->ipv6_route_delete = zebra_read_ipv6;
 #endif /* HAVE_IPV6 */
+  zclient->nexthop_update = bgp_nexthop_update;
+  zclient->zebra_connected = bgp_zebra_connected;
 
   /* Interface related init. */
   if_init ();
@@ -33,6 +33,7 @@ extern int bgp_config_write_redistribute (struct vty *, struct bgp *, afi_t, saf
 				   int *);
 extern void bgp_zebra_announce (struct prefix *, struct bgp_info *, struct bgp *, safi_t);
 extern void bgp_zebra_withdraw (struct prefix *, struct bgp_info *, safi_t);
+extern void bgp_zebra_nexthop_register (struct prefix *, int);
 
 extern int bgp_redistribute_set (struct bgp *, afi_t, int);
 extern int bgp_redistribute_rmap_set (struct bgp *, afi_t, int, const char *);
@@ -58,6 +58,9 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 #include "bgpd/bgp_network.h"
 #include "bgpd/bgp_vty.h"
 #include "bgpd/bgp_mpath.h"
+#include "bgpd/bgp_updgrp.h"
+#include "bgpd/bgp_io.h"
+#include "bgpd/bgp_select.h"
 #ifdef HAVE_SNMP
 #include "bgpd/bgp_snmp.h"
 #endif /* HAVE_SNMP */
@@ -282,6 +285,8 @@ bgp_confederation_id_set (struct bgp *bgp, as_t as)
   struct listnode *node, *nnode;
   int already_confed;
 
+  bgp_update_group_changed (bgp);
+
   if (as == 0)
     return BGP_ERR_INVALID_AS;
 
@@ -342,6 +347,8 @@ bgp_confederation_id_unset (struct bgp *bgp)
   struct peer *peer;
   struct listnode *node, *nnode;
 
+  bgp_update_group_changed (bgp);
+
   bgp->confed_id = 0;
   bgp_config_unset (bgp, BGP_CONFIG_CONFEDERATION);
       
@@ -388,6 +395,8 @@ bgp_confederation_peers_add (struct bgp *bgp, as_t as)
   struct peer *peer;
   struct listnode *node, *nnode;
 
+  bgp_update_group_changed (bgp);
+
   if (! bgp)
     return BGP_ERR_INVALID_BGP;
 
@@ -438,6 +447,8 @@ bgp_confederation_peers_remove (struct bgp *bgp, as_t as)
   struct peer *peer;
   struct listnode *node, *nnode;
 
+  bgp_update_group_changed (bgp);
+
   if (! bgp)
     return -1;
 
@@ -508,6 +519,29 @@ bgp_default_local_preference_unset (struct bgp *bgp)
 
   return 0;
 }
+
+/* Read quantum configuration.  */
+int
+bgp_read_quantum_set (struct bgp *bgp, u_int32_t quantum)
+{
+  if (! bgp)
+    return -1;
+
+  bgp->read_quantum = quantum;
+
+  return 0;
+}
+
+int
+bgp_read_quantum_unset (struct bgp *bgp)
+{
+  if (! bgp)
+    return -1;
+
+  bgp->read_quantum = BGP_DEFAULT_READ_QUANTUM;
+
+  return 0;
+}
 
 /* If peer is RSERVER_CLIENT in at least one address family and is not member
     of a peer_group for that family, return 1.
@@ -716,6 +750,7 @@ peer_free (struct peer *peer)
    * but just to be sure.. 
    */
   bgp_timer_set (peer);
+  bgp_io_peer_stop (peer);
   BGP_READ_OFF (peer->t_read);
   BGP_WRITE_OFF (peer->t_write);
   BGP_EVENT_FLUSH (peer);
@@ -865,6 +900,7 @@ peer_create (union sockunion *su, struct bgp *bgp, as_t local_as,
     
   peer = peer_lock (peer); /* bgp peer list reference */
   listnode_add_sort (bgp->peer, peer);
+  bgp->peer_version++;
 
   active = peer_active (peer);
 
@@ -898,6 +934,7 @@ peer_create_accept (struct bgp *bgp)
   
   peer = peer_lock (peer); /* bgp peer list reference */
   listnode_add_sort (bgp->peer, peer);
+  bgp->peer_version++;
 
   return peer;
 }
@@ -908,6 +945,8 @@ peer_as_change (struct peer *peer, as_t as)
 {
   bgp_peer_sort_t type;
 
+  bgp_update_group_changed (peer->bgp);
+
   /* Stop peer. */
   if (! CHECK_FLAG (peer->sflags, PEER_STATUS_GROUP))
     {
@@ -1222,6 +1261,7 @@ peer_delete (struct peer *peer)
   peer->last_reset = PEER_DOWN_NEIGHBOR_DELETE;
   bgp_stop (peer);
   bgp_fsm_change_status (peer, Deleted);
+  bgp_update_group_leave_all (peer);
 
   /* Password configuration */
   if (peer->password)
@@ -1241,6 +1281,7 @@ peer_delete (struct peer *peer)
     {
       peer_unlock (peer); /* bgp peer list reference */
       list_delete_node (bgp->peer, pn);
+      bgp->peer_version++;
     }
       
   if (peer_rsclient_active (peer)
@@ -1749,6 +1790,8 @@ peer_group_bind (struct bgp *bgp, union sockunion *su,
   struct peer *peer;
   int first_member = 0;
 
+  bgp_update_group_changed (bgp);
+
   /* Check peer group's address family.  */
   if (! group->conf->afc[afi][safi])
     return BGP_ERR_PEER_GROUP_AF_UNCONFIGURED;
@@ -1891,6 +1934,8 @@ peer_group_unbind (struct bgp *bgp, struct peer *peer,
   if (! peer->af_group[afi][safi])
       return 0;
 
+  bgp_update_group_changed (bgp);
+
   if (group != peer->group)
     return BGP_ERR_PEER_GROUP_MISMATCH;
 
@@ -1959,9 +2004,11 @@ bgp_create (as_t *as, const char *name)
 	bgp->rib[afi][safi] = bgp_table_init (afi, safi);
 	bgp->maxpaths[afi][safi].maxpaths_ebgp = BGP_DEFAULT_MAXPATHS;
 	bgp->maxpaths[afi][safi].maxpaths_ibgp = BGP_DEFAULT_MAXPATHS;
+	bgp->update_groups[afi][safi] = list_new ();
       }
 
   bgp->default_local_pref = BGP_DEFAULT_LOCAL_PREF;
+  bgp->read_quantum = BGP_DEFAULT_READ_QUANTUM;
   bgp->default_holdtime = BGP_DEFAULT_HOLDTIME;
   bgp->default_keepalive = BGP_DEFAULT_KEEPALIVE;
   bgp->restart_time = BGP_DEFAULT_RESTART_TIME;
@@ -2160,6 +2207,7 @@ bgp_free (struct bgp *bgp)
           bgp_table_finish (&bgp->aggregate[afi][safi]) ;
 	if (bgp->rib[afi][safi])
           bgp_table_finish (&bgp->rib[afi][safi]);
+	list_delete (bgp->update_groups[afi][safi]);
       }
   XFREE (MTYPE_BGP, bgp);
 }
@@ -2447,6 +2495,8 @@ peer_flag_modify (struct peer *peer, u_int32_t flag, int set)
   struct listnode *node, *nnode;
   struct peer_flag_action action;
 
+  bgp_update_group_changed (peer->bgp);
+
   memset (&action, 0, sizeof (struct peer_flag_action));
   size = sizeof peer_flag_action_list / sizeof (struct peer_flag_action);
 
@@ -2550,6 +2600,8 @@ peer_af_flag_modify (struct peer *peer, afi_t afi, safi_t safi, u_int32_t flag,
   struct peer_group *group;
   struct peer_flag_action action;
 
+  bgp_update_group_changed (peer->bgp);
+
   memset (&action, 0, sizeof (struct peer_flag_action));
   size = sizeof peer_af_flag_action_list / sizeof (struct peer_flag_action);
   
@@ -3411,6 +3463,8 @@ peer_local_as_set (struct peer *peer, as_t as, int no_prepend)
   struct peer_group *group;
   struct listnode *node, *nnode;
 
+  bgp_update_group_changed (peer->bgp);
+
   if (peer_sort (peer) != BGP_PEER_EBGP
       && peer_sort (peer) != BGP_PEER_INTERNAL)
     return BGP_ERR_LOCAL_AS_ALLOWED_ONLY_FOR_EBGP;
@@ -3474,6 +3528,8 @@ peer_local_as_unset (struct peer *peer)
   struct peer_group *group;
   struct listnode *node, *nnode;
 
+  bgp_update_group_changed (peer->bgp);
+
   if (peer_group_active (peer))
     return BGP_ERR_INVALID_FOR_PEER_GROUP_MEMBER;
 
@@ -3629,6 +3685,8 @@ peer_distribute_set (struct peer *peer, afi_t afi, safi_t safi, int direct,
   struct peer_group *group;
   struct listnode *node, *nnode;
 
+  bgp_update_group_changed (peer->bgp);
+
   if (! peer->afc[afi][safi])
     return BGP_ERR_PEER_INACTIVE;
 
@@ -3676,6 +3734,8 @@ peer_distribute_unset (struct peer *peer, afi_t afi, safi_t safi, int direct)
   struct peer_group *group;
   struct listnode *node, *nnode;
 
+  bgp_update_group_changed (peer->bgp);
+
   if (! peer->afc[afi][safi])
     return BGP_ERR_PEER_INACTIVE;
 
@@ -3741,6 +3801,9 @@ peer_distribute_update (struct access_list *access)
   struct peer_group *group;
   struct bgp_filter *filter;
 
+  /* Route-map matches may refer to the list. */
+  route_map_cache_invalidate ();
+
   for (ALL_LIST_ELEMENTS (bm->bgp, mnode, mnnode, bgp))
     {
       for (ALL_LIST_ELEMENTS (bgp->peer, node, nnode, peer))
@@ -3789,6 +3852,8 @@ peer_prefix_list_set (struct peer *peer, afi_t afi, safi_t safi, int direct,
   struct peer_group *group;
   struct listnode *node, *nnode;
 
+  bgp_update_group_changed (peer->bgp);
+
   if (! peer->afc[afi][safi])
     return BGP_ERR_PEER_INACTIVE;
 
@@ -3835,6 +3900,8 @@ peer_prefix_list_unset (struct peer *peer, afi_t afi, safi_t safi, int direct)
   struct peer_group *group;
   struct listnode *node, *nnode;
 
+  bgp_update_group_changed (peer->bgp);
+
   if (! peer->afc[afi][safi])
     return BGP_ERR_PEER_INACTIVE;
 
@@ -3886,6 +3953,19 @@ peer_prefix_list_unset (struct peer *peer, afi_t afi, safi_t safi, int direct)
   return 0;
 }
 
+/* Look up the list of a reference by name again if it is to the list
+   changed, NULL for any. */
+static void
+peer_prefix_list_relookup (struct prefix_list *changed, afi_t afi,
+			   const char *name, struct prefix_list **plist)
+{
+  if (name == NULL)
+    *plist = NULL;
+  else if (changed == NULL || changed->name == NULL
+	   || strcmp (name, changed->name) == 0)
+    *plist = prefix_list_lookup (afi, name);
+}
+
 /* Update prefix-list list. */
 static void
 peer_prefix_list_update (struct prefix_list *plist)
@@ -3900,6 +3980,9 @@ peer_prefix_list_update (struct prefix_list *plist)
   safi_t safi;
   int direct;
 
+  /* Route-map matches may refer to the list. */
+  route_map_cache_invalidate ();
+
   for (ALL_LIST_ELEMENTS (bm->bgp, mnode, mnnode, bgp))
     {
       for (ALL_LIST_ELEMENTS (bgp->peer, node, nnode, peer))
@@ -3910,13 +3993,9 @@ peer_prefix_list_update (struct prefix_list *plist)
 		filter = &peer->filter[afi][safi];
 
 		for (direct = FILTER_IN; direct < FILTER_MAX; direct++)
-		  {
-		    if (filter->plist[direct].name)
-		      filter->plist[direct].plist = 
-			prefix_list_lookup (afi, filter->plist[direct].name);
-		    else
-		      filter->plist[direct].plist = NULL;
-		  }
+		  peer_prefix_list_relookup (plist, afi,
+					     filter->plist[direct].name,
+					     &filter->plist[direct].plist);
 	      }
 	}
       for (ALL_LIST_ELEMENTS (bgp->group, node, nnode, group))
@@ -3927,13 +4006,9 @@ peer_prefix_list_update (struct prefix_list *plist)
 		filter = &group->conf->filter[afi][safi];
 
 		for (direct = FILTER_IN; direct < FILTER_MAX; direct++)
-		  {
-		    if (filter->plist[direct].name)
-		      filter->plist[direct].plist = 
-			prefix_list_lookup (afi, filter->plist[direct].name);
-		    else
-		      filter->plist[direct].plist = NULL;
-		  }
+		  peer_prefix_list_relookup (plist, afi,
+					     filter->plist[direct].name,
+					     &filter->plist[direct].plist);
 	      }
 	}
     }
@@ -3947,6 +4022,8 @@ peer_aslist_set (struct peer *peer, afi_t afi, safi_t safi, int direct,
   struct peer_group *group;
   struct listnode *node, *nnode;
 
+  bgp_update_group_changed (peer->bgp);
+
   if (! peer->afc[afi][safi])
     return BGP_ERR_PEER_INACTIVE;
 
@@ -3990,6 +4067,8 @@ peer_aslist_unset (struct peer *peer,afi_t afi, safi_t safi, int direct)
   struct peer_group *group;
   struct listnode *node, *nnode;
 
+  bgp_update_group_changed (peer->bgp);
+
   if (! peer->afc[afi][safi])
     return BGP_ERR_PEER_INACTIVE;
 
@@ -4054,6 +4133,9 @@ peer_aslist_update (void)
   struct peer_group *group;
   struct bgp_filter *filter;
 
+  /* Route-map matches may refer to the list. */
+  route_map_cache_invalidate ();
+
   for (ALL_LIST_ELEMENTS (bm->bgp, mnode, mnnode, bgp))
     {
       for (ALL_LIST_ELEMENTS (bgp->peer, node, nnode, peer))
@@ -4102,6 +4184,8 @@ peer_route_map_set (struct peer *peer, afi_t afi, safi_t safi, int direct,
   struct peer_group *group;
   struct listnode *node, *nnode;
 
+  bgp_update_group_changed (peer->bgp);
+
   if (! peer->afc[afi][safi])
     return BGP_ERR_PEER_INACTIVE;
 
@@ -4149,6 +4233,8 @@ peer_route_map_unset (struct peer *peer, afi_t afi, safi_t safi, int direct)
   struct peer_group *group;
   struct listnode *node, *nnode;
 
+  bgp_update_group_changed (peer->bgp);
+
   if (! peer->afc[afi][safi])
     return BGP_ERR_PEER_INACTIVE;
 
@@ -4210,6 +4296,8 @@ peer_unsuppress_map_set (struct peer *peer, afi_t afi, safi_t safi,
   struct peer_group *group;
   struct listnode *node, *nnode;
 
+  bgp_update_group_changed (peer->bgp);
+
   if (! peer->afc[afi][safi])
     return BGP_ERR_PEER_INACTIVE;
 
@@ -4251,6 +4339,8 @@ peer_unsuppress_map_unset (struct peer *peer, afi_t afi, safi_t safi)
   struct peer_group *group;
   struct listnode *node, *nnode;
 
+  bgp_update_group_changed (peer->bgp);
+
   if (! peer->afc[afi][safi])
     return BGP_ERR_PEER_INACTIVE;
   
@@ -5167,6 +5257,14 @@ bgp_config_write (struct vty *vty)
       write++;
     }
 
+  /* BGP selection pthreads. */
+  if (bgp_select_threads ())
+    {
+      vty_out (vty, "bgp process-threads %u%s", bgp_select_threads (),
+	       VTY_NEWLINE);
+      write++;
+    }
+
   /* BGP configuration. */
   for (ALL_LIST_ELEMENTS (bm->bgp, mnode, mnnode, bgp))
     {
@@ -5213,6 +5311,11 @@ bgp_config_write (struct vty *vty)
 	vty_out (vty, " bgp default local-preference %d%s",
 		 bgp->default_local_pref, VTY_NEWLINE);
 
+      /* BGP read quantum. */
+      if (bgp->read_quantum != BGP_DEFAULT_READ_QUANTUM)
+	vty_out (vty, " bgp read-quantum %u%s", bgp->read_quantum,
+		 VTY_NEWLINE);
+
       /* BGP client-to-client reflection. */
       if (bgp_flag_check (bgp, BGP_FLAG_NO_CLIENT_TO_CLIENT))
 	vty_out (vty, " no bgp client-to-client reflection%s", VTY_NEWLINE);
@@ -5368,6 +5471,8 @@ bgp_init (void)
   bgp_route_map_init ();
   bgp_address_init ();
   bgp_scan_init ();
+  bgp_update_group_init ();
+  bgp_io_init ();
   bgp_mplsvpn_init ();
 
   /* Access list initialize. */
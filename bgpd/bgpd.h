@@ -38,6 +38,9 @@ struct bgp_master
   /* BGP thread master.  */
   struct thread_master *master;
 
+  /* Thread master of the I/O pthread, see bgp_io.c.  */
+  struct thread_master *io_master;
+
   /* work queues */
   struct work_queue *process_main_queue;
   struct work_queue *process_rsclient_queue;
@@ -80,6 +83,10 @@ struct bgp
   /* BGP peer. */
   struct list *peer;
 
+  /* Bumped whenever a peer joins or leaves the list, which the MRT peer
+     index table numbers them by. */
+  unsigned int peer_version;
+
   /* BGP peer group.  */
   struct list *group;
 
@@ -156,6 +163,9 @@ struct bgp
   /* BGP default local-preference.  */
   u_int32_t default_local_pref;
 
+  /* Messages taken from a peer before others get a turn.  */
+  u_int32_t read_quantum;
+
   /* BGP default timer.  */
   u_int32_t default_holdtime;
   u_int32_t default_keepalive;
@@ -169,6 +179,13 @@ struct bgp
     u_int16_t maxpaths_ebgp;
     u_int16_t maxpaths_ibgp;
   } maxpaths[AFI_MAX][SAFI_MAX];
+
+  /* Update groups of the peers.  */
+  struct list *update_groups[AFI_MAX][SAFI_MAX];
+  int update_groups_changed;
+  unsigned int update_group_id;
+  unsigned long update_group_splits;
+  unsigned long update_group_merges;
 };
 
 /* BGP peer-group support. */
@@ -312,6 +329,10 @@ struct peer
   struct stream_fifo *obuf;
   struct stream *work;
 
+  /* Once Established, reading and writing are done by the I/O
+     pthread with this. */
+  struct bgp_io *io;
+
   /* Status of the peer. */
   int status;
   int ostatus;
@@ -502,6 +523,9 @@ struct peer
   /* Announcement attribute hash.  */
   struct hash *hash[AFI_MAX][SAFI_MAX];
 
+  /* Update group, if in one.  */
+  struct update_group *update_group[AFI_MAX][SAFI_MAX];
+
   /* Notify data. */
   struct bgp_notify notify;
 
@@ -742,6 +766,9 @@ struct bgp_nlri
 /* BGP default local preference.  */
 #define BGP_DEFAULT_LOCAL_PREF                 100
 
+/* BGP default read quantum.  */
+#define BGP_DEFAULT_READ_QUANTUM                64
+
 /* BGP graceful restart  */
 #define BGP_DEFAULT_RESTART_TIME               120
 #define BGP_DEFAULT_STALEPATH_TIME             360
@@ -881,6 +908,9 @@ extern int bgp_timers_unset (struct bgp *);
 extern int bgp_default_local_preference_set (struct bgp *, u_int32_t);
 extern int bgp_default_local_preference_unset (struct bgp *);
 
+extern int bgp_read_quantum_set (struct bgp *, u_int32_t);
+extern int bgp_read_quantum_unset (struct bgp *);
+
 extern int peer_rsclient_active (struct peer *);
 
 extern int peer_remote_as (struct bgp *, union sockunion *, as_t *, afi_t, safi_t);
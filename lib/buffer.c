@@ -127,6 +127,18 @@ buffer_empty (struct buffer *b)
   return (b->head == NULL);
 }
 
+/* Return the number of bytes waiting to be flushed. */
+size_t
+buffer_pending (struct buffer *b)
+{
+  struct buffer_data *data;
+  size_t pending = 0;
+
+  for (data = b->head; data; data = data->next)
+    pending += data->cp - data->sp;
+  return pending;
+}
+
 /* Clear and free all allocated data. */
 void
 buffer_reset (struct buffer *b)
@@ -393,15 +405,15 @@ buffer_status_t
 buffer_flush_available(struct buffer *b, int fd)
 {
 
-/* These are just reasonable values to make sure a significant amount of
-data is written.  There's no need to go crazy and try to write it all
-in one shot. */
+/* Hand the kernel as much as a single writev() takes, it will accept
+what fits in the socket buffer.  A zebra sending a full table to its
+clients otherwise needs a system call per 64k. */
 #ifdef IOV_MAX
-#define MAX_CHUNKS ((IOV_MAX >= 16) ? 16 : IOV_MAX)
+#define MAX_CHUNKS ((IOV_MAX <= 256) ? IOV_MAX : 256)
 #else
 #define MAX_CHUNKS 16
 #endif
-#define MAX_FLUSH 131072
+#define MAX_FLUSH (MAX_CHUNKS * 4096)
 
   struct buffer_data *d;
   size_t written;
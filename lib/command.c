@@ -30,6 +30,7 @@ Boston, MA 02111-1307, USA.  */
 #include "vty.h"
 #include "command.h"
 #include "workqueue.h"
+#include "hash.h"
 
 /* Command vector which includes some level of command lists. Normally
    each daemon maintains each own cmdvec. */
@@ -186,6 +187,191 @@ argv_concat (const char **argv, int argc, int shift)
   return str;
 }
 
+/* Token trie of the commands of a node.  A token stands for one word of
+   commands, the descs cmd_make_descvec() made for it, and commands whose
+   first words have the same descs share the tokens of them, so a line is
+   matched against the words that may follow what it matched so far
+   instead of against every command of the node. */
+struct cmd_token
+{
+  /* Descs of the word, NULL for the root. */
+  vector descvec;
+
+  /* Tokens of the next words: those of one keyword, sorted by it, and
+     all the others.  NULL while there are none. */
+  vector keywords;
+  vector others;
+
+  /* Commands through the token, and how many of them the words up to
+     and including it complete. */
+  unsigned int count;
+  unsigned int complete;
+
+  /* The last of those inserted, for when there is just one. */
+  struct cmd_element *cmd;
+  struct cmd_element *complete_cmd;
+};
+
+/* The keyword a word of a command consists of, or NULL if it has
+   alternatives or is a variable of any kind. */
+static const char *
+cmd_descvec_keyword (vector descvec)
+{
+  struct desc *desc;
+
+  if (vector_active (descvec) != 1
+      || (desc = vector_slot (descvec, 0)) == NULL)
+    return NULL;
+
+  if (CMD_VARARG (desc->cmd) || CMD_RANGE (desc->cmd)
+      || CMD_OPTION (desc->cmd) || CMD_VARIABLE (desc->cmd))
+    return NULL;
+  return desc->cmd;
+}
+
+/* Do the two words have the same descs? */
+static int
+cmd_descvec_same (vector a, vector b)
+{
+  unsigned int i;
+  struct desc *da, *db;
+
+  if (vector_active (a) != vector_active (b))
+    return 0;
+  for (i = 0; i < vector_active (a); i++)
+    {
+      da = vector_slot (a, i);
+      db = vector_slot (b, i);
+      if (da == NULL || db == NULL)
+	{
+	  if (da != db)
+	    return 0;
+	}
+      else if (strcmp (da->cmd, db->cmd) != 0)
+	return 0;
+    }
+  return 1;
+}
+
+static struct cmd_token *
+cmd_token_new (vector descvec)
+{
+  struct cmd_token *token;
+
+  token = XCALLOC (MTYPE_CMD_TOKEN, sizeof (struct cmd_token));
+  token->descvec = descvec;
+  return token;
+}
+
+static void
+cmd_token_free (struct cmd_token *token)
+{
+  unsigned int i;
+
+  if (token->keywords)
+    {
+      for (i = 0; i < vector_active (token->keywords); i++)
+	cmd_token_free (vector_slot (token->keywords, i));
+      vector_free (token->keywords);
+    }
+  if (token->others)
+    {
+      for (i = 0; i < vector_active (token->others); i++)
+	cmd_token_free (vector_slot (token->others, i));
+      vector_free (token->others);
+    }
+  XFREE (MTYPE_CMD_TOKEN, token);
+}
+
+#define cmd_token_keyword(T) \
+  (((struct desc *) vector_slot ((T)->descvec, 0))->cmd)
+
+/* Index of the first of the sorted keyword tokens whose keyword is not
+   less than word. */
+static unsigned int
+cmd_token_search (vector keywords, const char *word)
+{
+  unsigned int low = 0, high = vector_active (keywords), mid;
+
+  while (low < high)
+    {
+      mid = (low + high) / 2;
+      if (strcmp (cmd_token_keyword ((struct cmd_token *)
+				     vector_slot (keywords, mid)), word) < 0)
+	low = mid + 1;
+      else
+	high = mid;
+    }
+  return low;
+}
+
+/* The token under parent for the word descvec, made if need be. */
+static struct cmd_token *
+cmd_token_get (struct cmd_token *parent, vector descvec)
+{
+  struct cmd_token *token;
+  const char *keyword;
+  unsigned int i;
+
+  if ((keyword = cmd_descvec_keyword (descvec)) != NULL)
+    {
+      if (parent->keywords == NULL)
+	parent->keywords = vector_init (VECTOR_MIN_SIZE);
+
+      i = cmd_token_search (parent->keywords, keyword);
+      if (i < vector_active (parent->keywords)
+	  && strcmp (cmd_token_keyword ((struct cmd_token *)
+					vector_slot (parent->keywords, i)),
+		     keyword) == 0)
+	return vector_slot (parent->keywords, i);
+
+      token = cmd_token_new (descvec);
+      vector_ensure (parent->keywords, vector_active (parent->keywords));
+      memmove (&parent->keywords->index[i + 1], &parent->keywords->index[i],
+	       (vector_active (parent->keywords) - i) * sizeof (void *));
+      vector_slot (parent->keywords, i) = token;
+      parent->keywords->active++;
+      return token;
+    }
+
+  if (parent->others == NULL)
+    parent->others = vector_init (VECTOR_MIN_SIZE);
+
+  for (i = 0; i < vector_active (parent->others); i++)
+    {
+      token = vector_slot (parent->others, i);
+      if (cmd_descvec_same (token->descvec, descvec))
+	return token;
+    }
+
+  token = cmd_token_new (descvec);
+  vector_set (parent->others, token);
+  return token;
+}
+
+/* Add the words of cmd to the tokens under root. */
+static void
+cmd_token_insert (struct cmd_token *root, struct cmd_element *cmd)
+{
+  struct cmd_token *token = root;
+  unsigned int i = 0;
+
+  while (1)
+    {
+      token->count++;
+      token->cmd = cmd;
+      if ((unsigned int) cmd->cmdsize <= i)
+	{
+	  token->complete++;
+	  token->complete_cmd = cmd;
+	}
+
+      if (i >= vector_active (cmd->strvec))
+	break;
+      token = cmd_token_get (token, vector_slot (cmd->strvec, i++));
+    }
+}
+
 /* Install top node of command vector. */
 void
 install_node (struct cmd_node *node, 
@@ -194,6 +380,7 @@ install_node (struct cmd_node *node,
   vector_set_index (cmdvec, node->node, node);
   node->func = func;
   node->cmd_vector = vector_init (VECTOR_MIN_SIZE);
+  node->tokens = cmd_token_new (NULL);
 }
 
 /* Compare two command's string.  Used in sort_node (). */
@@ -502,6 +689,7 @@ install_element (enum node_type ntype, struct cmd_element *cmd)
     cmd->strvec = cmd_make_descvec (cmd->string, cmd->doc);
 
   cmd->cmdsize = cmd_cmdsize (cmd->strvec);
+  cmd_token_insert (cnode->tokens, cmd);
 }
 
 static const unsigned char itoa64[] =
@@ -607,6 +795,9 @@ config_write_host (struct vty *vty)
     vty_out (vty, "log timestamp precision %d%s",
 	     zlog_default->timestamp_precision, VTY_NEWLINE);
 
+  if (zlog_get_async (zlog_default))
+    vty_out (vty, "log async%s", VTY_NEWLINE);
+
   if (host.advanced)
     vty_out (vty, "service advanced-vty%s", VTY_NEWLINE);
 
@@ -1051,131 +1242,90 @@ cmd_range_match (const char *range, const char *str)
   return 1;
 }
 
-/* Make completion match and return match type flag. */
+/* Match type of the word command against the desc str of a command,
+   no_match if it does not match.  Strict matching, as for reading
+   configuration, takes neither abbreviated keywords nor incomplete
+   addresses. */
 static enum match_type
-cmd_filter_by_completion (char *command, vector v, unsigned int index)
+cmd_desc_match (const char *str, const char *command, int strict)
 {
-  unsigned int i;
-  const char *str;
-  struct cmd_element *cmd_element;
-  enum match_type match_type;
-  vector descvec;
-  struct desc *desc;
-
-  match_type = no_match;
-
-  /* If command and cmd_element string does not match set NULL to vector */
-  for (i = 0; i < vector_active (v); i++)
-    if ((cmd_element = vector_slot (v, i)) != NULL)
-      {
-	if (index >= vector_active (cmd_element->strvec))
-	  vector_slot (v, i) = NULL;
-	else
-	  {
-	    unsigned int j;
-	    int matched = 0;
-
-	    descvec = vector_slot (cmd_element->strvec, index);
-
-	    for (j = 0; j < vector_active (descvec); j++)
-	      if ((desc = vector_slot (descvec, j)))
-		{
-		  str = desc->cmd;
-		  
-		  if (CMD_VARARG (str))
-		    {
-		      if (match_type < vararg_match)
-			match_type = vararg_match;
-		      matched++;
-		    }
-		  else if (CMD_RANGE (str))
-		    {
-		      if (cmd_range_match (str, command))
-			{
-			  if (match_type < range_match)
-			    match_type = range_match;
+  enum match_type ret;
 
-			  matched++;
-			}
-		    }
+  if (CMD_VARARG (str))
+    return vararg_match;
+  else if (CMD_RANGE (str))
+    {
+      if (cmd_range_match (str, command))
+	return range_match;
+    }
 #ifdef HAVE_IPV6
-		  else if (CMD_IPV6 (str))
-		    {
-		      if (cmd_ipv6_match (command))
-			{
-			  if (match_type < ipv6_match)
-			    match_type = ipv6_match;
+  else if (CMD_IPV6 (str))
+    {
+      ret = cmd_ipv6_match (command);
+      if (ret == exact_match || (! strict && ret != no_match))
+	return ipv6_match;
+    }
+  else if (CMD_IPV6_PREFIX (str))
+    {
+      ret = cmd_ipv6_prefix_match (command);
+      if (ret == exact_match || (! strict && ret != no_match))
+	return ipv6_prefix_match;
+    }
+#endif /* HAVE_IPV6  */
+  else if (CMD_IPV4 (str))
+    {
+      ret = cmd_ipv4_match (command);
+      if (ret == exact_match || (! strict && ret != no_match))
+	return ipv4_match;
+    }
+  else if (CMD_IPV4_PREFIX (str))
+    {
+      ret = cmd_ipv4_prefix_match (command);
+      if (ret == exact_match || (! strict && ret != no_match))
+	return ipv4_prefix_match;
+    }
+  else
+    /* Check is this point's argument optional ? */
+  if (CMD_OPTION (str) || CMD_VARIABLE (str))
+    return extend_match;
+  else if (strict)
+    {
+      if (strcmp (command, str) == 0)
+	return exact_match;
+    }
+  else if (strncmp (command, str, strlen (command)) == 0)
+    return strcmp (command, str) == 0 ? exact_match : partly_match;
 
-			  matched++;
-			}
-		    }
-		  else if (CMD_IPV6_PREFIX (str))
-		    {
-		      if (cmd_ipv6_prefix_match (command))
-			{
-			  if (match_type < ipv6_prefix_match)
-			    match_type = ipv6_prefix_match;
+  return no_match;
+}
 
-			  matched++;
-			}
-		    }
-#endif /* HAVE_IPV6  */
-		  else if (CMD_IPV4 (str))
-		    {
-		      if (cmd_ipv4_match (command))
-			{
-			  if (match_type < ipv4_match)
-			    match_type = ipv4_match;
+/* Best match type of command against the descs of one word of a
+   command, no_match if none of them matches. */
+static enum match_type
+cmd_descvec_match (const char *command, vector descvec, int strict)
+{
+  unsigned int i;
+  struct desc *desc;
+  enum match_type ret, match_type = no_match;
 
-			  matched++;
-			}
-		    }
-		  else if (CMD_IPV4_PREFIX (str))
-		    {
-		      if (cmd_ipv4_prefix_match (command))
-			{
-			  if (match_type < ipv4_prefix_match)
-			    match_type = ipv4_prefix_match;
-			  matched++;
-			}
-		    }
-		  else
-		    /* Check is this point's argument optional ? */
-		  if (CMD_OPTION (str) || CMD_VARIABLE (str))
-		    {
-		      if (match_type < extend_match)
-			match_type = extend_match;
-		      matched++;
-		    }
-		  else if (strncmp (command, str, strlen (command)) == 0)
-		    {
-		      if (strcmp (command, str) == 0)
-			match_type = exact_match;
-		      else
-			{
-			  if (match_type < partly_match)
-			    match_type = partly_match;
-			}
-		      matched++;
-		    }
-		}
-	    if (!matched)
-	      vector_slot (v, i) = NULL;
-	  }
+  for (i = 0; i < vector_active (descvec); i++)
+    if ((desc = vector_slot (descvec, i)))
+      {
+	ret = cmd_desc_match (desc->cmd, command, strict);
+	if (match_type < ret)
+	  match_type = ret;
       }
   return match_type;
 }
 
-/* Filter vector by command character with index. */
+/* Filter the command vector by the word command at index, strictly or
+   by completion, and return the best match type. */
 static enum match_type
-cmd_filter_by_string (char *command, vector v, unsigned int index)
+cmd_filter (char *command, vector v, unsigned int index, int strict)
 {
   unsigned int i;
-  const char *str;
   struct cmd_element *cmd_element;
-  enum match_type match_type;
-  vector descvec;
-  struct desc *desc;
+  enum match_type match_type, ret;
 
   match_type = no_match;
 
@@ -1183,95 +1333,116 @@ cmd_filter_by_string (char *command, vector v, unsigned int index)
   for (i = 0; i < vector_active (v); i++)
     if ((cmd_element = vector_slot (v, i)) != NULL)
       {
-	/* If given index is bigger than max string vector of command,
-	   set NULL */
 	if (index >= vector_active (cmd_element->strvec))
 	  vector_slot (v, i) = NULL;
 	else
 	  {
-	    unsigned int j;
-	    int matched = 0;
+	    ret = cmd_descvec_match (command,
+				     vector_slot (cmd_element->strvec, index),
+				     strict);
+	    if (ret == no_match)
+	      vector_slot (v, i) = NULL;
+	    else if (match_type < ret)
+	      match_type = ret;
+	  }
+      }
+  return match_type;
+}
 
-	    descvec = vector_slot (cmd_element->strvec, index);
+/* Make completion match and return match type flag. */
+static enum match_type
+cmd_filter_by_completion (char *command, vector v, unsigned int index)
+{
+  return cmd_filter (command, v, index, 0);
+}
 
-	    for (j = 0; j < vector_active (descvec); j++)
-	      if ((desc = vector_slot (descvec, j)))
-		{
-		  str = desc->cmd;
+/* Check the descs of one word of a command against command once the
+   words have been filtered to match type.  Returns 1 if a desc matching
+   differs from the one *matched so far, which makes the word ambiguous,
+   2 if command is an incomplete prefix, otherwise 0 with *match set to
+   whether any of the descs matched. */
+static int
+cmd_descvec_ambiguous (const char *command, vector descvec,
+		       enum match_type type, const char **matched, int *match)
+{
+  unsigned int j;
+  const char *str = NULL;
+  struct desc *desc;
 
-		  if (CMD_VARARG (str))
-		    {
-		      if (match_type < vararg_match)
-			match_type = vararg_match;
-		      matched++;
-		    }
-		  else if (CMD_RANGE (str))
-		    {
-		      if (cmd_range_match (str, command))
-			{
-			  if (match_type < range_match)
-			    match_type = range_match;
-			  matched++;
-			}
-		    }
+  *match = 0;
+  for (j = 0; j < vector_active (descvec); j++)
+    if ((desc = vector_slot (descvec, j)))
+      {
+	enum match_type ret;
+
+	str = desc->cmd;
+
+	switch (type)
+	  {
+	  case exact_match:
+	    if (!(CMD_OPTION (str) || CMD_VARIABLE (str))
+		&& strcmp (command, str) == 0)
+	      (*match)++;
+	    break;
+	  case partly_match:
+	    if (!(CMD_OPTION (str) || CMD_VARIABLE (str))
+		&& strncmp (command, str, strlen (command)) == 0)
+	      {
+		if (*matched && strcmp (*matched, str) != 0)
+		  return 1;	/* There is ambiguous match. */
+		else
+		  *matched = str;
+		(*match)++;
+	      }
+	    break;
+	  case range_match:
+	    if (cmd_range_match (str, command))
+	      {
+		if (*matched && strcmp (*matched, str) != 0)
+		  return 1;
+		else
+		  *matched = str;
+		(*match)++;
+	      }
+	    break;
 #ifdef HAVE_IPV6
-		  else if (CMD_IPV6 (str))
-		    {
-		      if (cmd_ipv6_match (command) == exact_match)
-			{
-			  if (match_type < ipv6_match)
-			    match_type = ipv6_match;
-			  matched++;
-			}
-		    }
-		  else if (CMD_IPV6_PREFIX (str))
-		    {
-		      if (cmd_ipv6_prefix_match (command) == exact_match)
-			{
-			  if (match_type < ipv6_prefix_match)
-			    match_type = ipv6_prefix_match;
-			  matched++;
-			}
-		    }
-#endif /* HAVE_IPV6  */
-		  else if (CMD_IPV4 (str))
-		    {
-		      if (cmd_ipv4_match (command) == exact_match)
-			{
-			  if (match_type < ipv4_match)
-			    match_type = ipv4_match;
-			  matched++;
-			}
-		    }
-		  else if (CMD_IPV4_PREFIX (str))
-		    {
-		      if (cmd_ipv4_prefix_match (command) == exact_match)
-			{
-			  if (match_type < ipv4_prefix_match)
-			    match_type = ipv4_prefix_match;
-			  matched++;
-			}
-		    }
-		  else if (CMD_OPTION (str) || CMD_VARIABLE (str))
-		    {
-		      if (match_type < extend_match)
-			match_type = extend_match;
-		      matched++;
-		    }
-		  else
-		    {
-		      if (strcmp (command, str) == 0)
-			{
-			  match_type = exact_match;
-			  matched++;
-			}
-		    }
-		}
-	    if (!matched)
-	      vector_slot (v, i) = NULL;
+	  case ipv6_match:
+	    if (CMD_IPV6 (str))
+	      (*match)++;
+	    break;
+	  case ipv6_prefix_match:
+	    if ((ret = cmd_ipv6_prefix_match (command)) != no_match)
+	      {
+		if (ret == partly_match)
+		  return 2;	/* There is incomplete match. */
+
+		(*match)++;
+	      }
+	    break;
+#endif /* HAVE_IPV6 */
+	  case ipv4_match:
+	    if (CMD_IPV4 (str))
+	      (*match)++;
+	    break;
+	  case ipv4_prefix_match:
+	    if ((ret = cmd_ipv4_prefix_match (command)) != no_match)
+	      {
+		if (ret == partly_match)
+		  return 2;	/* There is incomplete match. */
+
+		(*match)++;
+	      }
+	    break;
+	  case extend_match:
+	    if (CMD_OPTION (str) || CMD_VARIABLE (str))
+	      (*match)++;
+	    break;
+	  case no_match:
+	  default:
+	    break;
 	  }
       }
-  return match_type;
+  return 0;
 }
 
 /* Check ambiguous match */
@@ -1279,96 +1450,241 @@ static int
 is_cmd_ambiguous (char *command, vector v, int index, enum match_type type)
 {
   unsigned int i;
-  unsigned int j;
-  const char *str = NULL;
   struct cmd_element *cmd_element;
   const char *matched = NULL;
-  vector descvec;
-  struct desc *desc;
+  int match, ret;
 
   for (i = 0; i < vector_active (v); i++)
     if ((cmd_element = vector_slot (v, i)) != NULL)
       {
-	int match = 0;
+	ret = cmd_descvec_ambiguous (command,
+				     vector_slot (cmd_element->strvec, index),
+				     type, &matched, &match);
+	if (ret)
+	  return ret;
+	if (!match)
+	  vector_slot (v, i) = NULL;
+      }
+  return 0;
+}
 
-	descvec = vector_slot (cmd_element->strvec, index);
+static void
+cmd_token_push (vector v, struct cmd_token *token)
+{
+  vector_ensure (v, vector_active (v));
+  vector_slot (v, vector_active (v)) = token;
+  v->active++;
+}
 
-	for (j = 0; j < vector_active (descvec); j++)
-	  if ((desc = vector_slot (descvec, j)))
-	    {
-	      enum match_type ret;
-	      
-	      str = desc->cmd;
+/* Match vline down the tokens of a node, word by word as the filtering
+   and ambiguity checks of the command vector above do, trying only the
+   words that may follow those matched.  Returns CMD_SUCCESS with the
+   one command matched in *matched, or the error of matching none or
+   more than one. */
+static int
+cmd_token_match (struct cmd_token *root, vector vline, int strict,
+		 struct cmd_element **matched)
+{
+  vector tokens, next;
+  struct cmd_token *token, *child;
+  unsigned int index, i, j, len;
+  unsigned int matched_count, incomplete_count;
+  enum match_type match = no_match, type;
+  const char *keyword, *ambiguous;
+  char *command;
+  int ret, found;
 
-	      switch (type)
-		{
-		case exact_match:
-		  if (!(CMD_OPTION (str) || CMD_VARIABLE (str))
-		      && strcmp (command, str) == 0)
-		    match++;
-		  break;
-		case partly_match:
-		  if (!(CMD_OPTION (str) || CMD_VARIABLE (str))
-		      && strncmp (command, str, strlen (command)) == 0)
-		    {
-		      if (matched && strcmp (matched, str) != 0)
-			return 1;	/* There is ambiguous match. */
-		      else
-			matched = str;
-		      match++;
-		    }
-		  break;
-		case range_match:
-		  if (cmd_range_match (str, command))
-		    {
-		      if (matched && strcmp (matched, str) != 0)
-			return 1;
-		      else
-			matched = str;
-		      match++;
-		    }
-		  break;
-#ifdef HAVE_IPV6
-		case ipv6_match:
-		  if (CMD_IPV6 (str))
-		    match++;
-		  break;
-		case ipv6_prefix_match:
-		  if ((ret = cmd_ipv6_prefix_match (command)) != no_match)
-		    {
-		      if (ret == partly_match)
-			return 2;	/* There is incomplete match. */
+  tokens = vector_init (VECTOR_MIN_SIZE);
+  next = vector_init (VECTOR_MIN_SIZE);
+  cmd_token_push (tokens, root);
 
-		      match++;
-		    }
-		  break;
-#endif /* HAVE_IPV6 */
-		case ipv4_match:
-		  if (CMD_IPV4 (str))
-		    match++;
-		  break;
-		case ipv4_prefix_match:
-		  if ((ret = cmd_ipv4_prefix_match (command)) != no_match)
-		    {
-		      if (ret == partly_match)
-			return 2;	/* There is incomplete match. */
+  matched_count = 0;
+  incomplete_count = 0;
+  *matched = NULL;
 
-		      match++;
-		    }
-		  break;
-		case extend_match:
-		  if (CMD_OPTION (str) || CMD_VARIABLE (str))
-		    match++;
-		  break;
-		case no_match:
-		default:
-		  break;
+  for (index = 0; index < vector_active (vline); index++)
+    {
+      /* Tokens of the next word that the word of the line matches.  A
+	 missing word, which lines never have, goes for any. */
+      command = vector_slot (vline, index);
+      next->active = 0;
+      match = no_match;
+
+      for (i = 0; i < vector_active (tokens); i++)
+	{
+	  token = vector_slot (tokens, i);
+
+	  if (token->keywords && command)
+	    {
+	      len = strlen (command);
+	      for (j = cmd_token_search (token->keywords, command);
+		   j < vector_active (token->keywords); j++)
+		{
+		  child = vector_slot (token->keywords, j);
+		  keyword = cmd_token_keyword (child);
+		  if (strcmp (command, keyword) == 0)
+		    type = exact_match;
+		  else if (! strict && strncmp (command, keyword, len) == 0)
+		    type = partly_match;
+		  else
+		    break;
+		  cmd_token_push (next, child);
+		  if (match < type)
+		    match = type;
 		}
 	    }
-	if (!match)
-	  vector_slot (v, i) = NULL;
+	  else if (token->keywords)
+	    for (j = 0; j < vector_active (token->keywords); j++)
+	      cmd_token_push (next, vector_slot (token->keywords, j));
+
+	  if (token->others)
+	    for (j = 0; j < vector_active (token->others); j++)
+	      {
+		child = vector_slot (token->others, j);
+		if (command == NULL)
+		  type = extend_match;
+		else if ((type = cmd_descvec_match (command, child->descvec,
+						    strict)) == no_match)
+		  continue;
+		cmd_token_push (next, child);
+		if (match < type)
+		  match = type;
+	      }
+	}
+
+      /* A word taking the rest of the line matches all the commands
+	 under the tokens. */
+      if (match == vararg_match)
+	{
+	  for (i = 0; i < vector_active (next); i++)
+	    {
+	      child = vector_slot (next, i);
+	      matched_count += child->count;
+	      *matched = child->cmd;
+	    }
+	  goto count;
+	}
+
+      tokens->active = 0;
+      ambiguous = NULL;
+      for (i = 0; i < vector_active (next); i++)
+	{
+	  child = vector_slot (next, i);
+	  if (command == NULL)
+	    found = 1;
+	  else if ((ret = cmd_descvec_ambiguous (command, child->descvec,
+						 match, &ambiguous, &found)))
+	    {
+	      vector_free (tokens);
+	      vector_free (next);
+	      return ret == 1 ? CMD_ERR_AMBIGUOUS : CMD_ERR_NO_MATCH;
+	    }
+	  if (found)
+	    cmd_token_push (tokens, child);
+	}
+    }
+
+  for (i = 0; i < vector_active (tokens); i++)
+    {
+      token = vector_slot (tokens, i);
+      if (token->complete)
+	*matched = token->complete_cmd;
+      matched_count += token->complete;
+      incomplete_count += token->count - token->complete;
+    }
+
+ count:
+  vector_free (tokens);
+  vector_free (next);
+
+  /* To execute command, matched_count must be 1. */
+  if (matched_count == 0)
+    {
+      if (incomplete_count)
+	return CMD_ERR_INCOMPLETE;
+      else
+	return CMD_ERR_NO_MATCH;
+    }
+
+  if (matched_count > 1)
+    return CMD_ERR_AMBIGUOUS;
+
+  return CMD_SUCCESS;
+}
+
+/* Match vline against the commands of node down its token trie, as
+   executing a command does. */
+int
+cmd_match (vector vline, enum node_type node, int strict,
+	   struct cmd_element **matched)
+{
+  struct cmd_node *cnode = vector_slot (cmdvec, node);
+
+  return cmd_token_match (cnode->tokens, vline, strict, matched);
+}
+
+/* Match vline against the commands of node by filtering a copy of the
+   command vector word by word, as describe and completion do.  Gives
+   the same as cmd_match(), which tests check. */
+int
+cmd_match_vector (vector vline, enum node_type node, int strict,
+		  struct cmd_element **matched)
+{
+  unsigned int i;
+  unsigned int index;
+  vector cmd_vector;
+  struct cmd_element *cmd_element;
+  unsigned int matched_count, incomplete_count;
+  enum match_type match = 0;
+  char *command;
+  int ret;
+
+  cmd_vector = vector_copy (cmd_node_vector (cmdvec, node));
+  *matched = NULL;
+
+  for (index = 0; index < vector_active (vline); index++)
+    if ((command = vector_slot (vline, index)))
+      {
+	match = cmd_filter (command, cmd_vector, index, strict);
+
+	if (match == vararg_match)
+	  break;
+
+	ret = is_cmd_ambiguous (command, cmd_vector, index, match);
+	if (ret)
+	  {
+	    vector_free (cmd_vector);
+	    return ret == 1 ? CMD_ERR_AMBIGUOUS : CMD_ERR_NO_MATCH;
+	  }
       }
-  return 0;
+
+  matched_count = 0;
+  incomplete_count = 0;
+  for (i = 0; i < vector_active (cmd_vector); i++)
+    if ((cmd_element = vector_slot (cmd_vector, i)))
+      {
+	if (match == vararg_match || index >= cmd_element->cmdsize)
+	  {
+	    *matched = cmd_element;
+	    matched_count++;
+	  }
+	else
+	  incomplete_count++;
+      }
+  vector_free (cmd_vector);
+
+  if (matched_count == 0)
+    {
+      if (incomplete_count)
+	return CMD_ERR_INCOMPLETE;
+      else
+	return CMD_ERR_NO_MATCH;
+    }
+
+  if (matched_count > 1)
+    return CMD_ERR_AMBIGUOUS;
+
+  return CMD_SUCCESS;
 }
 
 /* If src matches dst return dst string, otherwise return NULL */
@@ -1926,80 +2242,17 @@ cmd_execute_command_real (vector vline, struct vty *vty,
 			  struct cmd_element **cmd)
 {
   unsigned int i;
-  unsigned int index;
-  vector cmd_vector;
-  struct cmd_element *cmd_element;
+  struct cmd_node *cnode;
   struct cmd_element *matched_element;
-  unsigned int matched_count, incomplete_count;
   int argc;
   const char *argv[CMD_ARGC_MAX];
-  enum match_type match = 0;
   int varflag;
-  char *command;
-
-  /* Make copy of command elements. */
-  cmd_vector = vector_copy (cmd_node_vector (cmdvec, vty->node));
-
-  for (index = 0; index < vector_active (vline); index++)
-    if ((command = vector_slot (vline, index)))
-      {
-	int ret;
-
-	match = cmd_filter_by_completion (command, cmd_vector, index);
-
-	if (match == vararg_match)
-	  break;
-        
-	ret = is_cmd_ambiguous (command, cmd_vector, index, match);
-
-	if (ret == 1)
-	  {
-	    vector_free (cmd_vector);
-	    return CMD_ERR_AMBIGUOUS;
-	  }
-	else if (ret == 2)
-	  {
-	    vector_free (cmd_vector);
-	    return CMD_ERR_NO_MATCH;
-	  }
-      }
-
-  /* Check matched count. */
-  matched_element = NULL;
-  matched_count = 0;
-  incomplete_count = 0;
-
-  for (i = 0; i < vector_active (cmd_vector); i++)
-    if ((cmd_element = vector_slot (cmd_vector, i)))
-      {
-	if (match == vararg_match || index >= cmd_element->cmdsize)
-	  {
-	    matched_element = cmd_element;
-#if 0
-	    printf ("DEBUG: %s\n", cmd_element->string);
-#endif
-	    matched_count++;
-	  }
-	else
-	  {
-	    incomplete_count++;
-	  }
-      }
-
-  /* Finish of using cmd_vector. */
-  vector_free (cmd_vector);
-
-  /* To execute command, matched_count must be 1. */
-  if (matched_count == 0)
-    {
-      if (incomplete_count)
-	return CMD_ERR_INCOMPLETE;
-      else
-	return CMD_ERR_NO_MATCH;
-    }
+  int ret;
 
-  if (matched_count > 1)
-    return CMD_ERR_AMBIGUOUS;
+  cnode = vector_slot (cmdvec, vty->node);
+  ret = cmd_token_match (cnode->tokens, vline, 0, &matched_element);
+  if (ret != CMD_SUCCESS)
+    return ret;
 
   /* Argument treatment */
   varflag = 0;
@@ -2105,77 +2358,17 @@ cmd_execute_command_strict (vector vline, struct vty *vty,
 			    struct cmd_element **cmd)
 {
   unsigned int i;
-  unsigned int index;
-  vector cmd_vector;
-  struct cmd_element *cmd_element;
+  struct cmd_node *cnode;
   struct cmd_element *matched_element;
-  unsigned int matched_count, incomplete_count;
   int argc;
   const char *argv[CMD_ARGC_MAX];
   int varflag;
-  enum match_type match = 0;
-  char *command;
-
-  /* Make copy of command element */
-  cmd_vector = vector_copy (cmd_node_vector (cmdvec, vty->node));
-
-  for (index = 0; index < vector_active (vline); index++)
-    if ((command = vector_slot (vline, index)))
-      {
-	int ret;
-	
-	match = cmd_filter_by_string (vector_slot (vline, index),
-				      cmd_vector, index);
-
-	/* If command meets '.VARARG' then finish matching. */
-	if (match == vararg_match)
-	  break;
-        
-	ret = is_cmd_ambiguous (command, cmd_vector, index, match);
-	if (ret == 1)
-	  {
-	    vector_free (cmd_vector);
-	    return CMD_ERR_AMBIGUOUS;
-	  }
-	if (ret == 2)
-	  {
-	    vector_free (cmd_vector);
-	    return CMD_ERR_NO_MATCH;
-	  }
-      }
-
-  /* Check matched count. */
-  matched_element = NULL;
-  matched_count = 0;
-  incomplete_count = 0;
-  for (i = 0; i < vector_active (cmd_vector); i++)
-    if (vector_slot (cmd_vector, i) != NULL)
-      {
-	cmd_element = vector_slot (cmd_vector, i);
-
-	if (match == vararg_match || index >= cmd_element->cmdsize)
-	  {
-	    matched_element = cmd_element;
-	    matched_count++;
-	  }
-	else
-	  incomplete_count++;
-      }
-
-  /* Finish of using cmd_vector. */
-  vector_free (cmd_vector);
-
-  /* To execute command, matched_count must be 1. */
-  if (matched_count == 0)
-    {
-      if (incomplete_count)
-	return CMD_ERR_INCOMPLETE;
-      else
-	return CMD_ERR_NO_MATCH;
-    }
+  int ret;
 
-  if (matched_count > 1)
-    return CMD_ERR_AMBIGUOUS;
+  cnode = vector_slot (cmdvec, vty->node);
+  ret = cmd_token_match (cnode->tokens, vline, 1, &matched_element);
+  if (ret != CMD_SUCCESS)
+    return ret;
 
   /* Argument treatment */
   varflag = 0;
@@ -2990,6 +3183,7 @@ DEFUN (show_logging,
        "Show current logging configuration\n")
 {
   struct zlog *zl = zlog_default;
+  unsigned long queued, written, dropped;
 
   vty_out (vty, "Syslog logging: ");
   if (zl->maxlvl[ZLOG_DEST_SYSLOG] == ZLOG_DISABLED)
@@ -3032,6 +3226,11 @@ DEFUN (show_logging,
   	   (zl->record_priority ? "enabled" : "disabled"), VTY_NEWLINE);
   vty_out (vty, "Timestamp precision: %d%s",
 	   zl->timestamp_precision, VTY_NEWLINE);
+  if (zlog_async_stats (zl, &queued, &written, &dropped))
+    vty_out (vty, "Async logging: enabled, %lu queued, %lu written, "
+	     "%lu dropped%s", queued, written, dropped, VTY_NEWLINE);
+  else
+    vty_out (vty, "Async logging: disabled%s", VTY_NEWLINE);
 
   return CMD_SUCCESS;
 }
@@ -3387,6 +3586,27 @@ DEFUN (no_config_log_timestamp_precision,
   return CMD_SUCCESS;
 }
 
+DEFUN (config_log_async,
+       config_log_async_cmd,
+       "log async",
+       "Logging control\n"
+       "Write syslog, file and stdout logs from a separate thread\n")
+{
+  zlog_set_async (NULL, 1);
+  return CMD_SUCCESS;
+}
+
+DEFUN (no_config_log_async,
+       no_config_log_async_cmd,
+       "no log async",
+       NO_STR
+       "Logging control\n"
+       "Write syslog, file and stdout logs from a separate thread\n")
+{
+  zlog_set_async (NULL, 0);
+  return CMD_SUCCESS;
+}
+
 DEFUN (banner_motd_file,
        banner_motd_file_cmd,
        "banner motd file [FILE]",
@@ -3560,6 +3780,8 @@ cmd_init (int terminal)
       install_element (CONFIG_NODE, &no_config_log_record_priority_cmd);
       install_element (CONFIG_NODE, &config_log_timestamp_precision_cmd);
       install_element (CONFIG_NODE, &no_config_log_timestamp_precision_cmd);
+      install_element (CONFIG_NODE, &config_log_async_cmd);
+      install_element (CONFIG_NODE, &no_config_log_async_cmd);
       install_element (CONFIG_NODE, &service_password_encrypt_cmd);
       install_element (CONFIG_NODE, &no_service_password_encrypt_cmd);
       install_element (CONFIG_NODE, &banner_motd_default_cmd);
@@ -3575,6 +3797,8 @@ cmd_init (int terminal)
       install_element (ENABLE_NODE, &clear_thread_cpu_cmd);
       install_element (VIEW_NODE, &show_work_queues_cmd);
       install_element (ENABLE_NODE, &show_work_queues_cmd);
+      install_element (VIEW_NODE, &show_hash_statistics_cmd);
+      install_element (ENABLE_NODE, &show_hash_statistics_cmd);
     }
   srand(time(NULL));
 }
@@ -3593,6 +3817,8 @@ cmd_terminate ()
       for (i = 0; i < vector_active (cmdvec); i++) 
         if ((cmd_node = vector_slot (cmdvec, i)) != NULL)
           {
+            cmd_token_free (cmd_node->tokens);
+            cmd_node->tokens = NULL;
             cmd_node_v = cmd_node->cmd_vector;
 
             for (j = 0; j < vector_active (cmd_node_v); j++)
@@ -123,6 +123,9 @@ struct cmd_node
 
   /* Vector of this node's command list. */
   vector cmd_vector;	
+
+  /* Token trie of the commands, for matching lines against them. */
+  struct cmd_token *tokens;
 };
 
 enum
@@ -346,6 +349,9 @@ extern int config_from_file (struct vty *, FILE *);
 extern enum node_type node_parent (enum node_type);
 extern int cmd_execute_command (vector, struct vty *, struct cmd_element **, int);
 extern int cmd_execute_command_strict (vector, struct vty *, struct cmd_element **);
+extern int cmd_match (vector, enum node_type, int, struct cmd_element **);
+extern int cmd_match_vector (vector, enum node_type, int,
+			     struct cmd_element **);
 extern void config_replace_string (struct cmd_element *, char *, ...);
 extern void cmd_init (int);
 extern void cmd_terminate (void);
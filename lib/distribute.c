@@ -610,13 +610,42 @@ ALIAS (no_distribute_list_prefix, no_ipv6_distribute_list_prefix_cmd,
        "Filter outgoing routing updates\n"
        "Interface name\n")
 
+struct distribute_show_args
+{
+  struct vty *vty;
+  enum distribute_type type;
+};
+
+static void
+config_show_distribute_iterator (struct hash_backet *mp, void *arg)
+{
+  struct distribute_show_args *args = arg;
+  struct distribute *dist = mp->data;
+  struct vty *vty = args->vty;
+  enum distribute_type type = args->type;
+
+  if (dist->ifname)
+    if (dist->list[type] || dist->prefix[type])
+      {
+	vty_out (vty, "    %s filtered by", dist->ifname);
+	if (dist->list[type])
+	  vty_out (vty, " %s", dist->list[type]);
+	if (dist->prefix[type])
+	  vty_out (vty, "%s (prefix-list) %s",
+		   dist->list[type] ? "," : "",
+		   dist->prefix[type]);
+	vty_out (vty, "%s", VTY_NEWLINE);
+      }
+}
+
 int
 config_show_distribute (struct vty *vty)
 {
-  unsigned int i;
-  struct hash_backet *mp;
+  struct distribute_show_args args;
   struct distribute *dist;
 
+  args.vty = vty;
+
   /* Output filter configuration. */
   dist = distribute_lookup (NULL);
   if (dist && (dist->list[DISTRIBUTE_OUT] || dist->prefix[DISTRIBUTE_OUT]))
@@ -633,23 +662,8 @@ config_show_distribute (struct vty *vty)
   else
     vty_out (vty, "  Outgoing update filter list for all interface is not set%s", VTY_NEWLINE);
 
-  for (i = 0; i < disthash->size; i++)
-    for (mp = disthash->index[i]; mp; mp = mp->next)
-      {
-	dist = mp->data;
-	if (dist->ifname)
-	  if (dist->list[DISTRIBUTE_OUT] || dist->prefix[DISTRIBUTE_OUT])
-	    {
-	      vty_out (vty, "    %s filtered by", dist->ifname);
-	      if (dist->list[DISTRIBUTE_OUT])
-		vty_out (vty, " %s", dist->list[DISTRIBUTE_OUT]);
-	      if (dist->prefix[DISTRIBUTE_OUT])
-		vty_out (vty, "%s (prefix-list) %s",
-			 dist->list[DISTRIBUTE_OUT] ? "," : "",
-			 dist->prefix[DISTRIBUTE_OUT]);
-	      vty_out (vty, "%s", VTY_NEWLINE);
-	    }
-      }
+  args.type = DISTRIBUTE_OUT;
+  hash_iterate (disthash, config_show_distribute_iterator, &args);
 
 
   /* Input filter configuration. */
@@ -668,78 +682,64 @@ config_show_distribute (struct vty *vty)
   else
     vty_out (vty, "  Incoming update filter list for all interface is not set%s", VTY_NEWLINE);
 
-  for (i = 0; i < disthash->size; i++)
-    for (mp = disthash->index[i]; mp; mp = mp->next)
-      {
-	dist = mp->data;
-	if (dist->ifname)
-	  if (dist->list[DISTRIBUTE_IN] || dist->prefix[DISTRIBUTE_IN])
-	    {
-	      vty_out (vty, "    %s filtered by", dist->ifname);
-	      if (dist->list[DISTRIBUTE_IN])
-		vty_out (vty, " %s", dist->list[DISTRIBUTE_IN]);
-	      if (dist->prefix[DISTRIBUTE_IN])
-		vty_out (vty, "%s (prefix-list) %s",
-			 dist->list[DISTRIBUTE_IN] ? "," : "",
-			 dist->prefix[DISTRIBUTE_IN]);
-	      vty_out (vty, "%s", VTY_NEWLINE);
-	    }
-      }
+  args.type = DISTRIBUTE_IN;
+  hash_iterate (disthash, config_show_distribute_iterator, &args);
   return 0;
 }
 
 /* Configuration write function. */
+static void
+config_write_distribute_iterator (struct hash_backet *mp, void *arg)
+{
+  struct distribute *dist = mp->data;
+  struct vty *vty = ((void **) arg)[0];
+  int *write = ((void **) arg)[1];
+
+  if (dist->list[DISTRIBUTE_IN])
+    {
+      vty_out (vty, " distribute-list %s in %s%s", 
+	       dist->list[DISTRIBUTE_IN],
+	       dist->ifname ? dist->ifname : "",
+	       VTY_NEWLINE);
+      (*write)++;
+    }
+
+  if (dist->list[DISTRIBUTE_OUT])
+    {
+      vty_out (vty, " distribute-list %s out %s%s", 
+
+	       dist->list[DISTRIBUTE_OUT],
+	       dist->ifname ? dist->ifname : "",
+	       VTY_NEWLINE);
+      (*write)++;
+    }
+
+  if (dist->prefix[DISTRIBUTE_IN])
+    {
+      vty_out (vty, " distribute-list prefix %s in %s%s",
+	       dist->prefix[DISTRIBUTE_IN],
+	       dist->ifname ? dist->ifname : "",
+	       VTY_NEWLINE);
+      (*write)++;
+    }
+
+  if (dist->prefix[DISTRIBUTE_OUT])
+    {
+      vty_out (vty, " distribute-list prefix %s out %s%s",
+	       dist->prefix[DISTRIBUTE_OUT],
+	       dist->ifname ? dist->ifname : "",
+	       VTY_NEWLINE);
+      (*write)++;
+    }
+}
+
 int
 config_write_distribute (struct vty *vty)
 {
-  unsigned int i;
-  struct hash_backet *mp;
   int write = 0;
+  void *args[2] = { vty, &write };
 
-  for (i = 0; i < disthash->size; i++)
-    for (mp = disthash->index[i]; mp; mp = mp->next)
-      {
-	struct distribute *dist;
-
-	dist = mp->data;
-
-	if (dist->list[DISTRIBUTE_IN])
-	  {
-	    vty_out (vty, " distribute-list %s in %s%s", 
-		     dist->list[DISTRIBUTE_IN],
-		     dist->ifname ? dist->ifname : "",
-		     VTY_NEWLINE);
-	    write++;
-	  }
-
-	if (dist->list[DISTRIBUTE_OUT])
-	  {
-	    vty_out (vty, " distribute-list %s out %s%s", 
-
-		     dist->list[DISTRIBUTE_OUT],
-		     dist->ifname ? dist->ifname : "",
-		     VTY_NEWLINE);
-	    write++;
-	  }
-
-	if (dist->prefix[DISTRIBUTE_IN])
-	  {
-	    vty_out (vty, " distribute-list prefix %s in %s%s",
-		     dist->prefix[DISTRIBUTE_IN],
-		     dist->ifname ? dist->ifname : "",
-		     VTY_NEWLINE);
-	    write++;
-	  }
-
-	if (dist->prefix[DISTRIBUTE_OUT])
-	  {
-	    vty_out (vty, " distribute-list prefix %s out %s%s",
-		     dist->prefix[DISTRIBUTE_OUT],
-		     dist->ifname ? dist->ifname : "",
-		     VTY_NEWLINE);
-	    write++;
-	  }
-      }
+  hash_iterate (disthash, config_write_distribute_iterator, args);
   return write;
 }
 
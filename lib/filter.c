@@ -28,6 +28,7 @@
 #include "sockunion.h"
 #include "buffer.h"
 #include "log.h"
+#include "table.h"
 
 struct filter_cisco
 {
@@ -66,6 +67,17 @@ struct filter
       struct filter_cisco cfilter;
       struct filter_zebra zfilter;
     } u;
+
+  /* Position in the access-list, earlier filters having lower ones. */
+  unsigned long seq;
+
+  /* Number of times this filter was the first match. */
+  unsigned long hitcnt;
+
+  /* Trie node of the access-list the filter is on, NULL when on the
+     list's other chain, and the next filter there in list order. */
+  struct route_node *rn;
+  struct filter *rn_next;
 };
 
 /* List of access_list. */
@@ -111,6 +123,12 @@ static struct access_master access_master_ipv6 =
 };
 #endif /* HAVE_IPV6 */
 
+/* Depth of access_list_hooks_suspend() calls. */
+static int access_list_hooks_suspended = 0;
+
+#define ACCESS_LIST_HOOK_ADD		0x01
+#define ACCESS_LIST_HOOK_DELETE		0x02
+
 static struct access_master *
 access_master_get (afi_t afi)
 {
@@ -208,6 +226,187 @@ filter_match_zebra (struct filter *mfilter, struct prefix *p)
   else
     return 0;
 }
+
+static int
+filter_match (struct filter *mfilter, struct prefix *p)
+{
+  if (mfilter->cisco)
+    return filter_match_cisco (mfilter, p);
+  else
+    return filter_match_zebra (mfilter, p);
+}
+
+/* Besides on the list, an access-list keeps its filters indexed so
+   applying it need not try them all.  Zebra filters are on a trie per
+   address family keyed on their prefix, cisco filters whose wildcard
+   bits are contiguous on a trie keyed on the address part, which an
+   address matches at any length.  Every filter that can match then
+   sits on a node from the longest match up to the top.  The few cisco
+   filters with other wildcards are on a chain of their own.
+
+   Returns the trie filter belongs on and sets key, or NULL for the
+   other chain. */
+static struct route_table **
+filter_index (struct access_list *access, struct filter *mfilter,
+	      struct prefix *key)
+{
+  struct filter_cisco *cfilter;
+  struct in_addr mask;
+  u_int32_t wild;
+
+  memset (key, 0, sizeof (struct prefix));
+
+  if (! mfilter->cisco)
+    {
+      prefix_copy (key, &mfilter->u.zfilter.prefix);
+      apply_mask (key);
+
+      switch (key->family)
+	{
+	case AF_INET:
+	  return &access->trie[0];
+#ifdef HAVE_IPV6
+	case AF_INET6:
+	  return &access->trie[1];
+#endif /* HAVE_IPV6 */
+	default:
+	  return NULL;
+	}
+    }
+
+  cfilter = &mfilter->u.cfilter;
+  wild = ntohl (cfilter->addr_mask.s_addr);
+  if (wild & (wild + 1))
+    return NULL;
+
+  mask.s_addr = ~cfilter->addr_mask.s_addr;
+  key->family = AF_INET;
+  key->prefixlen = ip_masklen (mask);
+  key->u.prefix4 = cfilter->addr;
+  return &access->cisco_trie;
+}
+
+static void
+filter_index_add (struct access_list *access, struct filter *mfilter)
+{
+  struct route_table **trie;
+  struct route_node *rn;
+  struct filter *point;
+  struct prefix key;
+
+  trie = filter_index (access, mfilter, &key);
+  if (trie)
+    {
+      if (*trie == NULL)
+	*trie = route_table_init ();
+
+      /* The filters on a node share one lock. */
+      rn = route_node_get (*trie, &key);
+      if (rn->info)
+	route_unlock_node (rn);
+      mfilter->rn = rn;
+      point = rn->info;
+      if (point == NULL)
+	rn->info = mfilter;
+    }
+  else
+    {
+      point = access->other;
+      if (point == NULL)
+	access->other = mfilter;
+    }
+
+  /* A new filter comes last. */
+  if (point)
+    {
+      while (point->rn_next)
+	point = point->rn_next;
+      point->rn_next = mfilter;
+    }
+}
+
+static void
+filter_index_delete (struct access_list *access, struct filter *mfilter)
+{
+  struct route_node *rn = mfilter->rn;
+  struct filter *head;
+  struct filter *point;
+
+  head = rn ? rn->info : access->other;
+  if (head == mfilter)
+    head = mfilter->rn_next;
+  else
+    {
+      for (point = head; point->rn_next != mfilter; point = point->rn_next)
+	;
+      point->rn_next = mfilter->rn_next;
+    }
+
+  if (rn)
+    {
+      rn->info = head;
+      if (head == NULL)
+	route_unlock_node (rn);
+    }
+  else
+    access->other = head;
+
+  mfilter->rn = NULL;
+  mfilter->rn_next = NULL;
+}
+
+/* First filter of access indexed alongside mfilter, the others
+   following by rn_next. */
+static struct filter *
+filter_index_same (struct access_list *access, struct filter *mfilter)
+{
+  struct route_table **trie;
+  struct route_node *rn;
+  struct prefix key;
+
+  trie = filter_index (access, mfilter, &key);
+  if (trie == NULL)
+    return access->other;
+  if (*trie == NULL)
+    return NULL;
+
+  rn = route_node_lookup (*trie, &key);
+  if (rn == NULL)
+    return NULL;
+  route_unlock_node (rn);
+  return rn->info;
+}
+
+/* The first filter in list order on the chain that matches p, if it
+   comes before best. */
+static struct filter *
+filter_chain_match (struct filter *mfilter, struct prefix *p,
+		    struct filter *best)
+{
+  for (; mfilter; mfilter = mfilter->rn_next)
+    {
+      if (best && mfilter->seq > best->seq)
+	break;
+      if (filter_match (mfilter, p))
+	return mfilter;
+    }
+  return best;
+}
+
+/* The first filter in list order matching p on the nodes from rn, the
+   longest match, up. */
+static struct filter *
+filter_trie_match (struct route_node *rn, struct prefix *p,
+		   struct filter *best)
+{
+  struct route_node *node;
+
+  for (node = rn; node; node = node->parent)
+    best = filter_chain_match (node->info, p, best);
+  if (rn)
+    route_unlock_node (rn);
+  return best;
+}
 
 /* Allocate new access list structure. */
 static struct access_list *
@@ -232,6 +431,7 @@ access_list_delete (struct access_list *access)
   struct filter *next;
   struct access_list_list *list;
   struct access_master *master;
+  unsigned int i;
 
   for (filter = access->head; filter; filter = next)
     {
@@ -239,6 +439,12 @@ access_list_delete (struct access_list *access)
       filter_free (filter);
     }
 
+  for (i = 0; i < ACCESS_LIST_TRIES; i++)
+    if (access->trie[i])
+      route_table_finish (access->trie[i]);
+  if (access->cisco_trie)
+    route_table_finish (access->cisco_trie);
+
   master = access->master;
 
   if (access->type == ACCESS_TYPE_NUMBER)
@@ -400,6 +606,8 @@ enum filter_type
 access_list_apply (struct access_list *access, void *object)
 {
   struct filter *filter;
+  struct filter *match;
+  struct route_table *trie;
   struct prefix *p;
 
   p = (struct prefix *) object;
@@ -407,23 +615,124 @@ access_list_apply (struct access_list *access, void *object)
   if (access == NULL)
     return FILTER_DENY;
 
-  for (filter = access->head; filter; filter = filter->next)
+  switch (p->family)
     {
-      if (filter->cisco)
+    case AF_INET:
+      trie = access->trie[0];
+      break;
+#ifdef HAVE_IPV6
+    case AF_INET6:
+      /* Cisco filters look at the first four bytes of any address. */
+      if (access->cisco_trie == NULL && access->other == NULL)
 	{
-	  if (filter_match_cisco (filter, p))
-	    return filter->type;
+	  trie = access->trie[1];
+	  break;
 	}
-      else
-	{
-	  if (filter_match_zebra (filter, p))
+      /* Fall through. */
+#endif /* HAVE_IPV6 */
+    default:
+      for (filter = access->head; filter; filter = filter->next)
+	if (filter_match (filter, p))
+	  {
+	    filter->hitcnt++;
 	    return filter->type;
-	}
+	  }
+      return FILTER_DENY;
     }
 
+  match = NULL;
+  if (trie)
+    match = filter_trie_match (route_node_match (trie, p), p, match);
+  if (access->cisco_trie && p->family == AF_INET)
+    match = filter_trie_match (route_node_match_ipv4 (access->cisco_trie,
+						      &p->u.prefix4),
+			       p, match);
+  match = filter_chain_match (access->other, p, match);
+
+  if (match == NULL)
+    return FILTER_DENY;
+
+  match->hitcnt++;
+  return match->type;
+}
+
+/* Apply access list to object by trying its filters in list order,
+   as access_list_apply() did before the filters were indexed.  It must
+   give the same, which tests check.  Hits are not counted. */
+enum filter_type
+access_list_apply_linear (struct access_list *access, void *object)
+{
+  struct filter *filter;
+
+  if (access == NULL)
+    return FILTER_DENY;
+
+  for (filter = access->head; filter; filter = filter->next)
+    if (filter_match (filter, (struct prefix *) object))
+      return filter->type;
   return FILTER_DENY;
 }
 
+/* Run the add or delete hook for access, or hold it back until the
+   hooks are resumed. */
+static void
+access_list_hook (struct access_list *access, u_char hook)
+{
+  struct access_master *master = access->master;
+
+  if (access_list_hooks_suspended)
+    SET_FLAG (access->hooks, hook);
+  else if (hook == ACCESS_LIST_HOOK_ADD && master->add_hook)
+    (*master->add_hook) (access);
+  else if (hook == ACCESS_LIST_HOOK_DELETE && master->delete_hook)
+    (*master->delete_hook) (access);
+}
+
+static void
+access_master_hooks_run (struct access_master *master)
+{
+  struct access_list_list *lists[] = { &master->num, &master->str };
+  struct access_list *access, *next;
+  unsigned int i;
+  u_char hooks;
+
+  for (i = 0; i < sizeof (lists) / sizeof (lists[0]); i++)
+    for (access = lists[i]->head; access; access = next)
+      {
+	next = access->next;
+	hooks = access->hooks;
+	access->hooks = 0;
+
+	if (CHECK_FLAG (hooks, ACCESS_LIST_HOOK_DELETE))
+	  access_list_hook (access, ACCESS_LIST_HOOK_DELETE);
+	if (CHECK_FLAG (hooks, ACCESS_LIST_HOOK_ADD))
+	  access_list_hook (access, ACCESS_LIST_HOOK_ADD);
+      }
+}
+
+/* Hold back the hooks run on changes to filters, e.g. while a whole
+   configuration is read.  Lists deleted outright still run the delete
+   hook at once. */
+void
+access_list_hooks_suspend (void)
+{
+  access_list_hooks_suspended++;
+}
+
+/* Run the hooks held back since the outermost suspend, once for each
+   list that changed. */
+void
+access_list_hooks_resume (void)
+{
+  if (--access_list_hooks_suspended > 0)
+    return;
+
+  access_master_hooks_run (&access_master_ipv4);
+#ifdef HAVE_IPV6
+  access_master_hooks_run (&access_master_ipv6);
+#endif /* HAVE_IPV6 */
+}
+
 /* Add hook function. */
 void
 access_list_add_hook (void (*func) (struct access_list *access))
@@ -457,9 +766,11 @@ access_list_filter_add (struct access_list *access, struct filter *filter)
     access->head = filter;
   access->tail = filter;
 
+  filter->seq = ++access->seq;
+  filter_index_add (access, filter);
+
   /* Run hook function. */
-  if (access->master->add_hook)
-    (*access->master->add_hook) (access);
+  access_list_hook (access, ACCESS_LIST_HOOK_ADD);
 }
 
 /* If access_list has no filter then return 1. */
@@ -491,15 +802,20 @@ access_list_filter_delete (struct access_list *access, struct filter *filter)
   else
     access->head = filter->next;
 
+  filter_index_delete (access, filter);
   filter_free (filter);
 
   /* If access_list becomes empty delete it from access_master. */
   if (access_list_empty (access))
-    access_list_delete (access);
+    {
+      access_list_delete (access);
 
-  /* Run hook function. */
-  if (master->delete_hook)
-    (*master->delete_hook) (access);
+      /* Run hook function. */
+      if (master->delete_hook)
+	(*master->delete_hook) (access);
+    }
+  else
+    access_list_hook (access, ACCESS_LIST_HOOK_DELETE);
 }
 
 /*
@@ -523,8 +839,12 @@ filter_lookup_cisco (struct access_list *access, struct filter *mnew)
 
   new = &mnew->u.cfilter;
 
-  for (mfilter = access->head; mfilter; mfilter = mfilter->next)
+  for (mfilter = filter_index_same (access, mnew); mfilter;
+       mfilter = mfilter->rn_next)
     {
+      if (! mfilter->cisco)
+	continue;
+
       filter = &mfilter->u.cfilter;
 
       if (filter->extended)
@@ -557,8 +877,12 @@ filter_lookup_zebra (struct access_list *access, struct filter *mnew)
 
   new = &mnew->u.zfilter;
 
-  for (mfilter = access->head; mfilter; mfilter = mfilter->next)
+  for (mfilter = filter_index_same (access, mnew); mfilter;
+       mfilter = mfilter->rn_next)
     {
+      if (mfilter->cisco)
+	continue;
+
       filter = &mfilter->u.zfilter;
 
       if (filter->exact == new->exact
@@ -1568,6 +1892,35 @@ void config_write_access_zebra (struct vty *, struct filter *);
 void config_write_access_cisco (struct vty *, struct filter *);
 
 /* show access-list command. */
+static void
+filter_show_filter (struct vty *vty, struct filter *mfilter)
+{
+  struct filter_cisco *filter;
+
+  filter = &mfilter->u.cfilter;
+
+  vty_out (vty, "    %s%s", filter_type_str (mfilter),
+	   mfilter->type == FILTER_DENY ? "  " : "");
+
+  if (! mfilter->cisco)
+    config_write_access_zebra (vty, mfilter);
+  else if (filter->extended)
+    config_write_access_cisco (vty, mfilter);
+  else
+    {
+      if (filter->addr_mask.s_addr == 0xffffffff)
+	vty_out (vty, " any");
+      else
+	{
+	  vty_out (vty, " %s", inet_ntoa (filter->addr));
+	  if (filter->addr_mask.s_addr != 0)
+	    vty_out (vty, ", wildcard bits %s", inet_ntoa (filter->addr_mask));
+	}
+    }
+
+  vty_out (vty, " (hit count: %lu)%s", mfilter->hitcnt, VTY_NEWLINE);
+}
+
 static int
 filter_show (struct vty *vty, const char *name, afi_t afi)
 {
@@ -1607,25 +1960,7 @@ filter_show (struct vty *vty, const char *name, afi_t afi)
 	      write = 0;
 	    }
 
-	  vty_out (vty, "    %s%s", filter_type_str (mfilter),
-		   mfilter->type == FILTER_DENY ? "  " : "");
-
-	  if (! mfilter->cisco)
-	    config_write_access_zebra (vty, mfilter);
-	  else if (filter->extended)
-	    config_write_access_cisco (vty, mfilter);
-	  else
-	    {
-	      if (filter->addr_mask.s_addr == 0xffffffff)
-		vty_out (vty, " any%s", VTY_NEWLINE);
-	      else
-		{
-		  vty_out (vty, " %s", inet_ntoa (filter->addr));
-		  if (filter->addr_mask.s_addr != 0)
-		    vty_out (vty, ", wildcard bits %s", inet_ntoa (filter->addr_mask));
-		  vty_out (vty, "%s", VTY_NEWLINE);
-		}
-	    }
+	  filter_show_filter (vty, mfilter);
 	}
     }
 
@@ -1650,25 +1985,7 @@ filter_show (struct vty *vty, const char *name, afi_t afi)
 	      write = 0;
 	    }
 
-	  vty_out (vty, "    %s%s", filter_type_str (mfilter),
-		   mfilter->type == FILTER_DENY ? "  " : "");
-
-	  if (! mfilter->cisco)
-	    config_write_access_zebra (vty, mfilter);
-	  else if (filter->extended)
-	    config_write_access_cisco (vty, mfilter);
-	  else
-	    {
-	      if (filter->addr_mask.s_addr == 0xffffffff)
-		vty_out (vty, " any%s", VTY_NEWLINE);
-	      else
-		{
-		  vty_out (vty, " %s", inet_ntoa (filter->addr));
-		  if (filter->addr_mask.s_addr != 0)
-		    vty_out (vty, ", wildcard bits %s", inet_ntoa (filter->addr_mask));
-		  vty_out (vty, "%s", VTY_NEWLINE);
-		}
-	    }
+	  filter_show_filter (vty, mfilter);
 	}
     }
   return CMD_SUCCESS;
@@ -1699,6 +2016,68 @@ DEFUN (show_ip_access_list_name,
   return filter_show (vty, argv[0], AFI_IP);
 }
 
+/* Reset the hit counts of the named access-list, or all of them. */
+static int
+filter_clear (struct vty *vty, const char *name, afi_t afi)
+{
+  struct access_list *access;
+  struct access_master *master;
+  struct filter *mfilter;
+
+  master = access_master_get (afi);
+  if (master == NULL)
+    return CMD_WARNING;
+
+  if (name)
+    {
+      access = access_list_lookup (afi, name);
+      if (! access)
+	{
+	  vty_out (vty, "%% access-list %s doesn't exist%s", name,
+		   VTY_NEWLINE);
+	  return CMD_WARNING;
+	}
+      for (mfilter = access->head; mfilter; mfilter = mfilter->next)
+	mfilter->hitcnt = 0;
+      return CMD_SUCCESS;
+    }
+
+  for (access = master->num.head; access; access = access->next)
+    for (mfilter = access->head; mfilter; mfilter = mfilter->next)
+      mfilter->hitcnt = 0;
+
+  for (access = master->str.head; access; access = access->next)
+    for (mfilter = access->head; mfilter; mfilter = mfilter->next)
+      mfilter->hitcnt = 0;
+
+  return CMD_SUCCESS;
+}
+
+DEFUN (clear_ip_access_list,
+       clear_ip_access_list_cmd,
+       "clear ip access-list",
+       CLEAR_STR
+       IP_STR
+       "Clear IP access list hit counts\n")
+{
+  return filter_clear (vty, NULL, AFI_IP);
+}
+
+DEFUN (clear_ip_access_list_name,
+       clear_ip_access_list_name_cmd,
+       "clear ip access-list (<1-99>|<100-199>|<1300-1999>|<2000-2699>|WORD)",
+       CLEAR_STR
+       IP_STR
+       "Clear IP access list hit counts\n"
+       "IP standard access list\n"
+       "IP extended access list\n"
+       "IP standard access list (expanded range)\n"
+       "IP extended access list (expanded range)\n"
+       "IP zebra access-list\n")
+{
+  return filter_clear (vty, argv[0], AFI_IP);
+}
+
 #ifdef HAVE_IPV6
 DEFUN (show_ipv6_access_list,
        show_ipv6_access_list_cmd,
@@ -1720,6 +2099,27 @@ DEFUN (show_ipv6_access_list_name,
 {
   return filter_show (vty, argv[0], AFI_IP6);
 }
+
+DEFUN (clear_ipv6_access_list,
+       clear_ipv6_access_list_cmd,
+       "clear ipv6 access-list",
+       CLEAR_STR
+       IPV6_STR
+       "Clear IPv6 access list hit counts\n")
+{
+  return filter_clear (vty, NULL, AFI_IP6);
+}
+
+DEFUN (clear_ipv6_access_list_name,
+       clear_ipv6_access_list_name_cmd,
+       "clear ipv6 access-list WORD",
+       CLEAR_STR
+       IPV6_STR
+       "Clear IPv6 access list hit counts\n"
+       "IPv6 zebra access-list\n")
+{
+  return filter_clear (vty, argv[0], AFI_IP6);
+}
 #endif /* HAVE_IPV6 */
 
 void
@@ -1751,18 +2151,16 @@ config_write_access_cisco (struct vty *vty, struct filter *mfilter)
 	  vty_out (vty, " %s", inet_ntoa (filter->mask));
 	  vty_out (vty, " %s", inet_ntoa (filter->mask_mask));
 	}
-      vty_out (vty, "%s", VTY_NEWLINE);
     }
   else
     {
       if (filter->addr_mask.s_addr == 0xffffffff)
-	vty_out (vty, " any%s", VTY_NEWLINE);
+	vty_out (vty, " any");
       else
 	{
 	  vty_out (vty, " %s", inet_ntoa (filter->addr));
 	  if (filter->addr_mask.s_addr != 0)
 	    vty_out (vty, " %s", inet_ntoa (filter->addr_mask));
-	  vty_out (vty, "%s", VTY_NEWLINE);
 	}
     }
 }
@@ -1784,8 +2182,6 @@ config_write_access_zebra (struct vty *vty, struct filter *mfilter)
 	     inet_ntop (p->family, &p->u.prefix, buf, BUFSIZ),
 	     p->prefixlen,
 	     filter->exact ? " exact-match" : "");
-
-  vty_out (vty, "%s", VTY_NEWLINE);
 }
 
 static int
@@ -1822,6 +2218,7 @@ config_write_access (struct vty *vty, afi_t afi)
 	    config_write_access_cisco (vty, mfilter);
 	  else
 	    config_write_access_zebra (vty, mfilter);
+	  vty_out (vty, "%s", VTY_NEWLINE);
 
 	  write++;
 	}
@@ -1849,6 +2246,7 @@ config_write_access (struct vty *vty, afi_t afi)
 	    config_write_access_cisco (vty, mfilter);
 	  else
 	    config_write_access_zebra (vty, mfilter);
+	  vty_out (vty, "%s", VTY_NEWLINE);
 
 	  write++;
 	}
@@ -1907,6 +2305,8 @@ access_list_init_ipv4 (void)
 
   install_element (ENABLE_NODE, &show_ip_access_list_cmd);
   install_element (ENABLE_NODE, &show_ip_access_list_name_cmd);
+  install_element (ENABLE_NODE, &clear_ip_access_list_cmd);
+  install_element (ENABLE_NODE, &clear_ip_access_list_name_cmd);
 
   /* Zebra access-list */
   install_element (CONFIG_NODE, &access_list_cmd);
@@ -2002,6 +2402,8 @@ access_list_init_ipv6 (void)
 
   install_element (ENABLE_NODE, &show_ipv6_access_list_cmd);
   install_element (ENABLE_NODE, &show_ipv6_access_list_name_cmd);
+  install_element (ENABLE_NODE, &clear_ipv6_access_list_cmd);
+  install_element (ENABLE_NODE, &clear_ipv6_access_list_name_cmd);
 
   install_element (CONFIG_NODE, &ipv6_access_list_cmd);
   install_element (CONFIG_NODE, &ipv6_access_list_exact_cmd);
@@ -39,6 +39,9 @@ enum access_type
   ACCESS_TYPE_NUMBER
 };
 
+/* Tries of an access-list for zebra filters, IPv4 and IPv6. */
+#define ACCESS_LIST_TRIES 2
+
 /* Access list */
 struct access_list
 {
@@ -54,6 +57,17 @@ struct access_list
 
   struct filter *head;
   struct filter *tail;
+
+  /* The filters indexed for access_list_apply(), see filter.c. */
+  struct route_table *trie[ACCESS_LIST_TRIES];
+  struct route_table *cisco_trie;
+  struct filter *other;
+
+  /* Position given to the last filter added. */
+  unsigned long seq;
+
+  /* Hooks held back by access_list_hooks_suspend(). */
+  u_char hooks;
 };
 
 /* Prototypes for access-list. */
@@ -61,7 +75,11 @@ extern void access_list_init (void);
 extern void access_list_reset (void);
 extern void access_list_add_hook (void (*func)(struct access_list *));
 extern void access_list_delete_hook (void (*func)(struct access_list *));
+extern void access_list_hooks_suspend (void);
+extern void access_list_hooks_resume (void);
 extern struct access_list *access_list_lookup (afi_t, const char *);
 extern enum filter_type access_list_apply (struct access_list *, void *);
+extern enum filter_type access_list_apply_linear (struct access_list *,
+						  void *);
 
 #endif /* _ZEBRA_FILTER_H */
@@ -22,7 +22,14 @@
 #include <zebra.h>
 
 #include "hash.h"
+#include "ohash.h"
 #include "memory.h"
+#include "linklist.h"
+#include "vty.h"
+#include "command.h"
+
+/* Tables registered with hash_set_name(), for "show hash statistics". */
+static struct list *hash_tables;
 
 /* Allocate a new hash.  */
 struct hash *
@@ -31,10 +38,11 @@ hash_create_size (unsigned int size, unsigned int (*hash_key) (void *),
 {
   struct hash *hash;
 
-  hash = XMALLOC (MTYPE_HASH, sizeof (struct hash));
+  hash = XCALLOC (MTYPE_HASH, sizeof (struct hash));
   hash->index = XCALLOC (MTYPE_HASH_INDEX,
 			 sizeof (struct hash_backet *) * size);
   hash->size = size;
+  hash->min_size = size;
   hash->hash_key = hash_key;
   hash->hash_cmp = hash_cmp;
   hash->count = 0;
@@ -59,6 +67,89 @@ hash_alloc_intern (void *arg)
   return arg;
 }
 
+/* Return the chain a key belongs to.  While a resize is in progress
+   the key lives in the old index unless its bucket there has already
+   been moved.  */
+static struct hash_backet **
+hash_head (struct hash *hash, unsigned int key)
+{
+  unsigned int index;
+
+  if (hash->old_index)
+    {
+      index = key % hash->old_size;
+      if (index >= hash->rehash_pos)
+	return &hash->old_index[index];
+    }
+  return &hash->index[key % hash->size];
+}
+
+/* Move up to HASH_REHASH_STEP buckets of the old index to the new one,
+   and free the old index once it is empty.  Spreading the work over
+   the following inserts and releases keeps any single one of them
+   from paying for the whole table.  */
+static void
+hash_rehash_step (struct hash *hash)
+{
+  struct hash_backet *hb;
+  struct hash_backet *next;
+  struct hash_backet **head;
+  unsigned int n;
+
+  if (hash->old_index == NULL || hash->iterating)
+    return;
+
+  for (n = 0; n < HASH_REHASH_STEP && hash->rehash_pos < hash->old_size; n++)
+    {
+      head = &hash->old_index[hash->rehash_pos++];
+      for (hb = *head; hb; hb = next)
+	{
+	  next = hb->next;
+	  hb->next = hash->index[hb->key % hash->size];
+	  hash->index[hb->key % hash->size] = hb;
+	}
+      *head = NULL;
+    }
+
+  if (hash->rehash_pos >= hash->old_size)
+    {
+      XFREE (MTYPE_HASH_INDEX, hash->old_index);
+      hash->old_index = NULL;
+      hash->old_size = 0;
+      hash->rehash_pos = 0;
+    }
+}
+
+/* Start moving the table to an index of the given size.  */
+static void
+hash_resize (struct hash *hash, unsigned int size)
+{
+  hash->old_index = hash->index;
+  hash->old_size = hash->size;
+  hash->rehash_pos = 0;
+  hash->index = XCALLOC (MTYPE_HASH_INDEX,
+			 sizeof (struct hash_backet *) * size);
+  hash->size = size;
+  hash->resizes++;
+}
+
+/* Grow or shrink the table if its load is out of bounds, or else
+   make progress on a resize already under way.  */
+static void
+hash_maintain (struct hash *hash)
+{
+  if (hash->old_index)
+    hash_rehash_step (hash);
+  else if (hash->iterating)
+    return;
+  else if (hash->count > (unsigned long) hash->size * HASH_LOAD_MAX
+	   && hash->size < UINT_MAX / 2)
+    hash_resize (hash, hash->size * 2 + 1);
+  else if (hash->size > hash->min_size
+	   && hash->count < hash->size / HASH_LOAD_MIN)
+    hash_resize (hash, MAX ((hash->size - 1) / 2, hash->min_size));
+}
+
 /* Lookup and return hash backet in hash.  If there is no
    corresponding hash backet and alloc_func is specified, create new
    hash backet.  */
@@ -66,14 +157,14 @@ void *
 hash_get (struct hash *hash, void *data, void * (*alloc_func) (void *))
 {
   unsigned int key;
-  unsigned int index;
   void *newdata;
   struct hash_backet *backet;
+  struct hash_backet **head;
 
   key = (*hash->hash_key) (data);
-  index = key % hash->size;
+  head = hash_head (hash, key);
 
-  for (backet = hash->index[index]; backet != NULL; backet = backet->next) 
+  for (backet = *head; backet != NULL; backet = backet->next) 
     if (backet->key == key && (*hash->hash_cmp) (backet->data, data))
       return backet->data;
 
@@ -86,9 +177,10 @@ hash_get (struct hash *hash, void *data, void * (*alloc_func) (void *))
       backet = XMALLOC (MTYPE_HASH_BACKET, sizeof (struct hash_backet));
       backet->data = newdata;
       backet->key = key;
-      backet->next = hash->index[index];
-      hash->index[index] = backet;
+      backet->next = *head;
+      *head = backet;
       hash->count++;
+      hash_maintain (hash);
       return backet->data;
     }
   return NULL;
@@ -120,25 +212,26 @@ hash_release (struct hash *hash, void *data)
 {
   void *ret;
   unsigned int key;
-  unsigned int index;
   struct hash_backet *backet;
   struct hash_backet *pp;
+  struct hash_backet **head;
 
   key = (*hash->hash_key) (data);
-  index = key % hash->size;
+  head = hash_head (hash, key);
 
-  for (backet = pp = hash->index[index]; backet; backet = backet->next)
+  for (backet = pp = *head; backet; backet = backet->next)
     {
       if (backet->key == key && (*hash->hash_cmp) (backet->data, data)) 
 	{
 	  if (backet == pp) 
-	    hash->index[index] = backet->next;
+	    *head = backet->next;
 	  else 
 	    pp->next = backet->next;
 
 	  ret = backet->data;
 	  XFREE (MTYPE_HASH_BACKET, backet);
 	  hash->count--;
+	  hash_maintain (hash);
 	  return ret;
 	}
       pp = backet;
@@ -146,17 +239,18 @@ hash_release (struct hash *hash, void *data)
   return NULL;
 }
 
-/* Iterator function for hash.  */
-void
-hash_iterate (struct hash *hash, 
-	      void (*func) (struct hash_backet *, void *), void *arg)
+/* Call func on every backet of one index.  */
+static void
+hash_iterate_index (struct hash_backet **index, unsigned int from,
+		    unsigned int size,
+		    void (*func) (struct hash_backet *, void *), void *arg)
 {
   unsigned int i;
   struct hash_backet *hb;
   struct hash_backet *hbnext;
 
-  for (i = 0; i < hash->size; i++)
-    for (hb = hash->index[i]; hb; hb = hbnext)
+  for (i = from; i < size; i++)
+    for (hb = index[i]; hb; hb = hbnext)
       {
 	/* get pointer to next hash backet here, in case (*func)
 	 * decides to delete hb by calling hash_release
@@ -166,17 +260,32 @@ hash_iterate (struct hash *hash,
       }
 }
 
-/* Clean up hash.  */
+/* Iterator function for hash.  Resizing is held off for the duration,
+   so backets are neither moved nor visited twice.  */
 void
-hash_clean (struct hash *hash, void (*free_func) (void *))
+hash_iterate (struct hash *hash, 
+	      void (*func) (struct hash_backet *, void *), void *arg)
+{
+  hash->iterating++;
+  if (hash->old_index)
+    hash_iterate_index (hash->old_index, hash->rehash_pos, hash->old_size,
+			func, arg);
+  hash_iterate_index (hash->index, 0, hash->size, func, arg);
+  hash->iterating--;
+}
+
+/* Free every backet of one index.  */
+static void
+hash_clean_index (struct hash *hash, struct hash_backet **index,
+		  unsigned int size, void (*free_func) (void *))
 {
   unsigned int i;
   struct hash_backet *hb;
   struct hash_backet *next;
 
-  for (i = 0; i < hash->size; i++)
+  for (i = 0; i < size; i++)
     {
-      for (hb = hash->index[i]; hb; hb = next)
+      for (hb = index[i]; hb; hb = next)
 	{
 	  next = hb->next;
 	      
@@ -186,7 +295,30 @@ hash_clean (struct hash *hash, void (*free_func) (void *))
 	  XFREE (MTYPE_HASH_BACKET, hb);
 	  hash->count--;
 	}
-      hash->index[i] = NULL;
+      index[i] = NULL;
+    }
+}
+
+/* Clean up hash.  The index goes back to its initial size.  */
+void
+hash_clean (struct hash *hash, void (*free_func) (void *))
+{
+  if (hash->old_index)
+    {
+      hash_clean_index (hash, hash->old_index, hash->old_size, free_func);
+      XFREE (MTYPE_HASH_INDEX, hash->old_index);
+      hash->old_index = NULL;
+      hash->old_size = 0;
+      hash->rehash_pos = 0;
+    }
+  hash_clean_index (hash, hash->index, hash->size, free_func);
+
+  if (hash->size != hash->min_size)
+    {
+      XFREE (MTYPE_HASH_INDEX, hash->index);
+      hash->index = XCALLOC (MTYPE_HASH_INDEX,
+			     sizeof (struct hash_backet *) * hash->min_size);
+      hash->size = hash->min_size;
     }
 }
 
@@ -195,6 +327,102 @@ hash_clean (struct hash *hash, void (*free_func) (void *))
 void
 hash_free (struct hash *hash)
 {
+  if (hash->name)
+    listnode_delete (hash_tables, hash);
+  if (hash->old_index)
+    XFREE (MTYPE_HASH_INDEX, hash->old_index);
   XFREE (MTYPE_HASH_INDEX, hash->index);
   XFREE (MTYPE_HASH, hash);
 }
+
+/* Register hash under name for "show hash statistics".  */
+void
+hash_set_name (struct hash *hash, const char *name)
+{
+  if (hash_tables == NULL)
+    hash_tables = list_new ();
+  if (hash->name == NULL)
+    listnode_add (hash_tables, hash);
+  hash->name = name;
+}
+
+/* Chain length statistics of one index.  */
+struct hash_chain_stats
+{
+  unsigned long empty;
+  unsigned long longest;
+  unsigned long backets;
+};
+
+static void
+hash_chain_stats_index (struct hash_chain_stats *st,
+			struct hash_backet **index, unsigned int from,
+			unsigned int size)
+{
+  unsigned int i;
+  unsigned long len;
+  struct hash_backet *hb;
+
+  for (i = from; i < size; i++)
+    {
+      len = 0;
+      for (hb = index[i]; hb; hb = hb->next)
+	len++;
+      if (len == 0)
+	st->empty++;
+      if (len > st->longest)
+	st->longest = len;
+      st->backets += len;
+    }
+}
+
+DEFUN (show_hash_statistics,
+       show_hash_statistics_cmd,
+       "show hash statistics",
+       SHOW_STR
+       "Hash table information\n"
+       "Hash table chain length statistics\n")
+{
+  struct listnode *node;
+  struct hash *hash;
+  struct hash_chain_stats st;
+  unsigned long buckets;
+  double mean;
+  int resizing = 0;
+
+  vty_out (vty, "%-24s %9s %9s %6s %6s %7s %5s %7s%s",
+	   "Name", "Count", "Buckets", "Load", "Empty", "Chain",
+	   "Max", "Resizes", VTY_NEWLINE);
+
+  if (hash_tables)
+    for (ALL_LIST_ELEMENTS_RO (hash_tables, node, hash))
+      {
+	memset (&st, 0, sizeof (st));
+	buckets = hash->size;
+	if (hash->old_index)
+	  {
+	    hash_chain_stats_index (&st, hash->old_index, hash->rehash_pos,
+				    hash->old_size);
+	    buckets += hash->old_size - hash->rehash_pos;
+	    resizing = 1;
+	  }
+	hash_chain_stats_index (&st, hash->index, 0, hash->size);
+
+	/* Mean length of the chains a lookup actually walks, ie. of the
+	   non-empty buckets. */
+	mean = 0.0;
+	if (buckets > st.empty)
+	  mean = (double) st.backets / (buckets - st.empty);
+
+	vty_out (vty, "%-24s %9lu %9lu %6.2f %5.1f%% %7.2f %5lu %7lu%s%s",
+		 hash->name, hash->count, buckets,
+		 (double) hash->count / buckets,
+		 st.empty * 100.0 / buckets, mean, st.longest,
+		 hash->resizes, hash->old_index ? " *" : "", VTY_NEWLINE);
+      }
+  ohash_show_statistics (vty);
+  if (resizing)
+    vty_out (vty, "(* resize in progress)%s", VTY_NEWLINE);
+
+  return CMD_SUCCESS;
+}
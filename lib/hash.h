@@ -24,6 +24,16 @@ Boston, MA 02111-1307, USA.  */
 /* Default hash table size.  */ 
 #define HASHTABSIZE     1024
 
+/* The table is grown once it holds more than HASH_LOAD_MAX entries per
+   bucket and shrunk (never below its initial size) once it holds fewer
+   than one entry per HASH_LOAD_MIN buckets.  */
+#define HASH_LOAD_MAX   1
+#define HASH_LOAD_MIN   4
+
+/* Number of old buckets moved to the new index by each insert or
+   release while a resize is in progress.  */
+#define HASH_REHASH_STEP 4
+
 struct hash_backet
 {
   /* Linked list.  */
@@ -52,6 +62,25 @@ struct hash
 
   /* Backet alloc. */
   unsigned long count;
+
+  /* Size given at creation, the table never shrinks below it. */
+  unsigned int min_size;
+
+  /* Index being drained while a resize is in progress.  Buckets below
+     rehash_pos have already been moved to the new index. */
+  struct hash_backet **old_index;
+  unsigned int old_size;
+  unsigned int rehash_pos;
+
+  /* Non-zero while hash_iterate is walking the table, no buckets may
+     move under it. */
+  unsigned int iterating;
+
+  /* Number of resizes so far. */
+  unsigned long resizes;
+
+  /* Name shown by "show hash statistics", NULL if not registered. */
+  const char *name;
 };
 
 extern struct hash *hash_create (unsigned int (*) (void *), 
@@ -72,4 +101,8 @@ extern void hash_free (struct hash *);
 
 extern unsigned int string_hash_make (const char *);
 
+extern void hash_set_name (struct hash *, const char *);
+
+extern struct cmd_element show_hash_statistics_cmd;
+
 #endif /* _ZEBRA_HASH_H */
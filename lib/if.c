@@ -32,6 +32,7 @@
 #include "prefix.h"
 #include "memory.h"
 #include "table.h"
+#include "hash.h"
 #include "buffer.h"
 #include "str.h"
 #include "log.h"
@@ -39,6 +40,24 @@
 /* Master list of interfaces. */
 struct list *iflist;
 
+/* Indexes of iflist for the lookups below.  Every interface on iflist
+   is in if_name_hash, and in if_index_hash unless its ifindex is
+   IFINDEX_INTERNAL. */
+static struct hash *if_name_hash;
+static struct hash *if_index_hash;
+
+/* Number of interfaces left out of if_index_hash because another one
+   holds the same ifindex, as may happen for a moment when the kernel
+   reuses an index. */
+static unsigned int if_index_shadowed;
+
+/* IPv4 addresses of all interfaces, filed by connected_add() as host
+   routes in ifaddr_ipv4_table and under their prefix and destination
+   in ifprefix_ipv4_table.  The info of each node is the list of
+   connected addresses filed there. */
+static struct route_table *ifaddr_ipv4_table;
+static struct route_table *ifprefix_ipv4_table;
+
 /* One for each program.  This structure is needed to store hooks. */
 struct if_master
 {
@@ -111,6 +130,85 @@ if_cmp_func (struct interface *ifp1, struct interface *ifp2)
   return 0;
 }
 
+static unsigned int
+if_name_hash_key (void *arg)
+{
+  struct interface *ifp = arg;
+
+  return string_hash_make (ifp->name);
+}
+
+static int
+if_name_hash_cmp (const void *a, const void *b)
+{
+  const struct interface *ifp1 = a;
+  const struct interface *ifp2 = b;
+
+  return strcmp (ifp1->name, ifp2->name) == 0;
+}
+
+static unsigned int
+if_index_hash_key (void *arg)
+{
+  struct interface *ifp = arg;
+
+  return ifp->ifindex;
+}
+
+static int
+if_index_hash_cmp (const void *a, const void *b)
+{
+  const struct interface *ifp1 = a;
+  const struct interface *ifp2 = b;
+
+  return ifp1->ifindex == ifp2->ifindex;
+}
+
+/* Is the interface on iflist?  Not if if_create() found its name
+   taken. */
+static int
+if_listed (struct interface *ifp)
+{
+  return hash_lookup (if_name_hash, ifp) == ifp;
+}
+
+static void
+if_index_add (struct interface *ifp)
+{
+  if (ifp->ifindex == IFINDEX_INTERNAL || ! if_listed (ifp))
+    return;
+
+  if (hash_get (if_index_hash, ifp, hash_alloc_intern) != ifp)
+    if_index_shadowed++;
+}
+
+static void
+if_index_del (struct interface *ifp)
+{
+  struct listnode *node;
+  struct interface *other;
+
+  if (ifp->ifindex == IFINDEX_INTERNAL || ! if_listed (ifp))
+    return;
+
+  if (hash_lookup (if_index_hash, ifp) != ifp)
+    {
+      if_index_shadowed--;
+      return;
+    }
+  hash_release (if_index_hash, ifp);
+
+  /* Let an interface shadowed by this one take its place. */
+  if (if_index_shadowed)
+    for (ALL_LIST_ELEMENTS_RO (iflist, node, other))
+      if (other != ifp && other->ifindex == ifp->ifindex)
+	{
+	  hash_get (if_index_hash, other, hash_alloc_intern);
+	  if_index_shadowed--;
+	  break;
+	}
+}
+
 /* Create new interface structure. */
 struct interface *
 if_create (const char *name, int namelen)
@@ -125,7 +223,16 @@ if_create (const char *name, int namelen)
   strncpy (ifp->name, name, namelen);
   ifp->name[namelen] = '\0';
   if (if_lookup_by_name(ifp->name) == NULL)
-    listnode_add_sort (iflist, ifp);
+    {
+      /* Kernels mostly report interfaces in order, append those
+	 without walking the list. */
+      if (listcount (iflist) == 0
+	  || if_cmp_func (listgetdata (listtail (iflist)), ifp) < 0)
+	listnode_add (iflist, ifp);
+      else
+	listnode_add_sort (iflist, ifp);
+      hash_get (if_name_hash, ifp, hash_alloc_intern);
+    }
   else
     zlog_err("if_create(%s): corruption detected -- interface with this "
 	     "name exists already!", ifp->name);
@@ -153,7 +260,12 @@ if_delete_retain (struct interface *ifp)
 void
 if_delete (struct interface *ifp)
 {
-  listnode_delete (iflist, ifp);
+  if (if_listed (ifp))
+    {
+      if_index_del (ifp);
+      hash_release (if_name_hash, ifp);
+      listnode_delete (iflist, ifp);
+    }
 
   if_delete_retain(ifp);
 
@@ -184,13 +296,31 @@ if_lookup_by_index (unsigned int index)
 {
   struct listnode *node;
   struct interface *ifp;
+  struct interface key;
 
-  for (ALL_LIST_ELEMENTS_RO(iflist, node, ifp))
+  /* Internal interfaces are not indexed, there may be any number. */
+  if (index == IFINDEX_INTERNAL)
     {
-      if (ifp->ifindex == index)
-	return ifp;
+      for (ALL_LIST_ELEMENTS_RO(iflist, node, ifp))
+	if (ifp->ifindex == index)
+	  return ifp;
+      return NULL;
     }
-  return NULL;
+
+  key.ifindex = index;
+  return hash_lookup (if_index_hash, &key);
+}
+
+/* Change the ifindex of an interface. */
+void
+if_set_index (struct interface *ifp, unsigned int ifindex)
+{
+  if (ifp->ifindex == ifindex)
+    return;
+
+  if_index_del (ifp);
+  ifp->ifindex = ifindex;
+  if_index_add (ifp);
 }
 
 const char *
@@ -215,70 +345,66 @@ ifname2ifindex (const char *name)
 struct interface *
 if_lookup_by_name (const char *name)
 {
-  struct listnode *node;
-  struct interface *ifp;
-  
-  if (name)
-    for (ALL_LIST_ELEMENTS_RO (iflist, node, ifp))
-      {
-        if (strcmp(name, ifp->name) == 0)
-          return ifp;
-      }
-  return NULL;
+  if (name == NULL)
+    return NULL;
+
+  return if_lookup_by_name_len (name, strlen (name));
 }
 
 struct interface *
 if_lookup_by_name_len(const char *name, size_t namelen)
 {
-  struct listnode *node;
-  struct interface *ifp;
+  struct interface key;
 
   if (namelen > INTERFACE_NAMSIZ)
     return NULL;
 
-  for (ALL_LIST_ELEMENTS_RO (iflist, node, ifp))
-    {
-      if (!memcmp(name, ifp->name, namelen) && (ifp->name[namelen] == '\0'))
-	return ifp;
-    }
-  return NULL;
+  memcpy (key.name, name, namelen);
+  key.name[namelen] = '\0';
+  return hash_lookup (if_name_hash, &key);
 }
 
-/* Lookup interface by IPv4 address. */
+/* Lookup interface by IPv4 address.  Of several interfaces with the
+   address, the first one on iflist is returned. */
 struct interface *
 if_lookup_exact_address (struct in_addr src)
 {
-  struct listnode *node;
+  struct prefix_ipv4 p;
+  struct route_node *rn;
   struct listnode *cnode;
-  struct interface *ifp;
-  struct prefix *p;
   struct connected *c;
+  struct interface *match;
 
-  for (ALL_LIST_ELEMENTS_RO (iflist, node, ifp))
-    {
-      for (ALL_LIST_ELEMENTS_RO (ifp->connected, cnode, c))
-	{
-	  p = c->address;
+  p.family = AF_INET;
+  p.prefix = src;
+  p.prefixlen = IPV4_MAX_BITLEN;
 
-	  if (p && p->family == AF_INET)
-	    {
-	      if (IPV4_ADDR_SAME (&p->u.prefix4, &src))
-		return ifp;
-	    }	      
-	}
-    }
-  return NULL;
+  rn = route_node_lookup (ifaddr_ipv4_table, (struct prefix *) &p);
+  if (! rn)
+    return NULL;
+
+  match = NULL;
+  if (rn->info)
+    for (ALL_LIST_ELEMENTS_RO ((struct list *) rn->info, cnode, c))
+      {
+	if (IPV4_ADDR_SAME (&c->address->u.prefix4, &src)
+	    && (! match || if_cmp_func (c->ifp, match) < 0))
+	  match = c->ifp;
+      }
+  route_unlock_node (rn);
+  return match;
 }
 
-/* Lookup interface by IPv4 address. */
+/* Lookup interface by IPv4 address.  The interface with the longest
+   connected prefix covering the address wins, the first one on iflist
+   among equally long ones. */
 struct interface *
 if_lookup_address (struct in_addr src)
 {
-  struct listnode *node;
   struct prefix addr;
   int bestlen = 0;
+  struct route_node *rn, *pn;
   struct listnode *cnode;
-  struct interface *ifp;
   struct connected *c;
   struct interface *match;
 
@@ -286,21 +412,33 @@ if_lookup_address (struct in_addr src)
   addr.u.prefix4 = src;
   addr.prefixlen = IPV4_MAX_BITLEN;
 
-  match = NULL;
+  rn = route_node_match_ipv4 (ifprefix_ipv4_table, &src);
+  if (! rn)
+    return NULL;
 
-  for (ALL_LIST_ELEMENTS_RO (iflist, node, ifp))
+  /* Addresses are filed under both their prefix and destination, as
+     the peer flag may be set after connected_add(), so check each
+     candidate on the way up the way the old linear search did. */
+  match = NULL;
+  for (pn = rn; pn; pn = pn->parent)
     {
-      for (ALL_LIST_ELEMENTS_RO (ifp->connected, cnode, c))
+      if (pn->info == NULL)
+	continue;
+
+      for (ALL_LIST_ELEMENTS_RO ((struct list *) pn->info, cnode, c))
 	{
-	  if (c->address && (c->address->family == AF_INET) &&
+	  if (c->address->family == AF_INET &&
 	      prefix_match(CONNECTED_PREFIX(c), &addr) &&
-	      (c->address->prefixlen > bestlen))
+	      ((c->address->prefixlen > bestlen) ||
+	       (match && c->address->prefixlen == bestlen &&
+		if_cmp_func (c->ifp, match) < 0)))
 	    {
 	      bestlen = c->address->prefixlen;
-	      match = ifp;
+	      match = c->ifp;
 	    }
 	}
     }
+  route_unlock_node (rn);
   return match;
 }
 
@@ -625,10 +763,99 @@ connected_new (void)
   return XCALLOC (MTYPE_CONNECTED, sizeof (struct connected));
 }
 
+/* File ifc under addr/prefixlen in an address table. */
+static struct route_node *
+connected_index_add (struct route_table *table, struct in_addr addr,
+		     u_char prefixlen, struct connected *ifc)
+{
+  struct prefix_ipv4 p;
+  struct route_node *rn;
+
+  p.family = AF_INET;
+  p.prefix = addr;
+  p.prefixlen = prefixlen;
+  apply_mask_ipv4 (&p);
+
+  rn = route_node_get (table, (struct prefix *) &p);
+  if (rn->info == NULL)
+    rn->info = list_new ();
+  else
+    route_unlock_node (rn);
+
+  listnode_add (rn->info, ifc);
+  return rn;
+}
+
+static void
+connected_index_del (struct route_node *rn, struct connected *ifc)
+{
+  listnode_delete (rn->info, ifc);
+  if (listcount ((struct list *) rn->info) == 0)
+    {
+      list_free (rn->info);
+      rn->info = NULL;
+      route_unlock_node (rn);
+    }
+}
+
+/* Add an IPv4 address to the address indexes.  Nodes are remembered,
+   so the address may change while filed (OSPF virtual links do). */
+static void
+connected_index (struct connected *ifc)
+{
+  struct prefix *p = ifc->address;
+  struct prefix *d = ifc->destination;
+
+  if (p == NULL || p->family != AF_INET || ifc->rn_address)
+    return;
+
+  ifc->rn_address = connected_index_add (ifaddr_ipv4_table, p->u.prefix4,
+					 IPV4_MAX_BITLEN, ifc);
+  ifc->rn_prefix = connected_index_add (ifprefix_ipv4_table, p->u.prefix4,
+					p->prefixlen, ifc);
+
+  /* A peer usually lies outside the prefix, a broadcast address never. */
+  if (d && d->family == AF_INET
+      && (d->prefixlen < p->prefixlen || ! prefix_match (p, d)))
+    ifc->rn_destination = connected_index_add (ifprefix_ipv4_table,
+					       d->u.prefix4, d->prefixlen, ifc);
+}
+
+static void
+connected_unindex (struct connected *ifc)
+{
+  if (ifc->rn_address)
+    connected_index_del (ifc->rn_address, ifc);
+  if (ifc->rn_prefix)
+    connected_index_del (ifc->rn_prefix, ifc);
+  if (ifc->rn_destination)
+    connected_index_del (ifc->rn_destination, ifc);
+
+  ifc->rn_address = ifc->rn_prefix = ifc->rn_destination = NULL;
+}
+
+/* Add a connected address to the interface. */
+void
+connected_add (struct interface *ifp, struct connected *ifc)
+{
+  listnode_add (ifp->connected, ifc);
+  connected_index (ifc);
+}
+
+/* Take a connected address off the interface, without freeing it. */
+void
+connected_delete (struct interface *ifp, struct connected *ifc)
+{
+  connected_unindex (ifc);
+  listnode_delete (ifp->connected, ifc);
+}
+
 /* Free connected structure. */
 void
 connected_free (struct connected *connected)
 {
+  connected_unindex (connected);
+
   if (connected->address)
     prefix_free (connected->address);
 
@@ -700,7 +927,7 @@ connected_delete_by_prefix (struct interface *ifp, struct prefix *p)
 
       if (connected_same_prefix (ifc->address, p))
 	{
-	  listnode_delete (ifp->connected, ifc);
+	  connected_delete (ifp, ifc);
 	  return ifc;
 	}
     }
@@ -755,7 +982,7 @@ connected_add_by_prefix (struct interface *ifp, struct prefix *p,
     }
 
   /* Add connected address to the interface. */
-  listnode_add (ifp->connected, ifc);
+  connected_add (ifp, ifc);
   return ifc;
 }
 
@@ -783,93 +1010,17 @@ if_indextoname (unsigned int ifindex, char *name)
 }
 #endif
 
-#if 0 /* this route_table of struct connected's is unused
-       * however, it would be good to use a route_table rather than
-       * a list..
-       */
-/* Interface looking up by interface's address. */
-/* Interface's IPv4 address reverse lookup table. */
-struct route_table *ifaddr_ipv4_table;
-/* struct route_table *ifaddr_ipv6_table; */
-
-static void
-ifaddr_ipv4_add (struct in_addr *ifaddr, struct interface *ifp)
-{
-  struct route_node *rn;
-  struct prefix_ipv4 p;
-
-  p.family = AF_INET;
-  p.prefixlen = IPV4_MAX_PREFIXLEN;
-  p.prefix = *ifaddr;
-
-  rn = route_node_get (ifaddr_ipv4_table, (struct prefix *) &p);
-  if (rn)
-    {
-      route_unlock_node (rn);
-      zlog_info ("ifaddr_ipv4_add(): address %s is already added",
-		 inet_ntoa (*ifaddr));
-      return;
-    }
-  rn->info = ifp;
-}
-
-static void
-ifaddr_ipv4_delete (struct in_addr *ifaddr, struct interface *ifp)
-{
-  struct route_node *rn;
-  struct prefix_ipv4 p;
-
-  p.family = AF_INET;
-  p.prefixlen = IPV4_MAX_PREFIXLEN;
-  p.prefix = *ifaddr;
-
-  rn = route_node_lookup (ifaddr_ipv4_table, (struct prefix *) &p);
-  if (! rn)
-    {
-      zlog_info ("ifaddr_ipv4_delete(): can't find address %s",
-		 inet_ntoa (*ifaddr));
-      return;
-    }
-  rn->info = NULL;
-  route_unlock_node (rn);
-  route_unlock_node (rn);
-}
-
-/* Lookup interface by interface's IP address or interface index. */
-static struct interface *
-ifaddr_ipv4_lookup (struct in_addr *addr, unsigned int ifindex)
-{
-  struct prefix_ipv4 p;
-  struct route_node *rn;
-  struct interface *ifp;
-
-  if (addr)
-    {
-      p.family = AF_INET;
-      p.prefixlen = IPV4_MAX_PREFIXLEN;
-      p.prefix = *addr;
-
-      rn = route_node_lookup (ifaddr_ipv4_table, (struct prefix *) &p);
-      if (! rn)
-	return NULL;
-      
-      ifp = rn->info;
-      route_unlock_node (rn);
-      return ifp;
-    }
-  else
-    return if_lookup_by_index(ifindex);
-}
-#endif /* ifaddr_ipv4_table */
-
 /* Initialize interface list. */
 void
 if_init (void)
 {
   iflist = list_new ();
-#if 0
+  if_name_hash = hash_create (if_name_hash_key, if_name_hash_cmp);
+  if_index_hash = hash_create (if_index_hash_key, if_index_hash_cmp);
+  hash_set_name (if_name_hash, "Interface names");
+  hash_set_name (if_index_hash, "Interface indexes");
   ifaddr_ipv4_table = route_table_init ();
-#endif /* ifaddr_ipv4_table */
+  ifprefix_ipv4_table = route_table_init ();
 
   if (iflist) {
     iflist->cmp = (int (*)(void *, void *))if_cmp_func;
@@ -895,4 +1046,12 @@ if_terminate (void)
 
   list_delete (iflist);
   iflist = NULL;
+
+  hash_free (if_name_hash);
+  hash_free (if_index_hash);
+  if_name_hash = if_index_hash = NULL;
+  if_index_shadowed = 0;
+  route_table_finish (ifaddr_ipv4_table);
+  route_table_finish (ifprefix_ipv4_table);
+  ifaddr_ipv4_table = ifprefix_ipv4_table = NULL;
 }
@@ -81,7 +81,8 @@ struct interface
   char name[INTERFACE_NAMSIZ + 1];
 
   /* Interface index (should be IFINDEX_INTERNAL for non-kernel or
-     deleted interfaces). */
+     deleted interfaces).  Only change it through if_set_index(), which
+     keeps the index of if_lookup_by_index() up to date. */
   unsigned int ifindex;
 #define IFINDEX_INTERNAL	0
 
@@ -172,6 +173,12 @@ struct connected
 
   /* Label for Linux 2.2.X and upper. */
   char *label;
+
+  /* Nodes of the IPv4 address indexes this address is filed under by
+     connected_add(), NULL while it is not on its interface's list. */
+  struct route_node *rn_address;
+  struct route_node *rn_prefix;
+  struct route_node *rn_destination;
 };
 
 /* Does the destination field contain a peer address? */
@@ -232,6 +239,7 @@ struct connected
 extern int if_cmp_func (struct interface *, struct interface *);
 extern struct interface *if_create (const char *name, int namelen);
 extern struct interface *if_lookup_by_index (unsigned int);
+extern void if_set_index (struct interface *, unsigned int);
 extern struct interface *if_lookup_exact_address (struct in_addr);
 extern struct interface *if_lookup_address (struct in_addr);
 
@@ -284,6 +292,7 @@ extern unsigned int ifname2ifindex(const char *ifname);
 extern struct connected *connected_new (void);
 extern void connected_free (struct connected *);
 extern void connected_add (struct interface *, struct connected *);
+extern void connected_delete (struct interface *, struct connected *);
 extern struct connected  *connected_add_by_prefix (struct interface *,
                                             struct prefix *,
                                             struct prefix *);
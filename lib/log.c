@@ -23,6 +23,7 @@
 #define QUAGGA_DEFINE_DESC_TABLE
 
 #include <zebra.h>
+#include <pthread.h>
 
 #include "log.h"
 #include "memory.h"
@@ -144,6 +145,395 @@ time_print(FILE *fp, struct timestamp_control *ctl)
     }
   fprintf(fp, "%s ", ctl->buf);
 }
+
+/* Asynchronous logging.
+ *
+ * With "log async", vzlog() formats a message into a record of a ring
+ * buffer and returns; a writer pthread takes the records out in order
+ * and writes them to syslog, the log file and stdout, flushing once per
+ * batch.  Any number of pthreads may log: a producer claims a record by
+ * advancing tail with a compare-and-swap, and publishes it by setting
+ * its sequence number, so neither side takes a lock for a message.
+ * When the ring is full the message is dropped and counted, and the
+ * writer logs how many were lost once it has caught up.
+ *
+ * The writer is started at the first message, and again after a fork()
+ * (daemon mode), which leaves it behind in the parent.  The crash paths
+ * (zlog_signal, zlog_backtrace_sigsafe) don't go through here at all.
+ *
+ * Other pthreads may be in the middle of a push when "no log async"
+ * stops the writer, so the ring is kept until closezlog(), and used
+ * again if async logging is turned back on.
+ */
+#define ZLOG_ASYNC_RECORDS  4096	/* a power of two */
+#define ZLOG_ASYNC_MSGLEN   512
+#define ZLOG_ASYNC_BATCH    256		/* records written per flush */
+#define ZLOG_ASYNC_IDLE_MS  100		/* writer sleeps at most that long */
+
+struct zlog_record
+{
+  unsigned long seq;
+  int priority;
+  char ts[40];
+  char msg[ZLOG_ASYNC_MSGLEN];
+};
+
+struct zlog_async
+{
+  struct zlog_record *ring;
+
+  /* Next record to claim, and next one to write (writer only).  A
+     record is free for position pos when its seq is pos, and ready for
+     the writer when it is pos + 1. */
+  unsigned long tail;
+  unsigned long head;
+
+  unsigned long written;
+  unsigned long dropped;
+  unsigned long dropped_reported;
+
+  /* "log async" is on. */
+  int enabled;
+
+  /* Writer pthread, started and stopped under zlog_async_start_mtx. */
+  pthread_t writer;
+  int running;
+  int stop;
+
+  /* Wakeup of the writer when it sleeps. */
+  pthread_mutex_t mtx;
+  pthread_cond_t cond;
+  int sleeping;
+
+  /* Held by the writer while it writes a batch, and by whoever changes
+     the log file under it. */
+  pthread_mutex_t io;
+};
+
+#define ZLOG_SEQ(rec)  (*(volatile unsigned long *) &(rec)->seq)
+
+static pthread_mutex_t zlog_async_start_mtx = PTHREAD_MUTEX_INITIALIZER;
+
+static void
+zlog_async_output (struct zlog *zl, int priority, const char *ts,
+		   const char *msg)
+{
+  const char *prio = zl->record_priority ? zlog_priority[priority] : NULL;
+
+  if (priority <= zl->maxlvl[ZLOG_DEST_SYSLOG])
+    syslog (priority|zlog_default->facility, "%s", msg);
+
+  if ((priority <= zl->maxlvl[ZLOG_DEST_FILE]) && zl->fp)
+    fprintf (zl->fp, "%s %s%s%s: %s\n", ts, prio ? prio : "",
+	     prio ? ": " : "", zlog_proto_names[zl->protocol], msg);
+
+  if (priority <= zl->maxlvl[ZLOG_DEST_STDOUT])
+    fprintf (stdout, "%s %s%s%s: %s\n", ts, prio ? prio : "",
+	     prio ? ": " : "", zlog_proto_names[zl->protocol], msg);
+}
+
+/* Write out up to a batch of records, returns how many. */
+static int
+zlog_async_drain (struct zlog *zl)
+{
+  struct zlog_async *as = zl->async;
+  struct zlog_record *rec;
+  unsigned long dropped;
+  char msg[64], ts[40];
+  int n;
+
+  pthread_mutex_lock (&as->io);
+
+  for (n = 0; n < ZLOG_ASYNC_BATCH; n++)
+    {
+      rec = &as->ring[as->head & (ZLOG_ASYNC_RECORDS - 1)];
+      if (ZLOG_SEQ (rec) != as->head + 1)
+	break;
+      __sync_synchronize ();
+
+      zlog_async_output (zl, rec->priority, rec->ts, rec->msg);
+
+      __sync_synchronize ();
+      ZLOG_SEQ (rec) = as->head + ZLOG_ASYNC_RECORDS;
+      as->head++;
+    }
+  as->written += n;
+
+  if (n < ZLOG_ASYNC_BATCH
+      && (dropped = as->dropped) != as->dropped_reported)
+    {
+      quagga_timestamp (zl->timestamp_precision, ts, sizeof (ts));
+      snprintf (msg, sizeof (msg), "log ring buffer full, %lu messages lost",
+		dropped - as->dropped_reported);
+      zlog_async_output (zl, LOG_WARNING, ts, msg);
+      as->dropped_reported = dropped;
+    }
+
+  if (n)
+    {
+      if (zl->fp)
+	fflush (zl->fp);
+      fflush (stdout);
+    }
+
+  pthread_mutex_unlock (&as->io);
+
+  return n;
+}
+
+static void *
+zlog_async_writer (void *arg)
+{
+  struct zlog *zl = arg;
+  struct zlog_async *as = zl->async;
+  struct timespec until;
+  struct timeval now;
+
+  for (;;)
+    {
+      if (zlog_async_drain (zl))
+	continue;
+      if (as->stop)
+	break;
+
+      pthread_mutex_lock (&as->mtx);
+      as->sleeping = 1;
+      __sync_synchronize ();
+      if (ZLOG_SEQ (&as->ring[as->head & (ZLOG_ASYNC_RECORDS - 1)])
+	  != as->head + 1 && !as->stop)
+	{
+	  gettimeofday (&now, NULL);
+	  until.tv_sec = now.tv_sec;
+	  until.tv_nsec = (now.tv_usec + ZLOG_ASYNC_IDLE_MS * 1000) * 1000L;
+	  if (until.tv_nsec >= 1000000000L)
+	    {
+	      until.tv_sec++;
+	      until.tv_nsec -= 1000000000L;
+	    }
+	  pthread_cond_timedwait (&as->cond, &as->mtx, &until);
+	}
+      as->sleeping = 0;
+      pthread_mutex_unlock (&as->mtx);
+    }
+
+  return NULL;
+}
+
+static void
+zlog_async_wakeup (struct zlog_async *as)
+{
+  pthread_mutex_lock (&as->mtx);
+  pthread_cond_signal (&as->cond);
+  pthread_mutex_unlock (&as->mtx);
+}
+
+/* The writer doesn't survive fork(), have the child start its own. */
+static void
+zlog_async_atfork_child (void)
+{
+  if (zlog_default && zlog_default->async)
+    {
+      zlog_default->async->running = 0;
+      pthread_mutex_init (&zlog_default->async->mtx, NULL);
+      pthread_mutex_init (&zlog_default->async->io, NULL);
+    }
+}
+
+static void
+zlog_async_start (struct zlog *zl)
+{
+  static int atfork;
+  struct zlog_async *as = zl->async;
+  sigset_t all, old;
+
+  pthread_mutex_lock (&zlog_async_start_mtx);
+  if (as->enabled && !as->running)
+    {
+      if (!atfork)
+	{
+	  pthread_atfork (NULL, NULL, zlog_async_atfork_child);
+	  atfork = 1;
+	}
+
+      /* Signals are for the main pthread. */
+      sigfillset (&all);
+      pthread_sigmask (SIG_BLOCK, &all, &old);
+      as->stop = 0;
+      if (pthread_create (&as->writer, NULL, zlog_async_writer, zl) == 0)
+	as->running = 1;
+      pthread_sigmask (SIG_SETMASK, &old, NULL);
+    }
+  pthread_mutex_unlock (&zlog_async_start_mtx);
+}
+
+/* Queue a message for the writer.  Returns 0 if it has to be logged
+   synchronously instead. */
+static int
+zlog_async_push (struct zlog *zl, int priority,
+		 struct timestamp_control *tsctl, const char *format,
+		 va_list args)
+{
+  struct zlog_async *as = zl->async;
+  struct zlog_record *rec;
+  unsigned long pos;
+  long diff;
+  va_list ac;
+
+  if (priority > zl->maxlvl[ZLOG_DEST_SYSLOG]
+      && (priority > zl->maxlvl[ZLOG_DEST_FILE] || !zl->fp)
+      && priority > zl->maxlvl[ZLOG_DEST_STDOUT])
+    return 1;
+
+  if (!as->running)
+    {
+      zlog_async_start (zl);
+      if (!as->running)
+	return 0;
+    }
+
+  pos = as->tail;
+  for (;;)
+    {
+      rec = &as->ring[pos & (ZLOG_ASYNC_RECORDS - 1)];
+      diff = (long) (ZLOG_SEQ (rec) - pos);
+      if (diff == 0)
+	{
+	  if (__sync_bool_compare_and_swap (&as->tail, pos, pos + 1))
+	    break;
+	}
+      else if (diff < 0)
+	{
+	  __sync_fetch_and_add (&as->dropped, 1);
+	  return 1;
+	}
+      pos = *(volatile unsigned long *) &as->tail;
+    }
+  __sync_synchronize ();
+
+  if (!tsctl->already_rendered)
+    {
+      tsctl->len = quagga_timestamp (tsctl->precision, tsctl->buf,
+				     sizeof (tsctl->buf));
+      tsctl->already_rendered = 1;
+    }
+  memcpy (rec->ts, tsctl->buf, sizeof (rec->ts));
+  rec->priority = priority;
+  va_copy (ac, args);
+  vsnprintf (rec->msg, sizeof (rec->msg), format, ac);
+  va_end (ac);
+
+  __sync_synchronize ();
+  ZLOG_SEQ (rec) = pos + 1;
+
+  __sync_synchronize ();
+  if (*(volatile int *) &as->sleeping)
+    zlog_async_wakeup (as);
+
+  return 1;
+}
+
+void
+zlog_set_async (struct zlog *zl, int enable)
+{
+  struct zlog_async *as;
+  unsigned long i;
+
+  if (zl == NULL)
+    zl = zlog_default;
+
+  if (enable && zl->async == NULL)
+    {
+      as = XCALLOC (MTYPE_ZLOG_ASYNC, sizeof (struct zlog_async));
+      as->ring = XCALLOC (MTYPE_ZLOG_ASYNC,
+			  ZLOG_ASYNC_RECORDS * sizeof (struct zlog_record));
+      for (i = 0; i < ZLOG_ASYNC_RECORDS; i++)
+	as->ring[i].seq = i;
+      pthread_mutex_init (&as->mtx, NULL);
+      pthread_cond_init (&as->cond, NULL);
+      pthread_mutex_init (&as->io, NULL);
+      __sync_synchronize ();
+      zl->async = as;
+    }
+
+  if ((as = zl->async) == NULL)
+    return;
+
+  pthread_mutex_lock (&zlog_async_start_mtx);
+  as->enabled = enable;
+  __sync_synchronize ();
+  if (!enable && as->running)
+    {
+      /* Let the writer empty the ring before it goes. */
+      as->stop = 1;
+      zlog_async_wakeup (as);
+      pthread_join (as->writer, NULL);
+      as->running = 0;
+    }
+  pthread_mutex_unlock (&zlog_async_start_mtx);
+
+  /* What was pushed while the writer was stopping. */
+  if (!enable)
+    while (zlog_async_drain (zl))
+      ;
+}
+
+int
+zlog_get_async (struct zlog *zl)
+{
+  if (zl == NULL)
+    zl = zlog_default;
+  return zl->async && zl->async->enabled;
+}
+
+/* Only once no other pthread logs any more. */
+static void
+zlog_async_free (struct zlog *zl)
+{
+  struct zlog_async *as = zl->async;
+
+  if (as == NULL)
+    return;
+
+  zlog_set_async (zl, 0);
+  zl->async = NULL;
+  pthread_mutex_destroy (&as->mtx);
+  pthread_cond_destroy (&as->cond);
+  pthread_mutex_destroy (&as->io);
+  XFREE (MTYPE_ZLOG_ASYNC, as->ring);
+  XFREE (MTYPE_ZLOG_ASYNC, as);
+}
+
+int
+zlog_async_stats (struct zlog *zl, unsigned long *queued,
+		  unsigned long *written, unsigned long *dropped)
+{
+  struct zlog_async *as;
+
+  if (zl == NULL)
+    zl = zlog_default;
+  if ((as = zl->async) == NULL || !as->enabled)
+    return 0;
+
+  *queued = as->tail - as->head;
+  *written = as->written;
+  *dropped = as->dropped;
+  return 1;
+}
+
+/* Keep the writer off the outputs while they are changed. */
+static void
+zlog_io_lock (struct zlog *zl)
+{
+  if (zl->async)
+    pthread_mutex_lock (&zl->async->io);
+}
+
+static void
+zlog_io_unlock (struct zlog *zl)
+{
+  if (zl->async)
+    pthread_mutex_unlock (&zl->async->io);
+}
   
 
 /* va_list version of zlog. */
@@ -172,6 +562,12 @@ vzlog (struct zlog *zl, int priority, const char *format, va_list args)
     }
   tsctl.precision = zl->timestamp_precision;
 
+  /* Hand the message to the writer pthread if logging async, except
+     critical ones: they may be the last words before an abort(). */
+  if (zl->async && zl->async->enabled && priority > LOG_CRIT
+      && zlog_async_push (zl, priority, &tsctl, format, args))
+    goto monitor;
+
   /* Syslog output */
   if (priority <= zl->maxlvl[ZLOG_DEST_SYSLOG])
     {
@@ -212,6 +608,7 @@ vzlog (struct zlog *zl, int priority, const char *format, va_list args)
     }
 
   /* Terminal monitor. */
+monitor:
   if (priority <= zl->maxlvl[ZLOG_DEST_MONITOR])
     vty_log ((zl->record_priority ? zlog_priority[priority] : NULL),
 	     zlog_proto_names[zl->protocol], format, &tsctl, args);
@@ -649,6 +1046,7 @@ openzlog (const char *progname, zlog_proto_t protocol,
 void
 closezlog (struct zlog *zl)
 {
+  zlog_async_free (zl);
   closelog();
 
   if (zl->fp != NULL)
@@ -691,10 +1089,12 @@ zlog_set_file (struct zlog *zl, const char *filename, int log_level)
     return 0;
 
   /* Set flags. */
+  zlog_io_lock (zl);
   zl->filename = strdup (filename);
   zl->maxlvl[ZLOG_DEST_FILE] = log_level;
   zl->fp = fp;
   logfile_fd = fileno(fp);
+  zlog_io_unlock (zl);
 
   return 1;
 }
@@ -706,6 +1106,7 @@ zlog_reset_file (struct zlog *zl)
   if (zl == NULL)
     zl = zlog_default;
 
+  zlog_io_lock (zl);
   if (zl->fp)
     fclose (zl->fp);
   zl->fp = NULL;
@@ -715,6 +1116,7 @@ zlog_reset_file (struct zlog *zl)
   if (zl->filename)
     free (zl->filename);
   zl->filename = NULL;
+  zlog_io_unlock (zl);
 
   return 1;
 }
@@ -728,6 +1130,7 @@ zlog_rotate (struct zlog *zl)
   if (zl == NULL)
     zl = zlog_default;
 
+  zlog_io_lock (zl);
   if (zl->fp)
     fclose (zl->fp);
   zl->fp = NULL;
@@ -746,6 +1149,7 @@ zlog_rotate (struct zlog *zl)
       umask(oldumask);
       if (zl->fp == NULL)
         {
+	  zlog_io_unlock (zl);
 	  zlog_err("Log rotate failed: cannot open file %s for append: %s",
 	  	   zl->filename, safe_strerror(save_errno));
 	  return -1;
@@ -753,6 +1157,7 @@ zlog_rotate (struct zlog *zl)
       logfile_fd = fileno(zl->fp);
       zl->maxlvl[ZLOG_DEST_FILE] = level;
     }
+  zlog_io_unlock (zl);
 
   return 1;
 }
@@ -845,6 +1250,9 @@ static const struct zebra_desc_table command_types[] = {
   DESC_ENTRY	(ZEBRA_ROUTER_ID_DELETE),
   DESC_ENTRY	(ZEBRA_ROUTER_ID_UPDATE),
   DESC_ENTRY	(ZEBRA_HELLO),
+  DESC_ENTRY	(ZEBRA_NEXTHOP_REGISTER),
+  DESC_ENTRY	(ZEBRA_NEXTHOP_UNREGISTER),
+  DESC_ENTRY	(ZEBRA_NEXTHOP_UPDATE),
 };
 #undef DESC_ENTRY
 
@@ -69,6 +69,8 @@ typedef enum
 } zlog_dest_t;
 #define ZLOG_NUM_DESTS		(ZLOG_DEST_FILE+1)
 
+struct zlog_async;
+
 struct zlog 
 {
   const char *ident;	/* daemon name (first arg to openlog) */
@@ -83,6 +85,8 @@ struct zlog
   			   priority of the message? */
   int syslog_options;	/* 2nd arg to openlog */
   int timestamp_precision;	/* # of digits of subsecond precision */
+  struct zlog_async *async;	/* ring buffer and writer pthread, once
+				   "log async" has been on */
 };
 
 /* Message structure. */
@@ -146,6 +150,17 @@ extern int zlog_reset_file (struct zlog *zl);
 /* Rotate log. */
 extern int zlog_rotate (struct zlog *);
 
+/* Hand syslog, file and stdout output to a writer pthread, or stop
+   doing so.  Messages are queued in a ring buffer, and dropped (and
+   counted) when it is full.  Critical messages and the monitor
+   destination are always logged synchronously. */
+extern void zlog_set_async (struct zlog *zl, int enable);
+extern int zlog_get_async (struct zlog *zl);
+
+/* Statistics of the ring buffer; returns 0 if not logging async. */
+extern int zlog_async_stats (struct zlog *zl, unsigned long *queued,
+			     unsigned long *written, unsigned long *dropped);
+
 /* For hackey massage lookup and check */
 #define LOOKUP(x, y) mes_lookup(x, x ## _max, y, "(no item found)", #x)
 
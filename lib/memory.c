@@ -21,17 +21,24 @@
  */
 
 #include <zebra.h>
-/* malloc.h is generally obsolete, however GNU Libc mallinfo wants it. */
-#if !defined(HAVE_STDLIB_H) || (defined(GNU_LINUX) && defined(HAVE_MALLINFO))
+/* malloc.h is generally obsolete, however GNU Libc mallinfo and
+   malloc_usable_size want it. */
+#if !defined(HAVE_STDLIB_H) || (defined(GNU_LINUX) && defined(HAVE_MALLINFO)) \
+    || defined(HAVE_MALLOC_USABLE_SIZE)
 #include <malloc.h>
-#endif /* !HAVE_STDLIB_H || HAVE_MALLINFO */
+#endif /* !HAVE_STDLIB_H || HAVE_MALLINFO || HAVE_MALLOC_USABLE_SIZE */
+
+#include <pthread.h>
 
 #include "log.h"
 #include "memory.h"
+#include "thread.h"
 
-static void alloc_inc (int);
-static void alloc_dec (int);
+static void alloc_inc (int, size_t);
+static void alloc_dec (int, size_t);
+static void alloc_resize (int, size_t, size_t);
 static void log_memstats(int log_priority);
+static const char *mtype_name (int type);
 
 static const struct message mstr [] =
 {
@@ -58,6 +65,285 @@ zerror (const char *fname, int type, size_t size)
   abort();
 }
 
+/*
+ * Slab pools.
+ *
+ * Objects of a type opted in with memory_pool_init() are carved out of
+ * MEMORY_SLAB_SIZE slabs rather than malloc'ed one by one, which saves
+ * the allocator's header and bookkeeping on small fixed size objects
+ * that come and go by the million.  Slabs are aligned to their size,
+ * so the slab of an object is found by masking its address.  Each slab
+ * has a free list of its own, and slabs with free objects are on the
+ * pool's partial list.
+ *
+ * Slabs are cut in turn from chunks of MEMORY_CHUNK_SLABS, each a
+ * single malloc one slab bigger than needed so the slabs can be
+ * aligned within it (the system allocator would waste as much again
+ * on every slab otherwise).  Slabs that become empty wait on the
+ * pool's empty list to be used again, and a chunk goes back to the
+ * system once all of its slabs are empty, unless it is the pool's
+ * last one.
+ */
+#define MEMORY_SLAB_SIZE    65536
+#define MEMORY_CHUNK_SLABS  32
+#define MEMORY_POOL_ALIGN   8
+
+struct mchunk
+{
+  /* As returned by malloc, and the first aligned slab in it. */
+  void *mem;
+  char *base;
+
+  /* Slabs cut from the chunk so far, and how many of them are not
+     empty. */
+  unsigned int carved;
+  unsigned int used;
+};
+
+struct mslab
+{
+  /* Partial or empty list. */
+  struct mslab *next;
+  struct mslab *prev;
+
+  struct mchunk *chunk;
+
+  /* Objects released to this slab. */
+  void *free;
+
+  /* Start of the space never handed out so far. */
+  char *unused;
+
+  /* Objects allocated out of this slab. */
+  unsigned int inuse;
+};
+
+struct mpool
+{
+  pthread_mutex_t mtx;
+
+  /* Object size and objects per slab. */
+  size_t size;
+  unsigned int per_slab;
+
+  /* Slabs with free objects, and slabs with no objects allocated. */
+  struct mslab *partial;
+  struct mslab *empty;
+
+  /* Chunk slabs are being cut from. */
+  struct mchunk *current;
+
+  unsigned long chunks;
+  unsigned long slabs;
+  unsigned long inuse;
+};
+
+#define MSLAB_HEADER \
+  ((sizeof (struct mslab) + MEMORY_POOL_ALIGN - 1) & ~(MEMORY_POOL_ALIGN - 1))
+
+static struct mpool *mpools[MTYPE_MAX];
+
+static void
+mslab_link (struct mslab **head, struct mslab *slab)
+{
+  slab->prev = NULL;
+  slab->next = *head;
+  if (*head)
+    (*head)->prev = slab;
+  *head = slab;
+}
+
+static void
+mslab_unlink (struct mslab **head, struct mslab *slab)
+{
+  if (slab->prev)
+    slab->prev->next = slab->next;
+  else
+    *head = slab->next;
+  if (slab->next)
+    slab->next->prev = slab->prev;
+}
+
+/* Get an empty slab, from the empty list or a chunk. */
+static struct mslab *
+mslab_get (struct mpool *mp)
+{
+  struct mchunk *chunk;
+  struct mslab *slab;
+  void *mem;
+
+  if ((slab = mp->empty) != NULL)
+    {
+      mslab_unlink (&mp->empty, slab);
+      slab->chunk->used++;
+      return slab;
+    }
+
+  chunk = mp->current;
+  if (chunk == NULL || chunk->carved == MEMORY_CHUNK_SLABS)
+    {
+      if ((mem = malloc ((MEMORY_CHUNK_SLABS + 1) * MEMORY_SLAB_SIZE)) == NULL)
+	return NULL;
+      chunk = XCALLOC (MTYPE_MEMORY_CHUNK, sizeof (struct mchunk));
+      chunk->mem = mem;
+      chunk->base = (char *) (((uintptr_t) mem + MEMORY_SLAB_SIZE - 1)
+			      & ~((uintptr_t) MEMORY_SLAB_SIZE - 1));
+      mp->current = chunk;
+      mp->chunks++;
+    }
+
+  slab = (struct mslab *) (chunk->base + chunk->carved++ * MEMORY_SLAB_SIZE);
+  slab->chunk = chunk;
+  slab->free = NULL;
+  slab->unused = (char *) slab + MSLAB_HEADER;
+  slab->inuse = 0;
+  chunk->used++;
+  mp->slabs++;
+
+  return slab;
+}
+
+/* Take back a slab that just became empty. */
+static void
+mslab_put (struct mpool *mp, struct mslab *slab)
+{
+  struct mchunk *chunk = slab->chunk;
+  unsigned int i;
+
+  if (--chunk->used > 0 || mp->chunks == 1)
+    {
+      mslab_link (&mp->empty, slab);
+      return;
+    }
+
+  /* All the other slabs of the chunk are on the empty list. */
+  for (i = 0; i < chunk->carved; i++)
+    if (chunk->base + i * MEMORY_SLAB_SIZE != (char *) slab)
+      mslab_unlink (&mp->empty,
+		    (struct mslab *) (chunk->base + i * MEMORY_SLAB_SIZE));
+
+  if (mp->current == chunk)
+    mp->current = NULL;
+  mp->slabs -= chunk->carved;
+  mp->chunks--;
+  free (chunk->mem);
+  XFREE (MTYPE_MEMORY_CHUNK, chunk);
+}
+
+static void *
+mpool_alloc (struct mpool *mp)
+{
+  struct mslab *slab;
+  void *obj;
+
+  pthread_mutex_lock (&mp->mtx);
+
+  if ((slab = mp->partial) == NULL)
+    {
+      if ((slab = mslab_get (mp)) == NULL)
+	{
+	  pthread_mutex_unlock (&mp->mtx);
+	  return NULL;
+	}
+      mslab_link (&mp->partial, slab);
+    }
+
+  if (slab->free)
+    {
+      obj = slab->free;
+      slab->free = *(void **) obj;
+    }
+  else
+    {
+      obj = slab->unused;
+      slab->unused += mp->size;
+    }
+
+  if (++slab->inuse == mp->per_slab)
+    mslab_unlink (&mp->partial, slab);
+  mp->inuse++;
+
+  pthread_mutex_unlock (&mp->mtx);
+
+  return obj;
+}
+
+static void
+mpool_free (struct mpool *mp, void *obj)
+{
+  struct mslab *slab;
+
+  slab = (struct mslab *) ((uintptr_t) obj
+			   & ~((uintptr_t) MEMORY_SLAB_SIZE - 1));
+
+  pthread_mutex_lock (&mp->mtx);
+
+  *(void **) obj = slab->free;
+  slab->free = obj;
+  mp->inuse--;
+
+  /* A full slab is back on the partial list, an empty one leaves it. */
+  if (slab->inuse-- == mp->per_slab)
+    mslab_link (&mp->partial, slab);
+  if (slab->inuse == 0)
+    {
+      mslab_unlink (&mp->partial, slab);
+      mslab_put (mp, slab);
+    }
+
+  pthread_mutex_unlock (&mp->mtx);
+}
+
+/* Bytes taken by an allocation of the given type, 0 if the system
+   allocator can't tell. */
+static size_t
+mem_size (int type, void *ptr)
+{
+  if (mpools[type])
+    return mpools[type]->size;
+#ifdef HAVE_MALLOC_USABLE_SIZE
+  return malloc_usable_size (ptr);
+#else
+  return 0;
+#endif /* HAVE_MALLOC_USABLE_SIZE */
+}
+
+/*
+ * Allocate objects of the given type from a slab pool from now on.
+ * All of them must be allocated with size at most the given one, by
+ * zmalloc or zcalloc, and they can't be reallocated.  Returns 0 on
+ * success, or -1 if the type has objects allocated already or they
+ * are too big to be worth pooling.
+ */
+int
+memory_pool_init (int type, size_t size)
+{
+  struct mpool *mp;
+
+  if (mpools[type])
+    return (size <= mpools[type]->size) ? 0 : -1;
+
+  size = (size + MEMORY_POOL_ALIGN - 1) & ~(MEMORY_POOL_ALIGN - 1);
+  if (size < sizeof (void *))
+    size = sizeof (void *);
+
+  if (mtype_stats_alloc (type) != 0
+      || size > (MEMORY_SLAB_SIZE - MSLAB_HEADER) / 16)
+    {
+      zlog_warn ("%s: can't pool `%s' objects of size %lu", __func__,
+		 mtype_name (type), (unsigned long) size);
+      return -1;
+    }
+
+  mp = XCALLOC (MTYPE_MEMORY_POOL, sizeof (struct mpool));
+  pthread_mutex_init (&mp->mtx, NULL);
+  mp->size = size;
+  mp->per_slab = (MEMORY_SLAB_SIZE - MSLAB_HEADER) / size;
+  mpools[type] = mp;
+
+  return 0;
+}
+
 /*
  * Allocate memory of a given size, to be tracked by a given type.
  * Effects: Returns a pointer to usable memory.  If memory cannot
@@ -68,12 +354,18 @@ zmalloc (int type, size_t size)
 {
   void *memory;
 
-  memory = malloc (size);
+  if (mpools[type])
+    {
+      assert (size <= mpools[type]->size);
+      memory = mpool_alloc (mpools[type]);
+    }
+  else
+    memory = malloc (size);
 
   if (memory == NULL)
     zerror ("malloc", type, size);
 
-  alloc_inc (type);
+  alloc_inc (type, mem_size (type, memory));
 
   return memory;
 }
@@ -86,12 +378,19 @@ zcalloc (int type, size_t size)
 {
   void *memory;
 
-  memory = calloc (1, size);
+  if (mpools[type])
+    {
+      assert (size <= mpools[type]->size);
+      if ((memory = mpool_alloc (mpools[type])) != NULL)
+	memset (memory, 0, size);
+    }
+  else
+    memory = calloc (1, size);
 
   if (memory == NULL)
     zerror ("calloc", type, size);
 
-  alloc_inc (type);
+  alloc_inc (type, mem_size (type, memory));
 
   return memory;
 }
@@ -107,12 +406,18 @@ void *
 zrealloc (int type, void *ptr, size_t size)
 {
   void *memory;
+  size_t old;
+
+  assert (mpools[type] == NULL);
 
+  old = ptr ? mem_size (type, ptr) : 0;
   memory = realloc (ptr, size);
   if (memory == NULL)
     zerror ("realloc", type, size);
   if (ptr == NULL)
-    alloc_inc (type);
+    alloc_inc (type, mem_size (type, memory));
+  else
+    alloc_resize (type, old, mem_size (type, memory));
 
   return memory;
 }
@@ -128,8 +433,11 @@ zfree (int type, void *ptr)
 {
   if (ptr != NULL)
     {
-      alloc_dec (type);
-      free (ptr);
+      alloc_dec (type, mem_size (type, ptr));
+      if (mpools[type])
+	mpool_free (mpools[type], ptr);
+      else
+	free (ptr);
     }
 }
 
@@ -144,10 +452,12 @@ zstrdup (int type, const char *str)
 {
   void *dup;
 
+  assert (mpools[type] == NULL);
+
   dup = strdup (str);
   if (dup == NULL)
     zerror ("strdup", type, strlen (str));
-  alloc_inc (type);
+  alloc_inc (type, mem_size (type, dup));
   return dup;
 }
 
@@ -156,6 +466,10 @@ static struct
 {
   const char *name;
   long alloc;
+  long bytes;
+  long peak;
+  unsigned long allocs;
+  unsigned long frees;
   unsigned long t_malloc;
   unsigned long c_malloc;
   unsigned long t_calloc;
@@ -242,22 +556,63 @@ mtype_zstrdup (const char *file, int line, int type, const char *str)
 static struct 
 {
   char *name;
-  long alloc;
+  long alloc;			/* objects allocated */
+  long bytes;			/* bytes they take */
+  long peak;			/* highest bytes ever was */
+  unsigned long allocs;		/* allocations so far */
+  unsigned long frees;		/* frees so far */
 } mstat [MTYPE_MAX];
 #endif /* MEMORY_LOG */
 
+/* The counters are updated by whichever pthread allocates, with atomic
+   adds rather than under a lock.  They are read without one, so a
+   reader may see the fields of a type at slightly different times. */
+#define MSTAT_ADD(field, n)  __sync_add_and_fetch (&(field), (n))
+
+/* Counters as of "memory snapshot", or startup. */
+static struct
+{
+  long alloc;
+  long bytes;
+  unsigned long allocs;
+  unsigned long frees;
+} msnap [MTYPE_MAX];
+static struct timeval msnap_time;
+
+static void
+mstat_bytes (int type, long delta)
+{
+  long bytes, peak;
+
+  bytes = MSTAT_ADD (mstat[type].bytes, delta);
+  while (bytes > (peak = mstat[type].peak))
+    if (__sync_bool_compare_and_swap (&mstat[type].peak, peak, bytes))
+      break;
+}
+
 /* Increment allocation counter. */
 static void
-alloc_inc (int type)
+alloc_inc (int type, size_t size)
 {
-  mstat[type].alloc++;
+  MSTAT_ADD (mstat[type].alloc, 1);
+  MSTAT_ADD (mstat[type].allocs, 1);
+  mstat_bytes (type, size);
 }
 
 /* Decrement allocation counter. */
 static void
-alloc_dec (int type)
+alloc_dec (int type, size_t size)
 {
-  mstat[type].alloc--;
+  MSTAT_ADD (mstat[type].alloc, -1);
+  MSTAT_ADD (mstat[type].frees, 1);
+  MSTAT_ADD (mstat[type].bytes, -(long) size);
+}
+
+/* Account for an allocation changing size. */
+static void
+alloc_resize (int type, size_t old, size_t size)
+{
+  mstat_bytes (type, (long) size - (long) old);
 }
 
 /* Looking up memory status from vty interface. */
@@ -265,6 +620,20 @@ alloc_dec (int type)
 #include "vty.h"
 #include "command.h"
 
+/* Description of a type from the memory lists. */
+static const char *
+mtype_name (int type)
+{
+  struct mlist *ml;
+  struct memory_list *m;
+
+  for (ml = mlists; ml->list; ml++)
+    for (m = ml->list; m->index >= 0; m++)
+      if (m->index == type)
+	return m->format;
+  return "unknown";
+}
+
 static void
 log_memstats(int pri)
 {
@@ -332,6 +701,7 @@ static int
 show_memory_vty (struct vty *vty, struct memory_list *list)
 {
   struct memory_list *m;
+  char buf[MTYPE_MEMSTR_LEN], pbuf[MTYPE_MEMSTR_LEN];
   int needsep = 0;
 
   for (m = list; m->index >= 0; m++)
@@ -345,12 +715,160 @@ show_memory_vty (struct vty *vty, struct memory_list *list)
       }
     else if (mstat[m->index].alloc)
       {
-	vty_out (vty, "%-30s: %10ld\r\n", m->format, mstat[m->index].alloc);
+	if (mstat[m->index].peak)
+	  vty_out (vty, "%-30s: %10ld %10s (peak %s)\r\n", m->format,
+		   mstat[m->index].alloc,
+		   mtype_memstr (buf, MTYPE_MEMSTR_LEN, mstat[m->index].bytes),
+		   mtype_memstr (pbuf, MTYPE_MEMSTR_LEN, mstat[m->index].peak));
+	else
+	  vty_out (vty, "%-30s: %10ld\r\n", m->format, mstat[m->index].alloc);
 	needsep = 1;
       }
   return needsep;
 }
 
+/* Counters of all types ever allocated, one per line and tab
+   separated, for scripts to parse and diff.  Times are in
+   milliseconds since some unspecified point in the past. */
+static void
+show_memory_dump_vty (struct vty *vty)
+{
+  struct mlist *ml;
+  struct memory_list *m;
+  struct timeval now;
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &now);
+  vty_out (vty, "# time %lu snapshot %lu%s",
+	   now.tv_sec * 1000UL + now.tv_usec / 1000,
+	   msnap_time.tv_sec * 1000UL + msnap_time.tv_usec / 1000,
+	   VTY_NEWLINE);
+  vty_out (vty, "# module\ttype\tcount\tbytes\tpeak\tallocs\tfrees\tname%s",
+	   VTY_NEWLINE);
+  for (ml = mlists; ml->list; ml++)
+    for (m = ml->list; m->index >= 0; m++)
+      if (m->index && mstat[m->index].allocs)
+	vty_out (vty, "%s\t%d\t%ld\t%ld\t%ld\t%lu\t%lu\t%s%s",
+		 ml->name, m->index, mstat[m->index].alloc,
+		 mstat[m->index].bytes, mstat[m->index].peak,
+		 mstat[m->index].allocs, mstat[m->index].frees, m->format,
+		 VTY_NEWLINE);
+}
+
+/* Types that changed since the snapshot, with their allocation and
+   free rates over that time. */
+static void
+show_memory_diff_vty (struct vty *vty)
+{
+  struct mlist *ml;
+  struct memory_list *m;
+  struct timeval now;
+  char buf[MTYPE_MEMSTR_LEN], sbuf[MTYPE_MEMSTR_LEN + 1];
+  double secs;
+  long bytes;
+  unsigned long allocs, frees;
+  int header;
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &now);
+  secs = (now.tv_sec - msnap_time.tv_sec)
+	 + (now.tv_usec - msnap_time.tv_usec) / 1000000.0;
+  if (secs <= 0)
+    secs = 1;
+
+  vty_out (vty, "Changes over the last %.1f seconds:%s", secs, VTY_NEWLINE);
+  for (ml = mlists; ml->list; ml++)
+    {
+      header = 0;
+      for (m = ml->list; m->index >= 0; m++)
+	{
+	  if (m->index == 0)
+	    continue;
+	  allocs = mstat[m->index].allocs - msnap[m->index].allocs;
+	  frees = mstat[m->index].frees - msnap[m->index].frees;
+	  if (allocs == 0 && frees == 0)
+	    continue;
+
+	  if (!header)
+	    {
+	      vty_out (vty, "%s%-30s %10s %11s %10s %10s%s", VTY_NEWLINE,
+		       ml->name, "Count", "Bytes", "Allocs/s", "Frees/s",
+		       VTY_NEWLINE);
+	      header = 1;
+	    }
+	  bytes = mstat[m->index].bytes - msnap[m->index].bytes;
+	  snprintf (sbuf, sizeof (sbuf), "%c%s", bytes < 0 ? '-' : '+',
+		    mtype_memstr (buf, MTYPE_MEMSTR_LEN,
+				  bytes < 0 ? -bytes : bytes));
+	  vty_out (vty, "  %-28s %+10ld %11s %10.1f %10.1f%s", m->format,
+		   mstat[m->index].alloc - msnap[m->index].alloc, sbuf,
+		   allocs / secs, frees / secs, VTY_NEWLINE);
+	}
+    }
+}
+
+/* Remember the counters as they are now, for show_memory_diff_vty. */
+static void
+memory_snapshot_take (void)
+{
+  int type;
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &msnap_time);
+  for (type = 0; type < MTYPE_MAX; type++)
+    {
+      msnap[type].alloc = mstat[type].alloc;
+      msnap[type].bytes = mstat[type].bytes;
+      msnap[type].allocs = mstat[type].allocs;
+      msnap[type].frees = mstat[type].frees;
+    }
+}
+
+/* Utilisation of the slab pools.  Used is the share of the slabs'
+   object slots that is allocated, Frag the share that is free but
+   held by slabs still in use.  Memory counts the slabs cut so far. */
+static int
+show_memory_pool_vty (struct vty *vty)
+{
+  struct mpool *mp;
+  struct mslab *slab;
+  char buf[MTYPE_MEMSTR_LEN];
+  unsigned long slots, partial, empty;
+  int type, header = 0;
+
+  for (type = 0; type < MTYPE_MAX; type++)
+    {
+      if ((mp = mpools[type]) == NULL)
+	continue;
+
+      if (!header)
+	{
+	  vty_out (vty, "Memory pools:%s", VTY_NEWLINE);
+	  vty_out (vty, "  %-24s %5s %10s %7s %7s %7s %10s %5s %5s%s",
+		   "Type", "Size", "In use", "Slabs", "Partial", "Empty",
+		   "Memory", "Used", "Frag", VTY_NEWLINE);
+	  header = 1;
+	}
+
+      pthread_mutex_lock (&mp->mtx);
+      partial = empty = 0;
+      for (slab = mp->partial; slab; slab = slab->next)
+	partial++;
+      for (slab = mp->empty; slab; slab = slab->next)
+	empty++;
+      slots = mp->slabs * mp->per_slab;
+      vty_out (vty, "  %-24s %5lu %10lu %7lu %7lu %7lu %10s %4.0f%% %4.0f%%%s",
+	       mtype_name (type), (unsigned long) mp->size, mp->inuse,
+	       mp->slabs, partial, empty,
+	       mtype_memstr (buf, MTYPE_MEMSTR_LEN,
+			     mp->slabs * MEMORY_SLAB_SIZE),
+	       slots ? mp->inuse * 100.0 / slots : 0.0,
+	       slots ? ((mp->slabs - empty) * mp->per_slab - mp->inuse)
+		       * 100.0 / slots : 0.0,
+	       VTY_NEWLINE);
+      pthread_mutex_unlock (&mp->mtx);
+    }
+
+  return header;
+}
+
 #ifdef HAVE_MALLINFO
 static int
 show_memory_mallinfo (struct vty *vty)
@@ -405,6 +923,10 @@ DEFUN (show_memory_all,
 #ifdef HAVE_MALLINFO
   needsep = show_memory_mallinfo (vty);
 #endif /* HAVE_MALLINFO */
+
+  if (needsep)
+    show_separator (vty);
+  needsep = show_memory_pool_vty (vty);
   
   for (ml = mlists; ml->list; ml++)
     {
@@ -422,6 +944,50 @@ ALIAS (show_memory_all,
        "Show running system information\n"
        "Memory statistics\n")
 
+DEFUN (show_memory_dump,
+       show_memory_dump_cmd,
+       "show memory dump",
+       SHOW_STR
+       "Memory statistics\n"
+       "All counters in machine readable form\n")
+{
+  show_memory_dump_vty (vty);
+  return CMD_SUCCESS;
+}
+
+DEFUN (show_memory_diff,
+       show_memory_diff_cmd,
+       "show memory diff",
+       SHOW_STR
+       "Memory statistics\n"
+       "Changes and allocation rates since the last snapshot\n")
+{
+  show_memory_diff_vty (vty);
+  return CMD_SUCCESS;
+}
+
+DEFUN (memory_snapshot,
+       memory_snapshot_cmd,
+       "memory snapshot",
+       "Memory statistics\n"
+       "Take a snapshot of the counters for \"show memory diff\"\n")
+{
+  memory_snapshot_take ();
+  return CMD_SUCCESS;
+}
+
+DEFUN (show_memory_pools,
+       show_memory_pools_cmd,
+       "show memory pools",
+       SHOW_STR
+       "Memory statistics\n"
+       "Slab pool utilisation\n")
+{
+  if (!show_memory_pool_vty (vty))
+    vty_out (vty, "No memory pools%s", VTY_NEWLINE);
+  return CMD_SUCCESS;
+}
+
 DEFUN (show_memory_lib,
        show_memory_lib_cmd,
        "show memory lib",
@@ -524,8 +1090,11 @@ DEFUN (show_memory_isis,
 void
 memory_init (void)
 {
+  memory_snapshot_take ();
+
   install_element (RESTRICTED_NODE, &show_memory_cmd);
   install_element (RESTRICTED_NODE, &show_memory_all_cmd);
+  install_element (RESTRICTED_NODE, &show_memory_pools_cmd);
   install_element (RESTRICTED_NODE, &show_memory_lib_cmd);
   install_element (RESTRICTED_NODE, &show_memory_rip_cmd);
   install_element (RESTRICTED_NODE, &show_memory_ripng_cmd);
@@ -537,6 +1106,9 @@ memory_init (void)
 
   install_element (VIEW_NODE, &show_memory_cmd);
   install_element (VIEW_NODE, &show_memory_all_cmd);
+  install_element (VIEW_NODE, &show_memory_pools_cmd);
+  install_element (VIEW_NODE, &show_memory_dump_cmd);
+  install_element (VIEW_NODE, &show_memory_diff_cmd);
   install_element (VIEW_NODE, &show_memory_lib_cmd);
   install_element (VIEW_NODE, &show_memory_rip_cmd);
   install_element (VIEW_NODE, &show_memory_ripng_cmd);
@@ -548,6 +1120,10 @@ memory_init (void)
 
   install_element (ENABLE_NODE, &show_memory_cmd);
   install_element (ENABLE_NODE, &show_memory_all_cmd);
+  install_element (ENABLE_NODE, &show_memory_pools_cmd);
+  install_element (ENABLE_NODE, &show_memory_dump_cmd);
+  install_element (ENABLE_NODE, &show_memory_diff_cmd);
+  install_element (ENABLE_NODE, &memory_snapshot_cmd);
   install_element (ENABLE_NODE, &show_memory_lib_cmd);
   install_element (ENABLE_NODE, &show_memory_zebra_cmd);
   install_element (ENABLE_NODE, &show_memory_rip_cmd);
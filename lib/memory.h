@@ -83,6 +83,7 @@ extern void mtype_zfree (const char *file, int line, int type,
 extern char *mtype_zstrdup (const char *file, int line, int type,
 		            const char *str);
 extern void memory_init (void);
+extern int memory_pool_init (int type, size_t size);
 extern void log_memstats_stderr (const char *);
 
 /* return number of allocations outstanding for the type */
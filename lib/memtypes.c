@@ -13,6 +13,8 @@
 struct memory_list memory_list_lib[] =
 {
   { MTYPE_TMP,			"Temporary memory"		},
+  { MTYPE_MEMORY_POOL,		"Memory pool"			},
+  { MTYPE_MEMORY_CHUNK,		"Memory pool chunk"		},
   { MTYPE_STRVEC,		"String vector"			},
   { MTYPE_VECTOR,		"Vector"			},
   { MTYPE_VECTOR_INDEX,		"Vector index"			},
@@ -21,6 +23,8 @@ struct memory_list memory_list_lib[] =
   { MTYPE_THREAD,		"Thread"			},
   { MTYPE_THREAD_MASTER,	"Thread master"			},
   { MTYPE_THREAD_STATS,		"Thread stats"			},
+  { MTYPE_THREAD_IO,		"Thread I/O index"		},
+  { MTYPE_THREAD_MSG,		"Thread message"		},
   { MTYPE_VTY,			"VTY"				},
   { MTYPE_VTY_OUT_BUF,		"VTY output buffer"		},
   { MTYPE_VTY_HIST,		"VTY history"			},
@@ -31,15 +35,21 @@ struct memory_list memory_list_lib[] =
   { MTYPE_BUFFER_DATA,		"Buffer data"			},
   { MTYPE_STREAM,		"Stream"			},
   { MTYPE_STREAM_DATA,		"Stream data"			},
+  { MTYPE_STREAM_BUF,		"Stream shared data"		},
   { MTYPE_STREAM_FIFO,		"Stream FIFO"			},
+  { MTYPE_RINGBUF,		"Ring buffer"			},
+  { MTYPE_RINGBUF_DATA,		"Ring buffer data"		},
   { MTYPE_PREFIX,		"Prefix"			},
   { MTYPE_PREFIX_IPV4,		"Prefix IPv4"			},
   { MTYPE_PREFIX_IPV6,		"Prefix IPv6"			},
   { MTYPE_HASH,			"Hash"				},
   { MTYPE_HASH_BACKET,		"Hash Bucket"			},
   { MTYPE_HASH_INDEX,		"Hash Index"			},
+  { MTYPE_OHASH,		"Open hash"			},
+  { MTYPE_OHASH_SLOTS,		"Open hash slots"		},
   { MTYPE_ROUTE_TABLE,		"Route table"			},
   { MTYPE_ROUTE_NODE,		"Route node"			},
+  { MTYPE_ROUTE_JUMP,		"Route table jump index"	},
   { MTYPE_DISTRIBUTE,		"Distribute list"		},
   { MTYPE_DISTRIBUTE_IFNAME,	"Dist-list ifname"		},
   { MTYPE_ACCESS_LIST,		"Access List"			},
@@ -54,7 +64,9 @@ struct memory_list memory_list_lib[] =
   { MTYPE_ROUTE_MAP_RULE,	"Route map rule"		},
   { MTYPE_ROUTE_MAP_RULE_STR,	"Route map rule str"		},
   { MTYPE_ROUTE_MAP_COMPILED,	"Route map compiled"		},
+  { MTYPE_ROUTE_MAP_CACHE,	"Route map cache"		},
   { MTYPE_DESC,			"Command desc"			},
+  { MTYPE_CMD_TOKEN,		"Command token"			},
   { MTYPE_KEY,			"Key"				},
   { MTYPE_KEYCHAIN,		"Key chain"			},
   { MTYPE_IF_RMAP,		"Interface route map"		},
@@ -62,6 +74,7 @@ struct memory_list memory_list_lib[] =
   { MTYPE_SOCKUNION,		"Socket union"			},
   { MTYPE_PRIVS,		"Privilege information"		},
   { MTYPE_ZLOG,			"Logging"			},
+  { MTYPE_ZLOG_ASYNC,		"Logging ring buffer"		},
   { MTYPE_ZCLIENT,		"Zclient"			},
   { MTYPE_WORK_QUEUE,		"Work queue"			},
   { MTYPE_WORK_QUEUE_ITEM,	"Work queue item"		},
@@ -82,6 +95,9 @@ struct memory_list memory_list_zebra[] =
   { MTYPE_RIB_QUEUE,		"RIB process work queue"	},
   { MTYPE_STATIC_IPV4,		"Static IPv4 route"		},
   { MTYPE_STATIC_IPV6,		"Static IPv6 route"		},
+  { MTYPE_RIB_SHOW,		"RIB show cursor"		},
+  { MTYPE_RNH,			"Tracked nexthop"		},
+  { MTYPE_RNH_STATE,		"Tracked nexthop state"		},
   { -1, NULL },
 };
 
@@ -113,6 +129,8 @@ struct memory_list memory_list_bgp[] =
   { MTYPE_BGP_ADJ_IN,		"BGP adj in"			},
   { MTYPE_BGP_ADJ_OUT,		"BGP adj out"			},
   { MTYPE_BGP_MPATH_INFO,	"BGP multipath info"		},
+  { MTYPE_BGP_UPDATE_GROUP,	"BGP update group"		},
+  { MTYPE_BGP_UPDATE_PACKET,	"BGP update group packet"	},
   { 0, NULL },
   { MTYPE_AS_LIST,		"BGP AS list"			},
   { MTYPE_AS_FILTER,		"BGP AS filter"			},
@@ -150,6 +168,10 @@ struct memory_list memory_list_bgp[] =
   { MTYPE_BGP_REGEXP,		"BGP regexp"			},
   { MTYPE_BGP_AGGREGATE,	"BGP aggregate"			},
   { MTYPE_BGP_ADDR,		"BGP own address"		},
+  { MTYPE_BGP_SHOW,		"BGP show cursor"		},
+  { MTYPE_BGP_IO,		"BGP I/O"			},
+  { MTYPE_BGP_IO_MSG,		"BGP I/O message"		},
+  { MTYPE_BGP_SELECT,		"BGP selection pthreads"	},
   { -1, NULL }
 };
 
@@ -209,6 +231,7 @@ struct memory_list memory_list_ospf[] =
   { MTYPE_OSPF_IF_INFO,       "OSPF if info"			},
   { MTYPE_OSPF_IF_PARAMS,     "OSPF if params"			},
   { MTYPE_OSPF_MESSAGE,		"OSPF message"			},
+  { MTYPE_OSPF_SHOW,		"OSPF show cursor"		},
   { -1, NULL },
 };
 
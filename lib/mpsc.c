@@ -0,0 +1,82 @@
+/* Lock-free multi-producer, single-consumer queue.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/* Intrusive linked list queue after Dmitry Vyukov.  Producers append
+ * with a single atomic exchange of the head pointer, then link the
+ * previous head to the new node.  The consumer walks from the tail, and
+ * a stub node keeps the list from ever becoming empty so that the
+ * consumer never has to touch the head pointer of a busy queue.
+ */
+
+#include <zebra.h>
+
+#include "mpsc.h"
+
+void
+mpsc_init (struct mpsc_queue *q)
+{
+  q->stub.next = NULL;
+  q->head = &q->stub;
+  q->tail = &q->stub;
+}
+
+void
+mpsc_push (struct mpsc_queue *q, struct mpsc_node *node)
+{
+  struct mpsc_node *prev;
+
+  node->next = NULL;
+  prev = __atomic_exchange_n (&q->head, node, __ATOMIC_ACQ_REL);
+  __atomic_store_n (&prev->next, node, __ATOMIC_RELEASE);
+}
+
+/* Returns the oldest node, or NULL if the queue is empty. */
+struct mpsc_node *
+mpsc_pop (struct mpsc_queue *q)
+{
+  struct mpsc_node *tail = q->tail;
+  struct mpsc_node *next = __atomic_load_n (&tail->next, __ATOMIC_ACQUIRE);
+
+  if (tail == &q->stub)
+    {
+      if (next == NULL)
+        return NULL;
+      q->tail = tail = next;
+      next = __atomic_load_n (&tail->next, __ATOMIC_ACQUIRE);
+    }
+
+  if (next)
+    {
+      q->tail = next;
+      return tail;
+    }
+
+  /* tail is the last node.  Queue the stub behind it so it can be
+   * handed out, unless a producer already swapped in a newer head. */
+  if (tail == __atomic_load_n (&q->head, __ATOMIC_ACQUIRE))
+    mpsc_push (q, &q->stub);
+
+  /* Some producer is now between swapping the head and linking its
+   * node to tail, which takes it no more than a few instructions. */
+  while ((next = __atomic_load_n (&tail->next, __ATOMIC_ACQUIRE)) == NULL)
+    ;
+  q->tail = next;
+  return tail;
+}
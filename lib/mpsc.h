@@ -0,0 +1,42 @@
+/* Lock-free multi-producer, single-consumer queue.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _ZEBRA_MPSC_H
+#define _ZEBRA_MPSC_H
+
+/* Embed as the first member of whatever is to be queued. */
+struct mpsc_node
+{
+  struct mpsc_node *next;
+};
+
+/* Any number of pthreads may push, but only one may pop. */
+struct mpsc_queue
+{
+  struct mpsc_node *head;	/* last pushed, swapped in by producers */
+  struct mpsc_node *tail;	/* next to pop, owned by the consumer */
+  struct mpsc_node stub;
+};
+
+extern void mpsc_init (struct mpsc_queue *);
+extern void mpsc_push (struct mpsc_queue *, struct mpsc_node *);
+extern struct mpsc_node *mpsc_pop (struct mpsc_queue *);
+
+#endif /* _ZEBRA_MPSC_H */
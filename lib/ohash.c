@@ -0,0 +1,355 @@
+/* Open addressing hash table.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "ohash.h"
+#include "memory.h"
+#include "linklist.h"
+#include "vty.h"
+
+/* Marks a slot released during iteration, see struct ohash. */
+static char ohash_deleted_marker;
+#define OHASH_DELETED ((void *) &ohash_deleted_marker)
+
+/* Tables registered with ohash_set_name(), for "show hash statistics". */
+static struct list *ohash_tables;
+
+/* Home slot of a key.  Multiplicative hashing takes the high bits, so
+   keys that only differ in their low bits still spread out.  */
+static inline unsigned int
+ohash_home (struct ohash *hash, unsigned int key)
+{
+  return (key * 2654435769U) >> hash->shift;
+}
+
+/* How far the entry in slot i is from its home slot.  */
+static inline unsigned int
+ohash_dist (struct ohash *hash, unsigned int i, unsigned int key)
+{
+  return (i - ohash_home (hash, key)) & (hash->size - 1);
+}
+
+static unsigned int
+ohash_round_size (unsigned int size)
+{
+  unsigned int n = OHASH_MIN_SIZE;
+
+  while (n < size && n < (1U << 31))
+    n <<= 1;
+  return n;
+}
+
+static void
+ohash_alloc_slots (struct ohash *hash, unsigned int size)
+{
+  unsigned int bits = 0;
+
+  while ((1U << bits) < size)
+    bits++;
+
+  hash->slots = XCALLOC (MTYPE_OHASH_SLOTS, sizeof (struct ohash_slot) * size);
+  hash->size = size;
+  hash->shift = 32 - bits;
+}
+
+/* Allocate a new hash.  The size is rounded up to a power of two.  */
+struct ohash *
+ohash_create_size (unsigned int size, unsigned int (*hash_key) (void *),
+		   int (*hash_cmp) (const void *, const void *))
+{
+  struct ohash *hash;
+
+  hash = XCALLOC (MTYPE_OHASH, sizeof (struct ohash));
+  size = ohash_round_size (size);
+  ohash_alloc_slots (hash, size);
+  hash->min_size = size;
+  hash->hash_key = hash_key;
+  hash->hash_cmp = hash_cmp;
+
+  return hash;
+}
+
+/* Allocate a new hash with default size.  */
+struct ohash *
+ohash_create (unsigned int (*hash_key) (void *),
+	      int (*hash_cmp) (const void *, const void *))
+{
+  return ohash_create_size (OHASH_DEFAULT_SIZE, hash_key, hash_cmp);
+}
+
+/* Put an entry known not to be in the table yet into its slot, moving
+   entries closer to their home along as Robin Hood probing wants.  */
+static void
+ohash_insert (struct ohash *hash, unsigned int key, void *data)
+{
+  struct ohash_slot *slot;
+  unsigned int mask = hash->size - 1;
+  unsigned int i, dist, sdist, tkey;
+  void *tdata;
+
+  i = ohash_home (hash, key);
+  for (dist = 0; ; dist++, i = (i + 1) & mask)
+    {
+      slot = &hash->slots[i];
+      if (slot->data == NULL)
+	{
+	  slot->key = key;
+	  slot->data = data;
+	  return;
+	}
+
+      sdist = ohash_dist (hash, i, slot->key);
+      if (sdist < dist)
+	{
+	  tkey = slot->key;
+	  tdata = slot->data;
+	  slot->key = key;
+	  slot->data = data;
+	  key = tkey;
+	  data = tdata;
+	  dist = sdist;
+	}
+    }
+}
+
+/* Move every live entry to a new slot array of the given size,
+   dropping deleted markers on the way.  */
+static void
+ohash_rebuild (struct ohash *hash, unsigned int size)
+{
+  struct ohash_slot *old = hash->slots;
+  unsigned int old_size = hash->size;
+  unsigned int i;
+
+  ohash_alloc_slots (hash, size);
+  for (i = 0; i < old_size; i++)
+    if (old[i].data && old[i].data != OHASH_DELETED)
+      ohash_insert (hash, old[i].key, old[i].data);
+  hash->deleted = 0;
+
+  XFREE (MTYPE_OHASH_SLOTS, old);
+}
+
+/* Find the slot holding data, or -1.  */
+static long
+ohash_find (struct ohash *hash, unsigned int key, void *data)
+{
+  struct ohash_slot *slot;
+  unsigned int mask = hash->size - 1;
+  unsigned int i, dist;
+
+  i = ohash_home (hash, key);
+  for (dist = 0; ; dist++, i = (i + 1) & mask)
+    {
+      slot = &hash->slots[i];
+      if (slot->data == NULL || ohash_dist (hash, i, slot->key) < dist)
+	return -1;
+      if (slot->key == key && slot->data != OHASH_DELETED
+	  && (*hash->hash_cmp) (slot->data, data))
+	return i;
+    }
+}
+
+/* Lookup and return the entry equal to data.  If there is none and
+   alloc_func is specified, add what it returns.  */
+void *
+ohash_get (struct ohash *hash, void *data, void * (*alloc_func) (void *))
+{
+  unsigned int key;
+  void *newdata;
+  long i;
+
+  key = (*hash->hash_key) (data);
+  if ((i = ohash_find (hash, key, data)) >= 0)
+    return hash->slots[i].data;
+
+  if (alloc_func)
+    {
+      newdata = (*alloc_func) (data);
+      if (newdata == NULL)
+	return NULL;
+
+      /* Keep the load under 7/8, probe sequences grow fast beyond.  */
+      if ((hash->count + hash->deleted + 1) * 8 > (unsigned long) hash->size * 7
+	  && hash->size < (1U << 31))
+	{
+	  ohash_rebuild (hash, hash->size * 2);
+	  hash->resizes++;
+	}
+
+      ohash_insert (hash, key, newdata);
+      hash->count++;
+      return newdata;
+    }
+  return NULL;
+}
+
+/* Hash lookup.  */
+void *
+ohash_lookup (struct ohash *hash, void *data)
+{
+  return ohash_get (hash, data, NULL);
+}
+
+/* Remove the entry equal to data and return it, or NULL if there is
+   none.  Later entries of the probe sequence are shifted back, so no
+   marker is left behind except while iterating.  */
+void *
+ohash_release (struct ohash *hash, void *data)
+{
+  struct ohash_slot *slots = hash->slots;
+  unsigned int mask = hash->size - 1;
+  unsigned int i, j;
+  void *ret;
+  long found;
+
+  found = ohash_find (hash, (*hash->hash_key) (data), data);
+  if (found < 0)
+    return NULL;
+
+  i = found;
+  ret = slots[i].data;
+  hash->count--;
+
+  if (hash->iterating)
+    {
+      slots[i].data = OHASH_DELETED;
+      hash->deleted++;
+      return ret;
+    }
+
+  for (j = (i + 1) & mask;
+       slots[j].data && ohash_dist (hash, j, slots[j].key) > 0;
+       i = j, j = (j + 1) & mask)
+    slots[i] = slots[j];
+  slots[i].data = NULL;
+
+  if (hash->size > hash->min_size && hash->count < hash->size / 8)
+    {
+      ohash_rebuild (hash, hash->size / 2);
+      hash->resizes++;
+    }
+
+  return ret;
+}
+
+/* Iterator function for hash.  The callback gets a hash_backet of its
+   own for each entry and may release that entry.  */
+void
+ohash_iterate (struct ohash *hash,
+	       void (*func) (struct hash_backet *, void *), void *arg)
+{
+  struct hash_backet hb;
+  unsigned int i;
+
+  hash->iterating++;
+  for (i = 0; i < hash->size; i++)
+    {
+      if (hash->slots[i].data == NULL
+	  || hash->slots[i].data == OHASH_DELETED)
+	continue;
+
+      hb.next = NULL;
+      hb.key = hash->slots[i].key;
+      hb.data = hash->slots[i].data;
+      (*func) (&hb, arg);
+    }
+
+  if (--hash->iterating == 0 && hash->deleted)
+    ohash_rebuild (hash, hash->size);
+}
+
+/* Clean up hash.  The slot array goes back to its initial size.  */
+void
+ohash_clean (struct ohash *hash, void (*free_func) (void *))
+{
+  unsigned int i;
+
+  if (free_func)
+    for (i = 0; i < hash->size; i++)
+      if (hash->slots[i].data && hash->slots[i].data != OHASH_DELETED)
+	(*free_func) (hash->slots[i].data);
+
+  XFREE (MTYPE_OHASH_SLOTS, hash->slots);
+  ohash_alloc_slots (hash, hash->min_size);
+  hash->count = 0;
+  hash->deleted = 0;
+}
+
+/* Free hash memory.  You may call ohash_clean before call this
+   function.  */
+void
+ohash_free (struct ohash *hash)
+{
+  if (hash->name)
+    listnode_delete (ohash_tables, hash);
+  XFREE (MTYPE_OHASH_SLOTS, hash->slots);
+  XFREE (MTYPE_OHASH, hash);
+}
+
+/* Register hash under name for "show hash statistics".  */
+void
+ohash_set_name (struct ohash *hash, const char *name)
+{
+  if (ohash_tables == NULL)
+    ohash_tables = list_new ();
+  if (hash->name == NULL)
+    listnode_add (ohash_tables, hash);
+  hash->name = name;
+}
+
+/* Add the registered tables to "show hash statistics".  Chain is the
+   mean and Max the longest probe sequence of a successful lookup.  */
+void
+ohash_show_statistics (struct vty *vty)
+{
+  struct listnode *node;
+  struct ohash *hash;
+  unsigned long empty, probes, longest, dist;
+  unsigned int i;
+
+  if (ohash_tables == NULL)
+    return;
+
+  for (ALL_LIST_ELEMENTS_RO (ohash_tables, node, hash))
+    {
+      empty = probes = longest = 0;
+      for (i = 0; i < hash->size; i++)
+	{
+	  if (hash->slots[i].data == NULL)
+	    {
+	      empty++;
+	      continue;
+	    }
+	  dist = ohash_dist (hash, i, hash->slots[i].key) + 1;
+	  probes += dist;
+	  if (dist > longest)
+	    longest = dist;
+	}
+
+      vty_out (vty, "%-24s %9lu %9u %6.2f %5.1f%% %7.2f %5lu %7lu%s",
+	       hash->name, hash->count, hash->size,
+	       (double) hash->count / hash->size,
+	       empty * 100.0 / hash->size,
+	       hash->size > empty ? (double) probes / (hash->size - empty) : 0.0,
+	       longest, hash->resizes, VTY_NEWLINE);
+    }
+}
@@ -0,0 +1,104 @@
+/* Open addressing hash table.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _ZEBRA_OHASH_H
+#define _ZEBRA_OHASH_H
+
+#include "hash.h"
+#include "vty.h"
+
+/* A drop-in alternative to struct hash for tables holding many small
+   interned objects.  Entries live directly in one array of slots
+   (Robin Hood linear probing with the hash key stored next to the data
+   pointer), so there is no per-entry allocation and a lookup usually
+   touches a single cache line.  hash_alloc_intern and the hash_iterate
+   callbacks work unchanged.
+
+   Unlike struct hash, resizing rehashes the whole slot array at once
+   (from the stored keys, without calling hash_key), and entries must
+   not be added while the table is being iterated.  */
+
+/* Default and minimum number of slots, always a power of two.  */
+#define OHASH_DEFAULT_SIZE  1024
+#define OHASH_MIN_SIZE      16
+
+struct ohash_slot
+{
+  /* Hash key, kept so probing and resizing don't need hash_key. */
+  unsigned int key;
+
+  /* Data, NULL for an empty slot. */
+  void *data;
+};
+
+struct ohash
+{
+  /* Slot array. */
+  struct ohash_slot *slots;
+
+  /* Number of slots and 32 - log2 of it. */
+  unsigned int size;
+  unsigned int shift;
+
+  /* Key make function. */
+  unsigned int (*hash_key) (void *);
+
+  /* Data compare function. */
+  int (*hash_cmp) (const void *, const void *);
+
+  /* Number of entries. */
+  unsigned long count;
+
+  /* Size given at creation, the table never shrinks below it. */
+  unsigned int min_size;
+
+  /* Non-zero while ohash_iterate is walking the table.  Releases then
+     leave a deleted marker behind instead of moving entries, markers
+     are cleared when the outermost iteration finishes. */
+  unsigned int iterating;
+  unsigned long deleted;
+
+  /* Number of resizes so far. */
+  unsigned long resizes;
+
+  /* Name shown by "show hash statistics", NULL if not registered. */
+  const char *name;
+};
+
+extern struct ohash *ohash_create (unsigned int (*) (void *),
+				   int (*) (const void *, const void *));
+extern struct ohash *ohash_create_size (unsigned int,
+					unsigned int (*) (void *),
+					int (*) (const void *, const void *));
+
+extern void *ohash_get (struct ohash *, void *, void * (*) (void *));
+extern void *ohash_lookup (struct ohash *, void *);
+extern void *ohash_release (struct ohash *, void *);
+
+extern void ohash_iterate (struct ohash *,
+			   void (*) (struct hash_backet *, void *), void *);
+
+extern void ohash_clean (struct ohash *, void (*) (void *));
+extern void ohash_free (struct ohash *);
+
+extern void ohash_set_name (struct ohash *, const char *);
+extern void ohash_show_statistics (struct vty *);
+
+#endif /* _ZEBRA_OHASH_H */
@@ -29,6 +29,7 @@
 #include "buffer.h"
 #include "stream.h"
 #include "log.h"
+#include "table.h"
 
 /* Each prefix-list's entry. */
 struct prefix_list_entry
@@ -48,6 +49,11 @@ struct prefix_list_entry
 
   struct prefix_list_entry *next;
   struct prefix_list_entry *prev;
+
+  /* Node of the prefix-list's trie the entry is on, and the next entry
+     on that node in sequence order. */
+  struct route_node *rn;
+  struct prefix_list_entry *rn_next;
 };
 
 /* List of struct prefix_list. */
@@ -111,6 +117,12 @@ static struct prefix_master prefix_master_orf =
   NULL,
 };
 
+/* Depth of prefix_list_hooks_suspend() calls. */
+static int prefix_list_hooks_suspended = 0;
+
+#define PREFIX_LIST_HOOK_ADD		0x01
+#define PREFIX_LIST_HOOK_DELETE		0x02
+
 static struct prefix_master *
 prefix_master_get (afi_t afi)
 {
@@ -180,6 +192,119 @@ prefix_list_entry_free (struct prefix_list_entry *pentry)
   XFREE (MTYPE_PREFIX_LIST_ENTRY, pentry);
 }
 
+/* Each prefix-list keeps its entries, besides on the list in sequence
+   order, on a trie per address family keyed on the entry's prefix.
+   All entries that can match a prefix then sit on the nodes from its
+   longest match up to the top, so applying a list costs the depth of
+   the trie rather than its number of entries. */
+static struct route_table **
+prefix_list_trie (struct prefix_list *plist, u_char family)
+{
+  switch (family)
+    {
+    case AF_INET:
+      return &plist->trie[0];
+#ifdef HAVE_IPV6
+    case AF_INET6:
+      return &plist->trie[1];
+#endif /* HAVE_IPV6 */
+    default:
+      return NULL;
+    }
+}
+
+static void
+prefix_list_trie_add (struct prefix_list *plist,
+		      struct prefix_list_entry *pentry)
+{
+  struct route_table **trie;
+  struct route_node *rn;
+  struct prefix_list_entry *point;
+  struct prefix_list_entry *prev;
+  struct prefix p;
+
+  trie = prefix_list_trie (plist, pentry->prefix.family);
+  if (trie == NULL)
+    return;
+  if (*trie == NULL)
+    *trie = route_table_init ();
+
+  prefix_copy (&p, &pentry->prefix);
+  apply_mask (&p);
+
+  /* The entries on a node share one lock. */
+  rn = route_node_get (*trie, &p);
+  if (rn->info)
+    route_unlock_node (rn);
+
+  for (prev = NULL, point = rn->info; point; point = point->rn_next)
+    {
+      if (point->seq >= pentry->seq)
+	break;
+      prev = point;
+    }
+
+  pentry->rn = rn;
+  pentry->rn_next = point;
+  if (prev)
+    prev->rn_next = pentry;
+  else
+    rn->info = pentry;
+}
+
+static void
+prefix_list_trie_delete (struct prefix_list_entry *pentry)
+{
+  struct route_node *rn = pentry->rn;
+  struct prefix_list_entry *point;
+
+  if (rn == NULL)
+    return;
+
+  if (rn->info == pentry)
+    rn->info = pentry->rn_next;
+  else
+    {
+      for (point = rn->info; point->rn_next != pentry; point = point->rn_next)
+	;
+      point->rn_next = pentry->rn_next;
+    }
+
+  pentry->rn = NULL;
+  pentry->rn_next = NULL;
+
+  if (rn->info == NULL)
+    route_unlock_node (rn);
+}
+
+/* First entry of plist whose prefix is on the same trie node as
+   prefix, the others following by rn_next.  For a family without a
+   trie, the head of the list with *chained cleared. */
+static struct prefix_list_entry *
+prefix_list_trie_same (struct prefix_list *plist, struct prefix *prefix,
+		       int *chained)
+{
+  struct route_table **trie;
+  struct route_node *rn;
+  struct prefix p;
+
+  trie = prefix_list_trie (plist, prefix->family);
+  *chained = (trie != NULL);
+  if (trie == NULL)
+    return plist->head;
+  if (*trie == NULL)
+    return NULL;
+
+  prefix_copy (&p, prefix);
+  apply_mask (&p);
+
+  rn = route_node_lookup (*trie, &p);
+  if (rn == NULL)
+    return NULL;
+  route_unlock_node (rn);
+  return rn->info;
+}
+
 /* Insert new prefix list to list of prefix_list.  Each prefix_list
    is sorted by the name. */
 static struct prefix_list *
@@ -292,6 +417,7 @@ prefix_list_delete (struct prefix_list *plist)
   struct prefix_master *master;
   struct prefix_list_entry *pentry;
   struct prefix_list_entry *next;
+  unsigned int i;
 
   /* If prefix-list contain prefix_list_entry free all of it. */
   for (pentry = plist->head; pentry; pentry = next)
@@ -301,6 +427,10 @@ prefix_list_delete (struct prefix_list *plist)
       plist->count--;
     }
 
+  for (i = 0; i < PREFIX_LIST_TRIES; i++)
+    if (plist->trie[i])
+      route_table_finish (plist->trie[i]);
+
   master = plist->master;
 
   if (plist->type == PREFIX_TYPE_NUMBER)
@@ -354,6 +484,67 @@ prefix_list_entry_make (struct prefix *prefix, enum prefix_list_type type,
   return pentry;
 }
 
+/* Run the add or delete hook for plist, or hold it back until the hooks
+   are resumed. */
+static void
+prefix_list_hook (struct prefix_list *plist, u_char hook)
+{
+  struct prefix_master *master = plist->master;
+
+  if (prefix_list_hooks_suspended)
+    SET_FLAG (plist->hooks, hook);
+  else if (hook == PREFIX_LIST_HOOK_ADD && master->add_hook)
+    (*master->add_hook) (plist);
+  else if (hook == PREFIX_LIST_HOOK_DELETE && master->delete_hook)
+    (*master->delete_hook) (plist);
+}
+
+static void
+prefix_master_hooks_run (struct prefix_master *master)
+{
+  struct prefix_list_list *lists[] = { &master->num, &master->str };
+  struct prefix_list *plist, *next;
+  unsigned int i;
+  u_char hooks;
+
+  for (i = 0; i < sizeof (lists) / sizeof (lists[0]); i++)
+    for (plist = lists[i]->head; plist; plist = next)
+      {
+	next = plist->next;
+	hooks = plist->hooks;
+	plist->hooks = 0;
+
+	if (CHECK_FLAG (hooks, PREFIX_LIST_HOOK_DELETE))
+	  prefix_list_hook (plist, PREFIX_LIST_HOOK_DELETE);
+	if (CHECK_FLAG (hooks, PREFIX_LIST_HOOK_ADD))
+	  prefix_list_hook (plist, PREFIX_LIST_HOOK_ADD);
+      }
+}
+
+/* Hold back the hooks run on changes to entries, e.g. while a whole
+   configuration is read.  Lists deleted outright still run the delete
+   hook at once, nothing must be left pointing to them. */
+void
+prefix_list_hooks_suspend (void)
+{
+  prefix_list_hooks_suspended++;
+}
+
+/* Run the hooks held back since the outermost suspend, once for each
+   list that changed. */
+void
+prefix_list_hooks_resume (void)
+{
+  if (--prefix_list_hooks_suspended > 0)
+    return;
+
+  prefix_master_hooks_run (&prefix_master_ipv4);
+#ifdef HAVE_IPV6
+  prefix_master_hooks_run (&prefix_master_ipv6);
+#endif /* HAVE_IPV6 */
+  prefix_master_hooks_run (&prefix_master_orf);
+}
+
 /* Add hook function. */
 void
 prefix_list_add_hook (void (*func) (struct prefix_list *plist))
@@ -380,15 +571,12 @@ prefix_new_seq_get (struct prefix_list *plist)
 {
   int maxseq;
   int newseq;
-  struct prefix_list_entry *pentry;
 
   maxseq = newseq = 0;
 
-  for (pentry = plist->head; pentry; pentry = pentry->next)
-    {
-      if (maxseq < pentry->seq)
-	maxseq = pentry->seq;
-    }
+  /* The list is kept in sequence order. */
+  if (plist->tail && maxseq < plist->tail->seq)
+    maxseq = plist->tail->seq;
 
   newseq = ((maxseq / 5) * 5) + 5;
   
@@ -401,6 +589,9 @@ prefix_seq_check (struct prefix_list *plist, int seq)
 {
   struct prefix_list_entry *pentry;
 
+  if (plist->tail == NULL || plist->tail->seq < seq)
+    return NULL;
+
   for (pentry = plist->head; pentry; pentry = pentry->next)
     if (pentry->seq == seq)
       return pentry;
@@ -412,8 +603,10 @@ prefix_list_entry_lookup (struct prefix_list *plist, struct prefix *prefix,
 			  enum prefix_list_type type, int seq, int le, int ge)
 {
   struct prefix_list_entry *pentry;
+  int chained;
 
-  for (pentry = plist->head; pentry; pentry = pentry->next)
+  for (pentry = prefix_list_trie_same (plist, prefix, &chained); pentry;
+       pentry = chained ? pentry->rn_next : pentry->next)
     if (prefix_same (&pentry->prefix, prefix) && pentry->type == type)
       {
 	if (seq >= 0 && pentry->seq != seq)
@@ -446,14 +639,14 @@ prefix_list_entry_delete (struct prefix_list *plist,
   else
     plist->tail = pentry->prev;
 
+  prefix_list_trie_delete (pentry);
   prefix_list_entry_free (pentry);
 
   plist->count--;
 
   if (update_list)
     {
-      if (plist->master->delete_hook)
-	(*plist->master->delete_hook) (plist);
+      prefix_list_hook (plist, PREFIX_LIST_HOOK_DELETE);
 
       if (plist->head == NULL && plist->tail == NULL && plist->desc == NULL)
 	prefix_list_delete (plist);
@@ -478,10 +671,13 @@ prefix_list_entry_add (struct prefix_list *plist,
   if (replace)
     prefix_list_entry_delete (plist, replace, 0);
 
-  /* Check insert point. */
-  for (point = plist->head; point; point = point->next)
-    if (point->seq >= pentry->seq)
-      break;
+  /* Check insert point, most often the end. */
+  if (plist->tail && plist->tail->seq < pentry->seq)
+    point = NULL;
+  else
+    for (point = plist->head; point; point = point->next)
+      if (point->seq >= pentry->seq)
+	break;
 
   /* In case of this is the first element of the list. */
   pentry->next = point;
@@ -507,12 +703,13 @@ prefix_list_entry_add (struct prefix_list *plist,
       plist->tail = pentry;
     }
 
+  prefix_list_trie_add (plist, pentry);
+
   /* Increment count. */
   plist->count++;
 
   /* Run hook function. */
-  if (plist->master->add_hook)
-    (*plist->master->add_hook) (plist);
+  prefix_list_hook (plist, PREFIX_LIST_HOOK_ADD);
 
   plist->master->recent = plist;
 }
@@ -564,6 +761,10 @@ enum prefix_list_type
 prefix_list_apply (struct prefix_list *plist, void *object)
 {
   struct prefix_list_entry *pentry;
+  struct prefix_list_entry *match;
+  struct route_table **trie;
+  struct route_node *rn;
+  struct route_node *node;
   struct prefix *p;
 
   p = (struct prefix *) object;
@@ -574,17 +775,49 @@ prefix_list_apply (struct prefix_list *plist, void *object)
   if (plist->count == 0)
     return PREFIX_PERMIT;
 
-  for (pentry = plist->head; pentry; pentry = pentry->next)
+  trie = prefix_list_trie (plist, p->family);
+  if (trie == NULL)
     {
-      pentry->refcnt++;
-      if (prefix_list_entry_match (pentry, p))
+      for (pentry = plist->head; pentry; pentry = pentry->next)
 	{
-	  pentry->hitcnt++;
-	  return pentry->type;
+	  pentry->refcnt++;
+	  if (prefix_list_entry_match (pentry, p))
+	    {
+	      pentry->hitcnt++;
+	      return pentry->type;
+	    }
 	}
+      return PREFIX_DENY;
     }
 
-  return PREFIX_DENY;
+  if (*trie == NULL)
+    return PREFIX_DENY;
+
+  /* The first entry in sequence order matching on any node from the
+     longest match up.  Only entries before the best so far are worth
+     trying. */
+  match = NULL;
+  rn = route_node_match (*trie, p);
+  for (node = rn; node; node = node->parent)
+    for (pentry = node->info; pentry; pentry = pentry->rn_next)
+      {
+	if (match && pentry->seq > match->seq)
+	  break;
+	pentry->refcnt++;
+	if (prefix_list_entry_match (pentry, p))
+	  {
+	    match = pentry;
+	    break;
+	  }
+      }
+  if (rn)
+    route_unlock_node (rn);
+
+  if (match == NULL)
+    return PREFIX_DENY;
+
+  match->hitcnt++;
+  return match->type;
 }
 
 static void __attribute__ ((unused))
@@ -629,13 +862,15 @@ prefix_entry_dup_check (struct prefix_list *plist,
 {
   struct prefix_list_entry *pentry;
   int seq = 0;
+  int chained;
 
   if (new->seq == -1)
     seq = prefix_new_seq_get (plist);
   else
     seq = new->seq;
 
-  for (pentry = plist->head; pentry; pentry = pentry->next)
+  for (pentry = prefix_list_trie_same (plist, &new->prefix, &chained); pentry;
+       pentry = chained ? pentry->rn_next : pentry->next)
     {
       if (prefix_same (&pentry->prefix, &new->prefix)
 	  && pentry->type == new->type
@@ -25,6 +25,9 @@
 
 #define AFI_ORF_PREFIX 65535
 
+/* Tries of a prefix-list, for IPv4 and IPv6 entries. */
+#define PREFIX_LIST_TRIES 2
+
 enum prefix_list_type 
 {
   PREFIX_DENY,
@@ -52,6 +55,12 @@ struct prefix_list
   struct prefix_list_entry *head;
   struct prefix_list_entry *tail;
 
+  /* The entries indexed by prefix, see prefix_list_apply(). */
+  struct route_table *trie[PREFIX_LIST_TRIES];
+
+  /* Hooks held back by prefix_list_hooks_suspend(). */
+  u_char hooks;
+
   struct prefix_list *next;
   struct prefix_list *prev;
 };
@@ -69,6 +78,8 @@ extern void prefix_list_init (void);
 extern void prefix_list_reset (void);
 extern void prefix_list_add_hook (void (*func) (struct prefix_list *));
 extern void prefix_list_delete_hook (void (*func) (struct prefix_list *));
+extern void prefix_list_hooks_suspend (void);
+extern void prefix_list_hooks_resume (void);
 
 extern struct prefix_list *prefix_list_lookup (afi_t, const char *);
 extern enum prefix_list_type prefix_list_apply (struct prefix_list *, void *);
@@ -168,3 +168,21 @@ pqueue_dequeue (struct pqueue *queue)
   trickle_down (0, queue);
   return data;
 }
+
+/* Remove the node at index, e.g. as kept up to date by queue->update. */
+void
+pqueue_remove_at (int index, struct pqueue *queue)
+{
+  assert (index >= 0 && index < queue->size);
+
+  queue->array[index] = queue->array[--queue->size];
+  if (index == queue->size)
+    return;
+
+  if (index > 0
+      && (*queue->cmp) (queue->array[index],
+                        queue->array[PARENT_OF (index)]) < 0)
+    trickle_up (index, queue);
+  else
+    trickle_down (index, queue);
+}
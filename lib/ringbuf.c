@@ -0,0 +1,112 @@
+/* Ring buffer for reading from sockets in large chunks.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "memory.h"
+#include "ringbuf.h"
+
+struct ringbuf *
+ringbuf_new (size_t size)
+{
+  struct ringbuf *rb;
+
+  rb = XCALLOC (MTYPE_RINGBUF, sizeof (struct ringbuf));
+  rb->data = XMALLOC (MTYPE_RINGBUF_DATA, size);
+  rb->size = size;
+  return rb;
+}
+
+void
+ringbuf_free (struct ringbuf *rb)
+{
+  XFREE (MTYPE_RINGBUF_DATA, rb->data);
+  XFREE (MTYPE_RINGBUF, rb);
+}
+
+void
+ringbuf_reset (struct ringbuf *rb)
+{
+  rb->start = rb->count = 0;
+}
+
+ssize_t
+ringbuf_read (struct ringbuf *rb, int fd)
+{
+  struct iovec iov[2];
+  size_t end;
+  int iovcnt;
+  ssize_t nbytes;
+
+  if (ringbuf_space (rb) == 0)
+    return 0;
+
+  /* The free part runs from the end of the data to the end of the
+     buffer, then on from its start, or lies between the two ends. */
+  end = (rb->start + rb->count) % rb->size;
+  iov[0].iov_base = rb->data + end;
+  if (end >= rb->start)
+    {
+      iov[0].iov_len = rb->size - end;
+      iov[1].iov_base = rb->data;
+      iov[1].iov_len = rb->start;
+      iovcnt = rb->start ? 2 : 1;
+    }
+  else
+    {
+      iov[0].iov_len = rb->start - end;
+      iovcnt = 1;
+    }
+
+  nbytes = readv (fd, iov, iovcnt);
+  if (nbytes > 0)
+    rb->count += nbytes;
+  return nbytes;
+}
+
+size_t
+ringbuf_peek (struct ringbuf *rb, size_t offset, void *data, size_t size)
+{
+  size_t from, n;
+
+  if (offset >= rb->count)
+    return 0;
+  if (size > rb->count - offset)
+    size = rb->count - offset;
+
+  from = (rb->start + offset) % rb->size;
+  n = rb->size - from < size ? rb->size - from : size;
+  memcpy (data, rb->data + from, n);
+  memcpy ((u_char *) data + n, rb->data, size - n);
+  return size;
+}
+
+size_t
+ringbuf_get (struct ringbuf *rb, void *data, size_t size)
+{
+  size = ringbuf_peek (rb, 0, data, size);
+  rb->start = (rb->start + size) % rb->size;
+  rb->count -= size;
+
+  /* Keep what follows in one piece for as long as may be. */
+  if (rb->count == 0)
+    rb->start = 0;
+  return size;
+}
@@ -0,0 +1,53 @@
+/* Ring buffer for reading from sockets in large chunks.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _ZEBRA_RINGBUF_H
+#define _ZEBRA_RINGBUF_H
+
+/* A fixed size buffer of bytes, filled at one end and drained at the
+   other.  Whatever is free is filled by a single readv(), and data is
+   copied out of it, so nothing is ever moved within it. */
+struct ringbuf
+{
+  u_char *data;
+  size_t size;
+  size_t start;			/* first byte held */
+  size_t count;			/* bytes held */
+};
+
+extern struct ringbuf *ringbuf_new (size_t);
+extern void ringbuf_free (struct ringbuf *);
+extern void ringbuf_reset (struct ringbuf *);
+
+/* Bytes held, and room for more. */
+#define ringbuf_count(R)	((R)->count)
+#define ringbuf_space(R)	((R)->size - (R)->count)
+
+/* Read as much as there is room for from fd, returning what read()
+   does: -1 with errno set, 0 at end of file. */
+extern ssize_t ringbuf_read (struct ringbuf *, int);
+
+/* Copy out size bytes from offset on, returning how many there were. */
+extern size_t ringbuf_peek (struct ringbuf *, size_t, void *, size_t);
+
+/* The same from the start, taking them out. */
+extern size_t ringbuf_get (struct ringbuf *, void *, size_t);
+
+#endif /* _ZEBRA_RINGBUF_H */
@@ -66,6 +66,30 @@ struct route_map_list
 /* Master list of route map. */
 static struct route_map_list route_map_master = { NULL, NULL, NULL, NULL };
 
+/* Entry of the result cache of a route map: which of its first 32
+   indexes have been applied to objects of this key and which of those
+   matched. */
+struct route_map_cache
+{
+  unsigned long key;
+  unsigned int version;
+  u_int32_t known;
+  u_int32_t matched;
+};
+
+#define ROUTE_MAP_CACHE_SIZE	4096
+
+/* Of the applications of an index's match clauses not answered from
+   the cache, one in this many is timed, so the clock is not read on
+   every route. */
+#define ROUTE_MAP_TIME_SAMPLE	64
+
+/* Added to the versions of all maps, outdating all cache entries. */
+static unsigned int route_map_cache_generation = 0;
+
+/* Depth of route_map_hooks_suspend () calls. */
+static int route_map_hooks_suspended = 0;
+
 static void
 route_map_rule_delete (struct route_map_rule_list *,
 		       struct route_map_rule *);
@@ -73,6 +97,36 @@ route_map_rule_delete (struct route_map_rule_list *,
 static void
 route_map_index_delete (struct route_map_index *, int);
 
+/* The map changed: outdate its cache entries, work out which indexes
+   may keep results there and run the event hook. */
+static void
+route_map_event (route_map_event_t event, struct route_map *map)
+{
+  struct route_map_index *index;
+  struct route_map_rule *rule;
+  u_int32_t bit = 1;
+
+  map->version++;
+
+  if (route_map_hooks_suspended)
+    {
+      SET_FLAG (map->hooks, ROUTE_MAP_HOOK_EVENT);
+      map->event = event;
+      return;
+    }
+
+  for (index = map->head; index; index = index->next, bit <<= 1)
+    {
+      index->cachebit = index->match_list.head ? bit : 0;
+      for (rule = index->match_list.head; rule; rule = rule->next)
+	if (! rule->cmd->cacheable)
+	  index->cachebit = 0;
+    }
+
+  if (route_map_master.event_hook)
+    (*route_map_master.event_hook) (event, map->name);
+}
+
 /* New route map allocation. Please note route map's name must be
    specified. */
 static struct route_map *
@@ -104,7 +158,9 @@ route_map_add (const char *name)
   list->tail = map;
 
   /* Execute hook. */
-  if (route_map_master.add_hook)
+  if (route_map_hooks_suspended)
+    SET_FLAG (map->hooks, ROUTE_MAP_HOOK_ADD);
+  else if (route_map_master.add_hook)
     (*route_map_master.add_hook) (name);
 
   return map;
@@ -135,6 +191,8 @@ route_map_delete (struct route_map *map)
   else
     list->head = map->next;
 
+  if (map->cache)
+    XFREE (MTYPE_ROUTE_MAP_CACHE, map->cache);
   XFREE (MTYPE_ROUTE_MAP, map);
 
   /* Execute deletion hook. */
@@ -199,6 +257,17 @@ route_map_empty (struct route_map *map)
 }
 
 /* show route-map */
+/* Time spent in the match clauses of index, from the applications
+   that were timed. */
+unsigned long long
+route_map_index_usecs (struct route_map_index *index)
+{
+  if (index->timed == 0)
+    return 0;
+  return index->nsec * (index->applied - index->cached) / index->timed
+    / 1000;
+}
+
 static void
 vty_show_route_map_entry (struct vty *vty, struct route_map *map)
 {
@@ -216,6 +285,10 @@ vty_show_route_map_entry (struct vty *vty, struct route_map *map)
                map->name, route_map_type_str (index->type),
                index->pref, VTY_NEWLINE);
 
+      vty_out (vty, "  Applied %lu times, matched %lu (%lu from cache), "
+	       "about %llu usecs%s", index->applied, index->matched,
+	       index->cached, route_map_index_usecs (index), VTY_NEWLINE);
+
       /* Description */
       if (index->description)
 	vty_out (vty, "  Description:%s    %s%s", VTY_NEWLINE,
@@ -319,9 +392,8 @@ route_map_index_delete (struct route_map_index *index, int notify)
     XFREE (MTYPE_ROUTE_MAP_NAME, index->nextrm);
 
     /* Execute event hook. */
-  if (route_map_master.event_hook && notify)
-    (*route_map_master.event_hook) (RMAP_EVENT_INDEX_DELETED,
-				    index->map->name);
+  if (notify)
+    route_map_event (RMAP_EVENT_INDEX_DELETED, index->map);
 
   XFREE (MTYPE_ROUTE_MAP_INDEX, index);
 }
@@ -385,9 +457,7 @@ route_map_index_add (struct route_map *map, enum route_map_type type,
     }
 
   /* Execute event hook. */
-  if (route_map_master.event_hook)
-    (*route_map_master.event_hook) (RMAP_EVENT_INDEX_ADDED,
-				    map->name);
+  route_map_event (RMAP_EVENT_INDEX_ADDED, map);
 
   return index;
 }
@@ -571,11 +641,8 @@ route_map_add_match (struct route_map_index *index, const char *match_name,
   route_map_rule_add (&index->match_list, rule);
 
   /* Execute event hook. */
-  if (route_map_master.event_hook)
-    (*route_map_master.event_hook) (replaced ?
-				    RMAP_EVENT_MATCH_REPLACED:
-				    RMAP_EVENT_MATCH_ADDED,
-				    index->map->name);
+  route_map_event (replaced ? RMAP_EVENT_MATCH_REPLACED
+			    : RMAP_EVENT_MATCH_ADDED, index->map);
 
   return 0;
 }
@@ -598,9 +665,7 @@ route_map_delete_match (struct route_map_index *index, const char *match_name,
       {
 	route_map_rule_delete (&index->match_list, rule);
 	/* Execute event hook. */
-	if (route_map_master.event_hook)
-	  (*route_map_master.event_hook) (RMAP_EVENT_MATCH_DELETED,
-					  index->map->name);
+	route_map_event (RMAP_EVENT_MATCH_DELETED, index->map);
 	return 0;
       }
   /* Can't find matched rule. */
@@ -658,11 +723,8 @@ route_map_add_set (struct route_map_index *index, const char *set_name,
   route_map_rule_add (&index->set_list, rule);
 
   /* Execute event hook. */
-  if (route_map_master.event_hook)
-    (*route_map_master.event_hook) (replaced ?
-				    RMAP_EVENT_SET_REPLACED:
-				    RMAP_EVENT_SET_ADDED,
-				    index->map->name);
+  route_map_event (replaced ? RMAP_EVENT_SET_REPLACED
+			    : RMAP_EVENT_SET_ADDED, index->map);
   return 0;
 }
 
@@ -684,9 +746,7 @@ route_map_delete_set (struct route_map_index *index, const char *set_name,
       {
         route_map_rule_delete (&index->set_list, rule);
 	/* Execute event hook. */
-	if (route_map_master.event_hook)
-	  (*route_map_master.event_hook) (RMAP_EVENT_SET_DELETED,
-					  index->map->name);
+	route_map_event (RMAP_EVENT_SET_DELETED, index->map);
         return 0;
       }
   /* Can't find matched rule. */
@@ -769,15 +829,114 @@ route_map_apply_match (struct route_map_rule_list *match_list,
   return ret;
 }
 
+/* Monotonic clock in nanoseconds, for the statistics. */
+static unsigned long long
+route_map_clock (void)
+{
+#ifdef HAVE_CLOCK_MONOTONIC
+  struct timespec tp;
+
+  clock_gettime (CLOCK_MONOTONIC, &tp);
+  return tp.tv_sec * 1000000000ULL + tp.tv_nsec;
+#else /* !HAVE_CLOCK_MONOTONIC */
+  struct timeval tv;
+
+  gettimeofday (&tv, NULL);
+  return tv.tv_sec * 1000000000ULL + tv.tv_usec * 1000ULL;
+#endif /* HAVE_CLOCK_MONOTONIC */
+}
+
+/* Cache entry of the map for key, emptied if it was of another key or
+   an older version of the map. */
+static struct route_map_cache *
+route_map_cache_get (struct route_map *map, unsigned long key)
+{
+  struct route_map_cache *entry;
+  unsigned int version = map->version + route_map_cache_generation;
+
+  if (key == 0)
+    return NULL;
+
+  if (map->cache == NULL)
+    map->cache = XCALLOC (MTYPE_ROUTE_MAP_CACHE,
+			  ROUTE_MAP_CACHE_SIZE * sizeof (struct route_map_cache));
+
+  entry = &map->cache[key % ROUTE_MAP_CACHE_SIZE];
+  if (entry->key != key || entry->version != version)
+    {
+      entry->key = key;
+      entry->version = version;
+      entry->known = entry->matched = 0;
+    }
+  return entry;
+}
+
+/* Apply the match clauses of an index, or take their result from the
+   cache entry when it has it. */
+static route_map_result_t
+route_map_apply_index (struct route_map_index *index,
+		       struct route_map_cache *entry, struct prefix *prefix,
+		       route_map_object_t type, void *object)
+{
+  route_map_result_t ret;
+  unsigned long long start;
+
+  if (entry && CHECK_FLAG (entry->known, index->cachebit))
+    {
+      ret = CHECK_FLAG (entry->matched, index->cachebit)
+	? RMAP_MATCH : RMAP_NOMATCH;
+      index->cached++;
+    }
+  else
+    {
+      if ((index->applied - index->cached) % ROUTE_MAP_TIME_SAMPLE == 0)
+	{
+	  start = route_map_clock ();
+	  ret = route_map_apply_match (&index->match_list, prefix, type,
+				       object);
+	  index->nsec += route_map_clock () - start;
+	  index->timed++;
+	}
+      else
+	ret = route_map_apply_match (&index->match_list, prefix, type,
+				     object);
+
+      if (entry)
+	{
+	  SET_FLAG (entry->known, index->cachebit);
+	  if (ret == RMAP_MATCH)
+	    SET_FLAG (entry->matched, index->cachebit);
+	}
+    }
+
+  index->applied++;
+  if (ret == RMAP_MATCH)
+    index->matched++;
+  return ret;
+}
+
 /* Apply route map to the object. */
 route_map_result_t
 route_map_apply (struct route_map *map, struct prefix *prefix,
                  route_map_object_t type, void *object)
+{
+  return route_map_apply_cached (map, prefix, type, object, NULL);
+}
+
+/* Apply route map to the object, with the results of cacheable match
+   clauses kept by key (object).  The key is only asked for when an
+   index can use it, and not used any more once set clauses or a called
+   map may have changed the object. */
+route_map_result_t
+route_map_apply_cached (struct route_map *map, struct prefix *prefix,
+			route_map_object_t type, void *object,
+			unsigned long (*key) (void *))
 {
   static int recursion = 0;
   int ret = 0;
   struct route_map_index *index;
   struct route_map_rule *set;
+  struct route_map_cache *entry = NULL;
 
   if (recursion > RMAP_RECURSION_LIMIT)
     {
@@ -791,10 +950,21 @@ route_map_apply (struct route_map *map, struct prefix *prefix,
   if (map == NULL)
     return RMAP_DENYMATCH;
 
+  /* Which indexes may use the cache is not known until the held back
+     event has run. */
+  if (CHECK_FLAG (map->hooks, ROUTE_MAP_HOOK_EVENT))
+    key = NULL;
+
   for (index = map->head; index; index = index->next)
     {
       /* Apply this index. */
-      ret = route_map_apply_match (&index->match_list, prefix, type, object);
+      if (index->cachebit && key && entry == NULL)
+	{
+	  entry = route_map_cache_get (map, (*key) (object));
+	  if (entry == NULL)
+	    key = NULL;
+	}
+      ret = route_map_apply_index (index, entry, prefix, type, object);
 
       /* Now we apply the matrix from above */
       if (ret == RMAP_NOMATCH)
@@ -810,6 +980,13 @@ route_map_apply (struct route_map *map, struct prefix *prefix,
                 ret = (*set->cmd->func_apply) (set->value, prefix,
                                                type, object);
 
+              /* The object may have changed, its key would be stale. */
+              if (index->set_list.head)
+                {
+                  entry = NULL;
+                  key = NULL;
+                }
+
               /* Call another route-map if available */
               if (index->nextrm)
                 {
@@ -819,8 +996,11 @@ route_map_apply (struct route_map *map, struct prefix *prefix,
                   if (nextrm) /* Target route-map found, jump to it */
                     {
                       recursion++;
-                      ret = route_map_apply (nextrm, prefix, type, object);
+                      ret = route_map_apply_cached (nextrm, prefix, type,
+                                                    object, key);
                       recursion--;
+                      entry = NULL;
+                      key = NULL;
                     }
 
                   /* If nextrm returned 'deny', finish. */
@@ -864,6 +1044,58 @@ route_map_apply (struct route_map *map, struct prefix *prefix,
   return RMAP_DENYMATCH;
 }
 
+/* Whether any index of the map has a match clause of the named rule. */
+int
+route_map_has_match (struct route_map *map, const char *name)
+{
+  struct route_map_index *index;
+  struct route_map_rule *rule;
+
+  for (index = map->head; index; index = index->next)
+    for (rule = index->match_list.head; rule; rule = rule->next)
+      if (strcmp (rule->cmd->str, name) == 0)
+	return 1;
+  return 0;
+}
+
+/* Forget all cached results. */
+void
+route_map_cache_invalidate (void)
+{
+  route_map_cache_generation++;
+}
+
+void
+route_map_hooks_suspend (void)
+{
+  route_map_hooks_suspended++;
+}
+
+/* Run the hooks held back since the outermost suspend, once per map. */
+void
+route_map_hooks_resume (void)
+{
+  struct route_map *map, *next;
+
+  if (--route_map_hooks_suspended > 0)
+    return;
+
+  for (map = route_map_master.head; map; map = next)
+    {
+      next = map->next;
+
+      if (CHECK_FLAG (map->hooks, ROUTE_MAP_HOOK_ADD)
+	  && route_map_master.add_hook)
+	(*route_map_master.add_hook) (map->name);
+      if (CHECK_FLAG (map->hooks, ROUTE_MAP_HOOK_EVENT))
+	{
+	  map->hooks = 0;
+	  route_map_event (map->event, map);
+	}
+      map->hooks = 0;
+    }
+}
+
 void
 route_map_add_hook (void (*func) (const char *))
 {
@@ -87,6 +87,10 @@ struct route_map_rule_cmd
 
   /* Free allocated value by func_compile (). */
   void (*func_free)(void *);
+
+  /* Non-zero for a match whose result depends on nothing but the
+     object's attributes, see route_map_apply_cached (). */
+  int cacheable;
 };
 
 /* Route map apply error. */
@@ -131,6 +135,19 @@ struct route_map_index
   struct route_map_rule_list match_list;
   struct route_map_rule_list set_list;
 
+  /* Bit of this index in the cache entries of the map, zero when its
+     match result can't be cached. */
+  u_int32_t cachebit;
+
+  /* Times the match clauses were applied, matched and answered from
+     the cache, and of the others how many were timed and the time
+     those took. */
+  unsigned long applied;
+  unsigned long matched;
+  unsigned long cached;
+  unsigned long timed;
+  unsigned long long nsec;
+
   /* Make linked list. */
   struct route_map_index *next;
   struct route_map_index *prev;
@@ -146,6 +163,19 @@ struct route_map
   struct route_map_index *head;
   struct route_map_index *tail;
 
+  /* Bumped on every change, outdating the cache entries. */
+  unsigned int version;
+
+  /* Match results by object key, allocated on first use. */
+  struct route_map_cache *cache;
+
+  /* Hooks held back by route_map_hooks_suspend (), and the last event
+     for the event hook. */
+  u_char hooks;
+#define ROUTE_MAP_HOOK_ADD	0x01
+#define ROUTE_MAP_HOOK_EVENT	0x02
+  route_map_event_t event;
+
   /* Make linked list. */
   struct route_map *next;
   struct route_map *prev;
@@ -191,6 +221,33 @@ extern route_map_result_t route_map_apply (struct route_map *map,
                                            route_map_object_t object_type,
                                            void *object);
 
+/* Apply route map to the object, reusing the results of the cacheable
+   match clauses for objects which key () maps to the same number.  A
+   key of 0 means the object can't be looked up.  Past set clauses the
+   cache is not used. */
+extern route_map_result_t route_map_apply_cached (struct route_map *map,
+                                                  struct prefix *,
+                                                  route_map_object_t object_type,
+                                                  void *object,
+                                                  unsigned long (*key) (void *));
+
+/* Whether the map matches on the named rule anywhere, not counting
+   maps it calls. */
+extern int route_map_has_match (struct route_map *, const char *);
+
+/* Time spent in the match clauses of the index, estimated from the
+   applications that were timed. */
+extern unsigned long long route_map_index_usecs (struct route_map_index *);
+
+/* Forget all cached match results, e.g. when a list they refer to
+   changed. */
+extern void route_map_cache_invalidate (void);
+
+/* Hold back the hooks while a whole configuration is read, then run
+   them once for each map that changed. */
+extern void route_map_hooks_suspend (void);
+extern void route_map_hooks_resume (void);
+
 extern void route_map_add_hook (void (*func) (const char *));
 extern void route_map_delete_hook (void (*func) (const char *));
 extern void route_map_event_hook (void (*func) (route_map_event_t, const char *));
@@ -114,6 +114,20 @@ stream_new (size_t size)
   return s;
 }
 
+/* Drop a stream's hold on shared data. */
+static void
+stream_buf_release (struct stream *s)
+{
+  struct stream_buf *buf = s->buf;
+
+  s->buf = NULL;
+  if (__sync_sub_and_fetch (&buf->refcnt, 1) == 0)
+    {
+      XFREE (MTYPE_STREAM_DATA, buf->data);
+      XFREE (MTYPE_STREAM_BUF, buf);
+    }
+}
+
 /* Free it now. */
 void
 stream_free (struct stream *s)
@@ -121,7 +135,10 @@ stream_free (struct stream *s)
   if (!s)
     return;
   
-  XFREE (MTYPE_STREAM_DATA, s->data);
+  if (s->buf)
+    stream_buf_release (s);
+  else
+    XFREE (MTYPE_STREAM_DATA, s->data);
   XFREE (MTYPE_STREAM, s);
 }
 
@@ -154,13 +171,76 @@ stream_dup (struct stream *s)
   return (stream_copy (new, s));
 }
 
+/* Make a new stream onto the data of s, which is not copied.  It
+   starts out with the getp and endp of s. */
+struct stream *
+stream_ref (struct stream *s)
+{
+  struct stream *new;
+
+  STREAM_VERIFY_SANE (s);
+
+  if (s->buf == NULL)
+    {
+      s->buf = XMALLOC (MTYPE_STREAM_BUF, sizeof (struct stream_buf));
+      s->buf->refcnt = 1;
+      s->buf->data = s->data;
+    }
+  __sync_add_and_fetch (&s->buf->refcnt, 1);
+
+  new = XCALLOC (MTYPE_STREAM, sizeof (struct stream));
+  new->buf = s->buf;
+  new->data = s->data;
+  new->size = s->size;
+  new->getp = s->getp;
+  new->endp = s->endp;
+
+  return new;
+}
+
+/* Make a new stream onto size bytes of the data of s from offset from,
+   which is not copied.  The slice is full, its getp at 0. */
+struct stream *
+stream_slice (struct stream *s, size_t from, size_t size)
+{
+  struct stream *new;
+
+  if (from + size > s->endp)
+    {
+      STREAM_BOUND_WARN (s, "slice");
+      return NULL;
+    }
+
+  new = stream_ref (s);
+  new->data += from;
+  new->size = new->endp = size;
+  new->getp = 0;
+
+  return new;
+}
+
+/* Does s share its data with other streams? */
+int
+stream_is_shared (struct stream *s)
+{
+  return s->buf && s->buf->refcnt > 1;
+}
+
 size_t
 stream_resize (struct stream *s, size_t newsize)
 {
   u_char *newdata;
   STREAM_VERIFY_SANE (s);
   
-  newdata = XREALLOC (MTYPE_STREAM_DATA, s->data, newsize);
+  if (s->buf)
+    {
+      /* Shared data may not move, take a copy of our own. */
+      newdata = XMALLOC (MTYPE_STREAM_DATA, newsize);
+      memcpy (newdata, s->data, MIN (s->endp, newsize));
+      stream_buf_release (s);
+    }
+  else
+    newdata = XREALLOC (MTYPE_STREAM_DATA, s->data, newsize);
   
   if (newdata == NULL)
     return s->size;
@@ -934,6 +1014,14 @@ stream_fifo_push (struct stream_fifo *fifo, struct stream *s)
   fifo->count++;
 }
 
+/* Add another stream onto the data of s to fifo, s itself is left
+   as it is.  Lets one message be queued for many recipients. */
+void
+stream_fifo_push_ref (struct stream_fifo *fifo, struct stream *s)
+{
+  stream_fifo_push (fifo, stream_ref (s));
+}
+
 /* Delete first stream from fifo. */
 struct stream *
 stream_fifo_pop (struct stream_fifo *fifo)
@@ -955,6 +1043,60 @@ stream_fifo_pop (struct stream_fifo *fifo)
   return s; 
 }
 
+/* Most streams handed to writev() at once. */
+#ifdef IOV_MAX
+#define STREAM_FIFO_IOV ((IOV_MAX <= 1024) ? IOV_MAX : 1024)
+#else
+#define STREAM_FIFO_IOV 16
+#endif
+
+/* Write the streams at the head of fifo to fd with a single writev(),
+   at most count of them (all if 0) and STREAM_FIFO_IOV.  What was
+   written is consumed from each stream by moving its getp, a partly
+   written one is continued from there next time, and fully written
+   streams stay in the fifo for the caller to pop.  Returns the number
+   of bytes written or -1 with errno set, as writev() does. */
+ssize_t
+stream_fifo_write (struct stream_fifo *fifo, int fd, size_t count)
+{
+  struct iovec iov[STREAM_FIFO_IOV];
+  struct stream *s;
+  size_t iovcnt = 0;
+  ssize_t nbytes;
+  size_t left;
+
+  if (count == 0 || count > STREAM_FIFO_IOV)
+    count = STREAM_FIFO_IOV;
+
+  for (s = fifo->head; s && iovcnt < count; s = s->next)
+    {
+      if (STREAM_READABLE (s) == 0)
+	continue;
+      iov[iovcnt].iov_base = s->data + s->getp;
+      iov[iovcnt].iov_len = STREAM_READABLE (s);
+      iovcnt++;
+    }
+
+  if (iovcnt == 0)
+    return 0;
+
+  nbytes = writev (fd, iov, iovcnt);
+  if (nbytes <= 0)
+    return nbytes;
+
+  for (s = fifo->head, left = nbytes; s && left; s = s->next)
+    {
+      size_t readable = STREAM_READABLE (s);
+
+      if (readable > left)
+	readable = left;
+      s->getp += readable;
+      left -= readable;
+    }
+
+  return nbytes;
+}
+
 /* Return first fifo entry. */
 struct stream *
 stream_fifo_head (struct stream_fifo *fifo)
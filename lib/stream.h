@@ -89,8 +89,24 @@
  *
  * Best practice is to use stream_put (<stream *>, NULL, <size>) to zero out
  * any part of a stream which isn't otherwise written to.
+ *
+ * Sharing:
+ * stream_ref() and stream_slice() make further streams onto the data of
+ * an existing one, without copying it.  Each has its own getp and endp
+ * (and may sit in a stream_fifo of its own), while the data is
+ * reference counted and freed with the last stream using it.  Data
+ * written through any of them is seen by all, so a message is best
+ * shared once it is complete.  stream_resize() gives the stream it is
+ * called on a private copy first.
  */
 
+/* Data shared by several streams. */
+struct stream_buf
+{
+  unsigned int refcnt;
+  unsigned char *data;	/* start of the allocation */
+};
+
 /* Stream buffer. */
 struct stream
 {
@@ -104,6 +120,7 @@ struct stream
   size_t endp;		/* last valid data position */
   size_t size;		/* size of data segment */
   unsigned char *data; /* data pointer */
+  struct stream_buf *buf; /* shared data, NULL if not shared */
 };
 
 /* First in first out queue structure. */
@@ -139,6 +156,9 @@ extern struct stream *stream_new (size_t);
 extern void stream_free (struct stream *);
 extern struct stream * stream_copy (struct stream *, struct stream *src);
 extern struct stream *stream_dup (struct stream *);
+extern struct stream *stream_ref (struct stream *);
+extern struct stream *stream_slice (struct stream *, size_t, size_t);
+extern int stream_is_shared (struct stream *);
 extern size_t stream_resize (struct stream *, size_t);
 extern size_t stream_get_getp (struct stream *);
 extern size_t stream_get_endp (struct stream *);
@@ -214,8 +234,11 @@ extern u_char *stream_pnt (struct stream *);
 /* Stream fifo. */
 extern struct stream_fifo *stream_fifo_new (void);
 extern void stream_fifo_push (struct stream_fifo *fifo, struct stream *s);
+extern void stream_fifo_push_ref (struct stream_fifo *fifo, struct stream *s);
 extern struct stream *stream_fifo_pop (struct stream_fifo *fifo);
 extern struct stream *stream_fifo_head (struct stream_fifo *fifo);
+extern ssize_t stream_fifo_write (struct stream_fifo *fifo, int fd,
+				  size_t count);
 extern void stream_fifo_clean (struct stream_fifo *fifo);
 extern void stream_fifo_free (struct stream_fifo *fifo);
 
@@ -120,6 +120,8 @@ route_table_free (struct route_table *rt)
 	}
     }
  
+  if (rt->jump)
+    XFREE (MTYPE_ROUTE_JUMP, rt->jump);
   XFREE (MTYPE_ROUTE_TABLE, rt);
   return;
 }
@@ -174,6 +176,108 @@ set_link (struct route_node *node, struct route_node *new)
   new->parent = node;
 }
 
+/* Jump index slot of a prefix.  */
+static inline unsigned int
+route_jump_index (const u_char *prefix)
+{
+  return (prefix[0] << 8 | prefix[1]) >> (16 - ROUTE_JUMP_BITS);
+}
+
+/* Point the jump slots covered by a new node at it, unless they already
+   point further down.  */
+static void
+route_jump_add (struct route_table *table, struct route_node *node)
+{
+  struct route_node **slot;
+  unsigned int i, n;
+
+  if (table->jump == NULL || node->p.prefixlen > ROUTE_JUMP_BITS)
+    return;
+
+  slot = &table->jump[route_jump_index (&node->p.u.prefix)];
+  n = 1 << (ROUTE_JUMP_BITS - node->p.prefixlen);
+  for (i = 0; i < n; i++)
+    if (slot[i] == NULL || slot[i]->p.prefixlen < node->p.prefixlen)
+      slot[i] = node;
+}
+
+/* Hand the jump slots of a node about to be deleted to its parent.  */
+static void
+route_jump_delete (struct route_table *table, struct route_node *node)
+{
+  struct route_node **slot;
+  unsigned int i, n;
+
+  if (table->jump == NULL || node->p.prefixlen > ROUTE_JUMP_BITS)
+    return;
+
+  slot = &table->jump[route_jump_index (&node->p.u.prefix)];
+  n = 1 << (ROUTE_JUMP_BITS - node->p.prefixlen);
+  for (i = 0; i < n; i++)
+    if (slot[i] == node)
+      slot[i] = node->parent;
+}
+
+/* Build the jump index from the nodes of at most ROUTE_JUMP_BITS,
+   parents before children so the deepest one ends up in each slot.  */
+static void
+route_jump_build (struct route_table *table)
+{
+  struct route_node *node;
+
+  table->jump = XCALLOC (MTYPE_ROUTE_JUMP,
+			 sizeof (struct route_node *) << ROUTE_JUMP_BITS);
+
+  node = table->top;
+  while (node)
+    {
+      route_jump_add (table, node);
+
+      /* Children are longer, only look at them if they may fit. */
+      if (node->p.prefixlen < ROUTE_JUMP_BITS && node->l_left)
+	{
+	  node = node->l_left;
+	  continue;
+	}
+      if (node->p.prefixlen < ROUTE_JUMP_BITS && node->l_right)
+	{
+	  node = node->l_right;
+	  continue;
+	}
+
+      while (node->parent)
+	{
+	  if (node->parent->l_left == node && node->parent->l_right)
+	    break;
+	  node = node->parent;
+	}
+      node = node->parent ? node->parent->l_right : NULL;
+    }
+}
+
+/* Node to start walking down from when looking for p.  */
+static inline struct route_node *
+route_jump (const struct route_table *table, const struct prefix *p)
+{
+  struct route_node *node;
+
+  if (table->jump && p->prefixlen >= ROUTE_JUMP_BITS
+      && (node = table->jump[route_jump_index (&p->u.prefix)]) != NULL)
+    return node;
+  return table->top;
+}
+
+/* Account for a node just linked into the table.  */
+static void
+route_node_added (struct route_table *table, struct route_node *node)
+{
+  table->count++;
+  if (table->jump)
+    route_jump_add (table, node);
+  else if (table->count >= ROUTE_JUMP_NODES)
+    route_jump_build (table);
+}
+
 /* Lock node. */
 struct route_node *
 route_lock_node (struct route_node *node)
@@ -197,10 +301,11 @@ struct route_node *
 route_node_match (const struct route_table *table, const struct prefix *p)
 {
   struct route_node *node;
+  struct route_node *start;
   struct route_node *matched;
 
   matched = NULL;
-  node = table->top;
+  node = start = route_jump (table, p);
 
   /* Walk down tree.  If there is matched route then store it to
      matched. */
@@ -216,6 +321,15 @@ route_node_match (const struct route_table *table, const struct prefix *p)
       node = node->link[prefix_bit(&p->u.prefix, node->p.prefixlen)];
     }
 
+  /* Started below the top, the match may be further up. */
+  if (! matched && start)
+    for (node = start->parent; node; node = node->parent)
+      if (node->info)
+	{
+	  matched = node;
+	  break;
+	}
+
   /* If matched route found, return it. */
   if (matched)
     return route_lock_node (matched);
@@ -261,7 +375,7 @@ route_node_lookup (struct route_table *table, struct prefix *p)
   u_char prefixlen = p->prefixlen;
   const u_char *prefix = &p->u.prefix;
 
-  node = table->top;
+  node = route_jump (table, p);
 
   while (node && node->p.prefixlen <= prefixlen &&
 	 prefix_match (&node->p, p))
@@ -286,7 +400,7 @@ route_node_get (struct route_table *table, struct prefix *p)
   const u_char *prefix = &p->u.prefix;
 
   match = NULL;
-  node = table->top;
+  node = route_jump (table, p);
   while (node && node->p.prefixlen <= prefixlen &&
 	 prefix_match (&node->p, p))
     {
@@ -304,6 +418,7 @@ route_node_get (struct route_table *table, struct prefix *p)
 	set_link (match, new);
       else
 	table->top = new;
+      route_node_added (table, new);
     }
   else
     {
@@ -317,12 +432,14 @@ route_node_get (struct route_table *table, struct prefix *p)
 	set_link (match, new);
       else
 	table->top = new;
+      route_node_added (table, new);
 
       if (new->p.prefixlen != p->prefixlen)
 	{
 	  match = new;
 	  new = route_node_set (table, p);
 	  set_link (match, new);
+	  route_node_added (table, new);
 	}
     }
   route_lock_node (new);
@@ -350,6 +467,14 @@ route_node_delete (struct route_node *node)
 
   parent = node->parent;
 
+  route_jump_delete (node->table, node);
+  node->table->count--;
+  if (node->table->jump && node->table->count < ROUTE_JUMP_NODES / 4)
+    {
+      XFREE (MTYPE_ROUTE_JUMP, node->table->jump);
+      node->table->jump = NULL;
+    }
+
   if (child)
     child->parent = parent;
 
@@ -23,10 +23,24 @@
 #ifndef _ZEBRA_TABLE_H
 #define _ZEBRA_TABLE_H
 
+/* Big tables level-compress the top ROUTE_JUMP_BITS bits of the tree
+   into a directly indexed array, giving for each value of those bits
+   the deepest node of at most that length on the way down.  Lookups
+   start there instead of at the top.  The array is built once a table
+   has ROUTE_JUMP_NODES nodes and dropped when it shrinks well below.  */
+#define ROUTE_JUMP_BITS   16
+#define ROUTE_JUMP_NODES  65536
+
 /* Routing table top structure. */
 struct route_table
 {
   struct route_node *top;
+
+  /* Number of nodes, with or without info. */
+  unsigned long count;
+
+  /* Level compressed top of the tree, NULL for small tables. */
+  struct route_node **jump;
 };
 
 /* Each routing entry. */
@@ -29,17 +29,68 @@
 #include "hash.h"
 #include "command.h"
 #include "sigevent.h"
+#include "pqueue.h"
+
+#ifdef HAVE_POLL_H
+#include <poll.h>
+#endif /* HAVE_POLL_H */
+#ifdef HAVE_EPOLL
+#include <sys/epoll.h>
+#endif /* HAVE_EPOLL */
 
-/* Recent absolute time of day */
-struct timeval recent_time;
-static struct timeval last_recent_time;
-/* Relative time, since startup */
-static struct timeval relative_time;
+/* Recent absolute time of day, per pthread */
+__thread struct timeval recent_time;
+static __thread struct timeval last_recent_time;
+/* Relative time, since startup, per pthread */
+static __thread struct timeval relative_time;
 static struct timeval relative_time_base;
 /* init flag */
 static unsigned short timers_inited;
 
-static struct hash *cpu_record = NULL;
+/* All thread masters, for the CPU statistics each keeps of its own. */
+static struct thread_master *thread_masters;
+static pthread_mutex_t thread_masters_mtx = PTHREAD_MUTEX_INITIALIZER;
+
+/* A request posted to a thread master by another pthread. */
+struct thread_msg
+{
+  struct mpsc_node node;
+  int (*func) (struct thread *);	/* NULL to cancel events for arg */
+  void *arg;
+  int val;
+  const char *funcname;
+};
+
+/* Read and write threads waiting on one file descriptor. */
+struct thread_fd
+{
+  struct thread *read;
+  struct thread *write;
+  int pollidx;			/* index into m->pollfds, or -1 */
+};
+
+/* Coarse timers live in a hierarchical timing wheel with one second
+ * ticks.  Level 0 has a slot for each of the next 64 seconds, and each
+ * higher level a slot for each 64 slots of the level below.  Timers are
+ * cascaded down a level as the wheel turns, so adding and cancelling
+ * them is O(1) however many there are.
+ */
+#define WHEEL_BITS	6
+#define WHEEL_SIZE	(1 << WHEEL_BITS)
+#define WHEEL_MASK	(WHEEL_SIZE - 1)
+#define WHEEL_LEVELS	4
+#define WHEEL_SPAN(L)	((time_t) 1 << (WHEEL_BITS * (L)))
+
+struct thread_wheel
+{
+  time_t now;			/* next tick to be processed */
+  unsigned int count;
+  struct thread_list slots[WHEEL_LEVELS][WHEEL_SIZE];
+};
+
+/* Maximum number of epoll events collected per thread_fetch() wait,
+ * anything beyond this is level-triggered and is reported next time. */
+#define THREAD_EPOLL_EVENTS 256
 
 /* Struct timeval's tv_usec one second value.  */
 #define TIMER_SECOND_MICRO 1000000L
@@ -98,6 +149,15 @@ static void
 quagga_gettimeofday_relative_adjust (void)
 {
   struct timeval diff;
+
+  /* First use in a new pthread, start from the shared base. */
+  if (!last_recent_time.tv_sec)
+    {
+      relative_time = timeval_subtract (recent_time, relative_time_base);
+      last_recent_time = recent_time;
+      return;
+    }
+
   if (timeval_cmp (recent_time, last_recent_time) < 0)
     {
       relative_time.tv_sec++;
@@ -295,16 +355,55 @@ cpu_record_hash_print(struct hash_backet *bucket,
 #endif
 }
 
+/* Add what a master has of a callback to the merged history. */
+static void
+cpu_record_hash_merge (struct hash_backet *bucket, struct hash *merged)
+{
+  struct cpu_thread_history *a = bucket->data;
+  struct cpu_thread_history *m;
+
+  if (a->total_calls == 0)
+    return;
+
+  m = hash_get (merged, a, (void * (*) (void *))cpu_record_hash_alloc);
+  m->total_calls += a->total_calls;
+  m->real.total += a->real.total;
+  if (m->real.max < a->real.max)
+    m->real.max = a->real.max;
+#ifdef HAVE_RUSAGE
+  m->cpu.total += a->cpu.total;
+  if (m->cpu.max < a->cpu.max)
+    m->cpu.max = a->cpu.max;
+#endif
+  m->types |= a->types;
+}
+
 static void
 cpu_record_print(struct vty *vty, thread_type filter)
 {
   struct cpu_thread_history tmp;
   void *args[3] = {&tmp, vty, &filter};
+  struct thread_master *m;
+  struct hash *merged;
 
   memset(&tmp, 0, sizeof tmp);
   strcpy(tmp.funcname, "TOTAL");
   tmp.types = filter;
 
+  merged = hash_create_size (1011,
+			     (unsigned int (*) (void *))cpu_record_hash_key,
+			     (int (*) (const void *, const void *))cpu_record_hash_cmp);
+  pthread_mutex_lock (&thread_masters_mtx);
+  for (m = thread_masters; m; m = m->next)
+    {
+      pthread_mutex_lock (&m->cpu_mtx);
+      hash_iterate (m->cpu_record,
+		    (void (*) (struct hash_backet *, void *))cpu_record_hash_merge,
+		    merged);
+      pthread_mutex_unlock (&m->cpu_mtx);
+    }
+  pthread_mutex_unlock (&thread_masters_mtx);
+
 #ifdef HAVE_RUSAGE
   vty_out(vty, "%21s %18s %18s%s",
   	  "", "CPU (user+system):", "Real (wall-clock):", VTY_NEWLINE);
@@ -314,9 +413,11 @@ cpu_record_print(struct vty *vty, thread_type filter)
   vty_out(vty, " Avg uSec Max uSecs");
 #endif
   vty_out(vty, "  Type  Thread%s", VTY_NEWLINE);
-  hash_iterate(cpu_record,
+  hash_iterate(merged,
 	       (void(*)(struct hash_backet*,void*))cpu_record_hash_print,
 	       args);
+  hash_clean (merged, cpu_record_hash_free);
+  hash_free (merged);
 
   if (tmp.total_calls > 0)
     vty_out_cpu_thread_history(vty, &tmp);
@@ -382,6 +483,8 @@ DEFUN(show_thread_cpu,
   return CMD_SUCCESS;
 }
 
+/* Zeroed rather than released, as the owner of the master may be
+   adding to it at the same time. */
 static void
 cpu_record_hash_clear (struct hash_backet *bucket, 
 		      void *args)
@@ -393,16 +496,30 @@ cpu_record_hash_clear (struct hash_backet *bucket,
   if ( !(a->types & *filter) )
        return;
   
-  hash_release (cpu_record, bucket->data);
+  a->total_calls = 0;
+  memset (&a->real, 0, sizeof (a->real));
+#ifdef HAVE_RUSAGE
+  memset (&a->cpu, 0, sizeof (a->cpu));
+#endif
+  a->types = 0;
 }
 
 static void
 cpu_record_clear (thread_type filter)
 {
   thread_type *tmp = &filter;
-  hash_iterate (cpu_record,
-	        (void (*) (struct hash_backet*,void*)) cpu_record_hash_clear,
-	        tmp);
+  struct thread_master *m;
+
+  pthread_mutex_lock (&thread_masters_mtx);
+  for (m = thread_masters; m; m = m->next)
+    {
+      pthread_mutex_lock (&m->cpu_mtx);
+      hash_iterate (m->cpu_record,
+		    (void (*) (struct hash_backet*,void*)) cpu_record_hash_clear,
+		    tmp);
+      pthread_mutex_unlock (&m->cpu_mtx);
+    }
+  pthread_mutex_unlock (&thread_masters_mtx);
 }
 
 DEFUN(clear_thread_cpu,
@@ -482,29 +599,160 @@ thread_master_debug (struct thread_master *m)
   thread_list_debug (&m->read);
   printf ("writelist : ");
   thread_list_debug (&m->write);
-  printf ("timerlist : ");
-  thread_list_debug (&m->timer);
+  printf ("timerqueue : size [%d]\n", m->timer->size);
   printf ("eventlist : ");
   thread_list_debug (&m->event);
   printf ("unuselist : ");
   thread_list_debug (&m->unuse);
-  printf ("bgndlist : ");
-  thread_list_debug (&m->background);
+  printf ("bgndqueue : size [%d]\n", m->background->size);
+  printf ("timerwheel : count [%u]\n", m->wheel->count);
   printf ("total alloc: [%ld]\n", m->alloc);
   printf ("-----------\n");
 }
 
+static int thread_msg_read (struct thread *);
+
+/* Timer queue ordering, earliest first. */
+static int
+thread_timer_cmp (void *a, void *b)
+{
+  struct thread *thread_a = a;
+  struct thread *thread_b = b;
+  long cmp = timeval_cmp (thread_a->u.sands, thread_b->u.sands);
+
+  if (cmp < 0)
+    return -1;
+  if (cmp > 0)
+    return 1;
+  return 0;
+}
+
+/* Remember where a timer sits in its queue, for thread_cancel(). */
+static void
+thread_timer_update (void *node, int actual_position)
+{
+  struct thread *thread = node;
+
+  thread->index = actual_position;
+}
+
+/* Allocate new thread master, waiting for I/O with the given method.
+ * Falls back to the next best method if the requested one is not
+ * available on this system.
+ */
+struct thread_master *
+thread_master_create_method (enum thread_io_method method)
+{
+  struct thread_master *m;
+  int i;
+
+  m = XCALLOC (MTYPE_THREAD_MASTER, sizeof (struct thread_master));
+  m->epoll_fd = -1;
+
+  m->cpu_record
+    = hash_create_size (1011, (unsigned int (*) (void *))cpu_record_hash_key, 
+                        (int (*) (const void *, const void *))cpu_record_hash_cmp);
+  pthread_mutex_init (&m->cpu_mtx, NULL);
+  pthread_mutex_lock (&thread_masters_mtx);
+  m->next = thread_masters;
+  thread_masters = m;
+  pthread_mutex_unlock (&thread_masters_mtx);
+
+  m->timer = pqueue_create ();
+  m->timer->cmp = thread_timer_cmp;
+  m->timer->update = thread_timer_update;
+  m->background = pqueue_create ();
+  m->background->cmp = thread_timer_cmp;
+  m->background->update = thread_timer_update;
+
+  m->wheel = XCALLOC (MTYPE_THREAD_MASTER, sizeof (struct thread_wheel));
+  quagga_get_relative (NULL);
+  m->wheel->now = relative_time.tv_sec;
+
+  if (method == THREAD_IO_DEFAULT)
+    {
+#if defined (HAVE_EPOLL)
+      method = THREAD_IO_EPOLL;
+#elif defined (HAVE_POLL_H)
+      method = THREAD_IO_POLL;
+#else
+      method = THREAD_IO_SELECT;
+#endif
+    }
+
+#ifdef HAVE_EPOLL
+  if (method == THREAD_IO_EPOLL)
+    {
+      if ((m->epoll_fd = epoll_create (THREAD_EPOLL_EVENTS)) < 0)
+        {
+          zlog_warn ("%s: epoll_create failed: %s, falling back to poll",
+                     __func__, safe_strerror (errno));
+          method = THREAD_IO_POLL;
+        }
+      else
+        {
+          fcntl (m->epoll_fd, F_SETFD, FD_CLOEXEC);
+          m->epoll_events = XCALLOC (MTYPE_THREAD_IO,
+                                     THREAD_EPOLL_EVENTS
+                                     * sizeof (struct epoll_event));
+        }
+    }
+#else
+  if (method == THREAD_IO_EPOLL)
+    method = THREAD_IO_POLL;
+#endif /* HAVE_EPOLL */
+
+#ifndef HAVE_POLL_H
+  if (method == THREAD_IO_POLL)
+    method = THREAD_IO_SELECT;
+#endif /* HAVE_POLL_H */
+
+  m->io_method = method;
+
+  m->owner = pthread_self ();
+  mpsc_init (&m->msgq);
+  if (pipe (m->msg_pipe) < 0)
+    {
+      zlog_err ("%s: can't create wakeup pipe: %s", __func__,
+                safe_strerror (errno));
+      m->msg_pipe[0] = m->msg_pipe[1] = -1;
+    }
+  else
+    {
+      for (i = 0; i < 2; i++)
+        {
+          fcntl (m->msg_pipe[i], F_SETFL,
+                 fcntl (m->msg_pipe[i], F_GETFL) | O_NONBLOCK);
+          fcntl (m->msg_pipe[i], F_SETFD, FD_CLOEXEC);
+        }
+      m->t_msg = thread_add_read (m, thread_msg_read, m, m->msg_pipe[0]);
+    }
+
+  return m;
+}
+
 /* Allocate new thread master.  */
 struct thread_master *
 thread_master_create ()
 {
-  if (cpu_record == NULL) 
-    cpu_record 
-      = hash_create_size (1011, (unsigned int (*) (void *))cpu_record_hash_key, 
-                          (int (*) (const void *, const void *))cpu_record_hash_cmp);
-    
-  return (struct thread_master *) XCALLOC (MTYPE_THREAD_MASTER,
-					   sizeof (struct thread_master));
+  return thread_master_create_method (THREAD_IO_DEFAULT);
+}
+
+/* Name of the I/O method in use by a thread master. */
+const char *
+thread_master_io_method (struct thread_master *m)
+{
+  switch (m->io_method)
+    {
+    case THREAD_IO_SELECT:
+      return "select";
+    case THREAD_IO_POLL:
+      return "poll";
+    case THREAD_IO_EPOLL:
+      return "epoll";
+    default:
+      return "unknown";
+    }
 }
 
 /* Add a new thread to the list.  */
@@ -521,22 +769,6 @@ thread_list_add (struct thread_list *list, struct thread *thread)
   list->count++;
 }
 
-/* Add a new thread just before the point.  */
-static void
-thread_list_add_before (struct thread_list *list, 
-			struct thread *point, 
-			struct thread *thread)
-{
-  thread->next = point;
-  thread->prev = point->prev;
-  if (point->prev)
-    point->prev->next = thread;
-  else
-    list->head = thread;
-  point->prev = thread;
-  list->count++;
-}
-
 /* Delete a thread from the list. */
 static struct thread *
 thread_list_delete (struct thread_list *list, struct thread *thread)
@@ -582,26 +814,73 @@ thread_list_free (struct thread_master *m, struct thread_list *list)
     }
 }
 
+/* Free all threads in a timer queue, and the queue itself. */
+static void
+thread_queue_free (struct thread_master *m, struct pqueue *queue)
+{
+  int i;
+
+  for (i = 0; i < queue->size; i++)
+    XFREE (MTYPE_THREAD, queue->array[i]);
+
+  m->alloc -= queue->size;
+  pqueue_delete (queue);
+}
+
 /* Stop thread scheduler. */
 void
 thread_master_free (struct thread_master *m)
 {
+  struct mpsc_node *node;
+  struct thread_master **mp;
+  int i, j;
+
+  pthread_mutex_lock (&thread_masters_mtx);
+  for (mp = &thread_masters; *mp; mp = &(*mp)->next)
+    if (*mp == m)
+      {
+	*mp = m->next;
+	break;
+      }
+  pthread_mutex_unlock (&thread_masters_mtx);
+
   thread_list_free (m, &m->read);
   thread_list_free (m, &m->write);
-  thread_list_free (m, &m->timer);
+  thread_queue_free (m, m->timer);
   thread_list_free (m, &m->event);
   thread_list_free (m, &m->ready);
   thread_list_free (m, &m->unuse);
-  thread_list_free (m, &m->background);
-  
-  XFREE (MTYPE_THREAD_MASTER, m);
-
-  if (cpu_record)
+  thread_queue_free (m, m->background);
+  for (i = 0; i < WHEEL_LEVELS; i++)
+    for (j = 0; j < WHEEL_SIZE; j++)
+      thread_list_free (m, &m->wheel->slots[i][j]);
+  XFREE (MTYPE_THREAD_MASTER, m->wheel);
+
+  if (m->fds)
+    XFREE (MTYPE_THREAD_IO, m->fds);
+  if (m->pollfds)
+    XFREE (MTYPE_THREAD_IO, m->pollfds);
+  if (m->pollfds_ready)
+    XFREE (MTYPE_THREAD_IO, m->pollfds_ready);
+  if (m->epoll_events)
+    XFREE (MTYPE_THREAD_IO, m->epoll_events);
+  if (m->epoll_fd >= 0)
+    close (m->epoll_fd);
+
+  while ((node = mpsc_pop (&m->msgq)) != NULL)
+    XFREE (MTYPE_THREAD_MSG, node);
+  if (m->msg_pipe[0] >= 0)
     {
-      hash_clean (cpu_record, cpu_record_hash_free);
-      hash_free (cpu_record);
-      cpu_record = NULL;
+      close (m->msg_pipe[0]);
+      close (m->msg_pipe[1]);
     }
+  
+
+  hash_clean (m->cpu_record, cpu_record_hash_free);
+  hash_free (m->cpu_record);
+  pthread_mutex_destroy (&m->cpu_mtx);
+  
+  XFREE (MTYPE_THREAD_MASTER, m);
 }
 
 /* Thread list is empty or not.  */
@@ -680,52 +959,243 @@ thread_get (struct thread_master *m, u_char type,
   return thread;
 }
 
-/* Add new read thread. */
-struct thread *
-funcname_thread_add_read (struct thread_master *m, 
-		 int (*func) (struct thread *), void *arg, int fd, const char* funcname)
+/* Make sure the fd index can hold fd. */
+static void
+thread_fd_grow (struct thread_master *m, int fd)
 {
-  struct thread *thread;
+  int size, i;
 
-  assert (m != NULL);
+  if (fd < m->fds_size)
+    return;
 
-  if (FD_ISSET (fd, &m->readfd))
+  for (size = m->fds_size ? m->fds_size : 64; size <= fd; size *= 2)
+    ;
+  m->fds = XREALLOC (MTYPE_THREAD_IO, m->fds, size * sizeof (struct thread_fd));
+  for (i = m->fds_size; i < size; i++)
     {
-      zlog (NULL, LOG_WARNING, "There is already read fd [%d]", fd);
-      return NULL;
+      m->fds[i].read = m->fds[i].write = NULL;
+      m->fds[i].pollidx = -1;
     }
+  m->fds_size = size;
+}
 
-  thread = thread_get (m, THREAD_READ, func, arg, funcname);
-  FD_SET (fd, &m->readfd);
-  thread->u.fd = fd;
-  thread_list_add (&m->read, thread);
+#ifdef HAVE_POLL_H
+/* Update the poll events wanted for fd, adding or removing its entry
+ * in m->pollfds as required. */
+static void
+thread_poll_update (struct thread_master *m, int fd, short events)
+{
+  struct thread_fd *tfd = &m->fds[fd];
+  int last;
 
-  return thread;
+  if (tfd->pollidx < 0)
+    {
+      if (!events)
+        return;
+      if (m->pollfds_count == m->pollfds_size)
+        {
+          m->pollfds_size = m->pollfds_size ? m->pollfds_size * 2 : 64;
+          m->pollfds = XREALLOC (MTYPE_THREAD_IO, m->pollfds,
+                                 m->pollfds_size * sizeof (struct pollfd));
+          m->pollfds_ready = XREALLOC (MTYPE_THREAD_IO, m->pollfds_ready,
+                                       m->pollfds_size * sizeof (struct pollfd));
+        }
+      tfd->pollidx = m->pollfds_count++;
+      m->pollfds[tfd->pollidx].fd = fd;
+    }
+
+  if (events)
+    {
+      m->pollfds[tfd->pollidx].events = events;
+      return;
+    }
+
+  /* Nothing left to wait for, move the last entry into the hole. */
+  last = --m->pollfds_count;
+  if (tfd->pollidx != last)
+    {
+      m->pollfds[tfd->pollidx] = m->pollfds[last];
+      m->fds[m->pollfds[last].fd].pollidx = tfd->pollidx;
+    }
+  tfd->pollidx = -1;
 }
+#endif /* HAVE_POLL_H */
 
-/* Add new write thread. */
-struct thread *
-funcname_thread_add_write (struct thread_master *m,
-		 int (*func) (struct thread *), void *arg, int fd, const char* funcname)
+#ifdef HAVE_EPOLL
+/* Tell the kernel which events are now wanted for fd. */
+static int
+thread_epoll_update (struct thread_master *m, int fd, int old, int events)
+{
+  struct epoll_event ev;
+  int op;
+
+  memset (&ev, 0, sizeof (ev));
+  ev.events = events;
+  ev.data.fd = fd;
+
+  if (!old)
+    op = EPOLL_CTL_ADD;
+  else if (events)
+    op = EPOLL_CTL_MOD;
+  else
+    op = EPOLL_CTL_DEL;
+
+  if (epoll_ctl (m->epoll_fd, op, fd, &ev) < 0)
+    {
+      /* The descriptor may have been closed before its thread was
+       * cancelled, in which case the kernel already forgot about it. */
+      if (op == EPOLL_CTL_DEL && (errno == EBADF || errno == ENOENT))
+        return 0;
+      zlog_warn ("%s: epoll_ctl fd %d: %s", __func__, fd,
+                 safe_strerror (errno));
+      return -1;
+    }
+  return 0;
+}
+#endif /* HAVE_EPOLL */
+
+/* Tell the I/O backend about a read or write thread waiting on fd.
+ * Returns -1 if the thread cannot be waited for. */
+static int
+thread_fd_set (struct thread_master *m, int fd, struct thread *thread)
+{
+  struct thread_fd *tfd;
+#ifdef HAVE_EPOLL
+  int old;
+#endif /* HAVE_EPOLL */
+
+  tfd = &m->fds[fd];
+
+  switch (m->io_method)
+    {
+    case THREAD_IO_SELECT:
+      FD_SET (fd, (thread->type == THREAD_READ) ? &m->readfd : &m->writefd);
+      break;
+#ifdef HAVE_POLL_H
+    case THREAD_IO_POLL:
+      thread_poll_update (m, fd,
+                          ((tfd->read || thread->type == THREAD_READ)
+                           ? POLLIN : 0)
+                          | ((tfd->write || thread->type == THREAD_WRITE)
+                             ? POLLOUT : 0));
+      break;
+#endif /* HAVE_POLL_H */
+#ifdef HAVE_EPOLL
+    case THREAD_IO_EPOLL:
+      old = (tfd->read ? EPOLLIN : 0) | (tfd->write ? EPOLLOUT : 0);
+      if (thread_epoll_update (m, fd, old,
+                               old | ((thread->type == THREAD_READ)
+                                      ? EPOLLIN : EPOLLOUT)) < 0)
+        return -1;
+      break;
+#endif /* HAVE_EPOLL */
+    default:
+      break;
+    }
+
+  if (thread->type == THREAD_READ)
+    tfd->read = thread;
+  else
+    tfd->write = thread;
+  return 0;
+}
+
+/* Stop waiting for fd on behalf of a read or write thread. */
+static void
+thread_fd_clear (struct thread_master *m, int fd, thread_type type)
+{
+  struct thread_fd *tfd;
+#ifdef HAVE_EPOLL
+  int old;
+#endif /* HAVE_EPOLL */
+
+  assert (fd >= 0 && fd < m->fds_size);
+  tfd = &m->fds[fd];
+#ifdef HAVE_EPOLL
+  old = (tfd->read ? EPOLLIN : 0) | (tfd->write ? EPOLLOUT : 0);
+#endif /* HAVE_EPOLL */
+
+  if (type == THREAD_READ)
+    tfd->read = NULL;
+  else
+    tfd->write = NULL;
+
+  switch (m->io_method)
+    {
+    case THREAD_IO_SELECT:
+      FD_CLR (fd, (type == THREAD_READ) ? &m->readfd : &m->writefd);
+      break;
+#ifdef HAVE_POLL_H
+    case THREAD_IO_POLL:
+      thread_poll_update (m, fd, (tfd->read ? POLLIN : 0)
+                                 | (tfd->write ? POLLOUT : 0));
+      break;
+#endif /* HAVE_POLL_H */
+#ifdef HAVE_EPOLL
+    case THREAD_IO_EPOLL:
+      thread_epoll_update (m, fd, old, (tfd->read ? EPOLLIN : 0)
+                                       | (tfd->write ? EPOLLOUT : 0));
+      break;
+#endif /* HAVE_EPOLL */
+    default:
+      break;
+    }
+}
+
+/* Common part of adding a read or write thread. */
+static struct thread *
+thread_add_fd (struct thread_master *m, u_char type,
+               int (*func) (struct thread *), void *arg, int fd,
+               const char *funcname)
 {
   struct thread *thread;
 
   assert (m != NULL);
 
-  if (FD_ISSET (fd, &m->writefd))
+  if (fd < 0 || (m->io_method == THREAD_IO_SELECT && fd >= FD_SETSIZE))
+    {
+      zlog (NULL, LOG_ERR, "Can not wait for %s fd [%d]",
+            (type == THREAD_READ) ? "read" : "write", fd);
+      return NULL;
+    }
+
+  thread_fd_grow (m, fd);
+  if ((type == THREAD_READ) ? m->fds[fd].read : m->fds[fd].write)
     {
-      zlog (NULL, LOG_WARNING, "There is already write fd [%d]", fd);
+      zlog (NULL, LOG_WARNING, "There is already %s fd [%d]",
+            (type == THREAD_READ) ? "read" : "write", fd);
       return NULL;
     }
 
-  thread = thread_get (m, THREAD_WRITE, func, arg, funcname);
-  FD_SET (fd, &m->writefd);
+  thread = thread_get (m, type, func, arg, funcname);
   thread->u.fd = fd;
-  thread_list_add (&m->write, thread);
+  if (thread_fd_set (m, fd, thread) < 0)
+    {
+      thread->type = THREAD_UNUSED;
+      thread_add_unuse (m, thread);
+      return NULL;
+    }
+  thread_list_add ((type == THREAD_READ) ? &m->read : &m->write, thread);
 
   return thread;
 }
 
+/* Add new read thread. */
+struct thread *
+funcname_thread_add_read (struct thread_master *m, 
+		 int (*func) (struct thread *), void *arg, int fd, const char* funcname)
+{
+  return thread_add_fd (m, THREAD_READ, func, arg, fd, funcname);
+}
+
+/* Add new write thread. */
+struct thread *
+funcname_thread_add_write (struct thread_master *m,
+		 int (*func) (struct thread *), void *arg, int fd, const char* funcname)
+{
+  return thread_add_fd (m, THREAD_WRITE, func, arg, fd, funcname);
+}
+
 static struct thread *
 funcname_thread_add_timer_timeval (struct thread_master *m,
                                    int (*func) (struct thread *), 
@@ -735,16 +1205,15 @@ funcname_thread_add_timer_timeval (struct thread_master *m,
                                   const char* funcname)
 {
   struct thread *thread;
-  struct thread_list *list;
+  struct pqueue *queue;
   struct timeval alarm_time;
-  struct thread *tt;
 
   assert (m != NULL);
 
   assert (type == THREAD_TIMER || type == THREAD_BACKGROUND);
   assert (time_relative);
   
-  list = ((type == THREAD_TIMER) ? &m->timer : &m->background);
+  queue = ((type == THREAD_TIMER) ? m->timer : m->background);
   thread = thread_get (m, type, func, arg, funcname);
 
   /* Do we need jitter here? */
@@ -753,16 +1222,7 @@ funcname_thread_add_timer_timeval (struct thread_master *m,
   alarm_time.tv_usec = relative_time.tv_usec + time_relative->tv_usec;
   thread->u.sands = timeval_adjust(alarm_time);
 
-  /* Sort by timeval. */
-  for (tt = list->head; tt; tt = tt->next)
-    if (timeval_cmp (thread->u.sands, tt->u.sands) <= 0)
-      break;
-
-  if (tt)
-    thread_list_add_before (list, tt, thread);
-  else
-    thread_list_add (list, thread);
-
+  pqueue_enqueue (thread, queue);
   return thread;
 }
 
@@ -801,6 +1261,144 @@ funcname_thread_add_timer_msec (struct thread_master *m,
                                             arg, &trel, funcname);
 }
 
+/* File a coarse timer into the wheel slot for its expiry tick. */
+static void
+thread_wheel_add (struct thread_wheel *wheel, struct thread *thread)
+{
+  time_t expire = thread->u.sands.tv_sec;
+  int level, slot;
+
+  if (expire < wheel->now)
+    expire = wheel->now;
+
+  for (level = 0; level < WHEEL_LEVELS - 1; level++)
+    if (expire - wheel->now < WHEEL_SPAN (level + 1))
+      break;
+
+  /* Beyond the reach of the top level, park it in the furthest slot.
+   * It is filed again when that slot is cascaded. */
+  if (expire - wheel->now >= WHEEL_SPAN (WHEEL_LEVELS))
+    expire = wheel->now + WHEEL_SPAN (WHEEL_LEVELS) - 1;
+
+  slot = (expire >> (WHEEL_BITS * level)) & WHEEL_MASK;
+  thread->index = level * WHEEL_SIZE + slot;
+  thread_list_add (&wheel->slots[level][slot], thread);
+  wheel->count++;
+}
+
+/* Refile the timers of the current slot of a level into lower levels. */
+static void
+thread_wheel_cascade (struct thread_wheel *wheel, int level)
+{
+  struct thread_list *slot;
+  struct thread_list list;
+  struct thread *thread;
+
+  slot = &wheel->slots[level][(wheel->now >> (WHEEL_BITS * level))
+                              & WHEEL_MASK];
+  list = *slot;
+  memset (slot, 0, sizeof (struct thread_list));
+
+  while ((thread = thread_trim_head (&list)) != NULL)
+    {
+      wheel->count--;
+      thread_wheel_add (wheel, thread);
+    }
+}
+
+/* Turn the wheel up to and including tick now, moving expired coarse
+ * timers to the ready list. */
+static unsigned int
+thread_wheel_process (struct thread_master *m, time_t now)
+{
+  struct thread_wheel *wheel = m->wheel;
+  struct thread *thread;
+  unsigned int ready = 0;
+  int level;
+
+  while (wheel->count && wheel->now <= now)
+    {
+      if (!(wheel->now & WHEEL_MASK))
+        for (level = 1; level < WHEEL_LEVELS; level++)
+          {
+            thread_wheel_cascade (wheel, level);
+            if ((wheel->now >> (WHEEL_BITS * level)) & WHEEL_MASK)
+              break;
+          }
+
+      while ((thread = thread_trim_head (&wheel->slots[0][wheel->now
+                                                         & WHEEL_MASK])))
+        {
+          wheel->count--;
+          thread->type = THREAD_READY;
+          thread_list_add (&m->ready, thread);
+          ready++;
+        }
+      wheel->now++;
+    }
+
+  /* Nothing left to expire in the ticks up to now, skip them. */
+  if (!wheel->count && wheel->now <= now)
+    wheel->now = now + 1;
+
+  return ready;
+}
+
+/* Time until the wheel next needs turning, i.e. the next non-empty
+ * level 0 slot or the next cascade, whichever is sooner. */
+static struct timeval *
+thread_wheel_wait (struct thread_wheel *wheel, struct timeval *timer_val)
+{
+  time_t tick = wheel->now;
+  int i;
+
+  if (!wheel->count)
+    return NULL;
+
+  for (i = 0; i < WHEEL_SIZE; i++)
+    {
+      tick = wheel->now + i;
+      if (i && !(tick & WHEEL_MASK))
+        break;
+      if (wheel->slots[0][tick & WHEEL_MASK].head)
+        break;
+    }
+
+  timer_val->tv_sec = tick;
+  timer_val->tv_usec = 0;
+  *timer_val = timeval_subtract (*timer_val, relative_time);
+  return timer_val;
+}
+
+/* Add timer event thread with one second resolution.  It may run up
+ * to a second late, but is far cheaper than a normal timer to add and
+ * cancel when there are very many of them, e.g. per route timers. */
+struct thread *
+funcname_thread_add_timer_coarse (struct thread_master *m,
+                                  int (*func) (struct thread *),
+                                  void *arg, long timer, const char* funcname)
+{
+  struct thread *thread;
+
+  assert (m != NULL);
+
+  thread = thread_get (m, THREAD_TIMER_COARSE, func, arg, funcname);
+  thread->add_type = THREAD_TIMER;
+
+  quagga_get_relative (NULL);
+  if (!m->wheel->count && m->wheel->now < relative_time.tv_sec)
+    m->wheel->now = relative_time.tv_sec;
+
+  /* Round up, so that the timer never runs early. */
+  thread->u.sands.tv_sec = relative_time.tv_sec + timer;
+  if (timer > 0 && relative_time.tv_usec)
+    thread->u.sands.tv_sec++;
+  thread->u.sands.tv_usec = 0;
+
+  thread_wheel_add (m->wheel, thread);
+  return thread;
+}
+
 /* Add a background thread, with an optional millisec delay */
 struct thread *
 funcname_thread_add_background (struct thread_master *m,
@@ -847,22 +1445,29 @@ funcname_thread_add_event (struct thread_master *m,
 void
 thread_cancel (struct thread *thread)
 {
-  struct thread_list *list;
+  struct thread_list *list = NULL;
+  struct pqueue *queue = NULL;
   
   switch (thread->type)
     {
     case THREAD_READ:
-      assert (FD_ISSET (thread->u.fd, &thread->master->readfd));
-      FD_CLR (thread->u.fd, &thread->master->readfd);
+      assert (thread->master->fds[thread->u.fd].read == thread);
+      thread_fd_clear (thread->master, thread->u.fd, THREAD_READ);
       list = &thread->master->read;
       break;
     case THREAD_WRITE:
-      assert (FD_ISSET (thread->u.fd, &thread->master->writefd));
-      FD_CLR (thread->u.fd, &thread->master->writefd);
+      assert (thread->master->fds[thread->u.fd].write == thread);
+      thread_fd_clear (thread->master, thread->u.fd, THREAD_WRITE);
       list = &thread->master->write;
       break;
     case THREAD_TIMER:
-      list = &thread->master->timer;
+      queue = thread->master->timer;
+      break;
+    case THREAD_TIMER_COARSE:
+      assert (thread->index >= 0 && thread->index < WHEEL_LEVELS * WHEEL_SIZE);
+      list = &thread->master->wheel->slots[thread->index / WHEEL_SIZE]
+                                          [thread->index % WHEEL_SIZE];
+      thread->master->wheel->count--;
       break;
     case THREAD_EVENT:
       list = &thread->master->event;
@@ -871,13 +1476,21 @@ thread_cancel (struct thread *thread)
       list = &thread->master->ready;
       break;
     case THREAD_BACKGROUND:
-      list = &thread->master->background;
+      queue = thread->master->background;
       break;
     default:
       return;
       break;
     }
-  thread_list_delete (list, thread);
+
+  if (queue)
+    {
+      assert (thread->index >= 0 && thread->index < queue->size);
+      assert (thread == queue->array[thread->index]);
+      pqueue_remove_at (thread->index, queue);
+    }
+  else
+    thread_list_delete (list, thread);
   thread->type = THREAD_UNUSED;
   thread_add_unuse (thread->master, thread);
 }
@@ -926,12 +1539,159 @@ thread_cancel_event (struct thread_master *m, void *arg)
   return ret;
 }
 
+/* Hand requests posted by other pthreads to the owning thread master. */
+static int
+thread_msg_read (struct thread *thread)
+{
+  struct thread_master *m = THREAD_ARG (thread);
+  struct thread_msg *msg;
+  char buf[64];
+
+  m->t_msg = NULL;
+  while (read (m->msg_pipe[0], buf, sizeof (buf)) > 0)
+    ;
+  __atomic_store_n (&m->msg_pending, 0, __ATOMIC_SEQ_CST);
+
+  while ((msg = (struct thread_msg *) mpsc_pop (&m->msgq)) != NULL)
+    {
+      if (msg->func)
+        funcname_thread_add_event (m, msg->func, msg->arg, msg->val,
+                                   msg->funcname);
+      else
+        thread_cancel_event (m, msg->arg);
+      XFREE (MTYPE_THREAD_MSG, msg);
+    }
+
+  m->t_msg = thread_add_read (m, thread_msg_read, m, m->msg_pipe[0]);
+  return 0;
+}
+
+/* Queue a request for the pthread running m, and wake it up unless
+ * that has already been done for an earlier request. */
+static void
+thread_msg_post (struct thread_master *m, struct thread_msg *msg)
+{
+  mpsc_push (&m->msgq, &msg->node);
+
+  if (!__atomic_exchange_n (&m->msg_pending, 1, __ATOMIC_SEQ_CST))
+    {
+      /* If the pipe is full the owner has a wakeup coming anyway. */
+      if (write (m->msg_pipe[1], "", 1) < 0 && errno != EAGAIN)
+        zlog_warn ("%s: wakeup write failed: %s", __func__,
+                   safe_strerror (errno));
+    }
+}
+
+/* Add an event to a thread master which may be running in another
+ * pthread, see thread_master_start().  Safe to call from any pthread. */
+int
+funcname_thread_add_event_mt (struct thread_master *m,
+                              int (*func) (struct thread *), void *arg,
+                              int val, const char* funcname)
+{
+  struct thread_msg *msg;
+
+  assert (m != NULL);
+
+  if (pthread_equal (pthread_self (), m->owner))
+    return funcname_thread_add_event (m, func, arg, val, funcname) ? 0 : -1;
+
+  msg = XCALLOC (MTYPE_THREAD_MSG, sizeof (struct thread_msg));
+  msg->func = func;
+  msg->arg = arg;
+  msg->val = val;
+  msg->funcname = funcname;
+  thread_msg_post (m, msg);
+  return 0;
+}
+
+/* thread_cancel_event() for a thread master which may be running in
+ * another pthread.  Events for arg added by earlier calls to
+ * thread_add_event_mt() from the same pthread are cancelled too. */
+void
+thread_cancel_event_mt (struct thread_master *m, void *arg)
+{
+  struct thread_msg *msg;
+
+  if (pthread_equal (pthread_self (), m->owner))
+    {
+      thread_cancel_event (m, arg);
+      return;
+    }
+
+  msg = XCALLOC (MTYPE_THREAD_MSG, sizeof (struct thread_msg));
+  msg->arg = arg;
+  thread_msg_post (m, msg);
+}
+
+static void *
+thread_master_run (void *arg)
+{
+  struct thread_master *m = arg;
+  struct thread thread;
+
+  while (!m->stop && thread_fetch (m, &thread))
+    thread_call (&thread);
+  return NULL;
+}
+
+/* Run a thread master in a new pthread of its own.  Other pthreads
+ * must then only use the _mt functions on it, until it is stopped.
+ * Signals are left to the pthread running the main thread master. */
+int
+thread_master_start (struct thread_master *m)
+{
+  sigset_t all, old;
+  int ret;
+
+  m->stop = 0;
+  m->started = 1;
+
+  sigfillset (&all);
+  pthread_sigmask (SIG_BLOCK, &all, &old);
+  ret = pthread_create (&m->owner, NULL, thread_master_run, m);
+  pthread_sigmask (SIG_SETMASK, &old, NULL);
+
+  if (ret)
+    {
+      zlog_err ("%s: pthread_create failed: %s", __func__,
+                safe_strerror (ret));
+      m->owner = pthread_self ();
+      m->started = 0;
+      return -1;
+    }
+  return 0;
+}
+
+static int
+thread_master_stop_event (struct thread *thread)
+{
+  struct thread_master *m = THREAD_ARG (thread);
+
+  m->stop = 1;
+  return 0;
+}
+
+/* Stop a thread master started with thread_master_start(), and wait
+ * for its pthread to exit.  It then belongs to the calling pthread. */
+void
+thread_master_stop (struct thread_master *m)
+{
+  assert (m->started);
+
+  thread_add_event_mt (m, thread_master_stop_event, m, 0);
+  pthread_join (m->owner, NULL);
+  m->owner = pthread_self ();
+  m->started = 0;
+}
+
 static struct timeval *
-thread_timer_wait (struct thread_list *tlist, struct timeval *timer_val)
+thread_timer_wait (struct pqueue *queue, struct timeval *timer_val)
 {
-  if (!thread_empty (tlist))
+  if (queue->size)
     {
-      *timer_val = timeval_subtract (tlist->head->u.sands, relative_time);
+      struct thread *next_timer = queue->array[0];
+      *timer_val = timeval_subtract (next_timer->u.sands, relative_time);
       return timer_val;
     }
   return NULL;
@@ -947,6 +1707,17 @@ thread_run (struct thread_master *m, struct thread *thread,
   return fetch;
 }
 
+/* Move a read or write thread whose fd became ready to the ready list. */
+static void
+thread_fd_ready (struct thread_master *m, struct thread *thread)
+{
+  thread_fd_clear (m, THREAD_FD (thread), thread->type);
+  thread_list_delete ((thread->type == THREAD_READ) ? &m->read : &m->write,
+                      thread);
+  thread_list_add (&m->ready, thread);
+  thread->type = THREAD_READY;
+}
+
 static int
 thread_process_fd (struct thread_list *list, fd_set *fdset, fd_set *mfdset)
 {
@@ -963,30 +1734,127 @@ thread_process_fd (struct thread_list *list, fd_set *fdset, fd_set *mfdset)
       if (FD_ISSET (THREAD_FD (thread), fdset))
         {
           assert (FD_ISSET (THREAD_FD (thread), mfdset));
-          FD_CLR(THREAD_FD (thread), mfdset);
-          thread_list_delete (list, thread);
-          thread_list_add (&thread->master->ready, thread);
-          thread->type = THREAD_READY;
+          thread_fd_ready (thread->master, thread);
           ready++;
         }
     }
   return ready;
 }
 
+/* Convert a select() style timeout into milliseconds for poll() and
+ * epoll_wait(), rounding up so that we don't wake before the timer. */
+static int
+thread_timer_wait_msec (struct timeval *timer_wait)
+{
+  if (!timer_wait)
+    return -1;
+  return timer_wait->tv_sec * 1000 + (timer_wait->tv_usec + 999) / 1000;
+}
+
+/* Wait for I/O with poll() or epoll_wait().  Returns the number of
+ * ready entries to hand to thread_io_process(), or -1 on error. */
+static int
+thread_io_wait (struct thread_master *m, struct timeval *timer_wait)
+{
+  switch (m->io_method)
+    {
+#ifdef HAVE_POLL_H
+    case THREAD_IO_POLL:
+      /* poll() writes revents, and ready threads are removed from
+       * m->pollfds while we process them, hence the copy. */
+      if (m->pollfds_count)
+        memcpy (m->pollfds_ready, m->pollfds,
+                m->pollfds_count * sizeof (struct pollfd));
+      return poll (m->pollfds_ready, m->pollfds_count,
+                   thread_timer_wait_msec (timer_wait));
+#endif /* HAVE_POLL_H */
+#ifdef HAVE_EPOLL
+    case THREAD_IO_EPOLL:
+      return epoll_wait (m->epoll_fd, m->epoll_events, THREAD_EPOLL_EVENTS,
+                         thread_timer_wait_msec (timer_wait));
+#endif /* HAVE_EPOLL */
+    default:
+      errno = EINVAL;
+      return -1;
+    }
+}
+
+/* Add the read and write threads of descriptors reported by
+ * thread_io_wait() to the ready list.  Errors and hangups make both
+ * directions ready, so the thread notices them on its next read or
+ * write, as with select(). */
+static int
+thread_io_process (struct thread_master *m, int num)
+{
+  int i, fd;
+  int ready = 0;
+
+  switch (m->io_method)
+    {
+#ifdef HAVE_POLL_H
+    case THREAD_IO_POLL:
+      for (i = 0; num > 0 && i < m->pollfds_count; i++)
+        {
+          struct pollfd *pfd = &m->pollfds_ready[i];
+
+          if (!pfd->revents)
+            continue;
+          num--;
+          fd = pfd->fd;
+          if ((pfd->revents & (POLLIN|POLLERR|POLLHUP|POLLNVAL))
+              && m->fds[fd].read)
+            {
+              thread_fd_ready (m, m->fds[fd].read);
+              ready++;
+            }
+          if ((pfd->revents & (POLLOUT|POLLERR|POLLHUP|POLLNVAL))
+              && m->fds[fd].write)
+            {
+              thread_fd_ready (m, m->fds[fd].write);
+              ready++;
+            }
+        }
+      break;
+#endif /* HAVE_POLL_H */
+#ifdef HAVE_EPOLL
+    case THREAD_IO_EPOLL:
+      for (i = 0; i < num; i++)
+        {
+          struct epoll_event *ev = &m->epoll_events[i];
+
+          fd = ev->data.fd;
+          if ((ev->events & (EPOLLIN|EPOLLERR|EPOLLHUP)) && m->fds[fd].read)
+            {
+              thread_fd_ready (m, m->fds[fd].read);
+              ready++;
+            }
+          if ((ev->events & (EPOLLOUT|EPOLLERR|EPOLLHUP)) && m->fds[fd].write)
+            {
+              thread_fd_ready (m, m->fds[fd].write);
+              ready++;
+            }
+        }
+      break;
+#endif /* HAVE_EPOLL */
+    default:
+      break;
+    }
+  return ready;
+}
+
 /* Add all timers that have popped to the ready list. */
 static unsigned int
-thread_timer_process (struct thread_list *list, struct timeval *timenow)
+thread_timer_process (struct pqueue *queue, struct timeval *timenow)
 {
   struct thread *thread;
-  struct thread *next;
   unsigned int ready = 0;
   
-  for (thread = list->head; thread; thread = next)
+  while (queue->size)
     {
-      next = thread->next;
+      thread = queue->array[0];
       if (timeval_cmp (*timenow, thread->u.sands) < 0)
         return ready;
-      thread_list_delete (list, thread);
+      pqueue_dequeue (queue);
       thread->type = THREAD_READY;
       thread_list_add (&thread->master->ready, thread);
       ready++;
@@ -1024,15 +1892,18 @@ thread_fetch (struct thread_master *m, struct thread *fetch)
   fd_set exceptfd;
   struct timeval timer_val = { .tv_sec = 0, .tv_usec = 0 };
   struct timeval timer_val_bg;
+  struct timeval timer_val_wheel;
   struct timeval *timer_wait = &timer_val;
   struct timeval *timer_wait_bg;
+  struct timeval *timer_wait_wheel;
 
   while (1)
     {
       int num = 0;
       
       /* Signals pre-empt everything */
-      quagga_sigevent_process ();
+      if (!m->started)
+        quagga_sigevent_process ();
        
       /* Drain the ready queue of already scheduled jobs, before scheduling
        * more.
@@ -1048,31 +1919,42 @@ thread_fetch (struct thread_master *m, struct thread *fetch)
       /* Normal event are the next highest priority.  */
       thread_process (&m->event);
       
-      /* Structure copy.  */
-      readfd = m->readfd;
-      writefd = m->writefd;
-      exceptfd = m->exceptfd;
-      
       /* Calculate select wait timer if nothing else to do */
       if (m->ready.count == 0)
         {
           quagga_get_relative (NULL);
-          timer_wait = thread_timer_wait (&m->timer, &timer_val);
-          timer_wait_bg = thread_timer_wait (&m->background, &timer_val_bg);
+          timer_wait = thread_timer_wait (m->timer, &timer_val);
+          timer_wait_bg = thread_timer_wait (m->background, &timer_val_bg);
+          
+          timer_wait_wheel = thread_wheel_wait (m->wheel, &timer_val_wheel);
           
           if (timer_wait_bg &&
               (!timer_wait || (timeval_cmp (*timer_wait, *timer_wait_bg) > 0)))
             timer_wait = timer_wait_bg;
+          if (timer_wait_wheel &&
+              (!timer_wait || (timeval_cmp (*timer_wait, *timer_wait_wheel) > 0)))
+            timer_wait = timer_wait_wheel;
         }
       
-      num = select (FD_SETSIZE, &readfd, &writefd, &exceptfd, timer_wait);
+      if (m->io_method == THREAD_IO_SELECT)
+        {
+          /* Structure copy.  */
+          readfd = m->readfd;
+          writefd = m->writefd;
+          exceptfd = m->exceptfd;
+
+          num = select (FD_SETSIZE, &readfd, &writefd, &exceptfd, timer_wait);
+        }
+      else
+        num = thread_io_wait (m, timer_wait);
       
       /* Signals should get quick treatment */
       if (num < 0)
         {
           if (errno == EINTR)
             continue; /* signal received - process it */
-          zlog_warn ("select() error: %s", safe_strerror (errno));
+          zlog_warn ("%s() error: %s", thread_master_io_method (m),
+                     safe_strerror (errno));
             return NULL;
         }
 
@@ -1080,10 +1962,13 @@ thread_fetch (struct thread_master *m, struct thread *fetch)
          priority than I/O threads, so let's push them onto the ready
 	 list in front of the I/O threads. */
       quagga_get_relative (NULL);
-      thread_timer_process (&m->timer, &relative_time);
+      thread_timer_process (m->timer, &relative_time);
+      thread_wheel_process (m, relative_time.tv_sec);
       
       /* Got IO, process it */
-      if (num > 0)
+      if (num > 0 && m->io_method != THREAD_IO_SELECT)
+        thread_io_process (m, num);
+      else if (num > 0)
         {
           /* Normal priority read thead. */
           thread_process_fd (&m->read, &readfd, &m->readfd);
@@ -1101,7 +1986,7 @@ thread_fetch (struct thread_master *m, struct thread *fetch)
 #endif
 
       /* Background timer/events, lowest priority */
-      thread_timer_process (&m->background, &relative_time);
+      thread_timer_process (m->background, &relative_time);
       
       if ((thread = thread_trim_head (&m->ready)) != NULL)
         return thread_run (m, thread, fetch);
@@ -1165,31 +2050,41 @@ thread_call (struct thread *thread)
   unsigned long realtime, cputime;
   RUSAGE_T before, after;
 
- /* Cache a pointer to the relevant cpu history thread, if the thread
-  * does not have it yet.
-  *
-  * Callers submitting 'dummy threads' hence must take care that
-  * thread->cpu is NULL
-  */
+  GETRUSAGE (&before);
+  thread->real = before.real;
+
+  (*thread->func) (thread);
+
+  GETRUSAGE (&after);
+
+  realtime = thread_consumed_time (&after, &before, &cputime);
+
+  /* Cache a pointer to the relevant cpu history thread, if the thread
+   * does not have it yet.  The statistics are the master's own, and
+   * only this pthread changes the hash, so only adding to it has to
+   * be kept from "show thread cpu" looking at it.
+   *
+   * Callers submitting 'dummy threads' hence must take care that
+   * thread->cpu is NULL
+   */
   if (!thread->hist)
     {
       struct cpu_thread_history tmp;
+      struct thread_master *m = thread->master;
       
       tmp.func = thread->func;
       strcpy(tmp.funcname, thread->funcname);
       
-      thread->hist = hash_get (cpu_record, &tmp, 
-                    (void * (*) (void *))cpu_record_hash_alloc);
+      thread->hist = hash_lookup (m->cpu_record, &tmp);
+      if (!thread->hist)
+	{
+	  pthread_mutex_lock (&m->cpu_mtx);
+	  thread->hist = hash_get (m->cpu_record, &tmp, 
+				   (void * (*) (void *))cpu_record_hash_alloc);
+	  pthread_mutex_unlock (&m->cpu_mtx);
+	}
     }
 
-  GETRUSAGE (&before);
-  thread->real = before.real;
-
-  (*thread->func) (thread);
-
-  GETRUSAGE (&after);
-
-  realtime = thread_consumed_time (&after, &before, &cputime);
   thread->hist->real.total += realtime;
   if (thread->hist->real.max < realtime)
     thread->hist->real.max = realtime;
@@ -24,6 +24,9 @@
 #define _ZEBRA_THREAD_H
 
 #include <zebra.h>
+#include <pthread.h>
+
+#include "mpsc.h"
 
 struct rusage_t
 {
@@ -44,20 +47,57 @@ struct thread_list
   int count;
 };
 
+/* Mechanism used by thread_fetch() to wait for file descriptors. */
+enum thread_io_method
+{
+  THREAD_IO_DEFAULT = 0,	/* best available, chosen at build time */
+  THREAD_IO_SELECT,
+  THREAD_IO_POLL,
+  THREAD_IO_EPOLL,
+};
+
 /* Master of the theads. */
 struct thread_master
 {
   struct thread_list read;
   struct thread_list write;
-  struct thread_list timer;
+  struct pqueue *timer;
   struct thread_list event;
   struct thread_list ready;
   struct thread_list unuse;
-  struct thread_list background;
+  struct pqueue *background;
+  struct thread_wheel *wheel;	/* coarse timers */
   fd_set readfd;
   fd_set writefd;
   fd_set exceptfd;
   unsigned long alloc;
+
+  /* I/O backend, see thread_master_create_method(). */
+  enum thread_io_method io_method;
+  struct thread_fd *fds;	/* read/write threads, indexed by fd */
+  int fds_size;
+  struct pollfd *pollfds;	/* poll: registered descriptors */
+  struct pollfd *pollfds_ready;	/* poll: copy handed to poll() */
+  int pollfds_count;
+  int pollfds_size;
+  int epoll_fd;			/* epoll: instance descriptor */
+  struct epoll_event *epoll_events;
+
+  /* Requests from other pthreads, see thread_add_event_mt(). */
+  pthread_t owner;		/* pthread running this master */
+  struct mpsc_queue msgq;
+  int msg_pending;		/* wakeup pipe already written to */
+  int msg_pipe[2];
+  struct thread *t_msg;
+  int started;			/* running in a pthread of its own */
+  int stop;			/* thread_master_stop() requested */
+
+  /* CPU statistics of what this master has run.  Entries are added by
+     the owner alone, under cpu_mtx, so that "show thread cpu" can
+     merge those of all masters. */
+  struct hash *cpu_record;
+  pthread_mutex_t cpu_mtx;
+  struct thread_master *next;	/* in the list of all masters */
 };
 
 typedef unsigned char thread_type;
@@ -80,6 +120,7 @@ struct thread
     int fd;			/* file descriptor in case of read/write. */
     struct timeval sands;	/* rest of time sands value. */
   } u;
+  int index;			/* position in timer queue or wheel */
   struct timeval real;
   struct cpu_thread_history *hist; /* cache pointer to cpu_history */
   char funcname[FUNCNAME_LEN];
@@ -116,6 +157,7 @@ enum quagga_clkid {
 #define THREAD_BACKGROUND     5
 #define THREAD_UNUSED         6
 #define THREAD_EXECUTE        7
+#define THREAD_TIMER_COARSE   8
 
 /* Thread yield time.  */
 #define THREAD_YIELD_TIME_SLOT     10 * 1000L /* 10ms */
@@ -149,6 +191,12 @@ enum quagga_clkid {
       thread = thread_add_timer_msec (master, func, arg, time); \
   } while (0)
 
+#define THREAD_TIMER_COARSE_ON(master,thread,func,arg,time) \
+  do { \
+    if (! thread) \
+      thread = thread_add_timer_coarse (master, func, arg, time); \
+  } while (0)
+
 #define THREAD_OFF(thread) \
   do { \
     if (thread) \
@@ -166,7 +214,9 @@ enum quagga_clkid {
 #define thread_add_write(m,f,a,v) funcname_thread_add_write(m,f,a,v,#f)
 #define thread_add_timer(m,f,a,v) funcname_thread_add_timer(m,f,a,v,#f)
 #define thread_add_timer_msec(m,f,a,v) funcname_thread_add_timer_msec(m,f,a,v,#f)
+#define thread_add_timer_coarse(m,f,a,v) funcname_thread_add_timer_coarse(m,f,a,v,#f)
 #define thread_add_event(m,f,a,v) funcname_thread_add_event(m,f,a,v,#f)
+#define thread_add_event_mt(m,f,a,v) funcname_thread_add_event_mt(m,f,a,v,#f)
 #define thread_execute(m,f,a,v) funcname_thread_execute(m,f,a,v,#f)
 
 /* The 4th arg to thread_add_background is the # of milliseconds to delay. */
@@ -174,6 +224,8 @@ enum quagga_clkid {
 
 /* Prototypes. */
 extern struct thread_master *thread_master_create (void);
+extern struct thread_master *thread_master_create_method (enum thread_io_method);
+extern const char *thread_master_io_method (struct thread_master *);
 extern void thread_master_free (struct thread_master *);
 
 extern struct thread *funcname_thread_add_read (struct thread_master *, 
@@ -188,9 +240,15 @@ extern struct thread *funcname_thread_add_timer (struct thread_master *,
 extern struct thread *funcname_thread_add_timer_msec (struct thread_master *,
 				                      int (*)(struct thread *),
 				                      void *, long, const char*);
+extern struct thread *funcname_thread_add_timer_coarse (struct thread_master *,
+				                        int (*)(struct thread *),
+				                        void *, long, const char*);
 extern struct thread *funcname_thread_add_event (struct thread_master *,
 				                 int (*)(struct thread *),
 				                 void *, int, const char*);
+extern int funcname_thread_add_event_mt (struct thread_master *,
+				         int (*)(struct thread *),
+				         void *, int, const char*);
 extern struct thread *funcname_thread_add_background (struct thread_master *,
                                                int (*func)(struct thread *),
 				               void *arg,
@@ -201,6 +259,9 @@ extern struct thread *funcname_thread_execute (struct thread_master *,
                                                void *, int, const char *);
 extern void thread_cancel (struct thread *);
 extern unsigned int thread_cancel_event (struct thread_master *, void *);
+extern void thread_cancel_event_mt (struct thread_master *, void *);
+extern int thread_master_start (struct thread_master *);
+extern void thread_master_stop (struct thread_master *);
 extern struct thread *thread_fetch (struct thread_master *, struct thread *);
 extern void thread_call (struct thread *);
 extern unsigned long thread_timer_remain_second (struct thread *);
@@ -224,8 +285,9 @@ extern unsigned long thread_consumed_time(RUSAGE_T *after, RUSAGE_T *before,
 
 /* Global variable containing a recent result from gettimeofday.  This can
    be used instead of calling gettimeofday if a recent value is sufficient.
-   This is guaranteed to be refreshed before a thread is called. */
-extern struct timeval recent_time;
+   This is guaranteed to be refreshed before a thread is called.  Each
+   pthread has its own copy. */
+extern __thread struct timeval recent_time;
 /* Similar to recent_time, but a monotonically increasing time value */
 extern struct timeval recent_relative_time (void);
 #endif /* _ZEBRA_THREAD_H */
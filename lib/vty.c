@@ -33,6 +33,8 @@
 #include "log.h"
 #include "prefix.h"
 #include "filter.h"
+#include "plist.h"
+#include "routemap.h"
 #include "vty.h"
 #include "privs.h"
 #include "network.h"
@@ -151,6 +153,72 @@ vty_out (struct vty *vty, const char *format, ...)
   return len;
 }
 
+/* Outputs the string as a JSON string, in quotes and escaped. */
+void
+vty_out_json_string (struct vty *vty, const char *str)
+{
+  char buf[VTY_BUFSIZ];
+  size_t len = 0;
+
+  buf[len++] = '"';
+  for (; *str; str++)
+    {
+      /* Room for an escape and the closing quote. */
+      if (len > sizeof (buf) - 8)
+	{
+	  buf[len] = '\0';
+	  vty_out (vty, "%s", buf);
+	  len = 0;
+	}
+
+      if (*str == '"' || *str == '\\')
+	{
+	  buf[len++] = '\\';
+	  buf[len++] = *str;
+	}
+      else if ((u_char) *str < 0x20)
+	len += sprintf (buf + len, "\\u%04x", (u_char) *str);
+      else
+	buf[len++] = *str;
+    }
+  buf[len++] = '"';
+  buf[len] = '\0';
+  vty_out (vty, "%s", buf);
+}
+
+/* Binary output is framed, each frame a 4 byte length in network byte
+   order followed by that many bytes, and ends with a frame of length 0.
+   vtysh takes NULs as the end of the output, so it cannot be given
+   there. */
+int
+vty_binary_ok (struct vty *vty)
+{
+  if (vty->type == VTY_SHELL || vty->type == VTY_SHELL_SERV)
+    {
+      vty_out (vty, "%% Binary output is not available through vtysh%s",
+	       VTY_NEWLINE);
+      return 0;
+    }
+  return 1;
+}
+
+void
+vty_out_binary (struct vty *vty, const void *data, size_t size)
+{
+  u_int32_t len = htonl (size);
+
+  buffer_put (vty->obuf, &len, sizeof (len));
+  buffer_put (vty->obuf, data, size);
+}
+
+void
+vty_out_binary_end (struct vty *vty)
+{
+  u_int32_t len = 0;
+
+  buffer_put (vty->obuf, &len, sizeof (len));
+}
+
 static int
 vty_log_out (struct vty *vty, const char *level, const char *proto_str,
 	     const char *format, struct timestamp_control *ctl, va_list va)
@@ -327,6 +395,59 @@ vty_new ()
   return new;
 }
 
+/* Done with the output of the command giving it a piece at a time. */
+static void
+vty_output_end (struct vty *vty)
+{
+  if (vty->output_free)
+    (*vty->output_free) (vty->output_arg);
+  vty->output = NULL;
+  vty->output_free = NULL;
+  vty->output_arg = NULL;
+}
+
+/* Has the command give pieces of its output until there are want bytes
+   to write or it is done, then puts what vty_execute () and vtysh_read ()
+   held back for the end after it. */
+static void
+vty_output_run (struct vty *vty, size_t want)
+{
+  u_char header[4] = {0, 0, 0, 0};
+
+  while (vty->output && buffer_pending (vty->obuf) < want)
+    if (! (*vty->output) (vty, vty->output_arg))
+      {
+	vty_output_end (vty);
+	if (vty->type == VTY_SHELL_SERV)
+	  {
+	    header[3] = vty->output_ret;
+	    buffer_put (vty->obuf, header, 4);
+	  }
+	else
+	  vty_prompt (vty);
+      }
+}
+
+void
+vty_output_set (struct vty *vty, int (*func) (struct vty *, void *),
+		void (*free_func) (void *), void *arg)
+{
+  vty->output = func;
+  vty->output_free = free_func;
+  vty->output_arg = arg;
+
+  /* Only the vtys of connections are written as the socket takes it,
+     the rest get all of it now. */
+  if (vty->type == VTY_SHELL_SERV
+      || (vty->type == VTY_TERM && vtyvec
+	  && vector_lookup (vtyvec, vty->fd) == vty))
+    return;
+
+  while ((*func) (vty, arg))
+    ;
+  vty_output_end (vty);
+}
+
 /* Authentication of vty */
 static void
 vty_auth (struct vty *vty, char *buf)
@@ -1273,6 +1394,11 @@ vty_execute (struct vty *vty)
 
   ret = CMD_SUCCESS;
 
+  /* Output still to come of a command read before, in the same read,
+     goes all before that of this one, as vtysh_read () has it. */
+  if (vty->output)
+    vty_output_run (vty, (size_t) -1);
+
   switch (vty->node)
     {
     case AUTH_NODE:
@@ -1290,7 +1416,8 @@ vty_execute (struct vty *vty)
   vty->cp = vty->length = 0;
   vty_clear_buf (vty);
 
-  if (vty->status != VTY_CLOSE )
+  /* The prompt follows output still to come. */
+  if (vty->status != VTY_CLOSE && ! vty->output)
     vty_prompt (vty);
 
   return ret;
@@ -1332,6 +1459,7 @@ static void
 vty_buffer_reset (struct vty *vty)
 {
   buffer_reset (vty->obuf);
+  vty_output_end (vty);
   vty_prompt (vty);
   vty_redraw_line (vty);
 }
@@ -1567,6 +1695,14 @@ vty_flush (struct thread *thread)
   /* Function execution continue. */
   erase = ((vty->status == VTY_MORE || vty->status == VTY_MORELINE));
 
+  /* More output of the command, if what is left would not fill the
+     window. */
+  if ((vty->lines == 0) || (vty->width == 0))
+    vty_output_run (vty, 1);
+  else
+    vty_output_run (vty, (vty->width + 2) * (vty->lines > 0 ? vty->lines :
+					     vty->height > 0 ? vty->height : 1));
+
   /* N.B. if width is 0, that means we don't know the window size. */
   if ((vty->lines == 0) || (vty->width == 0))
     flushrc = buffer_flush_available(vty->obuf, vty->fd);
@@ -1590,6 +1726,9 @@ vty_flush (struct thread *thread)
     case BUFFER_EMPTY:
       if (vty->status == VTY_CLOSE)
 	vty_close (vty);
+      else if (vty->output)
+	/* The command has more to give. */
+	vty_event (VTY_WRITE, vty_sock, vty);
       else
 	{
 	  vty->status = VTY_NORMAL;
@@ -2029,6 +2168,8 @@ vtysh_accept (struct thread *thread)
 static int
 vtysh_flush(struct vty *vty)
 {
+  vty_output_run (vty, 1);
+
   switch (buffer_flush_available(vty->obuf, vty->fd))
     {
     case BUFFER_PENDING:
@@ -2042,6 +2183,8 @@ vtysh_flush(struct vty *vty)
       return -1;
       break;
     case BUFFER_EMPTY:
+      if (vty->output)
+	vty_event(VTYSH_WRITE, vty->fd, vty);
       break;
     }
   return 0;
@@ -2104,8 +2247,19 @@ vtysh_read (struct thread *thread)
 	  printf ("vtysh node: %d\n", vty->node);
 #endif /* VTYSH_DEBUG */
 
-	  header[3] = ret;
-	  buffer_put(vty->obuf, header, 4);
+	  if (vty->output)
+	    {
+	      /* The result follows the output still to come, all of it
+		 before that of another command read. */
+	      vty->output_ret = ret;
+	      if (p + 1 < buf + nbytes)
+		vty_output_run (vty, (size_t) -1);
+	    }
+	  else
+	    {
+	      header[3] = ret;
+	      buffer_put(vty->obuf, header, 4);
+	    }
 
 	  if (!vty->t_write && (vtysh_flush(vty) < 0))
 	    /* Try to flush results; exit if a write error occurs. */
@@ -2113,7 +2267,9 @@ vtysh_read (struct thread *thread)
 	}
     }
 
-  vty_event (VTYSH_READ, sock, vty);
+  /* Read the next command once all of the output is given. */
+  if (! vty->output)
+    vty_event (VTYSH_READ, sock, vty);
 
   return 0;
 }
@@ -2124,7 +2280,8 @@ vtysh_write (struct thread *thread)
   struct vty *vty = THREAD_ARG (thread);
 
   vty->t_write = NULL;
-  vtysh_flush(vty);
+  if (vtysh_flush(vty) == 0 && ! vty->output && ! vty->t_read)
+    vty_event (VTYSH_READ, vty->fd, vty);
   return 0;
 }
 
@@ -2172,6 +2329,9 @@ vty_close (struct vty *vty)
   if (vty->t_timeout)
     thread_cancel (vty->t_timeout);
 
+  /* Drop output still to come. */
+  vty_output_end (vty);
+
   /* Flush buffer. */
   buffer_flush_all (vty->obuf, vty->fd);
 
@@ -2413,8 +2573,19 @@ vty_read_config (char *config_file,
         fullpath = config_default_dir;
     }
 
+  /* Changes to lists and maps run the hooks of the daemon, which go
+     through everything using them.  Run those once per list or map
+     changed once all of the file is read, not for every line. */
+  prefix_list_hooks_suspend ();
+  access_list_hooks_suspend ();
+  route_map_hooks_suspend ();
+
   vty_read_file (confp);
 
+  prefix_list_hooks_resume ();
+  access_list_hooks_resume ();
+  route_map_hooks_resume ();
+
   fclose (confp);
 
   host_config_set (fullpath);
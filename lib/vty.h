@@ -117,6 +117,12 @@ struct vty
   unsigned long v_timeout;
   struct thread *t_timeout;
 
+  /* Command giving its output a piece at a time, see vty_output_set (). */
+  int (*output) (struct vty *, void *);
+  void (*output_free) (void *);
+  void *output_arg;
+  int output_ret;
+
   /* What address is this vty comming from. */
   char address[SU_ADDRSTRLEN];
 };
@@ -199,6 +205,18 @@ do {
     }                                                                         \
 } while (0)
 
+/* Most entries a command giving its output a piece at a time should
+   show per piece. */
+#define VTY_OUTPUT_ENTRIES 500
+
+/* What show commands giving structured output give it as. */
+enum vty_format
+{
+  VTY_FORMAT_TEXT,
+  VTY_FORMAT_JSON,
+  VTY_FORMAT_BINARY,
+};
+
 /* Exported variables */
 extern char integrate_default[];
 
@@ -222,6 +240,20 @@ extern int vty_shell (struct vty *);
 extern int vty_shell_serv (struct vty *);
 extern void vty_hello (struct vty *);
 
+/* Has the output of the command running on the vty given by calling
+   func, which shows the next piece of it and returns 1 while there is
+   more to come, 0 when done.  The vty calls func as what it gave before
+   is written, and free_func, if not NULL, on arg when done or closed.
+   Where the output cannot wait, func is called until done at once. */
+extern void vty_output_set (struct vty *, int (*func) (struct vty *, void *),
+			    void (*free_func) (void *), void *arg);
+
+/* Structured output of show commands. */
+extern void vty_out_json_string (struct vty *, const char *);
+extern int vty_binary_ok (struct vty *);
+extern void vty_out_binary (struct vty *, const void *, size_t);
+extern void vty_out_binary_end (struct vty *);
+
 /* Send a fixed-size message to all vty terminal monitors; this should be
    an async-signal-safe function. */
 extern void vty_log_fixed (const char *buf, size_t len);
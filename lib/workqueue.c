@@ -140,6 +140,24 @@ work_queue_add (struct work_queue *wq, void *data)
   return;
 }
 
+/* Fills data with the data of up to max items from the head of the
+   queue on, returning how many, so a user may work ahead on them. */
+unsigned int
+work_queue_peek (struct work_queue *wq, void **data, unsigned int max)
+{
+  struct listnode *node;
+  struct work_queue_item *item;
+  unsigned int n = 0;
+
+  for (ALL_LIST_ELEMENTS_RO (wq->items, node, item))
+    {
+      if (n == max)
+        break;
+      data[n++] = item->data;
+    }
+  return n;
+}
+
 static void
 work_queue_item_remove (struct work_queue *wq, struct listnode *ln)
 {
@@ -114,6 +114,10 @@ extern void work_queue_free (struct work_queue *);
 /* Add the supplied data as an item onto the workqueue */
 extern void work_queue_add (struct work_queue *, void *);
 
+/* data of up to the given number of items, from the head of the queue */
+extern unsigned int work_queue_peek (struct work_queue *, void **,
+                                     unsigned int);
+
 /* plug the queue, ie prevent it from being drained / processed */
 extern void work_queue_plug (struct work_queue *wq);
 /* unplug the queue, allow it to be drained again */
@@ -395,6 +395,9 @@ zclient_start (struct zclient *zclient)
   if (zclient->default_information)
     zebra_message_send (zclient, ZEBRA_REDISTRIBUTE_DEFAULT_ADD);
 
+  if (zclient->zebra_connected)
+    (*zclient->zebra_connected) (zclient);
+
   return 0;
 }
 
@@ -596,6 +599,24 @@ zebra_redistribute_send (int command, struct zclient *zclient, int type)
   return zclient_send_message(zclient);
 }
 
+/* Register the address of p with zebra, or unregister it. */
+int
+zebra_nexthop_send (int command, struct zclient *zclient, struct prefix *p)
+{
+  struct stream *s;
+
+  s = zclient->obuf;
+  stream_reset (s);
+
+  zclient_create_header (s, command);
+  stream_putc (s, p->family);
+  stream_put (s, &p->u.prefix, prefix_blen (p));
+
+  stream_putw_at (s, 0, stream_get_endp (s));
+
+  return zclient_send_message(zclient);
+}
+
 /* Router-id update from zebra daemon. */
 void
 zebra_router_id_update_read (struct stream *s, struct prefix *rid)
@@ -724,7 +745,7 @@ void
 zebra_interface_if_set_value (struct stream *s, struct interface *ifp)
 {
   /* Read interface's index. */
-  ifp->ifindex = stream_getl (s);
+  if_set_index (ifp, stream_getl (s));
   ifp->status = stream_getc (s);
 
   /* Read interface's value. */
@@ -794,6 +815,7 @@ zebra_interface_address_read (int type, struct stream *s)
   /* Fetch destination address. */
   stream_get (&d.u.prefix, s, plen);
   d.family = family;
+  d.prefixlen = p.prefixlen;
 
   if (type == ZEBRA_INTERFACE_ADDRESS_ADD) 
     {
@@ -801,11 +823,7 @@ zebra_interface_address_read (int type, struct stream *s)
        ifc = connected_add_by_prefix(ifp, &p,(memconstant(&d.u.prefix,0,plen) ?
 					      NULL : &d));
        if (ifc != NULL)
-	 {
-	   ifc->flags = ifc_flags;
-	   if (ifc->destination)
-	     ifc->destination->prefixlen = ifc->address->prefixlen;
-	 }
+	 ifc->flags = ifc_flags;
     }
   else
     {
@@ -957,6 +975,10 @@ zclient_read (struct thread *thread)
       if (zclient->ipv6_route_delete)
 	(*zclient->ipv6_route_delete) (command, zclient, length);
       break;
+    case ZEBRA_NEXTHOP_UPDATE:
+      if (zclient->nexthop_update)
+	(*zclient->nexthop_update) (command, zclient, length);
+      break;
     default:
       break;
     }
@@ -82,6 +82,11 @@ struct zclient
   int (*ipv4_route_delete) (int, struct zclient *, uint16_t);
   int (*ipv6_route_add) (int, struct zclient *, uint16_t);
   int (*ipv6_route_delete) (int, struct zclient *, uint16_t);
+  int (*nexthop_update) (int, struct zclient *, uint16_t);
+
+  /* Called once connected, so that the client can tell zebra again
+     what it had told it before. */
+  void (*zebra_connected) (struct zclient *);
 };
 
 /* Zebra API message flag. */
@@ -144,6 +149,13 @@ extern void zclient_redistribute (int command, struct zclient *, int type);
 /* If state has changed, update state and send the command to zebra. */
 extern void zclient_redistribute_default (int command, struct zclient *);
 
+/* Send ZEBRA_NEXTHOP_REGISTER or ZEBRA_NEXTHOP_UNREGISTER for the
+   address of the host prefix.  Registered, zebra sends a
+   ZEBRA_NEXTHOP_UPDATE at once and again whenever the way to the
+   address changes. */
+extern int zebra_nexthop_send (int command, struct zclient *,
+                               struct prefix *);
+
 /* Send the message in zclient->obuf to the zebra daemon (or enqueue it).
    Returns 0 for success or -1 on an I/O error. */
 extern int zclient_send_message(struct zclient *);
@@ -289,7 +289,9 @@ ospf_packet_dup (struct ospf_packet *op)
     zlog_warn ("ospf_packet_dup stream %lu ospf_packet %u size mismatch",
 	       (u_long)STREAM_SIZE(op->s), op->length);
 
-  /* Reserve space for MD5 authentication that may be added later. */
+  /* Reserve space for MD5 authentication that may be added later.  A
+     copy, not a stream_ref(): each send writes its own sequence number
+     and digest into the packet. */
   new = ospf_packet_new (stream_get_endp(op->s) + OSPF_AUTH_MD5_SIZE);
   stream_copy (new->s, op->s);
 
@@ -30,6 +30,7 @@
 #include "command.h"
 #include "plist.h"
 #include "log.h"
+#include "stream.h"
 #include "zclient.h"
 
 #include "ospfd/ospfd.h"
@@ -3961,75 +3962,277 @@ show_lsa_detail_adv_router (struct vty *vty, struct ospf *ospf, int type,
     }
 }
 
+/* Where "show ip ospf database" is between the pieces of output.  Areas
+   and their LSDBs may go meanwhile, so this has the area by ID and the
+   last LSA shown by its key. */
+struct ospf_database_cursor
+{
+  int self;
+  int as;			/* past the areas, at the AS scoped LSAs */
+  struct in_addr area_id;
+  int type;
+  int started;			/* the header of the type is shown */
+  struct prefix key;		/* of the last LSA shown */
+  enum vty_format format;
+  unsigned long count;		/* of LSAs shown */
+  struct stream *s;		/* binary record being given */
+};
+
+/* Gives the LSA as a member of the "lsas" array, with the ID of its
+   area unless AS scoped. */
 static void
-show_ip_ospf_database_summary (struct vty *vty, struct ospf *ospf, int self)
+show_lsa_json (struct vty *vty, struct ospf_lsa *lsa,
+	       struct in_addr *area_id, int first)
+{
+  struct router_lsa *rl;
+  struct summary_lsa *sl;
+  struct as_external_lsa *asel;
+  struct prefix_ipv4 p;
+
+  vty_out (vty, "%s%s{", first ? "" : ",", VTY_NEWLINE);
+  if (area_id)
+    vty_out (vty, "\"area\":\"%s\",", inet_ntoa (*area_id));
+  vty_out (vty, "\"type\":%d,\"id\":\"%s\",", lsa->data->type,
+	   inet_ntoa (lsa->data->id));
+  vty_out (vty, "\"advRouter\":\"%s\",\"age\":%d,\"seq\":%lu,"
+	   "\"checksum\":%u,\"length\":%u",
+	   inet_ntoa (lsa->data->adv_router), LS_AGE (lsa),
+	   (u_long) ntohl (lsa->data->ls_seqnum), ntohs (lsa->data->checksum),
+	   ntohs (lsa->data->length));
+
+  switch (lsa->data->type)
+    {
+    case OSPF_ROUTER_LSA:
+      rl = (struct router_lsa *) lsa->data;
+      vty_out (vty, ",\"links\":%d", ntohs (rl->links));
+      break;
+    case OSPF_SUMMARY_LSA:
+      sl = (struct summary_lsa *) lsa->data;
+      p.family = AF_INET;
+      p.prefix = sl->header.id;
+      p.prefixlen = ip_masklen (sl->mask);
+      apply_mask_ipv4 (&p);
+      vty_out (vty, ",\"route\":\"%s/%d\"", inet_ntoa (p.prefix),
+	       p.prefixlen);
+      break;
+    case OSPF_AS_EXTERNAL_LSA:
+    case OSPF_AS_NSSA_LSA:
+      asel = (struct as_external_lsa *) lsa->data;
+      p.family = AF_INET;
+      p.prefix = asel->header.id;
+      p.prefixlen = ip_masklen (asel->mask);
+      apply_mask_ipv4 (&p);
+      vty_out (vty, ",\"metricType\":%d,\"route\":\"%s/%d\",\"tag\":%lu",
+	       IS_EXTERNAL_METRIC (asel->e[0].tos) ? 2 : 1,
+	       inet_ntoa (p.prefix), p.prefixlen,
+	       (u_long) ntohl (asel->e[0].route_tag));
+      break;
+    default:
+      break;
+    }
+  vty_out (vty, "}");
+}
+
+/* Gives the LSA as a binary record: the 4 byte area ID, 0 for AS scoped
+   LSAs, then the LSA as on the wire with its age brought up to now. */
+static void
+show_lsa_binary (struct vty *vty, struct ospf_lsa *lsa,
+		 struct in_addr *area_id, struct stream *s)
+{
+  size_t length = ntohs (lsa->data->length);
+
+  if (STREAM_SIZE (s) < length + 4)
+    stream_resize (s, length + 4);
+  stream_reset (s);
+  if (area_id)
+    stream_put_in_addr (s, area_id);
+  else
+    stream_putl (s, 0);
+  stream_put (s, lsa->data, length);
+  stream_putw_at (s, 4, LS_AGE (lsa));
+
+  vty_out_binary (vty, STREAM_DATA (s), stream_get_endp (s));
+}
+
+/* The LSDB of the LSAs the cursor is at, NULL if not there any more. */
+static struct ospf_lsdb *
+show_database_lsdb (struct ospf *ospf, struct ospf_database_cursor *c)
+{
+  struct ospf_area *area;
+
+  if (c->as)
+    return ospf->lsdb;
+  area = ospf_area_lookup_by_area_id (ospf, c->area_id);
+  return area ? area->lsdb : NULL;
+}
+
+/* Moves the cursor on to the next type of LSA, returning 0 past the end. */
+static int
+show_database_advance (struct ospf *ospf, struct ospf_database_cursor *c)
 {
-  struct ospf_lsa *lsa;
-  struct route_node *rn;
   struct ospf_area *area;
   struct listnode *node;
-  int type;
 
+  c->started = 0;
+  if (++c->type < OSPF_MAX_LSA)
+    return 1;
+
+  c->type = OSPF_MIN_LSA;
+  if (c->as)
+    return 0;
+
+  /* The areas are kept in order of their IDs. */
   for (ALL_LIST_ELEMENTS_RO (ospf->areas, node, area))
+    if (ntohl (area->area_id.s_addr) > ntohl (c->area_id.s_addr))
+      {
+	c->area_id = area->area_id;
+	return 1;
+      }
+  c->as = 1;
+  return 1;
+}
+
+/* Shows the summaries of the next VTY_OUTPUT_ENTRIES LSAs, returning 1
+   while there are more. */
+static int
+show_ip_ospf_database_summary_next (struct vty *vty, void *arg)
+{
+  struct ospf_database_cursor *c = arg;
+  struct ospf *ospf;
+  struct ospf_lsdb *lsdb;
+  struct ospf_lsa *lsa;
+  struct route_node *rn;
+  int scoped;
+  int entries = 0;
+
+  /* Should OSPF have gone, the output ends as at the end of the LSDBs. */
+  ospf = ospf_lookup ();
+  while (ospf != NULL)
     {
-      for (type = OSPF_MIN_LSA; type < OSPF_MAX_LSA; type++)
+      if (entries >= VTY_OUTPUT_ENTRIES)
+	return 1;
+
+      switch (c->type)
 	{
-	  switch (type)
-	    {
-	    case OSPF_AS_EXTERNAL_LSA:
+	case OSPF_AS_EXTERNAL_LSA:
 #ifdef HAVE_OPAQUE_LSA
-            case OSPF_OPAQUE_AS_LSA:
+	case OSPF_OPAQUE_AS_LSA:
 #endif /* HAVE_OPAQUE_LSA */
-	      continue;
-	    default:
-	      break;
-	    }
-          if (ospf_lsdb_count_self (area->lsdb, type) > 0 ||
-              (!self && ospf_lsdb_count (area->lsdb, type) > 0))
-            {
-              vty_out (vty, "                %s (Area %s)%s%s",
-                       show_database_desc[type],
-		       ospf_area_desc_string (area),
-                       VTY_NEWLINE, VTY_NEWLINE);
-              vty_out (vty, "%s%s", show_database_header[type], VTY_NEWLINE);
+	  scoped = c->as;
+	  break;
+	default:
+	  scoped = ! c->as;
+	  break;
+	}
 
-	      LSDB_LOOP (AREA_LSDB (area, type), rn, lsa)
-		show_lsa_summary (vty, lsa, self);
+      lsdb = show_database_lsdb (ospf, c);
+      if (lsdb == NULL || ! scoped
+	  || (! c->started && ! ospf_lsdb_count_self (lsdb, c->type)
+	      && (c->self || ! ospf_lsdb_count (lsdb, c->type))))
+	{
+	  if (! show_database_advance (ospf, c))
+	    break;
+	  continue;
+	}
 
-              vty_out (vty, "%s", VTY_NEWLINE);
+      if (! c->started && c->format != VTY_FORMAT_TEXT)
+	{
+	  c->started = 1;
+	  rn = route_top (lsdb->type[c->type].db);
+	}
+      else if (! c->started)
+	{
+	  if (c->as)
+	    vty_out (vty, "                %s%s%s",
+		     show_database_desc[c->type], VTY_NEWLINE, VTY_NEWLINE);
+	  else
+	    vty_out (vty, "                %s (Area %s)%s%s",
+		     show_database_desc[c->type],
+		     ospf_area_desc_string (ospf_area_lookup_by_area_id
+					    (ospf, c->area_id)),
+		     VTY_NEWLINE, VTY_NEWLINE);
+	  vty_out (vty, "%s%s", show_database_header[c->type], VTY_NEWLINE);
+	  c->started = 1;
+	  rn = route_top (lsdb->type[c->type].db);
+	}
+      else
+	{
+	  /* Where the last LSA shown is or would be, and on from there. */
+	  rn = route_node_get (lsdb->type[c->type].db, &c->key);
+	  rn = route_next (rn);
+	}
+
+      for (; rn && entries < VTY_OUTPUT_ENTRIES; rn = route_next (rn))
+	if ((lsa = rn->info) != NULL)
+	  {
+	    if (c->format == VTY_FORMAT_JSON)
+	      show_lsa_json (vty, lsa, c->as ? NULL : &c->area_id,
+			     c->count == 0);
+	    else if (c->format == VTY_FORMAT_BINARY)
+	      show_lsa_binary (vty, lsa, c->as ? NULL : &c->area_id, c->s);
+	    else
+	      show_lsa_summary (vty, lsa, c->self);
+	    c->key = rn->p;
+	    c->count++;
+	    entries++;
 	  }
+
+      if (rn)
+	{
+	  route_unlock_node (rn);
+	  return 1;
 	}
+
+      if (c->format == VTY_FORMAT_TEXT)
+	vty_out (vty, "%s", VTY_NEWLINE);
+      if (! show_database_advance (ospf, c))
+	break;
     }
 
-  for (type = OSPF_MIN_LSA; type < OSPF_MAX_LSA; type++)
-    {
-      switch (type)
-        {
-          case OSPF_AS_EXTERNAL_LSA:
-#ifdef HAVE_OPAQUE_LSA
-          case OSPF_OPAQUE_AS_LSA:
-#endif /* HAVE_OPAQUE_LSA */
-            break;
-          default:
-            continue;
-        }
-      if (ospf_lsdb_count_self (ospf->lsdb, type) ||
-         (!self && ospf_lsdb_count (ospf->lsdb, type)))
-        {
-          vty_out (vty, "                %s%s%s",
-	       show_database_desc[type],
-	       VTY_NEWLINE, VTY_NEWLINE);
-          vty_out (vty, "%s%s", show_database_header[type],
-	       VTY_NEWLINE);
+  if (c->format == VTY_FORMAT_JSON)
+    vty_out (vty, "%s],\"totalLsas\":%lu}%s", VTY_NEWLINE, c->count,
+	     VTY_NEWLINE);
+  else if (c->format == VTY_FORMAT_BINARY)
+    vty_out_binary_end (vty);
+  else
+    vty_out (vty, "%s", VTY_NEWLINE);
+  return 0;
+}
 
-	  LSDB_LOOP (AS_LSDB (ospf, type), rn, lsa)
-	    show_lsa_summary (vty, lsa, self);
+static void
+show_ospf_database_cursor_free (void *arg)
+{
+  struct ospf_database_cursor *c = arg;
 
-          vty_out (vty, "%s", VTY_NEWLINE);
-        }
+  if (c->s)
+    stream_free (c->s);
+  XFREE (MTYPE_OSPF_SHOW, c);
+}
+
+static void
+show_ip_ospf_database_summary (struct vty *vty, struct ospf *ospf, int self,
+			       enum vty_format format)
+{
+  struct ospf_database_cursor *c;
+  struct ospf_area *area;
+
+  c = XCALLOC (MTYPE_OSPF_SHOW, sizeof (struct ospf_database_cursor));
+  c->self = self;
+  c->format = format;
+  if (format == VTY_FORMAT_BINARY)
+    c->s = stream_new (OSPF_MAX_LSA_SIZE + 4);
+  c->type = OSPF_MIN_LSA;
+  if (listhead (ospf->areas))
+    {
+      area = listgetdata (listhead (ospf->areas));
+      c->area_id = area->area_id;
     }
+  else
+    c->as = 1;
 
-  vty_out (vty, "%s", VTY_NEWLINE);
+  /* LSDBs may be large, show them a piece at a time as the vty takes it. */
+  vty_output_set (vty, show_ip_ospf_database_summary_next,
+		  show_ospf_database_cursor_free, c);
 }
 
 static void
@@ -4109,7 +4312,7 @@ DEFUN (show_ip_ospf_database,
   /* Show all LSA. */
   if (argc == 0)
     {
-      show_ip_ospf_database_summary (vty, ospf, 0);
+      show_ip_ospf_database_summary (vty, ospf, 0, VTY_FORMAT_TEXT);
       return CMD_SUCCESS;
     }
 
@@ -4128,7 +4331,7 @@ DEFUN (show_ip_ospf_database,
     type = OSPF_AS_EXTERNAL_LSA;
   else if (strncmp (argv[0], "se", 2) == 0)
     {
-      show_ip_ospf_database_summary (vty, ospf, 1);
+      show_ip_ospf_database_summary (vty, ospf, 1, VTY_FORMAT_TEXT);
       return CMD_SUCCESS;
     }
   else if (strncmp (argv[0], "m", 1) == 0)
@@ -4222,6 +4425,38 @@ ALIAS (show_ip_ospf_database,
        "Self-originated link states\n"
        "\n")
 
+DEFUN (show_ip_ospf_database_format,
+       show_ip_ospf_database_format_cmd,
+       "show ip ospf database (json|binary)",
+       SHOW_STR
+       IP_STR
+       "OSPF information\n"
+       "Database summary\n"
+       "Give the database as JSON\n"
+       "Give the database as framed binary records\n")
+{
+  struct ospf *ospf;
+
+  ospf = ospf_lookup ();
+  if (ospf == NULL)
+    {
+      vty_out (vty, " OSPF Routing Process not enabled%s", VTY_NEWLINE);
+      return CMD_SUCCESS;
+    }
+
+  if (strcmp (argv[0], "json") == 0)
+    {
+      vty_out (vty, "{\"routerId\":\"%s\",\"lsas\":[",
+	       inet_ntoa (ospf->router_id));
+      show_ip_ospf_database_summary (vty, ospf, 0, VTY_FORMAT_JSON);
+    }
+  else if (vty_binary_ok (vty))
+    show_ip_ospf_database_summary (vty, ospf, 0, VTY_FORMAT_BINARY);
+  else
+    return CMD_WARNING;
+  return CMD_SUCCESS;
+}
+
 DEFUN (show_ip_ospf_database_type_adv_router,
        show_ip_ospf_database_type_adv_router_cmd,
        "show ip ospf database (" OSPF_LSA_TYPES_CMD_STR ") adv-router A.B.C.D",
@@ -8105,6 +8340,7 @@ ospf_vty_show_init (void)
   install_element (VIEW_NODE, &show_ip_ospf_database_type_id_self_cmd);
   install_element (VIEW_NODE, &show_ip_ospf_database_type_self_cmd);
   install_element (VIEW_NODE, &show_ip_ospf_database_cmd);
+  install_element (VIEW_NODE, &show_ip_ospf_database_format_cmd);
   install_element (ENABLE_NODE, &show_ip_ospf_database_type_cmd);
   install_element (ENABLE_NODE, &show_ip_ospf_database_type_id_cmd);
   install_element (ENABLE_NODE, &show_ip_ospf_database_type_id_adv_router_cmd);
@@ -8112,6 +8348,7 @@ ospf_vty_show_init (void)
   install_element (ENABLE_NODE, &show_ip_ospf_database_type_id_self_cmd);
   install_element (ENABLE_NODE, &show_ip_ospf_database_type_self_cmd);
   install_element (ENABLE_NODE, &show_ip_ospf_database_cmd);
+  install_element (ENABLE_NODE, &show_ip_ospf_database_format_cmd);
 
   /* "show ip ospf interface" commands. */
   install_element (VIEW_NODE, &show_ip_ospf_interface_cmd);
@@ -107,8 +107,8 @@ rip_peer_get (struct in_addr *addr)
     }
 
   /* Update timeout thread. */
-  peer->t_timeout = thread_add_timer (master, rip_peer_timeout, peer,
-				      RIP_PEER_TIMER_DEFAULT);
+  peer->t_timeout = thread_add_timer_coarse (master, rip_peer_timeout, peer,
+					     RIP_PEER_TIMER_DEFAULT);
 
   /* Last update time set. */
   time (&peer->uptime);
@@ -356,11 +356,12 @@ enum rip_event
   RIP_TRIGGERED_UPDATE,
 };
 
-/* Macro for timer turn on. */
+/* Macro for per route timer turn on.  There can be very many of these,
+   so they use the cheaper one second resolution timers. */
 #define RIP_TIMER_ON(T,F,V) \
   do { \
     if (!(T)) \
-      (T) = thread_add_timer (master, (F), rinfo, (V)); \
+      (T) = thread_add_timer_coarse (master, (F), rinfo, (V)); \
   } while (0)
 
 /* Macro for timer turn off. */
@@ -318,11 +318,12 @@ enum ripng_event
   RIPNG_TRIGGERED_UPDATE,
 };
 
-/* RIPng timer on/off macro. */
+/* RIPng per route timer on/off macro, using one second resolution
+   timers as there can be very many of them. */
 #define RIPNG_TIMER_ON(T,F,V) \
 do { \
    if (!(T)) \
-      (T) = thread_add_timer (master, (F), rinfo, (V)); \
+      (T) = thread_add_timer_coarse (master, (F), rinfo, (V)); \
 } while (0)
 
 #define RIPNG_TIMER_OFF(T) \
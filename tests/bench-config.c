@@ -0,0 +1,222 @@
+/*
+ * Benchmark of reading configuration.
+ *
+ * Generates bgpd configurations of 1000, 10000 and 100000 lines in the
+ * order bgpd writes them: router bgp with a neighbor per customer first,
+ * then the prefix-lists for them as IRR tools make them, AS path and
+ * community lists and a route-map per customer.  Times config_from_file()
+ * on them with all the commands of bgpd installed, running the hooks of
+ * the lists and maps on every change, and with the hooks held back until
+ * the end as vty_read_config() does.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "command.h"
+#include "vty.h"
+#include "privs.h"
+#include "memory.h"
+#include "thread.h"
+#include "prefix.h"
+#include "plist.h"
+#include "filter.h"
+#include "routemap.h"
+
+#include "bgpd/bgpd.h"
+
+#include "test-common.h"
+
+/* need these to link in libbgp */
+struct zebra_privs_t *bgpd_privs = NULL;
+struct thread_master *master = NULL;
+
+#define ENTRIES    20		/* prefix-list entries per customer */
+
+static unsigned int
+customers_for (unsigned int lines)
+{
+  /* A customer takes ENTRIES + 12 lines. */
+  return lines / (ENTRIES + 12) ? lines / (ENTRIES + 12) : 1;
+}
+
+/* Writes the configuration for the customers, returning its lines. */
+static unsigned int
+config_write (FILE *fp, unsigned int customers)
+{
+  unsigned int c, i, n = 0;
+  unsigned long addr;
+
+  fprintf (fp, "router bgp 65000\n");
+  n++;
+  for (c = 0; c < customers; c++)
+    {
+      fprintf (fp, " neighbor 10.%u.%u.1 remote-as %u\n",
+	       (c >> 8) & 0xff, c & 0xff, 64512 + c);
+      fprintf (fp, " neighbor 10.%u.%u.1 description customer %u\n",
+	       (c >> 8) & 0xff, c & 0xff, c);
+      fprintf (fp, " neighbor 10.%u.%u.1 route-map AS%u in\n",
+	       (c >> 8) & 0xff, c & 0xff, 64512 + c);
+      fprintf (fp, " neighbor 10.%u.%u.1 prefix-list AS%u in\n",
+	       (c >> 8) & 0xff, c & 0xff, 64512 + c);
+      fprintf (fp, " neighbor 10.%u.%u.1 maximum-prefix %u\n",
+	       (c >> 8) & 0xff, c & 0xff, ENTRIES * 10);
+      n += 5;
+    }
+  fprintf (fp, "!\n");
+  n++;
+
+  for (c = 0; c < customers; c++)
+    for (i = 0; i < ENTRIES; i++)
+      {
+	addr = random ();
+	fprintf (fp, "ip prefix-list AS%u seq %u permit %lu.%lu.%lu.0/%u%s\n",
+		 64512 + c, (i + 1) * 5, 1 + (addr >> 24) % 223,
+		 (addr >> 16) & 0xff, (addr >> 8) & 0xff, 24 - i % 4,
+		 i % 8 == 0 ? " le 24" : "");
+	n++;
+      }
+
+  for (c = 0; c < customers; c++)
+    fprintf (fp, "ip as-path access-list AS%u permit ^%u(_%u)*$\n",
+	     64512 + c, 64512 + c, 64512 + c);
+  for (c = 0; c < customers; c++)
+    fprintf (fp, "ip community-list standard AS%u permit 65000:%u\n",
+	     64512 + c, c % 65535);
+  n += 2 * customers;
+
+  for (c = 0; c < customers; c++)
+    {
+      fprintf (fp, "route-map AS%u permit 10\n", 64512 + c);
+      fprintf (fp, " match ip address prefix-list AS%u\n", 64512 + c);
+      fprintf (fp, " match as-path AS%u\n", 64512 + c);
+      fprintf (fp, " set local-preference 200\n");
+      fprintf (fp, " set community 65000:%u additive\n", c % 65535);
+      n += 5;
+    }
+  return n;
+}
+
+/* Writes what takes the configuration away again. */
+static unsigned int
+config_clear (FILE *fp, unsigned int customers)
+{
+  unsigned int c;
+
+  fprintf (fp, "no router bgp 65000\n");
+  for (c = 0; c < customers; c++)
+    {
+      fprintf (fp, "no ip prefix-list AS%u\n", 64512 + c);
+      fprintf (fp, "no ip as-path access-list AS%u\n", 64512 + c);
+      fprintf (fp, "no ip community-list standard AS%u\n", 64512 + c);
+      fprintf (fp, "no route-map AS%u\n", 64512 + c);
+    }
+  return 1 + 4 * customers;
+}
+
+/* Reads what write () writes, returning the microseconds it took. */
+static unsigned long
+config_load (struct vty *vty, unsigned int (*write) (FILE *, unsigned int),
+	     unsigned int customers, int batch, unsigned int *lines)
+{
+  struct timeval start, end;
+  FILE *fp;
+  int ret;
+
+  fp = tmpfile ();
+  if (fp == NULL)
+    {
+      perror ("tmpfile");
+      exit (1);
+    }
+  *lines = (*write) (fp, customers);
+  rewind (fp);
+
+  vty->node = CONFIG_NODE;
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  if (batch)
+    {
+      prefix_list_hooks_suspend ();
+      access_list_hooks_suspend ();
+      route_map_hooks_suspend ();
+    }
+  ret = config_from_file (vty, fp);
+  if (batch)
+    {
+      prefix_list_hooks_resume ();
+      access_list_hooks_resume ();
+      route_map_hooks_resume ();
+    }
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &end);
+  fclose (fp);
+
+  if (ret != CMD_SUCCESS && ret != CMD_ERR_NOTHING_TODO)
+    {
+      fprintf (stderr, "%u lines: error %d at: %s\n", *lines, ret, vty->buf);
+      exit (1);
+    }
+  return tv_usec (&end, &start);
+}
+
+static void
+bench_run (struct vty *vty, unsigned int size)
+{
+  unsigned int customers = customers_for (size);
+  unsigned int lines, cleared;
+  unsigned long usec[2];
+  int batch;
+
+  for (batch = 0; batch <= 1; batch++)
+    {
+      srandom (size);
+      usec[batch] = config_load (vty, config_write, customers, batch, &lines);
+      config_load (vty, config_clear, customers, 0, &cleared);
+    }
+
+  printf ("%7u lines: hooks per line %8lu ms %9.0f lines/s  "
+	  "held back %8lu ms %9.0f lines/s\n", lines,
+	  usec[0] / 1000, lines * 1000000.0 / (usec[0] ? usec[0] : 1),
+	  usec[1] / 1000, lines * 1000000.0 / (usec[1] ? usec[1] : 1));
+}
+
+int
+main (void)
+{
+  static const unsigned int sizes[] = { 1000, 10000, 100000 };
+  struct vty *vty;
+  unsigned int i;
+
+  bgp_master_init ();
+  master = bm->master;
+  bgp_option_set (BGP_OPT_NO_LISTEN);
+
+  cmd_init (1);
+  vty_init (master);
+  memory_init ();
+  bgp_init ();
+  sort_node ();
+
+  vty = vty_new ();
+  vty->type = VTY_TERM;
+
+  for (i = 0; i < sizeof (sizes) / sizeof (sizes[0]); i++)
+    bench_run (vty, sizes[i]);
+
+  return 0;
+}
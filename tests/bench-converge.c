@@ -0,0 +1,340 @@
+/*
+ * Benchmark of converging on a full table.
+ *
+ * Four eBGP peers, made Established on socketpairs and read by the I/O
+ * pthread, each send a full table of 250k prefixes at once, with AS
+ * paths of 2 to 7 ASes and MEDs, so that most prefixes have paths to
+ * choose between.  Times until all is read and the process queue has
+ * emptied, with no selection pthreads and with the numbers given, each
+ * in a child of its own, and sums up which paths were selected so the
+ * runs can be seen to agree.  With deterministic MEDs and the
+ * router-ids compared, the order the paths come in makes no difference
+ * to that.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+#include <sys/wait.h>
+
+#include "command.h"
+#include "vty.h"
+#include "privs.h"
+#include "memory.h"
+#include "thread.h"
+#include "stream.h"
+#include "network.h"
+#include "prefix.h"
+#include "sockunion.h"
+#include "workqueue.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_table.h"
+#include "bgpd/bgp_route.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_aspath.h"
+#include "bgpd/bgp_fsm.h"
+#include "bgpd/bgp_packet.h"
+#include "bgpd/bgp_io.h"
+
+#include "test-common.h"
+
+/* need these to link in libbgp */
+struct zebra_privs_t *bgpd_privs = NULL;
+struct thread_master *master = NULL;
+
+#define PREFIXES  250000
+#define PEERS     4
+
+static const char *config[] =
+{
+  "router bgp 65000",
+  " bgp router-id 10.0.0.254",
+  " bgp bestpath compare-routerid",
+  " bgp deterministic-med",
+  " neighbor 10.0.0.1 remote-as 174",
+  " neighbor 10.0.0.1 disable-connected-check",
+  " neighbor 10.0.0.2 remote-as 3356",
+  " neighbor 10.0.0.2 disable-connected-check",
+  " neighbor 10.0.0.3 remote-as 1299",
+  " neighbor 10.0.0.3 disable-connected-check",
+  " neighbor 10.0.0.4 remote-as 174",
+  " neighbor 10.0.0.4 disable-connected-check",
+  NULL
+};
+
+static const as_t peer_as[PEERS] = { 174, 3356, 1299, 174 };
+
+/* What each peer sends. */
+static struct
+{
+  struct peer *peer;
+  u_char *data;
+  size_t size;
+  unsigned long msgs;
+  int fd;
+} feed[PEERS];
+
+/* The full table of peer i, in UPDATEs of 1 to 6 prefixes. */
+static void
+feed_make (int i)
+{
+  struct stream *s;
+  unsigned long p, k;
+  size_t attrlen, alloc = 0;
+  int n, len, j;
+
+  srandom (i + 1);
+  s = stream_new (BGP_MAX_PACKET_SIZE);
+  for (p = 0; p < PREFIXES; p += n)
+    {
+      n = 1 + random () % 6;
+      if (p + n > PREFIXES)
+	n = PREFIXES - p;
+      len = 2 + random () % 6;
+
+      stream_reset (s);
+      for (j = 0; j < BGP_MARKER_SIZE; j++)
+	stream_putc (s, 0xff);
+      stream_putw (s, 0);
+      stream_putc (s, BGP_MSG_UPDATE);
+      stream_putw (s, 0);
+      attrlen = stream_get_endp (s);
+      stream_putw (s, 0);
+
+      stream_putc (s, BGP_ATTR_FLAG_TRANS);
+      stream_putc (s, BGP_ATTR_ORIGIN);
+      stream_putc (s, 1);
+      stream_putc (s, BGP_ORIGIN_IGP);
+
+      stream_putc (s, BGP_ATTR_FLAG_TRANS);
+      stream_putc (s, BGP_ATTR_AS_PATH);
+      stream_putc (s, 2 + 4 * len);
+      stream_putc (s, AS_SEQUENCE);
+      stream_putc (s, len);
+      stream_putl (s, peer_as[i]);
+      for (j = 1; j < len; j++)
+	stream_putl (s, 1 + random () % 64511);
+
+      stream_putc (s, BGP_ATTR_FLAG_TRANS);
+      stream_putc (s, BGP_ATTR_NEXT_HOP);
+      stream_putc (s, 4);
+      stream_putl (s, 0x0a000001 + i);
+
+      stream_putc (s, BGP_ATTR_FLAG_OPTIONAL);
+      stream_putc (s, BGP_ATTR_MULTI_EXIT_DISC);
+      stream_putc (s, 4);
+      stream_putl (s, random () % 100);
+      stream_putw_at (s, attrlen, stream_get_endp (s) - attrlen - 2);
+
+      for (k = p; k < p + n; k++)
+	{
+	  stream_putc (s, 24);
+	  stream_putc (s, 1 + (k >> 16));
+	  stream_putc (s, (k >> 8) & 0xff);
+	  stream_putc (s, k & 0xff);
+	}
+      stream_putw_at (s, BGP_MARKER_SIZE, stream_get_endp (s));
+
+      if (feed[i].size + stream_get_endp (s) > alloc)
+	{
+	  alloc = alloc ? alloc * 2 : 1 << 20;
+	  feed[i].data = realloc (feed[i].data, alloc);
+	}
+      memcpy (feed[i].data + feed[i].size, STREAM_DATA (s),
+	      stream_get_endp (s));
+      feed[i].size += stream_get_endp (s);
+      feed[i].msgs++;
+    }
+  stream_free (s);
+}
+
+static void *
+writer (void *arg)
+{
+  int i = (long) arg;
+  size_t done = 0;
+  ssize_t n;
+
+  while (done < feed[i].size)
+    {
+      n = write (feed[i].fd, feed[i].data + done, feed[i].size - done);
+      if (n < 0)
+	{
+	  perror ("write");
+	  exit (1);
+	}
+      done += n;
+    }
+  return NULL;
+}
+
+static void
+peer_establish (struct peer *peer, int fd)
+{
+  /* Nothing of the configuring may go on with the session. */
+  BGP_EVENT_FLUSH (peer);
+  BGP_TIMER_OFF (peer->t_start);
+  BGP_TIMER_OFF (peer->t_connect);
+
+  /* As the OPEN and the connection would have set. */
+  peer->remote_id = peer->su.sin.sin_addr;
+  if (peer->su_remote == NULL)
+    peer->su_remote = sockunion_dup (&peer->su);
+
+  set_nonblocking (fd);
+  peer->fd = fd;
+  peer->status = Established;
+  peer->v_holdtime = 0;
+  peer->afc_nego[AFI_IP][SAFI_UNICAST] = 1;
+  SET_FLAG (peer->cap, PEER_CAP_AS4_RCV | PEER_CAP_AS4_ADV);
+  bgp_io_peer_start (peer);
+}
+
+static int
+converged (void)
+{
+  void *item;
+  int i;
+
+  for (i = 0; i < PEERS; i++)
+    if (feed[i].peer->update_in < feed[i].msgs)
+      return 0;
+  return (bm->process_main_queue == NULL
+	  || work_queue_peek (bm->process_main_queue, &item, 1) == 0);
+}
+
+/* Sums up which peer each selected path is from. */
+static unsigned long
+selected_sum (struct bgp *bgp)
+{
+  struct bgp_node *rn;
+  struct bgp_info *ri;
+  unsigned long sum = 0;
+  int i;
+
+  for (rn = bgp_table_top (bgp->rib[AFI_IP][SAFI_UNICAST]); rn;
+       rn = bgp_route_next (rn))
+    for (ri = rn->info; ri; ri = ri->next)
+      if (CHECK_FLAG (ri->flags, BGP_INFO_SELECTED))
+	for (i = 0; i < PEERS; i++)
+	  if (ri->peer == feed[i].peer)
+	    sum = sum * 31 + i + 1;
+  return sum;
+}
+
+static void
+bench_run (struct vty *vty, unsigned int threads)
+{
+  struct timeval start, end;
+  struct thread thread;
+  pthread_t tid[PEERS];
+  char buf[64], name[32];
+  unsigned long usec;
+  int sv[2];
+  long i;
+
+  if (threads)
+    {
+      snprintf (buf, sizeof (buf), "bgp process-threads %u", threads);
+      execute (vty, buf);
+    }
+
+  bgp_io_start ();
+  for (i = 0; i < PEERS; i++)
+    {
+      if (socketpair (AF_UNIX, SOCK_STREAM, 0, sv) < 0)
+	{
+	  perror ("socketpair");
+	  exit (1);
+	}
+      feed[i].fd = sv[1];
+      peer_establish (feed[i].peer, sv[0]);
+    }
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  for (i = 0; i < PEERS; i++)
+    pthread_create (&tid[i], NULL, writer, (void *) i);
+  while (! converged () && thread_fetch (master, &thread))
+    thread_call (&thread);
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &end);
+  for (i = 0; i < PEERS; i++)
+    pthread_join (tid[i], NULL);
+
+  usec = tv_usec (&end, &start);
+  snprintf (name, sizeof (name), "%u selection pthreads", threads);
+  printf ("%-24s %6lu ms %9.0f prefixes/s  selected %08lx\n", name,
+	  usec / 1000, PREFIXES * 1000000.0 / (usec ? usec : 1),
+	  selected_sum (bgp_get_default ()) & 0xffffffff);
+}
+
+int
+main (int argc, char **argv)
+{
+  struct vty *vty;
+  union sockunion su;
+  char addr[INET_ADDRSTRLEN];
+  unsigned int threads[16] = { 0, 1, 2, 4 };
+  int nthreads = 4;
+  int i, status;
+
+  signal (SIGPIPE, SIG_IGN);
+  bgp_master_init ();
+  master = bm->master;
+  bgp_option_set (BGP_OPT_NO_LISTEN);
+
+  cmd_init (1);
+  vty_init (master);
+  memory_init ();
+  bgp_init ();
+  sort_node ();
+
+  if (argc > 1)
+    for (nthreads = 0; nthreads < argc - 1 && nthreads < 16; nthreads++)
+      threads[nthreads] = atoi (argv[nthreads + 1]);
+
+  vty = vty_new ();
+  vty->type = VTY_TERM;
+  vty->node = CONFIG_NODE;
+  for (i = 0; config[i]; i++)
+    execute (vty, config[i]);
+  vty->node = CONFIG_NODE;
+
+  for (i = 0; i < PEERS; i++)
+    {
+      snprintf (addr, sizeof (addr), "10.0.0.%d", i + 1);
+      str2sockunion (addr, &su);
+      feed[i].peer = peer_lookup (bgp_get_default (), &su);
+      feed_make (i);
+    }
+  printf ("%d peers of %d prefixes, %lu UPDATEs each\n", PEERS, PREFIXES,
+	  feed[0].msgs);
+
+  for (i = 0; i < nthreads; i++)
+    {
+      fflush (stdout);
+      if (fork () == 0)
+	{
+	  bench_run (vty, threads[i]);
+	  exit (0);
+	}
+      wait (&status);
+    }
+
+  return 0;
+}
@@ -0,0 +1,194 @@
+/*
+ * System call count benchmark of writing stream fifos.
+ *
+ * Models the initial sync of a full table to 200 peers: every peer
+ * gets the same 500 UPDATE sized packets, queued by reference, and is
+ * written to over a socketpair in wakeups of at most 10 packets as
+ * bgp_write() does.  Compares a write() per packet with handing the
+ * packets of a wakeup to stream_fifo_write() at once, and with letting
+ * it take the whole queue.  The other ends are drained after each
+ * wakeup and not counted.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "stream.h"
+#include "network.h"
+#include "memory.h"
+#include "thread.h"
+
+#include "test-common.h"
+
+struct thread_master *master;
+
+#define PEERS        200
+#define PACKETS      500
+#define PACKET_SIZE  4096
+#define WAKEUP_MAX   10		/* BGP_WRITE_PACKET_MAX */
+
+struct peer
+{
+  int fd[2];
+  struct stream_fifo *obuf;
+};
+
+static struct peer peers[PEERS];
+static struct stream *packets[PACKETS];
+
+/* A write() per packet, as bgp_write() did.  Returns the calls made. */
+static unsigned long
+wakeup_write (struct peer *peer)
+{
+  struct stream *s;
+  unsigned long calls = 0;
+  unsigned int count;
+  ssize_t num;
+
+  for (count = 0; count < WAKEUP_MAX
+       && (s = stream_fifo_head (peer->obuf)) != NULL; count++)
+    {
+      calls++;
+      num = write (peer->fd[0], STREAM_PNT (s), STREAM_READABLE (s));
+      if (num < 0)
+	{
+	  if (ERRNO_IO_RETRY (errno))
+	    break;
+	  perror ("write");
+	  exit (1);
+	}
+      stream_forward_getp (s, num);
+      if (STREAM_READABLE (s))
+	break;
+      stream_free (stream_fifo_pop (peer->obuf));
+    }
+  return calls;
+}
+
+/* One stream_fifo_write() for up to max packets. */
+static unsigned long
+wakeup_writev (struct peer *peer, size_t max)
+{
+  struct stream *s;
+
+  if (stream_fifo_write (peer->obuf, peer->fd[0], max) < 0
+      && !ERRNO_IO_RETRY (errno))
+    {
+      perror ("writev");
+      exit (1);
+    }
+  while ((s = stream_fifo_head (peer->obuf)) != NULL
+	 && STREAM_READABLE (s) == 0)
+    stream_free (stream_fifo_pop (peer->obuf));
+  return 1;
+}
+
+/* Read what the peer was sent, returning the byte count. */
+static unsigned long
+drain (struct peer *peer)
+{
+  static char buf[65536];
+  unsigned long total = 0;
+  ssize_t num;
+
+  while ((num = read (peer->fd[1], buf, sizeof (buf))) > 0)
+    total += num;
+  return total;
+}
+
+static void
+bench_run (const char *label, int mode)
+{
+  struct timeval start, end;
+  unsigned long calls = 0, bytes = 0;
+  unsigned int i, p, busy;
+
+  for (p = 0; p < PEERS; p++)
+    for (i = 0; i < PACKETS; i++)
+      stream_fifo_push_ref (peers[p].obuf, packets[i]);
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  do
+    {
+      busy = 0;
+      for (p = 0; p < PEERS; p++)
+	{
+	  if (stream_fifo_head (peers[p].obuf) == NULL)
+	    continue;
+	  busy++;
+	  switch (mode)
+	    {
+	    case 0:
+	      calls += wakeup_write (&peers[p]);
+	      break;
+	    case 1:
+	      calls += wakeup_writev (&peers[p], WAKEUP_MAX);
+	      break;
+	    default:
+	      calls += wakeup_writev (&peers[p], 0);
+	      break;
+	    }
+	  bytes += drain (&peers[p]);
+	}
+    }
+  while (busy);
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &end);
+
+  if (bytes != (unsigned long) PEERS * PACKETS * PACKET_SIZE)
+    {
+      fprintf (stderr, "%s: %lu bytes arrived\n", label, bytes);
+      exit (1);
+    }
+
+  printf ("%-22s %8lu system calls  %6.1f packets/call  %5lu ms\n",
+	  label, calls, (double) PEERS * PACKETS / calls,
+	  tv_usec (&end, &start) / 1000);
+}
+
+int
+main (void)
+{
+  unsigned int i, p;
+
+  for (i = 0; i < PACKETS; i++)
+    {
+      packets[i] = stream_new (PACKET_SIZE);
+      stream_put (packets[i], NULL, PACKET_SIZE);
+    }
+
+  for (p = 0; p < PEERS; p++)
+    {
+      if (socketpair (AF_UNIX, SOCK_STREAM, 0, peers[p].fd) < 0)
+	{
+	  perror ("socketpair");
+	  return 1;
+	}
+      set_nonblocking (peers[p].fd[0]);
+      set_nonblocking (peers[p].fd[1]);
+      peers[p].obuf = stream_fifo_new ();
+    }
+
+  printf ("%u peers, %u packets of %u bytes each\n",
+	  PEERS, PACKETS, PACKET_SIZE);
+  bench_run ("write per packet", 0);
+  bench_run ("writev per wakeup", 1);
+  bench_run ("writev of the queue", 2);
+
+  return 0;
+}
@@ -0,0 +1,236 @@
+/*
+ * Benchmark of applying access-lists.
+ *
+ * Builds access-lists of 10, 1000 and 10000 filters through the CLI:
+ * zebra filters on prefixes of /16 to /24, cisco standard filters with
+ * the wildcards of such prefixes and cisco extended ones also matching
+ * on the mask, every 64th of them a deny and, for the cisco lists,
+ * every 16th with a non-contiguous wildcard.  Then times
+ * access_list_apply() on a mix of listed prefixes, more specifics of
+ * them and random ones against trying the filters in list order as it
+ * used to, checking both give the same answers.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "command.h"
+#include "vty.h"
+#include "prefix.h"
+#include "filter.h"
+#include "memory.h"
+#include "thread.h"
+
+#include "test-common.h"
+
+struct thread_master *master;
+
+#define FILTERS_MAX   10000
+#define LOOKUPS       1000000
+#define WALK_BUDGET   200000000UL	/* filters the walk may try per size */
+
+enum list_kind
+{
+  LIST_ZEBRA,
+  LIST_STANDARD,
+  LIST_EXTENDED,
+  LIST_KINDS
+};
+
+static const char *list_names[LIST_KINDS] = { "bench", "10", "110" };
+static const char *kind_names[LIST_KINDS] =
+  { "zebra", "standard", "extended" };
+
+/* The prefixes of the filters, in list order. */
+static struct prefix *entries;
+static char (*lines)[128];
+
+static struct prefix *lookups;
+
+static void
+random_prefix (struct prefix *p, u_char len)
+{
+  memset (p, 0, sizeof (*p));
+  p->family = AF_INET;
+  p->prefixlen = len;
+  p->u.prefix4.s_addr = htonl ((1 + random () % 223) << 24
+			       | (random () & 0xffffff));
+  apply_mask (p);
+}
+
+static void
+workload_init (enum list_kind kind, unsigned int count)
+{
+  struct in_addr mask, wild;
+  char addr[INET_ADDRSTRLEN], wildcard[INET_ADDRSTRLEN];
+  const char *type;
+  unsigned int i;
+
+  srandom (count);
+  for (i = 0; i < count; i++)
+    {
+      random_prefix (&entries[i], 16 + random () % 9);
+      type = (i % 64 == 63) ? "deny" : "permit";
+      strcpy (addr, inet_ntoa (entries[i].u.prefix4));
+      masklen2ip (entries[i].prefixlen, &mask);
+      wild.s_addr = ~mask.s_addr;
+      if (i % 16 == 15)
+	wild.s_addr |= htonl (0x00ff0000);
+      strcpy (wildcard, inet_ntoa (wild));
+
+      switch (kind)
+	{
+	case LIST_ZEBRA:
+	  snprintf (lines[i], sizeof (lines[i]), "access-list %s %s %s/%d",
+		    list_names[kind], type, addr, entries[i].prefixlen);
+	  break;
+	case LIST_STANDARD:
+	  snprintf (lines[i], sizeof (lines[i]), "access-list %s %s %s %s",
+		    list_names[kind], type, addr, wildcard);
+	  break;
+	default:
+	  snprintf (lines[i], sizeof (lines[i]),
+		    "access-list %s %s ip %s %s 255.255.255.0 0.0.0.255",
+		    list_names[kind], type, addr, wildcard);
+	  break;
+	}
+    }
+
+  for (i = 0; i < LOOKUPS; i++)
+    {
+      struct prefix *e = &entries[random () % count];
+
+      switch (random () % 4)
+	{
+	case 0:		/* listed */
+	  lookups[i] = *e;
+	  break;
+	case 1:		/* a more specific */
+	  lookups[i] = *e;
+	  lookups[i].u.prefix4.s_addr
+	    |= htonl (random () & (0xffffffff >> e->prefixlen));
+	  lookups[i].prefixlen = e->prefixlen + random () % (25 - e->prefixlen);
+	  apply_mask (&lookups[i]);
+	  break;
+	default:	/* anywhere */
+	  random_prefix (&lookups[i], 16 + random () % 9);
+	  break;
+	}
+    }
+}
+
+static void
+bench_run (struct vty *vty, enum list_kind kind, unsigned int count)
+{
+  struct access_list *access;
+  struct timeval start, end;
+  char line[160];
+  unsigned int i, walks, permitted;
+  double r_build, r_apply, r_walk, r_delete;
+
+  workload_init (kind, count);
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  for (i = 0; i < count; i++)
+    execute (vty, lines[i]);
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &end);
+  r_build = rate (count, &end, &start);
+
+  access = access_list_lookup (AFI_IP, list_names[kind]);
+
+  permitted = 0;
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  for (i = 0; i < LOOKUPS; i++)
+    if (access_list_apply (access, &lookups[i]) == FILTER_PERMIT)
+      permitted++;
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &end);
+  r_apply = rate (LOOKUPS, &end, &start);
+
+  walks = WALK_BUDGET / count;
+  if (walks > LOOKUPS)
+    walks = LOOKUPS;
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  for (i = 0; i < walks; i++)
+    access_list_apply_linear (access, &lookups[i]);
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &end);
+  r_walk = rate (walks, &end, &start);
+
+  for (i = 0; i < walks; i++)
+    if (access_list_apply (access, &lookups[i])
+	!= access_list_apply_linear (access, &lookups[i]))
+      {
+	fprintf (stderr, "%s %u filters: %s/%d differs from the walk\n",
+		 kind_names[kind], count, inet_ntoa (lookups[i].u.prefix4),
+		 lookups[i].prefixlen);
+	exit (1);
+      }
+
+  /* Filters one by one, as the list goes down when a configuration is
+     taken back. */
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  for (i = 0; i < count; i++)
+    {
+      snprintf (line, sizeof (line), "no %s", lines[i]);
+      execute (vty, line);
+    }
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &end);
+  r_delete = rate (count, &end, &start);
+
+  if (access_list_lookup (AFI_IP, list_names[kind]) != NULL)
+    {
+      fprintf (stderr, "%s %u filters: list left after delete\n",
+	       kind_names[kind], count);
+      exit (1);
+    }
+
+  printf ("%-8s %5u filters: add %8.0f/s  apply %9.0f/s (%u%% permit)  "
+	  "walk %9.0f/s  delete %8.0f/s\n",
+	  kind_names[kind], count, r_build, r_apply,
+	  permitted * 100 / LOOKUPS, r_walk, r_delete);
+}
+
+int
+main (void)
+{
+  static const unsigned int sizes[] = { 10, 1000, FILTERS_MAX };
+  struct vty *vty;
+  unsigned int i;
+  int kind;
+
+  master = thread_master_create ();
+  cmd_init (1);
+  vty_init (master);
+  memory_init ();
+  access_list_init ();
+  sort_node ();
+
+  vty = vty_new ();
+  vty->type = VTY_TERM;
+  vty->node = CONFIG_NODE;
+
+  entries = XCALLOC (MTYPE_TMP, FILTERS_MAX * sizeof (struct prefix));
+  lines = XCALLOC (MTYPE_TMP, FILTERS_MAX * sizeof (lines[0]));
+  lookups = XCALLOC (MTYPE_TMP, LOOKUPS * sizeof (struct prefix));
+
+  for (kind = 0; kind < LIST_KINDS; kind++)
+    for (i = 0; i < sizeof (sizes) / sizeof (sizes[0]); i++)
+      bench_run (vty, kind, sizes[i]);
+
+  return 0;
+}
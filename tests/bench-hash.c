@@ -0,0 +1,125 @@
+/*
+ * Benchmark of the self-resizing hash table.
+ *
+ * Insert, look up and release N keys in a table started at the default
+ * size, which has to grow its way up, and in one created big enough
+ * from the start.  Besides the throughput, report the slowest single
+ * insert so any pause caused by resizing shows up.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "hash.h"
+#include "jhash.h"
+#include "memory.h"
+#include "thread.h"
+
+#include "test-common.h"
+
+struct thread_master *master;
+
+static const unsigned int key_counts[] = { 10000, 100000, 1000000 };
+
+static unsigned int
+bench_key (void *p)
+{
+  return jhash_1word (*(unsigned int *) p, 0);
+}
+
+static int
+bench_cmp (const void *a, const void *b)
+{
+  return *(const unsigned int *) a == *(const unsigned int *) b;
+}
+
+static void
+bench_run (const char *label, unsigned int n, unsigned int size)
+{
+  struct hash *hash;
+  struct timeval start, end, t0, t1;
+  unsigned int *keys;
+  unsigned int i;
+  unsigned long worst = 0, usec;
+  double r_insert, r_lookup, r_release;
+
+  keys = XCALLOC (MTYPE_TMP, n * sizeof (unsigned int));
+  for (i = 0; i < n; i++)
+    keys[i] = i * 2654435761U;
+
+  hash = hash_create_size (size, bench_key, bench_cmp);
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  for (i = 0; i < n; i++)
+    {
+      quagga_gettime (QUAGGA_CLK_MONOTONIC, &t0);
+      hash_get (hash, &keys[i], hash_alloc_intern);
+      quagga_gettime (QUAGGA_CLK_MONOTONIC, &t1);
+      if ((usec = tv_usec (&t1, &t0)) > worst)
+        worst = usec;
+    }
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &end);
+  r_insert = rate (n, &end, &start);
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  for (i = 0; i < n; i++)
+    if (hash_lookup (hash, &keys[i]) != &keys[i])
+      {
+        fprintf (stderr, "key %u lost\n", keys[i]);
+        exit (1);
+      }
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &end);
+  r_lookup = rate (n, &end, &start);
+
+  printf ("%-8s %8u keys: %8u buckets %3lu resizes  "
+          "insert %9.0f/s (worst %5lu usec)  lookup %9.0f/s  ",
+          label, n, hash->size, hash->resizes,
+          r_insert, worst, r_lookup);
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  for (i = 0; i < n; i++)
+    hash_release (hash, &keys[i]);
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &end);
+  r_release = rate (n, &end, &start);
+
+  printf ("release %9.0f/s\n", r_release);
+
+  if (hash->count != 0)
+    {
+      fprintf (stderr, "%lu keys left after release\n", hash->count);
+      exit (1);
+    }
+
+  hash_free (hash);
+  XFREE (MTYPE_TMP, keys);
+}
+
+int
+main (void)
+{
+  unsigned int i;
+
+  for (i = 0; i < sizeof (key_counts) / sizeof (key_counts[0]); i++)
+    {
+      bench_run ("growing", key_counts[i], HASHTABSIZE);
+      bench_run ("presized", key_counts[i], key_counts[i]);
+    }
+
+  return 0;
+}
@@ -0,0 +1,252 @@
+/*
+ * Benchmark of the interface lookups.
+ *
+ * Creates 10k interfaces, each with an ifindex and an IPv4 address in
+ * its own /30 (every 16th a point-to-point one with a /32 peer), then
+ * times lookups by ifindex, by name, by exact address and by longest
+ * prefix against the linear searches of iflist the library used to do,
+ * checking both give the same answers.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "if.h"
+#include "prefix.h"
+#include "memory.h"
+#include "thread.h"
+
+#include "test-common.h"
+
+struct thread_master *master;
+
+#define INTERFACES  10000
+#define LOOKUPS     200000
+#define SCANS       2000	/* the linear searches are that much slower */
+
+/* The linear searches, as lib/if.c had them. */
+static struct interface *
+scan_by_index (unsigned int index)
+{
+  struct listnode *node;
+  struct interface *ifp;
+
+  for (ALL_LIST_ELEMENTS_RO (iflist, node, ifp))
+    if (ifp->ifindex == index)
+      return ifp;
+  return NULL;
+}
+
+static struct interface *
+scan_by_name (const char *name)
+{
+  struct listnode *node;
+  struct interface *ifp;
+
+  for (ALL_LIST_ELEMENTS_RO (iflist, node, ifp))
+    if (strcmp (name, ifp->name) == 0)
+      return ifp;
+  return NULL;
+}
+
+static struct interface *
+scan_exact_address (struct in_addr src)
+{
+  struct listnode *node, *cnode;
+  struct interface *ifp;
+  struct connected *c;
+
+  for (ALL_LIST_ELEMENTS_RO (iflist, node, ifp))
+    for (ALL_LIST_ELEMENTS_RO (ifp->connected, cnode, c))
+      if (c->address->family == AF_INET
+	  && IPV4_ADDR_SAME (&c->address->u.prefix4, &src))
+	return ifp;
+  return NULL;
+}
+
+static struct interface *
+scan_address (struct in_addr src)
+{
+  struct listnode *node, *cnode;
+  struct interface *ifp, *match = NULL;
+  struct connected *c;
+  struct prefix addr;
+  int bestlen = 0;
+
+  addr.family = AF_INET;
+  addr.u.prefix4 = src;
+  addr.prefixlen = IPV4_MAX_BITLEN;
+
+  for (ALL_LIST_ELEMENTS_RO (iflist, node, ifp))
+    for (ALL_LIST_ELEMENTS_RO (ifp->connected, cnode, c))
+      if (c->address->family == AF_INET
+	  && prefix_match (CONNECTED_PREFIX (c), &addr)
+	  && c->address->prefixlen > bestlen)
+	{
+	  bestlen = c->address->prefixlen;
+	  match = ifp;
+	}
+  return match;
+}
+
+/* Workload: which interface or address each lookup asks for. */
+static unsigned int *keys;
+static struct in_addr *addrs;
+
+static struct in_addr
+if_address (unsigned int i)
+{
+  struct in_addr a;
+
+  a.s_addr = htonl (0x0a000001 + (i << 2));
+  return a;
+}
+
+static void
+setup (void)
+{
+  struct interface *ifp;
+  struct connected *ifc;
+  struct prefix p, d;
+  char name[INTERFACE_NAMSIZ];
+  unsigned int i;
+
+  for (i = 0; i < INTERFACES; i++)
+    {
+      snprintf (name, sizeof (name), "eth%u", i);
+      ifp = if_get_by_name (name);
+      if_set_index (ifp, i + 1);
+
+      memset (&p, 0, sizeof (p));
+      p.family = AF_INET;
+      p.u.prefix4 = if_address (i);
+      p.prefixlen = 30;
+      if (i % 16)
+	connected_add_by_prefix (ifp, &p, NULL);
+      else
+	{
+	  /* Point-to-point, peer in 172.16/12. */
+	  p.prefixlen = 32;
+	  d = p;
+	  d.u.prefix4.s_addr = htonl (0xac100000 + i);
+	  ifc = connected_add_by_prefix (ifp, &p, &d);
+	  SET_FLAG (ifc->flags, ZEBRA_IFA_PEER);
+	}
+    }
+
+  srandom (1);
+  keys = XCALLOC (MTYPE_TMP, LOOKUPS * sizeof (unsigned int));
+  addrs = XCALLOC (MTYPE_TMP, LOOKUPS * sizeof (struct in_addr));
+  for (i = 0; i < LOOKUPS; i++)
+    {
+      keys[i] = random () % INTERFACES;
+      switch (random () % 4)
+	{
+	case 0:		/* an interface address */
+	  addrs[i] = if_address (keys[i]);
+	  break;
+	case 1:		/* a neighbour on the subnet or a peer */
+	  addrs[i].s_addr = (keys[i] % 16)
+	    ? htonl (ntohl (if_address (keys[i]).s_addr) + 1)
+	    : htonl (0xac100000 + keys[i]);
+	  break;
+	default:	/* anywhere */
+	  addrs[i].s_addr = random ();
+	  break;
+	}
+    }
+}
+
+static void
+check (void)
+{
+  char name[INTERFACE_NAMSIZ];
+  unsigned int i;
+
+  for (i = 0; i < SCANS; i++)
+    {
+      snprintf (name, sizeof (name), "eth%u", keys[i]);
+      if (if_lookup_by_index (keys[i] + 1) != scan_by_index (keys[i] + 1)
+	  || if_lookup_by_name (name) != scan_by_name (name)
+	  || if_lookup_exact_address (addrs[i]) != scan_exact_address (addrs[i])
+	  || if_lookup_address (addrs[i]) != scan_address (addrs[i]))
+	{
+	  fprintf (stderr, "lookup %u of eth%u/%s differs from the scan\n",
+		   i, keys[i], inet_ntoa (addrs[i]));
+	  exit (1);
+	}
+    }
+}
+
+/* Time n lookups of one kind, returning the number of hits. */
+#define BENCH(label, n, expr)						\
+  do {									\
+    struct timeval start, end;						\
+    unsigned int i, hits = 0;						\
+									\
+    quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);			\
+    for (i = 0; i < (n); i++)						\
+      if ((expr) != NULL)						\
+	hits++;								\
+    quagga_gettime (QUAGGA_CLK_MONOTONIC, &end);			\
+    printf ("  %-16s %10.0f/s  (%u%% hit)\n", label,			\
+	    rate ((n), &end, &start), hits * 100 / (n));		\
+  } while (0)
+
+static char names[LOOKUPS][INTERFACE_NAMSIZ];
+
+int
+main (void)
+{
+  struct timeval start, end;
+  unsigned int i;
+
+  if_init ();
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  setup ();
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &end);
+  printf ("%u interfaces set up in %lu ms\n", INTERFACES,
+	  tv_usec (&end, &start) / 1000);
+
+  for (i = 0; i < LOOKUPS; i++)
+    snprintf (names[i], INTERFACE_NAMSIZ, "eth%u", keys[i]);
+
+  check ();
+
+  printf ("indexed:\n");
+  BENCH ("by index", LOOKUPS, if_lookup_by_index (keys[i] + 1));
+  BENCH ("by name", LOOKUPS, if_lookup_by_name (names[i]));
+  BENCH ("exact address", LOOKUPS, if_lookup_exact_address (addrs[i]));
+  BENCH ("longest match", LOOKUPS, if_lookup_address (addrs[i]));
+
+  printf ("linear scan:\n");
+  BENCH ("by index", SCANS, scan_by_index (keys[i] + 1));
+  BENCH ("by name", SCANS, scan_by_name (names[i]));
+  BENCH ("exact address", SCANS, scan_exact_address (addrs[i]));
+  BENCH ("longest match", SCANS, scan_address (addrs[i]));
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  if_terminate ();
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &end);
+  printf ("%u interfaces deleted in %lu ms\n", INTERFACES,
+	  tv_usec (&end, &start) / 1000);
+
+  return 0;
+}
@@ -0,0 +1,320 @@
+/*
+ * Replay benchmark of the bgpd intern tables.
+ *
+ * Generates a full-table like workload of AS paths and attributes, then
+ * replays the same sequence of intern and unintern operations bgpd does
+ * during convergence, churn and teardown against the chained hash
+ * (struct hash) and the open addressing one (struct ohash), using
+ * bgpd's own key and compare functions.  Memory is what the table
+ * itself needs per interned object, malloc overhead not included.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "vty.h"
+#include "privs.h"
+#include "memory.h"
+#include "hash.h"
+#include "ohash.h"
+#include "thread.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_aspath.h"
+#include "bgpd/bgp_attr.h"
+
+#include "test-common.h"
+
+/* need these to link in libbgp */
+struct zebra_privs_t *bgpd_privs = NULL;
+struct thread_master *master = NULL;
+
+#define PREFIXES   900000	/* routes in the table */
+#define ASPATHS    250000	/* distinct AS paths */
+#define ATTRS      400000	/* distinct attribute sets */
+#define CHURN      (2 * PREFIXES)	/* updates after convergence */
+
+/* Workload, shared by both runs. */
+static struct aspath **aspaths;
+static struct attr *attrs;
+static unsigned int *attr_aspath;	/* path index of each attr */
+static unsigned int *converge;		/* attr of each prefix */
+static unsigned int *churn_prefix;	/* prefix updated by each update */
+static unsigned int *churn_attr;	/* and its new attr */
+
+/* Per run state. */
+static unsigned int *attr_refcnt;
+static unsigned int *aspath_refcnt;
+static unsigned int *prefix_attr;
+
+/* The table operations being measured. */
+struct table_ops
+{
+  const char *name;
+  void *(*create) (unsigned int (*) (void *),
+		   int (*) (const void *, const void *));
+  void *(*get) (void *, void *);
+  void *(*release) (void *, void *);
+  unsigned long (*bytes) (void *);
+  void (*destroy) (void *);
+};
+
+static void *
+chained_create (unsigned int (*key) (void *),
+		int (*cmp) (const void *, const void *))
+{
+  return hash_create (key, cmp);
+}
+
+static void *
+chained_get (void *h, void *data)
+{
+  return hash_get (h, data, hash_alloc_intern);
+}
+
+static void *
+chained_release (void *h, void *data)
+{
+  return hash_release (h, data);
+}
+
+static unsigned long
+chained_bytes (void *p)
+{
+  struct hash *h = p;
+
+  return h->count * sizeof (struct hash_backet)
+	 + (h->size + h->old_size) * sizeof (struct hash_backet *);
+}
+
+static void
+chained_destroy (void *h)
+{
+  hash_clean (h, NULL);
+  hash_free (h);
+}
+
+static void *
+open_create (unsigned int (*key) (void *),
+	     int (*cmp) (const void *, const void *))
+{
+  return ohash_create (key, cmp);
+}
+
+static void *
+open_get (void *h, void *data)
+{
+  return ohash_get (h, data, hash_alloc_intern);
+}
+
+static void *
+open_release (void *h, void *data)
+{
+  return ohash_release (h, data);
+}
+
+static unsigned long
+open_bytes (void *p)
+{
+  struct ohash *h = p;
+
+  return h->size * sizeof (struct ohash_slot);
+}
+
+static void
+open_destroy (void *h)
+{
+  ohash_clean (h, NULL);
+  ohash_free (h);
+}
+
+static const struct table_ops tables[] =
+{
+  { "hash", chained_create, chained_get, chained_release, chained_bytes,
+    chained_destroy },
+  { "ohash", open_create, open_get, open_release, open_bytes,
+    open_destroy },
+};
+
+/* Like bgp_attr_intern(): every intern looks the attribute up, a new one
+   holds a reference on its AS path.  */
+static void
+intern (const struct table_ops *ops, void *attrh, void *ash, unsigned int i)
+{
+  struct attr *attr = &attrs[i];
+
+  ops->get (attrh, attr);
+  if (attr_refcnt[i]++ == 0)
+    {
+      ops->get (ash, attr->aspath);
+      aspath_refcnt[attr_aspath[i]]++;
+    }
+}
+
+static void
+unintern (const struct table_ops *ops, void *attrh, void *ash, unsigned int i)
+{
+  struct attr *attr = &attrs[i];
+
+  if (--attr_refcnt[i] == 0)
+    {
+      ops->release (attrh, attr);
+      if (--aspath_refcnt[attr_aspath[i]] == 0)
+	ops->release (ash, attr->aspath);
+    }
+}
+
+static void
+bench_run (const struct table_ops *ops)
+{
+  struct timeval start, end;
+  void *attrh, *ash;
+  unsigned long bytes, objects;
+  unsigned int i;
+  double r_converge, r_churn, r_teardown;
+
+  memset (attr_refcnt, 0, ATTRS * sizeof (unsigned int));
+  memset (aspath_refcnt, 0, ASPATHS * sizeof (unsigned int));
+
+  attrh = ops->create (attrhash_key_make, attrhash_cmp);
+  ash = ops->create (aspath_key_make, aspath_cmp);
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  for (i = 0; i < PREFIXES; i++)
+    {
+      prefix_attr[i] = converge[i];
+      intern (ops, attrh, ash, converge[i]);
+    }
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &end);
+  r_converge = rate (PREFIXES, &end, &start);
+
+  bytes = ops->bytes (attrh) + ops->bytes (ash);
+  objects = 0;
+  for (i = 0; i < ATTRS; i++)
+    objects += (attr_refcnt[i] != 0);
+  for (i = 0; i < ASPATHS; i++)
+    objects += (aspath_refcnt[i] != 0);
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  for (i = 0; i < CHURN; i++)
+    {
+      unsigned int p = churn_prefix[i];
+
+      intern (ops, attrh, ash, churn_attr[i]);
+      unintern (ops, attrh, ash, prefix_attr[p]);
+      prefix_attr[p] = churn_attr[i];
+    }
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &end);
+  r_churn = rate (CHURN, &end, &start);
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  for (i = 0; i < PREFIXES; i++)
+    unintern (ops, attrh, ash, prefix_attr[i]);
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &end);
+  r_teardown = rate (PREFIXES, &end, &start);
+
+  printf ("%-6s converge %9.0f/s  churn %9.0f/s  teardown %9.0f/s  "
+	  "%5.1f bytes/object (%lu objects)\n",
+	  ops->name, r_converge, r_churn, r_teardown,
+	  (double) bytes / objects, objects);
+
+  ops->destroy (attrh);
+  ops->destroy (ash);
+}
+
+/* Pick from [0, n) with a skew towards low numbers, so a few attribute
+   sets are shared by many prefixes as in a real table.  */
+static unsigned int
+skewed (unsigned int n)
+{
+  unsigned long r = random () % n;
+
+  return (r * (random () % n)) / n;
+}
+
+static void
+workload_init (void)
+{
+  char buf[128];
+  unsigned int i, j, len;
+  int pos;
+
+  srandom (1);
+
+  aspaths = XCALLOC (MTYPE_TMP, ASPATHS * sizeof (struct aspath *));
+  for (i = 0; i < ASPATHS; i++)
+    {
+      /* The last AS is unique, so all paths are distinct.  */
+      pos = 0;
+      len = 1 + random () % 6;
+      for (j = 0; j < len; j++)
+	pos += snprintf (buf + pos, sizeof (buf) - pos, "%ld ",
+			 1 + random () % 64000);
+      snprintf (buf + pos, sizeof (buf) - pos, "%u", 100000 + i);
+      aspaths[i] = aspath_str2aspath (buf);
+      aspath_key_make (aspaths[i]);
+    }
+
+  /* Each attribute set: a path and one of 32 nexthops.  The MED keeps
+     all of them distinct. */
+  attrs = XCALLOC (MTYPE_TMP, ATTRS * sizeof (struct attr));
+  attr_aspath = XCALLOC (MTYPE_TMP, ATTRS * sizeof (unsigned int));
+  for (i = 0; i < ATTRS; i++)
+    {
+      j = (i < ASPATHS) ? i : skewed (ASPATHS);
+      attr_aspath[i] = j;
+      attrs[i].aspath = aspaths[j];
+      attrs[i].nexthop.s_addr = htonl (0x0a000001 + random () % 32);
+      attrs[i].med = i;
+      attrs[i].local_pref = 100;
+      attrs[i].flag = ATTR_FLAG_BIT (BGP_ATTR_AS_PATH)
+		      | ATTR_FLAG_BIT (BGP_ATTR_NEXT_HOP);
+    }
+
+  converge = XCALLOC (MTYPE_TMP, PREFIXES * sizeof (unsigned int));
+  for (i = 0; i < PREFIXES; i++)
+    converge[i] = skewed (ATTRS);
+
+  churn_prefix = XCALLOC (MTYPE_TMP, CHURN * sizeof (unsigned int));
+  churn_attr = XCALLOC (MTYPE_TMP, CHURN * sizeof (unsigned int));
+  for (i = 0; i < CHURN; i++)
+    {
+      churn_prefix[i] = random () % PREFIXES;
+      churn_attr[i] = skewed (ATTRS);
+    }
+
+  attr_refcnt = XCALLOC (MTYPE_TMP, ATTRS * sizeof (unsigned int));
+  aspath_refcnt = XCALLOC (MTYPE_TMP, ASPATHS * sizeof (unsigned int));
+  prefix_attr = XCALLOC (MTYPE_TMP, PREFIXES * sizeof (unsigned int));
+}
+
+int
+main (void)
+{
+  unsigned int i;
+
+  workload_init ();
+
+  printf ("%u prefixes, %u AS paths, %u attribute sets, %u updates\n",
+	  PREFIXES, ASPATHS, ATTRS, CHURN);
+  for (i = 0; i < sizeof (tables) / sizeof (tables[0]); i++)
+    bench_run (&tables[i]);
+
+  return 0;
+}
@@ -0,0 +1,147 @@
+/*
+ * Benchmark of synchronous against asynchronous logging.
+ *
+ * Logs debug messages to a file the way "debug bgp updates" does, in
+ * bursts of BURST with a short pause in between like an event loop
+ * waiting for input, first synchronously and then with "log async".
+ * Reports how long the logging pthread was held up per message, the
+ * worst single call, and how many messages made it to the file.  Both
+ * are repeated with several pthreads logging at once.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+#include <pthread.h>
+
+#include "log.h"
+#include "memory.h"
+#include "thread.h"
+
+#include "test-common.h"
+
+struct thread_master *master;
+
+#define MESSAGES   200000
+#define BURST      200
+#define PAUSE_USEC 1000
+#define PRODUCERS  4
+
+struct producer
+{
+  unsigned int count;
+  unsigned long usec;
+  unsigned long worst;
+};
+
+static void *
+produce (void *arg)
+{
+  struct producer *p = arg;
+  struct timeval t0, t1;
+  unsigned long usec;
+  unsigned int i;
+
+  for (i = 0; i < p->count; i++)
+    {
+      if (i % BURST == 0)
+	usleep (PAUSE_USEC);
+      quagga_gettime (QUAGGA_CLK_MONOTONIC, &t0);
+      zlog_debug ("Rcvd UPDATE w/ attr: nexthop 10.0.%u.%u, origin i, "
+		  "path 65001 65002 %u, 192.168.%u.0/24", (i >> 8) & 0xff,
+		  i & 0xff, i, i & 0xff);
+      quagga_gettime (QUAGGA_CLK_MONOTONIC, &t1);
+      usec = tv_usec (&t1, &t0);
+      p->usec += usec;
+      if (usec > p->worst)
+	p->worst = usec;
+    }
+
+  return NULL;
+}
+
+static unsigned long
+count_lines (const char *path)
+{
+  FILE *fp;
+  unsigned long n = 0;
+  int c;
+
+  if ((fp = fopen (path, "r")) == NULL)
+    return 0;
+  while ((c = getc (fp)) != EOF)
+    n += (c == '\n');
+  fclose (fp);
+  return n;
+}
+
+static void
+bench_run (const char *label, const char *path, int async, int producers)
+{
+  pthread_t tid[PRODUCERS];
+  struct producer p[PRODUCERS];
+  unsigned long queued, written, dropped = 0, usec = 0, worst = 0;
+  int i;
+
+  unlink (path);
+  zlog_set_file (NULL, path, LOG_DEBUG);
+  zlog_set_async (NULL, async);
+
+  memset (p, 0, sizeof (p));
+  for (i = 0; i < producers; i++)
+    {
+      p[i].count = MESSAGES / producers;
+      pthread_create (&tid[i], NULL, produce, &p[i]);
+    }
+  for (i = 0; i < producers; i++)
+    {
+      pthread_join (tid[i], NULL);
+      usec += p[i].usec;
+      if (p[i].worst > worst)
+	worst = p[i].worst;
+    }
+
+  if (async)
+    zlog_async_stats (NULL, &queued, &written, &dropped);
+  zlog_set_async (NULL, 0);
+  zlog_reset_file (NULL);
+
+  printf ("%-6s %d pthread(s): %6.2f usec/message, worst %6lu usec, "
+	  "%lu of %u in the file, %lu dropped\n", label, producers,
+	  (double) usec / MESSAGES, worst, count_lines (path), MESSAGES,
+	  dropped);
+  unlink (path);
+}
+
+int
+main (int argc, char **argv)
+{
+  char path[64];
+
+  snprintf (path, sizeof (path), "/tmp/benchlog.%d", (int) getpid ());
+  zlog_default = openzlog ("benchlog", ZLOG_NONE, 0, LOG_DAEMON);
+  zlog_set_level (NULL, ZLOG_DEST_MONITOR, ZLOG_DISABLED);
+
+  bench_run ("sync", path, 0, 1);
+  bench_run ("async", path, 1, 1);
+  bench_run ("sync", path, 0, PRODUCERS);
+  bench_run ("async", path, 1, PRODUCERS);
+
+  closezlog (zlog_default);
+  return 0;
+}
@@ -0,0 +1,211 @@
+/*
+ * Benchmark of applying prefix-lists.
+ *
+ * Builds IRR generated like IPv4 prefix-lists of 10, 1000 and 100000
+ * entries, mostly exact permits with every 8th allowing more specifics
+ * up to /24 and every 64th a deny, then times prefix_list_apply() on a
+ * mix of listed prefixes, more specifics of them and random ones against
+ * the walk of the entries in sequence order it used to do, checking both
+ * give the same answers.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "prefix.h"
+#include "plist.h"
+#include "memory.h"
+#include "thread.h"
+
+#include "test-common.h"
+
+struct thread_master *master;
+
+#define LOOKUPS       1000000
+#define WALK_BUDGET   200000000UL	/* entries the walk may try per size */
+
+/* The entries, in sequence order, and what they say. */
+static struct orf_prefix *entries;
+static int *permits;
+
+static struct prefix *lookups;
+
+/* The walk, as lib/plist.c had it. */
+static enum prefix_list_type
+walk_apply (unsigned int count, struct prefix *p)
+{
+  struct orf_prefix *e;
+  unsigned int i;
+
+  for (i = 0; i < count; i++)
+    {
+      e = &entries[i];
+      if (! prefix_match (&e->p, p))
+	continue;
+      if (! e->le && ! e->ge)
+	{
+	  if (e->p.prefixlen != p->prefixlen)
+	    continue;
+	}
+      else
+	{
+	  if (e->le && p->prefixlen > e->le)
+	    continue;
+	  if (e->ge && p->prefixlen < e->ge)
+	    continue;
+	}
+      return permits[i] ? PREFIX_PERMIT : PREFIX_DENY;
+    }
+  return PREFIX_DENY;
+}
+
+static void
+random_prefix (struct prefix *p, u_char len)
+{
+  memset (p, 0, sizeof (*p));
+  p->family = AF_INET;
+  p->prefixlen = len;
+  p->u.prefix4.s_addr = htonl ((1 + random () % 223) << 24
+			       | (random () & 0xffffff));
+  apply_mask (p);
+}
+
+static void
+workload_init (unsigned int count)
+{
+  unsigned int i;
+
+  srandom (count);
+  for (i = 0; i < count; i++)
+    {
+      memset (&entries[i], 0, sizeof (entries[i]));
+      entries[i].seq = (i + 1) * 5;
+      random_prefix (&entries[i].p, 16 + random () % 9);
+      if (i % 8 == 0 && entries[i].p.prefixlen < 24)
+	entries[i].le = 24;
+      permits[i] = (i % 64 != 63);
+    }
+
+  for (i = 0; i < LOOKUPS; i++)
+    {
+      struct orf_prefix *e = &entries[random () % count];
+
+      switch (random () % 4)
+	{
+	case 0:		/* listed */
+	  lookups[i] = e->p;
+	  break;
+	case 1:		/* a more specific */
+	  lookups[i] = e->p;
+	  lookups[i].u.prefix4.s_addr
+	    |= htonl (random () & (0xffffffff >> e->p.prefixlen));
+	  lookups[i].prefixlen = e->p.prefixlen
+	    + random () % (25 - e->p.prefixlen);
+	  apply_mask (&lookups[i]);
+	  break;
+	default:	/* anywhere */
+	  random_prefix (&lookups[i], 16 + random () % 9);
+	  break;
+	}
+    }
+}
+
+static void
+bench_run (unsigned int count)
+{
+  struct prefix_list *plist;
+  struct timeval start, end;
+  char name[] = "bench";
+  unsigned int i, walks, permitted;
+  double r_build, r_apply, r_walk, r_delete;
+
+  workload_init (count);
+
+  /* Duplicates of earlier entries are refused, and could never be the
+     first match anyway. */
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  for (i = 0; i < count; i++)
+    prefix_bgp_orf_set (name, AFI_IP, &entries[i], permits[i], 1);
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &end);
+  r_build = rate (count, &end, &start);
+
+  plist = prefix_list_lookup (AFI_ORF_PREFIX, name);
+
+  permitted = 0;
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  for (i = 0; i < LOOKUPS; i++)
+    if (prefix_list_apply (plist, &lookups[i]) == PREFIX_PERMIT)
+      permitted++;
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &end);
+  r_apply = rate (LOOKUPS, &end, &start);
+
+  walks = WALK_BUDGET / count;
+  if (walks > LOOKUPS)
+    walks = LOOKUPS;
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  for (i = 0; i < walks; i++)
+    walk_apply (count, &lookups[i]);
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &end);
+  r_walk = rate (walks, &end, &start);
+
+  for (i = 0; i < walks; i++)
+    if (prefix_list_apply (plist, &lookups[i])
+	!= walk_apply (count, &lookups[i]))
+      {
+	char buf[INET_ADDRSTRLEN];
+
+	fprintf (stderr, "%u entries: %s/%d differs from the walk\n", count,
+		 inet_ntop (AF_INET, &lookups[i].u.prefix4, buf, sizeof (buf)),
+		 lookups[i].prefixlen);
+	exit (1);
+      }
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  for (i = 0; i < count; i++)
+    prefix_bgp_orf_set (name, AFI_IP, &entries[i], permits[i], 0);
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &end);
+  r_delete = rate (count, &end, &start);
+
+  if (prefix_list_lookup (AFI_ORF_PREFIX, name) != NULL)
+    {
+      fprintf (stderr, "%u entries: list left after delete\n", count);
+      exit (1);
+    }
+
+  printf ("%6u entries: add %9.0f/s  apply %9.0f/s (%u%% permit)  "
+	  "walk %9.0f/s  delete %9.0f/s\n",
+	  count, r_build, r_apply, permitted * 100 / LOOKUPS, r_walk,
+	  r_delete);
+}
+
+int
+main (void)
+{
+  static const unsigned int sizes[] = { 10, 1000, 100000 };
+  unsigned int i;
+
+  entries = XCALLOC (MTYPE_TMP, 100000 * sizeof (struct orf_prefix));
+  permits = XCALLOC (MTYPE_TMP, 100000 * sizeof (int));
+  lookups = XCALLOC (MTYPE_TMP, LOOKUPS * sizeof (struct prefix));
+
+  for (i = 0; i < sizeof (sizes) / sizeof (sizes[0]); i++)
+    bench_run (sizes[i]);
+
+  return 0;
+}
@@ -0,0 +1,414 @@
+/*
+ * Benchmark of reading UPDATEs from a peer.
+ *
+ * Replays the UPDATEs one peer sent in an MRT file of BGP4MP records,
+ * as "dump bgp updates" writes them, to that peer made Established on
+ * one end of a socketpair, and times until bgpd has taken all of them:
+ * read on the main thread a message at a time, as before a session is
+ * handed on, and read by the I/O pthread in large chunks.  Each is run
+ * in a child of its own, with a table empty to start with.  With no
+ * file given, a full table of 500k prefixes is made up.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+#include <sys/wait.h>
+
+#include "command.h"
+#include "vty.h"
+#include "privs.h"
+#include "memory.h"
+#include "thread.h"
+#include "stream.h"
+#include "network.h"
+#include "prefix.h"
+#include "sockunion.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_aspath.h"
+#include "bgpd/bgp_fsm.h"
+#include "bgpd/bgp_packet.h"
+#include "bgpd/bgp_dump.h"
+#include "bgpd/bgp_io.h"
+
+#include "test-common.h"
+
+/* need these to link in libbgp */
+struct zebra_privs_t *bgpd_privs = NULL;
+struct thread_master *master = NULL;
+
+#define PREFIXES  500000
+#define PEER_AS   65001
+#define LOCAL_AS  65000
+
+#define MSG_PROTOCOL_BGP4MP_ET  17
+
+/* The UPDATEs to replay, one after the other as on the wire. */
+static struct
+{
+  u_char *data;
+  size_t size;
+  size_t alloc;
+  unsigned long msgs;
+
+  /* The peer that sent them. */
+  int afi;
+  u_char addr[16];
+  as_t as;
+  as_t local_as;
+  int as4;
+} replay;
+
+static void
+put_mrt (FILE *fp, struct stream *msg)
+{
+  struct stream *s = stream_new (BGP_MAX_PACKET_SIZE + 64);
+
+  stream_putl (s, 0);
+  stream_putw (s, MSG_PROTOCOL_BGP4MP);
+  stream_putw (s, BGP4MP_MESSAGE_AS4);
+  stream_putl (s, 20 + stream_get_endp (msg));
+  stream_putl (s, PEER_AS);
+  stream_putl (s, LOCAL_AS);
+  stream_putw (s, 0);
+  stream_putw (s, AFI_IP);
+  stream_putl (s, 0x0a000001);	/* 10.0.0.1 */
+  stream_putl (s, 0x0a0000fe);	/* 10.0.0.254 */
+  stream_put (s, STREAM_DATA (msg), stream_get_endp (msg));
+  fwrite (STREAM_DATA (s), stream_get_endp (s), 1, fp);
+  stream_free (s);
+}
+
+/* Writes a made up full table, UPDATEs of 1 to 6 /24s and a few
+   shorter prefixes each, with AS paths of 3 to 7 ASes and MEDs. */
+static FILE *
+table_write (void)
+{
+  struct stream *s;
+  unsigned long i, p;
+  int n, len, j;
+  size_t attrlen;
+  FILE *fp;
+
+  fp = tmpfile ();
+  if (fp == NULL)
+    {
+      perror ("tmpfile");
+      exit (1);
+    }
+
+  srandom (1);
+  s = stream_new (BGP_MAX_PACKET_SIZE);
+  for (p = 0; p < PREFIXES; p += n)
+    {
+      n = 1 + random () % 6;
+      if (p + n > PREFIXES)
+	n = PREFIXES - p;
+      len = 3 + random () % 5;
+
+      stream_reset (s);
+      for (i = 0; i < BGP_MARKER_SIZE; i++)
+	stream_putc (s, 0xff);
+      stream_putw (s, 0);
+      stream_putc (s, BGP_MSG_UPDATE);
+      stream_putw (s, 0);		/* withdrawn */
+      attrlen = stream_get_endp (s);
+      stream_putw (s, 0);
+
+      stream_putc (s, BGP_ATTR_FLAG_TRANS);
+      stream_putc (s, BGP_ATTR_ORIGIN);
+      stream_putc (s, 1);
+      stream_putc (s, random () % 8 ? BGP_ORIGIN_IGP : BGP_ORIGIN_INCOMPLETE);
+
+      stream_putc (s, BGP_ATTR_FLAG_TRANS);
+      stream_putc (s, BGP_ATTR_AS_PATH);
+      stream_putc (s, 2 + 4 * len);
+      stream_putc (s, AS_SEQUENCE);
+      stream_putc (s, len);
+      stream_putl (s, PEER_AS);
+      for (j = 1; j < len; j++)
+	stream_putl (s, 1 + random () % 64511);
+
+      stream_putc (s, BGP_ATTR_FLAG_TRANS);
+      stream_putc (s, BGP_ATTR_NEXT_HOP);
+      stream_putc (s, 4);
+      stream_putl (s, 0x0a000001);
+
+      if (random () % 4 == 0)
+	{
+	  stream_putc (s, BGP_ATTR_FLAG_OPTIONAL);
+	  stream_putc (s, BGP_ATTR_MULTI_EXIT_DISC);
+	  stream_putc (s, 4);
+	  stream_putl (s, random () % 1000);
+	}
+      stream_putw_at (s, attrlen, stream_get_endp (s) - attrlen - 2);
+
+      for (i = p; i < p + n; i++)
+	{
+	  /* /24s and a few shorter, from 1.0.0.0 on. */
+	  int plen = i % 10 ? 24 : 20 + i % 4;
+
+	  stream_putc (s, plen);
+	  stream_putc (s, 1 + (i >> 16));
+	  stream_putc (s, (i >> 8) & 0xff);
+	  stream_putc (s, i & 0xff);
+	}
+      stream_putw_at (s, BGP_MARKER_SIZE, stream_get_endp (s));
+      put_mrt (fp, s);
+    }
+  stream_free (s);
+
+  rewind (fp);
+  return fp;
+}
+
+static void
+replay_add (u_char *msg, size_t size)
+{
+  if (replay.size + size > replay.alloc)
+    {
+      replay.alloc = replay.alloc ? replay.alloc * 2 : 1 << 20;
+      replay.data = realloc (replay.data, replay.alloc);
+    }
+  memcpy (replay.data + replay.size, msg, size);
+  replay.size += size;
+  replay.msgs++;
+}
+
+/* Takes the UPDATEs of the peer of the first BGP4MP message record. */
+static void
+replay_load (FILE *fp)
+{
+  u_char hdr[BGP_DUMP_HEADER_SIZE];
+  u_char *rec = NULL, *pnt, *end;
+  size_t reclen, alloc = 0, iplen;
+  int type, subtype, afi, as4;
+  as_t as, local_as;
+
+  while (fread (hdr, sizeof (hdr), 1, fp) == 1)
+    {
+      type = (hdr[4] << 8) | hdr[5];
+      subtype = (hdr[6] << 8) | hdr[7];
+      reclen = ((size_t) hdr[8] << 24) | (hdr[9] << 16) | (hdr[10] << 8)
+	       | hdr[11];
+      if (reclen > alloc)
+	{
+	  alloc = reclen;
+	  rec = realloc (rec, alloc);
+	}
+      if (fread (rec, reclen, 1, fp) != 1)
+	break;
+
+      pnt = rec;
+      end = rec + reclen;
+      if (type == MSG_PROTOCOL_BGP4MP_ET)
+	pnt += 4;
+      else if (type != MSG_PROTOCOL_BGP4MP)
+	continue;
+      if (subtype != BGP4MP_MESSAGE && subtype != BGP4MP_MESSAGE_AS4)
+	continue;
+
+      as4 = (subtype == BGP4MP_MESSAGE_AS4);
+      if (as4)
+	{
+	  as = (pnt[0] << 24) | (pnt[1] << 16) | (pnt[2] << 8) | pnt[3];
+	  local_as = (pnt[4] << 24) | (pnt[5] << 16) | (pnt[6] << 8) | pnt[7];
+	  pnt += 8;
+	}
+      else
+	{
+	  as = (pnt[0] << 8) | pnt[1];
+	  local_as = (pnt[2] << 8) | pnt[3];
+	  pnt += 4;
+	}
+      afi = (pnt[2] << 8) | pnt[3];
+      pnt += 4;
+      iplen = (afi == AFI_IP6) ? 16 : 4;
+      if (pnt + 2 * iplen + BGP_HEADER_SIZE > end)
+	continue;
+
+      if (replay.afi == 0)
+	{
+	  replay.afi = afi;
+	  memcpy (replay.addr, pnt, iplen);
+	  replay.as = as;
+	  replay.local_as = local_as;
+	  replay.as4 = as4;
+	}
+      else if (afi != replay.afi || memcmp (replay.addr, pnt, iplen))
+	continue;
+      pnt += 2 * iplen;
+
+      if (pnt[BGP_MARKER_SIZE + 2] == BGP_MSG_UPDATE)
+	replay_add (pnt, end - pnt);
+    }
+  free (rec);
+
+  if (replay.msgs == 0)
+    {
+      fprintf (stderr, "no UPDATEs in the file\n");
+      exit (1);
+    }
+}
+
+static void *
+writer (void *arg)
+{
+  int fd = *(int *) arg;
+  size_t done = 0;
+  ssize_t n;
+
+  while (done < replay.size)
+    {
+      n = write (fd, replay.data + done, replay.size - done);
+      if (n < 0)
+	{
+	  perror ("write");
+	  exit (1);
+	}
+      done += n;
+    }
+  return NULL;
+}
+
+/* Replays the UPDATEs to the peer, by the I/O pthread if io. */
+static void
+bench_run (struct peer *peer, int io, const char *name)
+{
+  struct timeval start, end;
+  struct thread thread;
+  pthread_t tid;
+  unsigned long usec;
+  int sv[2];
+
+  if (socketpair (AF_UNIX, SOCK_STREAM, 0, sv) < 0)
+    {
+      perror ("socketpair");
+      exit (1);
+    }
+  set_nonblocking (sv[0]);
+
+  /* Nothing of the configuring may go on with the session. */
+  BGP_EVENT_FLUSH (peer);
+  BGP_TIMER_OFF (peer->t_start);
+  BGP_TIMER_OFF (peer->t_connect);
+
+  peer->fd = sv[0];
+  peer->status = Established;
+  peer->v_holdtime = 0;
+  peer->afc_nego[AFI_IP][SAFI_UNICAST] = 1;
+  peer->afc_nego[AFI_IP6][SAFI_UNICAST] = 1;
+  if (replay.as4)
+    SET_FLAG (peer->cap, PEER_CAP_AS4_RCV | PEER_CAP_AS4_ADV);
+
+  if (io)
+    {
+      bgp_io_start ();
+      bgp_io_peer_start (peer);
+    }
+  else
+    BGP_READ_ON (peer->t_read, bgp_read, peer->fd);
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  pthread_create (&tid, NULL, writer, &sv[1]);
+  while (peer->update_in < replay.msgs && thread_fetch (master, &thread))
+    thread_call (&thread);
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &end);
+  pthread_join (tid, NULL);
+
+  usec = tv_usec (&end, &start);
+  printf ("%-28s %6lu ms %9.0f messages/s %7.1f MB/s\n", name,
+	  usec / 1000, replay.msgs * 1000000.0 / (usec ? usec : 1),
+	  replay.size / (usec ? (double) usec : 1.0));
+}
+
+int
+main (int argc, char **argv)
+{
+  struct vty *vty;
+  struct peer *peer;
+  union sockunion su;
+  char buf[128], addr[INET6_ADDRSTRLEN];
+  FILE *fp;
+  int io, status;
+
+  signal (SIGPIPE, SIG_IGN);
+  bgp_master_init ();
+  master = bm->master;
+  bgp_option_set (BGP_OPT_NO_LISTEN);
+
+  cmd_init (1);
+  vty_init (master);
+  memory_init ();
+  bgp_init ();
+  sort_node ();
+
+  if (argc > 1)
+    {
+      fp = fopen (argv[1], "r");
+      if (fp == NULL)
+	{
+	  perror (argv[1]);
+	  exit (1);
+	}
+    }
+  else
+    fp = table_write ();
+  replay_load (fp);
+  fclose (fp);
+
+  inet_ntop (replay.afi == AFI_IP6 ? AF_INET6 : AF_INET, replay.addr,
+	     addr, sizeof (addr));
+  printf ("%lu UPDATEs from %s AS %u, %zu bytes\n", replay.msgs, addr,
+	  replay.as, replay.size);
+
+  vty = vty_new ();
+  vty->type = VTY_TERM;
+  vty->node = CONFIG_NODE;
+  snprintf (buf, sizeof (buf), "router bgp %u",
+	    replay.local_as ? replay.local_as : LOCAL_AS);
+  execute (vty, buf);
+  execute (vty, "bgp router-id 10.0.0.254");
+  snprintf (buf, sizeof (buf), "neighbor %s remote-as %u", addr, replay.as);
+  execute (vty, buf);
+  if (replay.local_as != replay.as)
+    {
+      snprintf (buf, sizeof (buf), "neighbor %s disable-connected-check",
+		addr);
+      execute (vty, buf);
+    }
+
+  str2sockunion (addr, &su);
+  peer = peer_lookup (bgp_get_default (), &su);
+
+  for (io = 0; io <= 1; io++)
+    {
+      fflush (stdout);
+      if (fork () == 0)
+	{
+	  bench_run (peer, io, io ? "I/O pthread, 64KB reads"
+		     : "main thread, per message");
+	  exit (0);
+	}
+      wait (&status);
+    }
+
+  return 0;
+}
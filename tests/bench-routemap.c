@@ -0,0 +1,302 @@
+/*
+ * Benchmark of the route-map result cache.
+ *
+ * Applies a route-map of AS path regular expressions, as filters of
+ * customer and transit paths look, with one prefix length entry among
+ * them, to 200k routes sharing 2000 distinct AS paths.  Times
+ * route_map_apply() against route_map_apply_cached() keyed by the path,
+ * checking both give the same answers, and prints the counters "show
+ * route-map" has for the entries.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+#include <regex.h>
+
+#include "command.h"
+#include "vty.h"
+#include "prefix.h"
+#include "routemap.h"
+#include "memory.h"
+#include "thread.h"
+
+#include "test-common.h"
+
+struct thread_master *master;
+
+#define ROUTES  200000
+#define PATHS   2000
+
+/* What the matches look at. */
+struct route
+{
+  struct prefix p;
+  unsigned long path;		/* number of the path, from 1 */
+};
+
+static char *paths[PATHS + 1];
+static struct route *routes;
+
+static const char *config[] =
+{
+  "route-map BENCH deny 10",
+  " match as-path _6451[2-9]_",
+  "route-map BENCH deny 20",
+  " match as-path _(174|1299|3356)_(174|1299|3356)_",
+  "route-map BENCH deny 30",
+  " match length 25",
+  "route-map BENCH permit 40",
+  " match as-path ^65000_([0-9]+_)*[0-9]+$",
+  "route-map BENCH deny 50",
+  " match as-path _23456_",
+  "route-map BENCH permit 60",
+  " match as-path ^(174|1299|3356)_",
+  NULL
+};
+
+/* `match as-path REGEX', on the path as a string as bgpd has it. */
+static route_map_result_t
+match_aspath (void *rule, struct prefix *prefix, route_map_object_t type,
+	      void *object)
+{
+  struct route *route = object;
+
+  return regexec (rule, paths[route->path], 0, NULL, 0) == 0
+    ? RMAP_MATCH : RMAP_NOMATCH;
+}
+
+static void *
+match_aspath_compile (const char *arg)
+{
+  regex_t *regex;
+  char *str, *c;
+
+  /* '_' stands for the start, end or a space, as in bgp_regcomp(). */
+  str = XMALLOC (MTYPE_TMP, strlen (arg) * 8 + 1);
+  for (c = str; *arg; arg++)
+    if (*arg == '_')
+      c += sprintf (c, "(^|[ ]|$)");
+    else
+      *c++ = *arg;
+  *c = '\0';
+
+  regex = XMALLOC (MTYPE_TMP, sizeof (regex_t));
+  if (regcomp (regex, str, REG_EXTENDED | REG_NOSUB) != 0)
+    {
+      XFREE (MTYPE_TMP, regex);
+      regex = NULL;
+    }
+  XFREE (MTYPE_TMP, str);
+  return regex;
+}
+
+static void
+match_aspath_free (void *rule)
+{
+  regfree (rule);
+  XFREE (MTYPE_TMP, rule);
+}
+
+static struct route_map_rule_cmd match_aspath_cmd =
+{
+  "as-path",
+  match_aspath,
+  match_aspath_compile,
+  match_aspath_free,
+  1
+};
+
+/* `match length LEN', which looks at the prefix. */
+static route_map_result_t
+match_length (void *rule, struct prefix *prefix, route_map_object_t type,
+	      void *object)
+{
+  return prefix->prefixlen == *(u_char *) rule ? RMAP_MATCH : RMAP_NOMATCH;
+}
+
+static void *
+match_length_compile (const char *arg)
+{
+  u_char *len = XMALLOC (MTYPE_TMP, sizeof (u_char));
+
+  *len = atoi (arg);
+  return len;
+}
+
+static void
+match_length_free (void *rule)
+{
+  XFREE (MTYPE_TMP, rule);
+}
+
+static struct route_map_rule_cmd match_length_cmd =
+{
+  "length",
+  match_length,
+  match_length_compile,
+  match_length_free
+};
+
+DEFUN (match_aspath_bench,
+       match_aspath_bench_cmd,
+       "match as-path WORD",
+       "Match values\n"
+       "AS path\n"
+       "Regular expression\n")
+{
+  return route_map_add_match (vty->index, "as-path", argv[0])
+    ? CMD_WARNING : CMD_SUCCESS;
+}
+
+DEFUN (match_length_bench,
+       match_length_bench_cmd,
+       "match length <0-32>",
+       "Match values\n"
+       "Prefix length\n"
+       "Length\n")
+{
+  return route_map_add_match (vty->index, "length", argv[0])
+    ? CMD_WARNING : CMD_SUCCESS;
+}
+
+static unsigned long
+route_key (void *object)
+{
+  return ((struct route *) object)->path;
+}
+
+static const int transits[] = { 174, 1299, 3356, 6939, 2914 };
+
+static void
+setup (void)
+{
+  struct vty *vty;
+  vector vline;
+  char buf[128];
+  unsigned int i, j, len;
+  int n;
+
+  cmd_init (1);
+  route_map_init ();
+  route_map_init_vty ();
+  route_map_install_match (&match_aspath_cmd);
+  route_map_install_match (&match_length_cmd);
+  install_element (RMAP_NODE, &match_aspath_bench_cmd);
+  install_element (RMAP_NODE, &match_length_bench_cmd);
+
+  vty = vty_new ();
+  vty->type = VTY_TERM;
+  vty->node = CONFIG_NODE;
+  for (i = 0; config[i]; i++)
+    {
+      vline = cmd_make_strvec (config[i]);
+      if (cmd_execute_command (vline, vty, NULL, 1) != CMD_SUCCESS)
+	{
+	  fprintf (stderr, "config failed: %s\n", config[i]);
+	  exit (1);
+	}
+      cmd_free_strvec (vline);
+    }
+
+  srandom (1);
+  for (i = 1; i <= PATHS; i++)
+    {
+      /* Customers of ours, or a transit and a few networks behind. */
+      if (i % 4 == 0)
+	n = snprintf (buf, sizeof (buf), "65000");
+      else
+	n = snprintf (buf, sizeof (buf), "%d",
+		      transits[random () % 5]);
+      len = 1 + random () % 5;
+      for (j = 0; j < len; j++)
+	n += snprintf (buf + n, sizeof (buf) - n, " %ld",
+		       j == 0 && i % 7 == 0 ? transits[random () % 5]
+		       : i % 53 == 0 ? 23456
+		       : 1 + random () % 65535);
+      paths[i] = XSTRDUP (MTYPE_TMP, buf);
+    }
+
+  routes = XCALLOC (MTYPE_TMP, ROUTES * sizeof (struct route));
+  for (i = 0; i < ROUTES; i++)
+    {
+      routes[i].p.family = AF_INET;
+      routes[i].p.prefixlen = 16 + random () % 10;
+      routes[i].p.u.prefix4.s_addr = random ();
+      apply_mask (&routes[i].p);
+      routes[i].path = 1 + random () % PATHS;
+    }
+}
+
+static void
+show (struct route_map *map)
+{
+  struct route_map_index *index;
+
+  for (index = map->head; index; index = index->next)
+    printf ("  sequence %d: applied %lu, matched %lu (%lu from cache), "
+	    "about %llu usecs\n", index->pref, index->applied, index->matched,
+	    index->cached, route_map_index_usecs (index));
+}
+
+int
+main (void)
+{
+  struct route_map *map;
+  struct route_map_index *index;
+  struct timeval start, end;
+  route_map_result_t *results;
+  unsigned int i, permits;
+
+  setup ();
+  map = route_map_lookup_by_name ("BENCH");
+  results = XCALLOC (MTYPE_TMP, ROUTES * sizeof (route_map_result_t));
+
+  permits = 0;
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  for (i = 0; i < ROUTES; i++)
+    if ((results[i] = route_map_apply (map, &routes[i].p, RMAP_BGP,
+				       &routes[i])) == RMAP_MATCH)
+      permits++;
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &end);
+  printf ("uncached %9.0f routes/s (%u%% permitted)\n",
+	  rate (ROUTES, &end, &start), permits * 100 / ROUTES);
+  show (map);
+
+  /* Start the counters over. */
+  for (index = map->head; index; index = index->next)
+    {
+      index->applied = index->matched = index->cached = index->timed = 0;
+      index->nsec = 0;
+    }
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  for (i = 0; i < ROUTES; i++)
+    if (route_map_apply_cached (map, &routes[i].p, RMAP_BGP, &routes[i],
+				route_key) != results[i])
+      {
+	fprintf (stderr, "route %u of path %s differs from uncached\n",
+		 i, paths[routes[i].path]);
+	exit (1);
+      }
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &end);
+  printf ("cached   %9.0f routes/s\n", rate (ROUTES, &end, &start));
+  show (map);
+
+  return 0;
+}
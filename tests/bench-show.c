@@ -0,0 +1,202 @@
+/*
+ * Benchmark of the output formats of "show ip bgp".
+ *
+ * Fills the table of a bgpd instance with 200k prefixes, each learnt
+ * from two transit peers and every fourth also over iBGP, with AS paths
+ * of a full table's length, MEDs and local preferences.  Times "show ip
+ * bgp", "show ip bgp json" and "show ip bgp binary" giving all of it,
+ * and the bytes each gives.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "command.h"
+#include "vty.h"
+#include "buffer.h"
+#include "privs.h"
+#include "memory.h"
+#include "thread.h"
+#include "prefix.h"
+#include "sockunion.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_table.h"
+#include "bgpd/bgp_route.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_aspath.h"
+
+#include "test-common.h"
+
+/* need these to link in libbgp */
+struct zebra_privs_t *bgpd_privs = NULL;
+struct thread_master *master = NULL;
+
+#define PREFIXES  200000
+#define PATHS     5000
+
+static const char *config[] =
+{
+  "router bgp 65000",
+  " bgp router-id 10.0.0.254",
+  " neighbor 10.0.0.1 remote-as 174",
+  " neighbor 10.0.0.2 remote-as 3356",
+  " neighbor 10.0.0.3 remote-as 65000",
+  NULL
+};
+
+static const char *peers[] = { "10.0.0.1", "10.0.0.2", "10.0.0.3" };
+
+static const char *shows[] =
+{
+  "show ip bgp",
+  "show ip bgp json",
+  "show ip bgp binary",
+};
+
+/* A path from the peer of the AS, of 3 to 7 ASes as in a full table. */
+static struct aspath *
+path_make (as_t first)
+{
+  char buf[128];
+  int n, i, len;
+
+  n = snprintf (buf, sizeof (buf), "%u", first);
+  len = 2 + random () % 5;
+  for (i = 0; i < len; i++)
+    n += snprintf (buf + n, sizeof (buf) - n, " %ld", 1 + random () % 64511);
+  return aspath_intern (aspath_str2aspath (buf));
+}
+
+static void
+route_add (struct bgp *bgp, struct peer *peer, struct prefix *p,
+	   struct aspath *aspath, int best)
+{
+  struct bgp_node *rn;
+  struct bgp_info *ri;
+  struct attr attr;
+
+  memset (&attr, 0, sizeof (attr));
+  bgp_attr_extra_get (&attr);
+  attr.origin = random () % 8 ? BGP_ORIGIN_IGP : BGP_ORIGIN_INCOMPLETE;
+  attr.aspath = aspath;
+  attr.nexthop = peer->su.sin.sin_addr;
+  attr.med = random () % 4 ? 0 : random () % 1000;
+  attr.local_pref = peer->as == bgp->as ? 200 : 100;
+  attr.flag = ATTR_FLAG_BIT (BGP_ATTR_ORIGIN)
+    | ATTR_FLAG_BIT (BGP_ATTR_AS_PATH) | ATTR_FLAG_BIT (BGP_ATTR_NEXT_HOP)
+    | ATTR_FLAG_BIT (BGP_ATTR_MULTI_EXIT_DISC)
+    | ATTR_FLAG_BIT (BGP_ATTR_LOCAL_PREF);
+
+  ri = XCALLOC (MTYPE_BGP_ROUTE, sizeof (struct bgp_info));
+  ri->type = ZEBRA_ROUTE_BGP;
+  ri->sub_type = BGP_ROUTE_NORMAL;
+  ri->peer = peer;
+  ri->attr = bgp_attr_intern (&attr);
+  ri->uptime = bgp_clock ();
+  SET_FLAG (ri->flags, BGP_INFO_VALID);
+  if (best)
+    SET_FLAG (ri->flags, BGP_INFO_SELECTED);
+  bgp_attr_extra_free (&attr);
+
+  rn = bgp_node_get (bgp->rib[AFI_IP][SAFI_UNICAST], p);
+  bgp_info_add (rn, ri);
+  bgp_unlock_node (rn);
+}
+
+static void
+table_fill (struct bgp *bgp)
+{
+  static struct aspath *paths[3][PATHS];
+  struct peer *peer[3];
+  union sockunion su;
+  struct prefix p;
+  unsigned int i, j;
+
+  srandom (1);
+  for (i = 0; i < 3; i++)
+    {
+      str2sockunion (peers[i], &su);
+      peer[i] = peer_lookup (bgp, &su);
+      for (j = 0; j < PATHS; j++)
+	paths[i][j] = path_make (i < 2 ? peer[i]->as : 65001);
+    }
+
+  memset (&p, 0, sizeof (p));
+  p.family = AF_INET;
+  for (i = 0; i < PREFIXES; i++)
+    {
+      /* /24s and a few shorter, from 1.0.0.0 on. */
+      p.prefixlen = i % 10 ? 24 : 20 + i % 4;
+      p.u.prefix4.s_addr = htonl ((1 << 24) + (i << 8));
+      apply_mask (&p);
+
+      route_add (bgp, peer[0], &p, paths[0][random () % PATHS], 1);
+      route_add (bgp, peer[1], &p, paths[1][random () % PATHS], 0);
+      if (i % 4 == 0)
+	route_add (bgp, peer[2], &p, paths[2][random () % PATHS], 0);
+    }
+}
+
+int
+main (void)
+{
+  struct timeval start, end;
+  struct vty *vty;
+  unsigned long usec;
+  size_t bytes;
+  unsigned int i;
+
+  bgp_master_init ();
+  master = bm->master;
+  bgp_option_set (BGP_OPT_NO_LISTEN);
+
+  cmd_init (1);
+  vty_init (master);
+  memory_init ();
+  bgp_init ();
+  sort_node ();
+
+  /* Not on a connection, so the shows give all at once. */
+  vty = vty_new ();
+  vty->type = VTY_TERM;
+  vty->node = CONFIG_NODE;
+  for (i = 0; config[i]; i++)
+    execute (vty, config[i]);
+
+  table_fill (bgp_get_default ());
+
+  for (i = 0; i < sizeof (shows) / sizeof (shows[0]); i++)
+    {
+      vty->node = ENABLE_NODE;
+      quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+      execute (vty, shows[i]);
+      quagga_gettime (QUAGGA_CLK_MONOTONIC, &end);
+      usec = tv_usec (&end, &start);
+      bytes = buffer_pending (vty->obuf);
+      buffer_reset (vty->obuf);
+
+      printf ("%-20s %6lu ms %9.0f prefixes/s %10lu bytes "
+	      "%6.1f bytes/prefix\n", shows[i], usec / 1000,
+	      PREFIXES * 1000000.0 / (usec ? usec : 1), (unsigned long) bytes,
+	      (double) bytes / PREFIXES);
+    }
+
+  return 0;
+}
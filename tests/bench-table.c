@@ -0,0 +1,238 @@
+/*
+ * Benchmark of the route_table lookups.
+ *
+ * Builds an IPv4 table of 900k prefixes and an IPv6 table of 200k with
+ * a full-table like prefix length mix, then times inserting, exact
+ * lookups, longest prefix matches of random addresses, a full walk and
+ * deleting everything again.  Run as "benchtable pool" to have the
+ * nodes allocated out of a slab pool.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+#if defined(GNU_LINUX) && defined(HAVE_MALLINFO)
+#include <malloc.h>
+#endif
+
+#include "prefix.h"
+#include "table.h"
+#include "memory.h"
+#include "thread.h"
+
+#include "test-common.h"
+
+struct thread_master *master;
+
+#define IPV4_PREFIXES  900000
+#define IPV6_PREFIXES  200000
+#define MATCHES        2000000
+
+/* Prefix length mixes, in percent of the table. */
+struct length_mix
+{
+  u_char len;
+  unsigned int percent;
+};
+
+static const struct length_mix ipv4_mix[] =
+{
+  { 24, 58 }, { 23, 8 }, { 22, 11 }, { 21, 5 }, { 20, 5 }, { 19, 4 },
+  { 18, 2 }, { 17, 1 }, { 16, 4 }, { 14, 1 }, { 12, 1 }, { 0, 0 },
+};
+
+static const struct length_mix ipv6_mix[] =
+{
+  { 48, 52 }, { 32, 15 }, { 44, 10 }, { 40, 8 }, { 36, 5 }, { 29, 3 },
+  { 56, 2 }, { 64, 2 }, { 24, 2 }, { 46, 1 }, { 0, 0 },
+};
+
+/* Bytes taken from the system allocator so far, 0 if unknown. */
+static unsigned long
+heap_used (void)
+{
+#ifdef HAVE_MALLINFO
+  struct mallinfo minfo = mallinfo ();
+
+  return (unsigned long) minfo.uordblks + minfo.hblkhd;
+#else
+  return 0;
+#endif /* HAVE_MALLINFO */
+}
+
+static u_char
+random_length (const struct length_mix *mix)
+{
+  unsigned int r = random () % 100;
+
+  for (; mix->len; mix++)
+    {
+      if (r < mix->percent)
+	return mix->len;
+      r -= mix->percent;
+    }
+  return 24;
+}
+
+static void
+random_prefix (struct prefix *p, int family, const struct length_mix *mix)
+{
+  unsigned int i;
+
+  memset (p, 0, sizeof (*p));
+  p->family = family;
+  p->prefixlen = random_length (mix);
+  if (family == AF_INET)
+    p->u.prefix4.s_addr = htonl ((1 + random () % 223) << 24
+				 | (random () & 0xffffff));
+#ifdef HAVE_IPV6
+  else
+    {
+      for (i = 0; i < 16; i++)
+	p->u.prefix6.s6_addr[i] = random ();
+      /* Global unicast, mostly out of a few /12s like the real table. */
+      p->u.prefix6.s6_addr[0] = 0x20 | (random () % 4 ? 0x00 : 0x0a);
+      p->u.prefix6.s6_addr[1] &= 0x0f;
+    }
+#endif /* HAVE_IPV6 */
+  apply_mask (p);
+}
+
+static void
+bench_run (const char *label, int family, unsigned int count,
+	   const struct length_mix *mix)
+{
+  struct route_table *table;
+  struct route_node *rn;
+  struct prefix *prefixes, p;
+  struct timeval start, end;
+  unsigned int i, found, nodes, routes;
+  unsigned long heap;
+  double r_insert, r_lookup, r_match, r_walk, r_delete;
+
+  srandom (1);
+  prefixes = XCALLOC (MTYPE_TMP, count * sizeof (struct prefix));
+  for (i = 0; i < count; i++)
+    random_prefix (&prefixes[i], family, mix);
+
+  table = route_table_init ();
+  heap = heap_used ();
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  for (i = 0; i < count; i++)
+    {
+      rn = route_node_get (table, &prefixes[i]);
+      if (rn->info)
+	route_unlock_node (rn);	/* duplicate */
+      else
+	rn->info = &prefixes[i];
+    }
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &end);
+  r_insert = rate (count, &end, &start);
+  heap = heap_used () - heap;
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  for (i = 0; i < count; i++)
+    {
+      rn = route_node_lookup (table, &prefixes[i]);
+      if (rn == NULL)
+	{
+	  fprintf (stderr, "lost prefix %u\n", i);
+	  exit (1);
+	}
+      route_unlock_node (rn);
+    }
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &end);
+  r_lookup = rate (count, &end, &start);
+
+  /* Half the addresses fall inside a known prefix, half anywhere. */
+  found = 0;
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  for (i = 0; i < MATCHES; i++)
+    {
+      if (i & 1)
+	random_prefix (&p, family, mix);
+      else
+	p = prefixes[random () % count];
+      p.prefixlen = (family == AF_INET) ? IPV4_MAX_BITLEN : IPV6_MAX_BITLEN;
+      if ((rn = route_node_match (table, &p)) != NULL)
+	{
+	  found++;
+	  route_unlock_node (rn);
+	}
+    }
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &end);
+  r_match = rate (MATCHES, &end, &start);
+
+  nodes = routes = 0;
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  for (rn = route_top (table); rn; rn = route_next (rn))
+    {
+      nodes++;
+      if (rn->info)
+	routes++;
+    }
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &end);
+  r_walk = rate (nodes, &end, &start);
+
+  printf ("%s: %u routes in %u nodes (%lu bytes/route, %lu from the heap)\n",
+	  label, routes, nodes,
+	  (unsigned long) nodes * sizeof (struct route_node) / routes,
+	  heap / routes);
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  for (i = 0; i < count; i++)
+    {
+      rn = route_node_lookup (table, &prefixes[i]);
+      if (rn == NULL)
+	continue;	/* duplicate, already gone */
+      rn->info = NULL;
+      route_unlock_node (rn);
+      route_unlock_node (rn);
+    }
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &end);
+  r_delete = rate (count, &end, &start);
+
+  if (route_top (table) != NULL)
+    {
+      fprintf (stderr, "table not empty after delete\n");
+      exit (1);
+    }
+
+  printf ("  insert %9.0f/s  lookup %9.0f/s  match %9.0f/s (%u%% hit)  "
+	  "walk %9.0f/s  delete %9.0f/s\n",
+	  r_insert, r_lookup, r_match, found * 100 / MATCHES, r_walk,
+	  r_delete);
+
+  route_table_finish (table);
+  XFREE (MTYPE_TMP, prefixes);
+}
+
+int
+main (int argc, char **argv)
+{
+  if (argc > 1 && strcmp (argv[1], "pool") == 0)
+    memory_pool_init (MTYPE_ROUTE_NODE, sizeof (struct route_node));
+
+  bench_run ("IPv4", AF_INET, IPV4_PREFIXES, ipv4_mix);
+#ifdef HAVE_IPV6
+  bench_run ("IPv6", AF_INET6, IPV6_PREFIXES, ipv6_mix);
+#endif /* HAVE_IPV6 */
+
+  return 0;
+}
@@ -0,0 +1,192 @@
+/*
+ * Benchmark of the thread library I/O wait methods.
+ *
+ * For each available method (select, poll, epoll) and for a number of
+ * idle sockets registered as read threads, bounce a byte through a pipe
+ * and measure how long each wakeup of thread_fetch() takes.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+#include <sys/resource.h>
+
+#include "thread.h"
+#include "memory.h"
+
+#include "test-common.h"
+
+struct thread_master *master;
+
+#define PING_COUNT 20000
+
+static const int idle_counts[] = { 10, 1000, 10000 };
+
+static const enum thread_io_method methods[] =
+{
+  THREAD_IO_SELECT,
+  THREAD_IO_POLL,
+  THREAD_IO_EPOLL,
+};
+
+struct ping_state
+{
+  int rfd, wfd;
+  int count;
+  int limit;
+  struct timeval sent;
+  unsigned long latency;	/* total microseconds from write to wakeup */
+};
+
+static int
+idle_read (struct thread *thread)
+{
+  fprintf (stderr, "idle socket %d became readable\n", THREAD_FD (thread));
+  return 0;
+}
+
+static int
+ping_read (struct thread *thread)
+{
+  struct ping_state *ps = THREAD_ARG (thread);
+  struct timeval now;
+  char c;
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &now);
+  ps->latency += tv_usec (&now, &ps->sent);
+
+  if (read (ps->rfd, &c, 1) != 1)
+    {
+      perror ("read");
+      exit (1);
+    }
+  if (++ps->count >= ps->limit)
+    return 0;
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &ps->sent);
+  if (write (ps->wfd, &c, 1) != 1)
+    {
+      perror ("write");
+      exit (1);
+    }
+  thread_add_read (master, ping_read, ps, ps->rfd);
+  return 0;
+}
+
+static void
+bench_run (enum thread_io_method method, int idle)
+{
+  struct ping_state ps;
+  struct thread **threads;
+  struct thread thread;
+  struct timeval start, end;
+  unsigned long elapsed;
+  int *socks;
+  int fds[2];
+  int i, added = 0;
+
+  master = thread_master_create_method (method);
+  if (master->io_method != method)
+    {
+      thread_master_free (master);
+      return;
+    }
+
+  socks = XCALLOC (MTYPE_TMP, idle * sizeof (int));
+  threads = XCALLOC (MTYPE_TMP, idle * sizeof (struct thread *));
+  for (i = 0; i < idle; i++)
+    {
+      if ((socks[i] = socket (AF_INET, SOCK_DGRAM, 0)) < 0)
+        continue;
+      if ((threads[i] = thread_add_read (master, idle_read, NULL, socks[i])))
+        added++;
+    }
+
+  if (pipe (fds) < 0)
+    {
+      perror ("pipe");
+      exit (1);
+    }
+
+  printf ("%-6s %6d idle: ", thread_master_io_method (master), idle);
+  if (added < idle)
+    printf ("(only %d registered) ", added);
+  fflush (stdout);
+
+  memset (&ps, 0, sizeof (ps));
+  ps.rfd = fds[0];
+  ps.wfd = fds[1];
+  /* Keep the slow methods with many idle sockets from taking forever */
+  ps.limit = PING_COUNT / (idle / 1000 + 1);
+  thread_add_read (master, ping_read, &ps, ps.rfd);
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  ps.sent = start;
+  if (write (ps.wfd, "x", 1) != 1)
+    {
+      perror ("write");
+      exit (1);
+    }
+  while (ps.count < ps.limit && thread_fetch (master, &thread))
+    thread_call (&thread);
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &end);
+
+  elapsed = tv_usec (&end, &start);
+  printf ("%8.2f usec/wakeup %10.0f events/sec\n",
+          (double) ps.latency / ps.count,
+          ps.count * 1000000.0 / (elapsed ? elapsed : 1));
+
+  for (i = 0; i < idle; i++)
+    {
+      if (threads[i])
+        thread_cancel (threads[i]);
+      if (socks[i] >= 0)
+        close (socks[i]);
+    }
+  close (fds[0]);
+  close (fds[1]);
+  XFREE (MTYPE_TMP, threads);
+  XFREE (MTYPE_TMP, socks);
+  thread_master_free (master);
+  master = NULL;
+}
+
+int
+main (void)
+{
+  struct rlimit rl;
+  unsigned int i, j;
+
+  /* Room for the largest idle set plus stdio, the pipe and epoll. */
+  if (getrlimit (RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < 10100)
+    {
+      rl.rlim_cur = (rl.rlim_max < 10100) ? rl.rlim_max : 10100;
+      setrlimit (RLIMIT_NOFILE, &rl);
+    }
+
+  for (i = 0; i < sizeof (idle_counts) / sizeof (idle_counts[0]); i++)
+    for (j = 0; j < sizeof (methods) / sizeof (methods[0]); j++)
+      {
+        /* select() can't wait for descriptors beyond FD_SETSIZE */
+        if (methods[j] == THREAD_IO_SELECT && idle_counts[i] >= FD_SETSIZE)
+          continue;
+        bench_run (methods[j], idle_counts[i]);
+      }
+
+  return 0;
+}
@@ -0,0 +1,341 @@
+/*
+ * Test of handing an Established session to the BGP I/O pthread.
+ *
+ * A peer is made Established on one end of a socketpair and handed to
+ * the I/O pthread, the test playing the remote side on the other end.
+ * Checks that what is written to it gets to the main thread, that what
+ * the main thread sends gets written, that reading holds back while
+ * the main thread is not taking what was read and goes on once it
+ * does, and that the session can be taken back with messages still
+ * queued.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "command.h"
+#include "vty.h"
+#include "privs.h"
+#include "memory.h"
+#include "thread.h"
+#include "network.h"
+#include "sockunion.h"
+#include "prefix.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_packet.h"
+#include "bgpd/bgp_fsm.h"
+#include "bgpd/bgp_io.h"
+
+#include "test-common.h"
+
+/* need these to link in libbgp */
+struct zebra_privs_t *bgpd_privs = NULL;
+struct thread_master *master = NULL;
+
+/* Far more than the I/O pthread may have waiting for the main thread,
+   plus what the socket buffers and its own read buffer hold. */
+#define FLOOD_MAX  200000
+
+static const char *config[] =
+{
+  "router bgp 65000",
+  " bgp router-id 10.0.0.254",
+  " neighbor 10.0.0.1 remote-as 65001",
+  " neighbor 10.0.0.1 disable-connected-check",
+  NULL
+};
+
+static void
+keepalive_make (u_char *buf)
+{
+  memset (buf, 0xff, BGP_MARKER_SIZE);
+  buf[BGP_MARKER_SIZE] = 0;
+  buf[BGP_MARKER_SIZE + 1] = BGP_HEADER_SIZE;
+  buf[BGP_MARKER_SIZE + 2] = BGP_MSG_KEEPALIVE;
+}
+
+/* Keeps thread_fetch () from waiting for long. */
+static int
+tick (struct thread *thread)
+{
+  thread_add_timer_msec (master, tick, NULL, 10);
+  return 0;
+}
+
+/* Run the main thread until the peer has had count KEEPALIVEs, or for
+   at most secs seconds. */
+static void
+run_until (struct peer *peer, u_int32_t count, int secs)
+{
+  struct thread thread;
+  time_t end = time (NULL) + secs;
+
+  while (peer->keepalive_in < count && time (NULL) < end
+	 && thread_fetch (master, &thread))
+    thread_call (&thread);
+}
+
+/* Read what is there on fd, for at most secs seconds, until there are
+   size bytes. */
+static size_t
+read_for (int fd, u_char *buf, size_t size, int secs)
+{
+  time_t end = time (NULL) + secs;
+  size_t done = 0;
+  ssize_t n;
+
+  while (done < size && time (NULL) < end)
+    {
+      n = read (fd, buf + done, size - done);
+      if (n > 0)
+	done += n;
+      else
+	usleep (1000);
+    }
+  return done;
+}
+
+static void
+peer_establish (struct peer *peer, int fd)
+{
+  BGP_EVENT_FLUSH (peer);
+  BGP_TIMER_OFF (peer->t_start);
+  BGP_TIMER_OFF (peer->t_connect);
+
+  peer->remote_id = peer->su.sin.sin_addr;
+  if (peer->su_remote == NULL)
+    peer->su_remote = sockunion_dup (&peer->su);
+
+  peer->fd = fd;
+  peer->status = Established;
+  peer->v_holdtime = 0;
+  peer->afc_nego[AFI_IP][SAFI_UNICAST] = 1;
+  SET_FLAG (peer->cap, PEER_CAP_AS4_RCV | PEER_CAP_AS4_ADV);
+  bgp_io_peer_start (peer);
+}
+
+/* KEEPALIVEs written by the peer get to the FSM. */
+static void
+test_read (struct peer *peer, int fd)
+{
+  u_char buf[BGP_HEADER_SIZE];
+  int i, oldfailed = failed;
+
+  keepalive_make (buf);
+  for (i = 0; i < 100; i++)
+    if (write (fd, buf, sizeof (buf)) != sizeof (buf))
+      {
+	perror ("write");
+	exit (1);
+      }
+
+  run_until (peer, 100, 10);
+  if (peer->keepalive_in != 100)
+    {
+      printf ("read %u of 100 KEEPALIVEs\n", peer->keepalive_in);
+      failed++;
+    }
+  result ("read", oldfailed);
+}
+
+/* KEEPALIVEs queued by the main thread get written. */
+static void
+test_write (struct peer *peer, int fd)
+{
+  u_char buf[50 * BGP_HEADER_SIZE], expect[BGP_HEADER_SIZE];
+  size_t n;
+  int i, oldfailed = failed;
+
+  for (i = 0; i < 50; i++)
+    bgp_keepalive_send (peer);
+
+  /* bgp_write () hands them on from the main thread. */
+  run_until (peer, peer->keepalive_in + 1, 1);
+  n = read_for (fd, buf, sizeof (buf), 10);
+  if (n != sizeof (buf))
+    {
+      printf ("written %lu of %lu bytes\n", (unsigned long) n,
+	      (unsigned long) sizeof (buf));
+      failed++;
+    }
+
+  keepalive_make (expect);
+  for (i = 0; i < (int) (n / BGP_HEADER_SIZE); i++)
+    if (memcmp (buf + i * BGP_HEADER_SIZE, expect, BGP_HEADER_SIZE))
+      {
+	printf ("packet %d is not a KEEPALIVE\n", i);
+	failed++;
+	break;
+      }
+  result ("write", oldfailed);
+}
+
+/* With the main thread not running, the I/O pthread stops reading
+   before long, so writing to it blocks.  Once the main thread takes
+   what was read, the rest is read too. */
+static void
+test_backpressure (struct peer *peer, int fd)
+{
+  u_char buf[BGP_HEADER_SIZE];
+  u_int32_t start = peer->keepalive_in;
+  unsigned long sent = 0;
+  int idle = 0, oldfailed = failed;
+
+  keepalive_make (buf);
+  while (sent < FLOOD_MAX && idle < 200)
+    {
+      if (write (fd, buf, sizeof (buf)) == sizeof (buf))
+	{
+	  sent++;
+	  idle = 0;
+	}
+      else
+	{
+	  usleep (1000);
+	  idle++;
+	}
+    }
+
+  if (sent >= FLOOD_MAX)
+    {
+      printf ("all of %lu KEEPALIVEs read without the main thread\n",
+	      sent);
+      failed++;
+    }
+  result ("backpressure", oldfailed);
+
+  oldfailed = failed;
+  run_until (peer, start + sent, 30);
+  if (peer->keepalive_in - start != sent)
+    {
+      printf ("read %lu of %lu KEEPALIVEs after draining\n",
+	      (unsigned long) (peer->keepalive_in - start), sent);
+      failed++;
+    }
+  result ("resume", oldfailed);
+}
+
+/* Taking the session back, with messages read and not yet taken,
+   waits for the I/O pthread to be done with the socket. */
+static void
+test_stop (struct peer *peer, int fd)
+{
+  u_char buf[BGP_HEADER_SIZE], got[BGP_HEADER_SIZE];
+  u_int32_t start = peer->keepalive_in;
+  int i, oldfailed = failed;
+
+  keepalive_make (buf);
+  for (i = 0; i < 10; i++)
+    if (write (fd, buf, sizeof (buf)) != sizeof (buf))
+      {
+	perror ("write");
+	exit (1);
+      }
+  usleep (100000);
+
+  bgp_io_peer_stop (peer);
+  if (peer->io != NULL)
+    {
+      printf ("peer still with the I/O pthread\n");
+      failed++;
+    }
+  if (peer->keepalive_out != 50)
+    {
+      printf ("%u KEEPALIVEs counted as sent, not 50\n", peer->keepalive_out);
+      failed++;
+    }
+
+  /* What was read is dropped, and what comes now is left for the main
+     thread to read. */
+  run_until (peer, start + 1, 1);
+  if (peer->keepalive_in != start)
+    {
+      printf ("%u KEEPALIVEs taken after stopping\n",
+	      peer->keepalive_in - start);
+      failed++;
+    }
+  if (write (fd, buf, sizeof (buf)) != sizeof (buf))
+    {
+      perror ("write");
+      exit (1);
+    }
+  usleep (100000);
+  if (read_for (peer->fd, got, sizeof (got), 1) != sizeof (got))
+    {
+      printf ("I/O pthread read after stopping\n");
+      failed++;
+    }
+  result ("stop", oldfailed);
+}
+
+int
+main (void)
+{
+  struct vty *vty;
+  union sockunion su;
+  struct peer *peer;
+  int i, sv[2];
+
+  signal (SIGPIPE, SIG_IGN);
+  bgp_master_init ();
+  master = bm->master;
+  bgp_option_set (BGP_OPT_NO_LISTEN);
+
+  cmd_init (1);
+  vty_init (master);
+  memory_init ();
+  bgp_init ();
+  sort_node ();
+
+  vty = vty_new ();
+  vty->type = VTY_TERM;
+  vty->node = CONFIG_NODE;
+  for (i = 0; config[i]; i++)
+    execute (vty, config[i]);
+
+  str2sockunion ("10.0.0.1", &su);
+  peer = peer_lookup (bgp_get_default (), &su);
+
+  if (socketpair (AF_UNIX, SOCK_STREAM, 0, sv) < 0)
+    {
+      perror ("socketpair");
+      exit (1);
+    }
+  set_nonblocking (sv[1]);
+
+  bgp_io_start ();
+  peer_establish (peer, sv[0]);
+  if (peer->io == NULL)
+    {
+      printf ("session not handed to the I/O pthread\n");
+      return 1;
+    }
+  thread_add_timer_msec (master, tick, NULL, 10);
+
+  test_read (peer, sv[1]);
+  test_write (peer, sv[1]);
+  test_backpressure (peer, sv[1]);
+  test_stop (peer, sv[1]);
+
+  bgp_io_finish ();
+  printf ("failures: %d\n", failed);
+  return failed;
+}
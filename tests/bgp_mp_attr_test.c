@@ -449,6 +449,7 @@ parse_test (struct peer *peer, struct test_segment *t, int type)
   };
 #define RANDOM_FUZZ 35
   
+  memset (&attr, 0, sizeof (attr));
   stream_reset (peer->ibuf);
   stream_put (peer->ibuf, NULL, RANDOM_FUZZ);
   stream_set_getp (peer->ibuf, RANDOM_FUZZ);
@@ -0,0 +1,474 @@
+/*
+ * Test of how bgpd tracks the nexthops of its paths.
+ *
+ * The test stands in for zebra on two socketpairs: one answers the
+ * lookup of a nexthop seen for the first time, on the other come the
+ * registrations, and what zebra would send back on it is handed to
+ * bgp_nexthop_update () directly.  Checks that paths through a nexthop
+ * follow what zebra tells of it, that the nexthop is registered while
+ * there are paths through it and unregistered after, and that paths
+ * from a directly connected EBGP peer, IPv4 and IPv6, follow their
+ * nexthop being on a connected network as networks come and go.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "command.h"
+#include "vty.h"
+#include "privs.h"
+#include "memory.h"
+#include "thread.h"
+#include "stream.h"
+#include "network.h"
+#include "sockunion.h"
+#include "prefix.h"
+#include "if.h"
+#include "zclient.h"
+#include "workqueue.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_table.h"
+#include "bgpd/bgp_route.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_packet.h"
+#include "bgpd/bgp_fsm.h"
+#include "bgpd/bgp_nexthop.h"
+
+#include "test-common.h"
+
+/* need these to link in libbgp */
+struct zebra_privs_t *bgpd_privs = NULL;
+struct thread_master *master = NULL;
+
+extern struct zclient *zclient;
+extern struct zclient *zlookup;
+
+/* Zebra's ends of the lookup and the other socketpair. */
+static int lookup_fd;
+static int zebra_fd;
+
+/* 10.0.0.1 is a directly connected EBGP peer, 10.0.0.2 an IBGP one. */
+static const char *config[] =
+{
+  "router bgp 65000",
+  " bgp router-id 10.0.0.254",
+  " neighbor 10.0.0.1 remote-as 65001",
+  " neighbor 10.0.0.2 remote-as 65000",
+  " address-family ipv6",
+  " neighbor 10.0.0.1 activate",
+  " exit-address-family",
+  NULL
+};
+
+static struct bgp *bgp;
+static struct peer *ebgp, *ibgp;
+static struct connected *ifc4, *ifc6;
+
+/* Have zebra's answer to the next lookup waiting: metric and a nexthop
+   out of ifindex 1, or no route if metric is 0.  The lookups asked
+   before are dropped. */
+static void
+lookup_answer (afi_t afi, const char *addr, u_int32_t metric)
+{
+  struct stream *s;
+  struct prefix p;
+  u_char buf[256];
+
+  while (read (lookup_fd, buf, sizeof (buf)) > 0)
+    ;
+
+  str2prefix (addr, &p);
+  s = stream_new (ZEBRA_MAX_PACKET_SIZ);
+  if (afi == AFI_IP)
+    {
+      zclient_create_header (s, ZEBRA_IPV4_NEXTHOP_LOOKUP);
+      stream_put_in_addr (s, &p.u.prefix4);
+    }
+  else
+    {
+      zclient_create_header (s, ZEBRA_IPV6_NEXTHOP_LOOKUP);
+      stream_put (s, &p.u.prefix6, 16);
+    }
+  stream_putl (s, metric);
+  if (metric)
+    {
+      stream_putc (s, 1);
+      stream_putc (s, ZEBRA_NEXTHOP_IFINDEX);
+      stream_putl (s, 1);
+    }
+  else
+    stream_putc (s, 0);
+  stream_putw_at (s, 0, stream_get_endp (s));
+
+  if (write (lookup_fd, STREAM_DATA (s), stream_get_endp (s))
+      != (ssize_t) stream_get_endp (s))
+    {
+      perror ("write");
+      exit (1);
+    }
+  stream_free (s);
+}
+
+/* Whether bgpd sent command for addr since last looked. */
+static int
+zebra_sent (int command, const char *addr)
+{
+  static u_char buf[65536];
+  struct prefix p;
+  size_t len = 0, i;
+  ssize_t n;
+  uint16_t size;
+  int found = 0;
+
+  while ((n = read (zebra_fd, buf + len, sizeof (buf) - len)) > 0)
+    len += n;
+
+  str2prefix (addr, &p);
+  for (i = 0; i + ZEBRA_HEADER_SIZE <= len; i += size)
+    {
+      size = (buf[i] << 8) | buf[i + 1];
+      if (size < ZEBRA_HEADER_SIZE)
+	break;
+      if (((buf[i + 4] << 8) | buf[i + 5]) == command
+	  && buf[i + ZEBRA_HEADER_SIZE] == p.family
+	  && memcmp (buf + i + ZEBRA_HEADER_SIZE + 1, &p.u.prefix,
+		     prefix_blen (&p)) == 0)
+	found = 1;
+    }
+  return found;
+}
+
+/* Hand bgpd what zebra tells of a tracked address: metric and a
+   nexthop out of ifindex 1, or no route if metric is 0. */
+static void
+nexthop_update (const char *addr, u_int32_t metric)
+{
+  struct stream *s = zclient->ibuf;
+  struct prefix p;
+
+  str2prefix (addr, &p);
+  stream_reset (s);
+  stream_putc (s, p.family);
+  stream_put (s, &p.u.prefix, prefix_blen (&p));
+  stream_putl (s, metric);
+  if (metric)
+    {
+      stream_putc (s, 1);
+      stream_putc (s, ZEBRA_NEXTHOP_IFINDEX);
+      stream_putl (s, 1);
+    }
+  else
+    stream_putc (s, 0);
+  bgp_nexthop_update (ZEBRA_NEXTHOP_UPDATE, zclient, stream_get_endp (s));
+}
+
+/* The peer may not go anywhere, nor have anything sent to it. */
+static void
+peer_quiet (struct peer *peer)
+{
+  BGP_EVENT_FLUSH (peer);
+  BGP_TIMER_OFF (peer->t_start);
+}
+
+static struct connected *
+connected_make (struct interface *ifp, const char *addr)
+{
+  struct connected *ifc;
+
+  ifc = connected_new ();
+  ifc->ifp = ifp;
+  ifc->address = prefix_new ();
+  str2prefix (addr, ifc->address);
+  return ifc;
+}
+
+static void
+path_update (struct peer *peer, const char *prefix, const char *nexthop)
+{
+  struct attr attr;
+  struct prefix p, nh;
+  afi_t afi;
+
+  str2prefix (prefix, &p);
+  str2prefix (nexthop, &nh);
+  afi = family2afi (p.family);
+
+  bgp_attr_default_set (&attr, BGP_ORIGIN_IGP);
+  if (afi == AFI_IP)
+    attr.nexthop = nh.u.prefix4;
+  else
+    {
+      attr.extra->mp_nexthop_global = nh.u.prefix6;
+      attr.extra->mp_nexthop_len = 16;
+    }
+  bgp_update (peer, &p, &attr, afi, SAFI_UNICAST, ZEBRA_ROUTE_BGP,
+	      BGP_ROUTE_NORMAL, NULL, NULL, 0);
+  bgp_attr_extra_free (&attr);
+}
+
+static void
+path_withdraw (struct peer *peer, const char *prefix)
+{
+  struct prefix p;
+
+  str2prefix (prefix, &p);
+  bgp_withdraw (peer, &p, NULL, family2afi (p.family), SAFI_UNICAST,
+		ZEBRA_ROUTE_BGP, BGP_ROUTE_NORMAL, NULL, NULL);
+}
+
+static struct bgp_info *
+path_get (struct peer *peer, const char *prefix)
+{
+  struct bgp_node *rn;
+  struct bgp_info *ri;
+  struct prefix p;
+
+  str2prefix (prefix, &p);
+  rn = bgp_node_lookup (bgp->rib[family2afi (p.family)][SAFI_UNICAST], &p);
+  if (rn == NULL)
+    return NULL;
+  bgp_unlock_node (rn);
+  for (ri = rn->info; ri; ri = ri->next)
+    if (ri->peer == peer && ! CHECK_FLAG (ri->flags, BGP_INFO_REMOVED))
+      return ri;
+  return NULL;
+}
+
+/* Check the path is there, and valid or not. */
+static void
+path_check (struct peer *peer, const char *prefix, int valid)
+{
+  struct bgp_info *ri = path_get (peer, prefix);
+
+  if (ri == NULL)
+    {
+      printf ("  %s: no path\n", prefix);
+      failed++;
+    }
+  else if ((CHECK_FLAG (ri->flags, BGP_INFO_VALID) ? 1 : 0) != valid)
+    {
+      printf ("  %s: %s, expected %s\n", prefix,
+	      valid ? "invalid" : "valid", valid ? "valid" : "invalid");
+      failed++;
+    }
+}
+
+/* Keeps thread_fetch () from waiting for long. */
+static int
+tick (struct thread *thread)
+{
+  thread_add_timer_msec (master, tick, NULL, 10);
+  return 0;
+}
+
+/* Run the main thread until the paths have been processed. */
+static void
+process_run (void)
+{
+  struct thread thread;
+  void *item;
+  time_t end = time (NULL) + 10;
+
+  while (bm->process_main_queue
+	 && work_queue_peek (bm->process_main_queue, &item, 1)
+	 && time (NULL) < end && thread_fetch (master, &thread))
+    thread_call (&thread);
+}
+
+static void
+test_ibgp (void)
+{
+  struct bgp_info *ri;
+  int oldfailed = failed;
+
+  lookup_answer (AFI_IP, "192.0.2.1/32", 5);
+  path_update (ibgp, "10.1.0.0/16", "192.0.2.1/32");
+  path_check (ibgp, "10.1.0.0/16", 1);
+  if (! zebra_sent (ZEBRA_NEXTHOP_REGISTER, "192.0.2.1/32"))
+    {
+      printf ("  192.0.2.1 not registered\n");
+      failed++;
+    }
+
+  /* A second path through it, no lookup nor registering again. */
+  path_update (ibgp, "10.2.0.0/16", "192.0.2.1/32");
+  path_check (ibgp, "10.2.0.0/16", 1);
+  if (zebra_sent (ZEBRA_NEXTHOP_REGISTER, "192.0.2.1/32"))
+    {
+      printf ("  192.0.2.1 registered again\n");
+      failed++;
+    }
+  result ("ibgp register", oldfailed);
+
+  oldfailed = failed;
+  nexthop_update ("192.0.2.1/32", 0);
+  path_check (ibgp, "10.1.0.0/16", 0);
+  path_check (ibgp, "10.2.0.0/16", 0);
+  result ("ibgp unreachable", oldfailed);
+
+  oldfailed = failed;
+  nexthop_update ("192.0.2.1/32", 20);
+  path_check (ibgp, "10.1.0.0/16", 1);
+  path_check (ibgp, "10.2.0.0/16", 1);
+  ri = path_get (ibgp, "10.1.0.0/16");
+  if (ri && ri->extra->igpmetric != 20)
+    {
+      printf ("  IGP metric %u, expected 20\n", ri->extra->igpmetric);
+      failed++;
+    }
+  result ("ibgp reachable", oldfailed);
+
+  oldfailed = failed;
+  path_withdraw (ibgp, "10.1.0.0/16");
+  process_run ();
+  if (zebra_sent (ZEBRA_NEXTHOP_UNREGISTER, "192.0.2.1/32"))
+    {
+      printf ("  192.0.2.1 unregistered with a path through it\n");
+      failed++;
+    }
+  path_withdraw (ibgp, "10.2.0.0/16");
+  process_run ();
+  if (! zebra_sent (ZEBRA_NEXTHOP_UNREGISTER, "192.0.2.1/32"))
+    {
+      printf ("  192.0.2.1 not unregistered\n");
+      failed++;
+    }
+  result ("ibgp unregister", oldfailed);
+}
+
+static void
+test_ebgp (void)
+{
+  int oldfailed = failed;
+
+  lookup_answer (AFI_IP, "10.0.0.1/32", 1);
+  path_update (ebgp, "10.3.0.0/16", "10.0.0.1/32");
+  path_check (ebgp, "10.3.0.0/16", 1);
+  result ("ebgp onlink", oldfailed);
+
+  /* Zebra still has a route to the nexthop, but it is not on a
+     connected network. */
+  oldfailed = failed;
+  bgp_connected_delete (ifc4);
+  path_check (ebgp, "10.3.0.0/16", 0);
+  nexthop_update ("10.0.0.1/32", 10);
+  path_check (ebgp, "10.3.0.0/16", 0);
+  result ("ebgp connected gone", oldfailed);
+
+  oldfailed = failed;
+  bgp_connected_add (ifc4);
+  path_check (ebgp, "10.3.0.0/16", 1);
+  result ("ebgp connected back", oldfailed);
+}
+
+static void
+test_ebgp_ipv6 (void)
+{
+  int oldfailed = failed;
+
+  lookup_answer (AFI_IP6, "2001:db8::1/128", 1);
+  path_update (ebgp, "2001:db8:1::/48", "2001:db8::1/128");
+  path_check (ebgp, "2001:db8:1::/48", 1);
+  result ("ebgp ipv6 onlink", oldfailed);
+
+  oldfailed = failed;
+  lookup_answer (AFI_IP6, "2001:db8:ffff::1/128", 1);
+  path_update (ebgp, "2001:db8:2::/48", "2001:db8:ffff::1/128");
+  path_check (ebgp, "2001:db8:2::/48", 0);
+  result ("ebgp ipv6 not onlink", oldfailed);
+
+  oldfailed = failed;
+  bgp_connected_delete (ifc6);
+  path_check (ebgp, "2001:db8:1::/48", 0);
+  result ("ebgp ipv6 connected gone", oldfailed);
+
+  oldfailed = failed;
+  bgp_connected_add (ifc6);
+  path_check (ebgp, "2001:db8:1::/48", 1);
+  path_check (ebgp, "2001:db8:2::/48", 0);
+  result ("ebgp ipv6 connected back", oldfailed);
+}
+
+int
+main (void)
+{
+  struct vty *vty;
+  struct interface *ifp;
+  union sockunion su;
+  int i, sv[2];
+
+  signal (SIGPIPE, SIG_IGN);
+  bgp_master_init ();
+  master = bm->master;
+  bgp_option_set (BGP_OPT_NO_LISTEN);
+
+  cmd_init (1);
+  vty_init (master);
+  memory_init ();
+  bgp_init ();
+  sort_node ();
+
+  vty = vty_new ();
+  vty->type = VTY_TERM;
+  vty->node = CONFIG_NODE;
+  for (i = 0; config[i]; i++)
+    execute (vty, config[i]);
+
+  bgp = bgp_get_default ();
+  str2sockunion ("10.0.0.1", &su);
+  ebgp = peer_lookup (bgp, &su);
+  str2sockunion ("10.0.0.2", &su);
+  ibgp = peer_lookup (bgp, &su);
+
+  peer_quiet (ebgp);
+  peer_quiet (ibgp);
+
+  if (socketpair (AF_UNIX, SOCK_STREAM, 0, sv) < 0)
+    {
+      perror ("socketpair");
+      exit (1);
+    }
+  zlookup->sock = sv[0];
+  lookup_fd = sv[1];
+  set_nonblocking (lookup_fd);
+  if (socketpair (AF_UNIX, SOCK_STREAM, 0, sv) < 0)
+    {
+      perror ("socketpair");
+      exit (1);
+    }
+  zclient->sock = sv[0];
+  zebra_fd = sv[1];
+  set_nonblocking (zebra_fd);
+
+  ifp = if_get_by_name ("eth0");
+  ifc4 = connected_make (ifp, "10.0.0.254/24");
+  ifc6 = connected_make (ifp, "2001:db8::fe/64");
+  bgp_connected_add (ifc4);
+  bgp_connected_add (ifc6);
+
+  thread_add_timer_msec (master, tick, NULL, 10);
+
+  test_ibgp ();
+  test_ebgp ();
+  test_ebgp_ipv6 ();
+
+  printf ("failures: %d\n", failed);
+  return failed;
+}
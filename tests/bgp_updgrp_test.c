@@ -0,0 +1,362 @@
+/*
+ * Test of which peers bgpd puts in an update group together.
+ *
+ * Peers are configured from the CLI, then made Established by hand
+ * for each look at the groups.  Each step changes something the
+ * grouping depends on, and checks both that it asked for the groups to
+ * be worked out again and what they came out as.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "command.h"
+#include "vty.h"
+#include "privs.h"
+#include "memory.h"
+#include "thread.h"
+#include "linklist.h"
+#include "sockunion.h"
+#include "prefix.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_packet.h"
+#include "bgpd/bgp_fsm.h"
+#include "bgpd/bgp_updgrp.h"
+
+#include "test-common.h"
+
+/* need these to link in libbgp */
+struct zebra_privs_t *bgpd_privs = NULL;
+struct thread_master *master = NULL;
+
+#define PEERS  7
+
+/* EBGP peers 1 to 4 and 7, of two ASes, and IBGP peers 5 and 6. */
+static const char *config[] =
+{
+  "ip prefix-list PL seq 5 permit 10.0.0.0/8 le 32",
+  "ip as-path access-list AL permit _65001_",
+  "route-map OUT permit 10",
+  "router bgp 65000",
+  " bgp router-id 10.0.0.254",
+  " neighbor 10.0.0.1 remote-as 65001",
+  " neighbor 10.0.0.2 remote-as 65001",
+  " neighbor 10.0.0.3 remote-as 65001",
+  " neighbor 10.0.0.4 remote-as 65001",
+  " neighbor 10.0.0.5 remote-as 65000",
+  " neighbor 10.0.0.6 remote-as 65000",
+  " neighbor 10.0.0.7 remote-as 65002",
+  NULL
+};
+
+static struct bgp *bgp;
+static struct peer *peers[PEERS];
+
+/* Peers left out of being made Established. */
+static int down[PEERS];
+
+/* As bgp_establish() would leave them, but for the session. */
+static void
+peers_establish (void)
+{
+  struct peer *peer;
+  int i;
+
+  for (i = 0; i < PEERS; i++)
+    {
+      peer = peers[i];
+      BGP_EVENT_FLUSH (peer);
+      peer->status = down[i] ? Idle : Established;
+      peer->afc_nego[AFI_IP][SAFI_UNICAST] = 1;
+    }
+}
+
+/* Idle between steps, so that configuring doesn't try to talk to
+   them. */
+static void
+peers_idle (void)
+{
+  struct peer *peer;
+  int i;
+
+  for (i = 0; i < PEERS; i++)
+    {
+      peer = peers[i];
+      BGP_EVENT_FLUSH (peer);
+      peer->status = Idle;
+    }
+}
+
+/* The groups of the peers as a letter each, in the order the groups
+   are first met, '-' for none. */
+static void
+groups_str (char *buf)
+{
+  struct update_group *seen[PEERS];
+  struct update_group *group;
+  int i, j, n = 0;
+
+  for (i = 0; i < PEERS; i++)
+    {
+      group = peers[i]->update_group[AFI_IP][SAFI_UNICAST];
+      if (group == NULL)
+	{
+	  buf[i] = '-';
+	  continue;
+	}
+      for (j = 0; j < n && seen[j] != group; j++)
+	;
+      if (j == n)
+	seen[n++] = group;
+      buf[i] = 'A' + j;
+    }
+  buf[PEERS] = '\0';
+}
+
+/* Each group has members, and its first is one of them. */
+static int
+groups_sane (void)
+{
+  struct listnode *node;
+  struct update_group *group;
+
+  for (ALL_LIST_ELEMENTS_RO (bgp->update_groups[AFI_IP][SAFI_UNICAST],
+			     node, group))
+    if (listcount (group->peer) == 0
+	|| listnode_lookup (group->peer, group->conf) == NULL)
+      return 0;
+  return 1;
+}
+
+/* What bgp_establish() does on capabilities being negotiated. */
+static void
+orf_set (void)
+{
+  SET_FLAG (peers[0]->af_cap[AFI_IP][SAFI_UNICAST],
+	    PEER_CAP_ORF_PREFIX_RM_ADV | PEER_CAP_ORF_PREFIX_SM_RCV);
+  bgp_update_group_changed (bgp);
+}
+
+static void
+orf_unset (void)
+{
+  UNSET_FLAG (peers[0]->af_cap[AFI_IP][SAFI_UNICAST],
+	      PEER_CAP_ORF_PREFIX_RM_ADV | PEER_CAP_ORF_PREFIX_SM_RCV);
+  bgp_update_group_changed (bgp);
+}
+
+static void
+as4_unset (void)
+{
+  UNSET_FLAG (peers[2]->cap, PEER_CAP_AS4_RCV);
+  bgp_update_group_changed (bgp);
+}
+
+static void
+as4_set (void)
+{
+  SET_FLAG (peers[2]->cap, PEER_CAP_AS4_RCV);
+  bgp_update_group_changed (bgp);
+}
+
+static void
+peer6_down (void)
+{
+  down[5] = 1;
+  bgp_update_group_changed (bgp);
+}
+
+static void
+peer6_up (void)
+{
+  down[5] = 0;
+  bgp_update_group_changed (bgp);
+}
+
+static struct test_step
+{
+  const char *name;
+  const char *cmds[4];		/* each from the config node */
+  void (*hook) (void);
+  const char *groups;		/* expected, as groups_str() has it */
+} test_steps[] =
+{
+  { "route-map out",
+    { "router bgp 65000", " neighbor 10.0.0.2 route-map OUT out" },
+    NULL, "ABAACCD" },
+  { "same route-map out",
+    { "router bgp 65000", " neighbor 10.0.0.3 route-map OUT out" },
+    NULL, "ABBACCD" },
+  { "no route-map out",
+    { "router bgp 65000", " no neighbor 10.0.0.2 route-map OUT out",
+      " no neighbor 10.0.0.3 route-map OUT out" },
+    NULL, "AAAABBC" },
+  { "prefix-list out",
+    { "router bgp 65000", " neighbor 10.0.0.1 prefix-list PL out" },
+    NULL, "ABBBCCD" },
+  { "no prefix-list out",
+    { "router bgp 65000", " no neighbor 10.0.0.1 prefix-list PL out" },
+    NULL, "AAAABBC" },
+  { "filter-list out",
+    { "router bgp 65000", " neighbor 10.0.0.4 filter-list AL out" },
+    NULL, "AAABCCD" },
+  { "no filter-list out",
+    { "router bgp 65000", " no neighbor 10.0.0.4 filter-list AL out" },
+    NULL, "AAAABBC" },
+  { "next-hop-self",
+    { "router bgp 65000", " neighbor 10.0.0.5 next-hop-self" },
+    NULL, "AAAABCD" },
+  { "no next-hop-self",
+    { "router bgp 65000", " no neighbor 10.0.0.5 next-hop-self" },
+    NULL, "AAAABBC" },
+  { "route-server-client",
+    { "router bgp 65000", " neighbor 10.0.0.4 route-server-client" },
+    NULL, "AAA-BBC" },
+  { "no route-server-client",
+    { "router bgp 65000", " no neighbor 10.0.0.4 route-server-client" },
+    NULL, "AAAABBC" },
+  { "ORF prefix-list received", { NULL }, orf_set, "-AAABBC" },
+  { "ORF prefix-list gone", { NULL }, orf_unset, "AAAABBC" },
+  { "no AS4 capability", { NULL }, as4_unset, "AABACCD" },
+  { "AS4 capability", { NULL }, as4_set, "AAAABBC" },
+  { "local-as",
+    { "router bgp 65000", " neighbor 10.0.0.2 local-as 65100" },
+    NULL, "ABAACCD" },
+  { "same local-as",
+    { "router bgp 65000", " neighbor 10.0.0.3 local-as 65100" },
+    NULL, "ABBACCD" },
+  { "local-as no-prepend",
+    { "router bgp 65000", " neighbor 10.0.0.3 local-as 65100 no-prepend" },
+    NULL, "ABCADDE" },
+  { "no local-as",
+    { "router bgp 65000", " no neighbor 10.0.0.2 local-as",
+      " no neighbor 10.0.0.3 local-as" },
+    NULL, "AAAABBC" },
+  { "route-map out, again",
+    { "router bgp 65000", " neighbor 10.0.0.1 route-map OUT out" },
+    NULL, "ABBBCCD" },
+  { "match peer in route-map out",
+    { "route-map OUT permit 10", " match peer 10.0.0.9" },
+    NULL, "-AAABBC" },
+  { "no match peer in route-map out",
+    { "route-map OUT permit 10", " no match peer 10.0.0.9" },
+    NULL, "ABBBCCD" },
+  { "no route-map out, again",
+    { "router bgp 65000", " no neighbor 10.0.0.1 route-map OUT out" },
+    NULL, "AAAABBC" },
+  { "remote-as",
+    { "router bgp 65000", " neighbor 10.0.0.7 remote-as 65001" },
+    NULL, "AAAABBA" },
+  { "remote-as back",
+    { "router bgp 65000", " neighbor 10.0.0.7 remote-as 65002" },
+    NULL, "AAAABBC" },
+  { "not established", { NULL }, peer6_down, "AAAAB-C" },
+  { "established", { NULL }, peer6_up, "AAAABBC" },
+  { NULL }
+};
+
+static void
+check (const char *name, const char *expect, int changed)
+{
+  char groups[PEERS + 1];
+  int oldfailed = failed;
+
+  peers_establish ();
+  bgp_update_groups_sync (bgp);
+  peers_idle ();
+
+  groups_str (groups);
+  printf ("%s: groups %s", name, groups);
+  if (! changed)
+    {
+      printf (", not asked to work them out again");
+      failed++;
+    }
+  if (strcmp (groups, expect))
+    {
+      printf (", expected %s", expect);
+      failed++;
+    }
+  if (! groups_sane ())
+    {
+      printf (", a group without its first member");
+      failed++;
+    }
+  printf (": %s\n", result_str (oldfailed));
+}
+
+int
+main (void)
+{
+  struct vty *vty;
+  union sockunion su;
+  char addr[INET_ADDRSTRLEN];
+  struct test_step *t;
+  int i;
+
+  bgp_master_init ();
+  master = bm->master;
+  bgp_option_set (BGP_OPT_NO_LISTEN);
+
+  cmd_init (1);
+  vty_init (master);
+  memory_init ();
+  bgp_init ();
+  sort_node ();
+
+  vty = vty_new ();
+  vty->type = VTY_TERM;
+  vty->node = CONFIG_NODE;
+  for (i = 0; config[i]; i++)
+    {
+      if (config[i][0] != ' ')
+	vty->node = CONFIG_NODE;
+      execute (vty, config[i]);
+    }
+
+  bgp = bgp_get_default ();
+  for (i = 0; i < PEERS; i++)
+    {
+      snprintf (addr, sizeof (addr), "10.0.0.%d", i + 1);
+      str2sockunion (addr, &su);
+      peers[i] = peer_lookup (bgp, &su);
+      BGP_TIMER_OFF (peers[i]->t_start);
+      SET_FLAG (peers[i]->cap, PEER_CAP_AS4_RCV | PEER_CAP_AS4_ADV);
+    }
+
+  /* As bgp_establish () asks for. */
+  bgp_update_group_changed (bgp);
+  check ("initial", "AAAABBC", 1);
+
+  for (t = test_steps; t->name; t++)
+    {
+      bgp->update_groups_changed = 0;
+      vty->node = CONFIG_NODE;
+      for (i = 0; t->cmds[i]; i++)
+	execute (vty, t->cmds[i]);
+      if (t->hook)
+	t->hook ();
+      check (t->name, t->groups, bgp->update_groups_changed);
+    }
+
+  printf ("failures: %d\n", failed);
+  return failed;
+}
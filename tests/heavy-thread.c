@@ -27,6 +27,9 @@
  * (it defaults to port 4000) and enter the 'clear foo string' command.
  * then type whatever and observe that, unlike heavy.c, the vty interface
  * remains responsive.
+ *
+ * The 'bench timers <count>' command reports how fast the thread library
+ * adds, cancels and expires large numbers of timers.
  */
 #include <zebra.h>
 #include <math.h>
@@ -138,8 +141,95 @@ DEFUN (clear_foo,
   return CMD_SUCCESS;
 }
 
+/* State of a 'bench timers' run, while its timers expire. */
+static struct
+{
+  int expected;
+  int expired;
+  struct timeval first;
+} timer_bench;
+
+static double
+bench_usec (struct timeval *start)
+{
+  struct timeval now;
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &now);
+  return (now.tv_sec - start->tv_sec) * 1000000.0
+         + (now.tv_usec - start->tv_usec);
+}
+
+static int
+bench_timer_expire (struct thread *thread)
+{
+  double usec;
+
+  if (timer_bench.expired++ == 0)
+    quagga_gettime (QUAGGA_CLK_MONOTONIC, &timer_bench.first);
+
+  if (timer_bench.expired < timer_bench.expected)
+    return 0;
+
+  usec = bench_usec (&timer_bench.first);
+  printf ("%d timers expired in %.0f usec, %.0f expiries/sec\n",
+          timer_bench.expired, usec,
+          timer_bench.expired * 1000000.0 / (usec ? usec : 1));
+  fflush (stdout);
+  return 0;
+}
+
+DEFUN (bench_timers,
+       bench_timers_cmd,
+       "bench timers <1-1000000>",
+       "Benchmark\n"
+       "Thread timer add, cancel and expiry throughput\n"
+       "Number of timers\n")
+{
+  struct thread **timers;
+  struct timeval start;
+  double usec;
+  int count, i;
+
+  if (timer_bench.expired < timer_bench.expected)
+    {
+      vty_out (vty, "%% timer benchmark already running%s", VTY_NEWLINE);
+      return CMD_WARNING;
+    }
+
+  count = atoi (argv[0]);
+  timers = XCALLOC (MTYPE_TMP, count * sizeof (struct thread *));
+
+  /* Spread the timers over 10ms, one second from now, so they all
+   * expire in one burst and in random order of insertion. */
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  for (i = 0; i < count; i++)
+    timers[i] = thread_add_timer_msec (master, bench_timer_expire, NULL,
+                                       1000 + random () % 10);
+  usec = bench_usec (&start);
+  vty_out (vty, "%d timers added in %.0f usec, %.0f adds/sec%s",
+           count, usec, count * 1000000.0 / (usec ? usec : 1), VTY_NEWLINE);
+
+  /* Cancel every other one, from the middle of the queue. */
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  for (i = 0; i < count; i += 2)
+    thread_cancel (timers[i]);
+  usec = bench_usec (&start);
+  vty_out (vty, "%d timers cancelled in %.0f usec, %.0f cancels/sec%s",
+           (count + 1) / 2, usec,
+           ((count + 1) / 2) * 1000000.0 / (usec ? usec : 1), VTY_NEWLINE);
+
+  XFREE (MTYPE_TMP, timers);
+
+  timer_bench.expected = count / 2;
+  timer_bench.expired = 0;
+  vty_out (vty, "expiry rate of the remaining %d timers will be printed "
+           "on stdout%s", timer_bench.expected, VTY_NEWLINE);
+  return CMD_SUCCESS;
+}
+
 void
 test_init()
 {
   install_element (VIEW_NODE, &clear_foo_cmd);
+  install_element (VIEW_NODE, &bench_timers_cmd);
 }
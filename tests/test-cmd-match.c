@@ -0,0 +1,389 @@
+/*
+ * Test of matching command lines down the token trie of a node.
+ *
+ * Every line is matched both by cmd_match(), which execution uses, and
+ * by cmd_match_vector(), the filtering of the command vector word by
+ * word that came before it, in strict and in completion matching.  The
+ * two must give the same result, and the same command when one matched.
+ *
+ * The commands are those of lib and bgpd, plus some to cover each kind
+ * of word: abbreviated and alternative keywords, optional words,
+ * varargs, ranges and IPv4 and IPv6 addresses and prefixes.  Some lines
+ * are checked for what they must give; the bulk are made at random
+ * from the commands of each node, with words abbreviated, left out,
+ * added or taken from other commands, and with valid, incomplete and
+ * invalid values for variables.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "command.h"
+#include "vty.h"
+#include "privs.h"
+#include "memory.h"
+#include "thread.h"
+
+#include "bgpd/bgpd.h"
+
+#include "test-common.h"
+
+/* need these to link in libbgp */
+struct zebra_privs_t *bgpd_privs = NULL;
+struct thread_master *master = NULL;
+
+extern vector cmdvec;
+
+/* Random lines made from each command, in each kind of matching. */
+#define VARIANTS  8
+
+/* Commands for the kinds of words, installed in CONFIG_NODE. */
+static const char *test_cmds[] =
+{
+  "neighbor A.B.C.D remote-as <1-65535>",
+  "neighbor A.B.C.D description .LINE",
+  "neighbor A.B.C.D (activate|shutdown)",
+  "neighbor X:X::X:X remote-as <1-65535>",
+  "neighbor WORD peer-group",
+  "network A.B.C.D/M",
+  "network A.B.C.D/M route-map WORD",
+  "network A.B.C.D mask A.B.C.D",
+  "ipv6 network X:X::X:X/M",
+  "no neighbor A.B.C.D",
+  "no neighbor A.B.C.D remote-as <1-65535>",
+  "no network A.B.C.D/M",
+  "nexthop (ipv4|ipv6) WORD",
+  "nexthop-tracking [WORD]",
+  "distance <1-255> [WORD]",
+  "distance <1-255> A.B.C.D/M",
+  "redistribute (kernel|connected|static) metric <0-16777214>",
+  "redistribute (kernel|connected|static) route-map WORD",
+  "ip route A.B.C.D/M (A.B.C.D|INTERFACE)",
+  "ip route A.B.C.D/M A.B.C.D <1-255>",
+  "ipv6 route X:X::X:X/M X:X::X:X",
+  "set community .AA:NN",
+  "set comm-list WORD delete",
+  NULL
+};
+
+/* Lines and what they must give in CONFIG_NODE: the result, and the
+   command if one matched. */
+static struct
+{
+  const char *line;
+  int strict;
+  int ret;
+  const char *cmd;
+} expect[] =
+{
+  { "neighbor 10.0.0.1 remote-as 100", 1, CMD_SUCCESS,
+    "neighbor A.B.C.D remote-as <1-65535>" },
+  { "nei 10.0.0.1 rem 100", 0, CMD_SUCCESS,
+    "neighbor A.B.C.D remote-as <1-65535>" },
+  { "nei 10.0.0.1 rem 100", 1, CMD_ERR_NO_MATCH, NULL },
+  { "ne 10.0.0.1", 0, CMD_ERR_AMBIGUOUS, NULL },
+  { "neighbor 10.0.0.1", 0, CMD_ERR_INCOMPLETE, NULL },
+  { "neighbor 10.0.0.1 remote-as 65536", 0, CMD_ERR_NO_MATCH, NULL },
+  { "neighbor 10.0.0.1 description a b c", 1, CMD_SUCCESS,
+    "neighbor A.B.C.D description .LINE" },
+  { "neighbor 10.0.0.1 sh", 0, CMD_SUCCESS,
+    "neighbor A.B.C.D (activate|shutdown)" },
+  { "neighbor 2001:db8::1 remote-as 1", 1, CMD_SUCCESS,
+    "neighbor X:X::X:X remote-as <1-65535>" },
+  { "neighbor foo peer-group", 1, CMD_SUCCESS,
+    "neighbor WORD peer-group" },
+  { "network 10.0.0.0/8", 1, CMD_SUCCESS, "network A.B.C.D/M" },
+  { "network 10.0.0.0/33", 0, CMD_ERR_NO_MATCH, NULL },
+  { "network 10.0.0.0 mask 255.0.0.0", 1, CMD_SUCCESS,
+    "network A.B.C.D mask A.B.C.D" },
+  { "ipv6 network 2001:db8::/32", 1, CMD_SUCCESS,
+    "ipv6 network X:X::X:X/M" },
+  { "ipv6 net 2001:db8::/129", 0, CMD_ERR_NO_MATCH, NULL },
+  { "network 10.0.0.0/8 route-map RM", 1, CMD_SUCCESS,
+    "network A.B.C.D/M route-map WORD" },
+  { "nexthop-tracking", 1, CMD_SUCCESS, "nexthop-tracking [WORD]" },
+  { "nexthop-tracking foo", 1, CMD_SUCCESS, "nexthop-tracking [WORD]" },
+  { "distance 10", 1, CMD_SUCCESS, "distance <1-255> [WORD]" },
+  { "distance 10 10.0.0.0/8", 1, CMD_ERR_AMBIGUOUS, NULL },
+  { "distance 256", 0, CMD_ERR_NO_MATCH, NULL },
+  { "redistribute static metric 10", 1, CMD_SUCCESS,
+    "redistribute (kernel|connected|static) metric <0-16777214>" },
+  { "red c r RM", 0, CMD_SUCCESS,
+    "redistribute (kernel|connected|static) route-map WORD" },
+  { "ip route 10.0.0.0/8 eth0", 1, CMD_SUCCESS,
+    "ip route A.B.C.D/M (A.B.C.D|INTERFACE)" },
+  { "ip route 10.0.0.0/8 10.0.0.1 5", 1, CMD_SUCCESS,
+    "ip route A.B.C.D/M A.B.C.D <1-255>" },
+  { "ipv6 route 2001:db8::/32 2001:db8::1", 1, CMD_SUCCESS,
+    "ipv6 route X:X::X:X/M X:X::X:X" },
+  { "set community 65000:1 65000:2", 1, CMD_SUCCESS,
+    "set community .AA:NN" },
+  { "set comm-list L delete", 1, CMD_SUCCESS,
+    "set comm-list WORD delete" },
+  { NULL, 0, 0, NULL }
+};
+
+/* Values for variables: valid, incomplete and invalid. */
+static const char *ipv4_values[] =
+  { "10.0.0.1", "10.0", "10.0.0.", "300.1.1.1", "1.2.3.4.5", "x", NULL };
+static const char *ipv4_prefix_values[] =
+  { "10.0.0.0/8", "10.0.0.0/", "10.0.0.0/33", "10.0.0", "10.0.0.1", NULL };
+static const char *ipv6_values[] =
+  { "2001:db8::1", "2001:db8:", "::", "2001:db8::/32", "10.0.0.1", NULL };
+static const char *ipv6_prefix_values[] =
+  { "2001:db8::/32", "2001:db8::/", "2001:db8::/129", "2001:db8::1", NULL };
+static const char *word_values[] =
+  { "foo", "eth0", "10", "n", NULL };
+
+static int
+cmd_nop (struct cmd_element *self, struct vty *vty, int argc,
+	 const char *argv[])
+{
+  return CMD_SUCCESS;
+}
+
+/* Install cmd with a help line for each of its words. */
+static void
+test_cmd_install (enum node_type node, const char *string)
+{
+  struct cmd_element *cmd;
+  const char *p;
+  char *doc;
+  int words = 1;
+
+  for (p = string; *p; p++)
+    if (*p == ' ')
+      words++;
+  doc = XCALLOC (MTYPE_TMP, 5 * words + 1);
+  while (words--)
+    strcat (doc, "Test\n");
+
+  cmd = XCALLOC (MTYPE_TMP, sizeof (struct cmd_element));
+  cmd->string = string;
+  cmd->func = cmd_nop;
+  cmd->doc = doc;
+  install_element (node, cmd);
+}
+
+static const char *
+pick (const char **values)
+{
+  int n;
+
+  for (n = 0; values[n]; n++)
+    ;
+  return values[random () % n];
+}
+
+/* A value for desc str, or str itself abbreviated for a keyword. */
+static void
+word_make (char *buf, size_t size, const char *str)
+{
+  long long low, high;
+
+  if (CMD_VARARG (str))
+    snprintf (buf, size, "%s", pick (word_values));
+  else if (CMD_RANGE (str))
+    {
+      sscanf (str, "<%lld-%lld>", &low, &high);
+      switch (random () % 4)
+	{
+	case 0:
+	  snprintf (buf, size, "%lld", low);
+	  break;
+	case 1:
+	  snprintf (buf, size, "%lld", high);
+	  break;
+	case 2:
+	  snprintf (buf, size, "%lld", high + 1);
+	  break;
+	default:
+	  snprintf (buf, size, "%lld", low + random () % (high - low + 1));
+	  break;
+	}
+    }
+  else if (CMD_IPV4 (str))
+    snprintf (buf, size, "%s", pick (ipv4_values));
+  else if (CMD_IPV4_PREFIX (str))
+    snprintf (buf, size, "%s", pick (ipv4_prefix_values));
+  else if (CMD_IPV6 (str))
+    snprintf (buf, size, "%s", pick (ipv6_values));
+  else if (CMD_IPV6_PREFIX (str))
+    snprintf (buf, size, "%s", pick (ipv6_prefix_values));
+  else if (CMD_OPTION (str) || CMD_VARIABLE (str) || *str == '\0')
+    snprintf (buf, size, "%s", pick (word_values));
+  else if (random () % 2)
+    snprintf (buf, size, "%s", str);
+  else
+    snprintf (buf, size, "%.*s", 1 + (int) (random () % strlen (str)), str);
+}
+
+/* A word for the descs of one word of a command, from one of them. */
+static void
+descvec_word (char *buf, size_t size, vector descvec)
+{
+  struct desc *desc;
+
+  desc = vector_slot (descvec, random () % vector_active (descvec));
+  word_make (buf, size, desc->cmd);
+}
+
+/* Match vline both ways, and count a difference as a failure. */
+static int
+compare (vector vline, enum node_type node, int strict)
+{
+  struct cmd_element *trie_cmd, *vector_cmd;
+  int trie_ret, vector_ret;
+  unsigned int i;
+
+  trie_ret = cmd_match (vline, node, strict, &trie_cmd);
+  vector_ret = cmd_match_vector (vline, node, strict, &vector_cmd);
+  if (trie_ret == vector_ret
+      && (trie_ret != CMD_SUCCESS || trie_cmd == vector_cmd))
+    return trie_ret;
+
+  printf ("node %d%s:", node, strict ? " strict" : "");
+  for (i = 0; i < vector_active (vline); i++)
+    printf (" %s", (char *) vector_slot (vline, i));
+  printf ("\n  trie %d %s, vector %d %s\n",
+	  trie_ret, trie_ret == CMD_SUCCESS ? trie_cmd->string : "",
+	  vector_ret, vector_ret == CMD_SUCCESS ? vector_cmd->string : "");
+  failed++;
+  return trie_ret;
+}
+
+static void
+test_expect (void)
+{
+  struct cmd_element *cmd;
+  vector vline;
+  int i, ret, oldfailed = failed;
+
+  for (i = 0; expect[i].line; i++)
+    {
+      vline = cmd_make_strvec (expect[i].line);
+      ret = compare (vline, CONFIG_NODE, expect[i].strict);
+      cmd_match (vline, CONFIG_NODE, expect[i].strict, &cmd);
+      if (ret != expect[i].ret
+	  || (ret == CMD_SUCCESS && strcmp (cmd->string, expect[i].cmd)))
+	{
+	  printf ("%s%s: %d %s, expected %d %s\n", expect[i].line,
+		  expect[i].strict ? " (strict)" : "", ret,
+		  ret == CMD_SUCCESS ? cmd->string : "",
+		  expect[i].ret, expect[i].cmd ? expect[i].cmd : "");
+	  failed++;
+	}
+      cmd_free_strvec (vline);
+    }
+  result ("expected results", oldfailed);
+}
+
+/* Lines made from the commands of node. */
+static void
+test_random (enum node_type node, vector cmds, unsigned long *lines,
+	     unsigned long *results)
+{
+  struct cmd_element *cmd, *other;
+  char buf[64];
+  vector vline;
+  unsigned int i, j, words, variant;
+  int strict, ret;
+
+  for (i = 0; i < vector_active (cmds); i++)
+    {
+      if ((cmd = vector_slot (cmds, i)) == NULL)
+	continue;
+
+      for (variant = 0; variant < VARIANTS; variant++)
+	{
+	  /* All the words, or some left out at the end, or one more. */
+	  words = vector_active (cmd->strvec);
+	  switch (random () % 4)
+	    {
+	    case 0:
+	      words = random () % (words + 1);
+	      break;
+	    case 1:
+	      words++;
+	      break;
+	    }
+	  if (words == 0)
+	    words = 1;
+
+	  vline = vector_init (words);
+	  for (j = 0; j < words; j++)
+	    {
+	      /* Now and then a word of another command. */
+	      other = cmd;
+	      if (j >= vector_active (cmd->strvec) || random () % 8 == 0)
+		other = vector_slot (cmds, random () % vector_active (cmds));
+	      if (other && j < vector_active (other->strvec))
+		descvec_word (buf, sizeof (buf),
+			      vector_slot (other->strvec, j));
+	      else
+		snprintf (buf, sizeof (buf), "%s", pick (word_values));
+	      vector_set (vline, XSTRDUP (MTYPE_STRVEC, buf));
+	    }
+
+	  for (strict = 0; strict <= 1; strict++)
+	    {
+	      ret = compare (vline, node, strict);
+	      (*lines)++;
+	      if (ret >= 0 && ret < 16)
+		results[ret]++;
+	    }
+	  cmd_free_strvec (vline);
+	}
+    }
+}
+
+int
+main (void)
+{
+  struct cmd_node *cnode;
+  unsigned long lines = 0, results[16];
+  unsigned int node;
+  int i, oldfailed;
+
+  master = thread_master_create ();
+  cmd_init (1);
+  vty_init (master);
+  memory_init ();
+  bgp_master_init ();
+  bgp_init ();
+  for (i = 0; test_cmds[i]; i++)
+    test_cmd_install (CONFIG_NODE, test_cmds[i]);
+  sort_node ();
+
+  test_expect ();
+
+  oldfailed = failed;
+  srandom (1);
+  memset (results, 0, sizeof (results));
+  for (node = 0; node < vector_active (cmdvec); node++)
+    if ((cnode = vector_slot (cmdvec, node)) != NULL)
+      test_random (node, cnode->cmd_vector, &lines, results);
+  printf ("random lines: %lu, %lu matched, %lu ambiguous, %lu incomplete,"
+	  " %lu no match: %s\n", lines, results[CMD_SUCCESS],
+	  results[CMD_ERR_AMBIGUOUS], results[CMD_ERR_INCOMPLETE],
+	  results[CMD_ERR_NO_MATCH], result_str (oldfailed));
+
+  printf ("failures: %d\n", failed);
+  return failed;
+}
@@ -0,0 +1,72 @@
+/*
+ * Helpers shared by the tests and benchmarks.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "command.h"
+#include "vty.h"
+
+#include "test-common.h"
+
+int failed = 0;
+
+const char *
+result_str (int oldfailed)
+{
+  if (isatty (STDOUT_FILENO))
+    return (failed > oldfailed) ? VT100_RED "failed!" VT100_RESET
+				: VT100_GREEN "OK" VT100_RESET;
+  return (failed > oldfailed) ? "failed!" : "OK";
+}
+
+void
+result (const char *name, int oldfailed)
+{
+  printf ("%s: %s\n", name, result_str (oldfailed));
+}
+
+void
+execute (struct vty *vty, const char *line)
+{
+  vector vline;
+
+  vline = cmd_make_strvec (line);
+  if (cmd_execute_command (vline, vty, NULL, 1) != CMD_SUCCESS)
+    {
+      fprintf (stderr, "failed: %s\n", line);
+      exit (1);
+    }
+  cmd_free_strvec (vline);
+}
+
+unsigned long
+tv_usec (struct timeval *a, struct timeval *b)
+{
+  return (a->tv_sec - b->tv_sec) * 1000000L + (a->tv_usec - b->tv_usec);
+}
+
+double
+rate (unsigned long n, struct timeval *end, struct timeval *start)
+{
+  unsigned long usec = tv_usec (end, start);
+
+  return n * 1000000.0 / (usec ? usec : 1);
+}
@@ -0,0 +1,47 @@
+/*
+ * Helpers shared by the tests and benchmarks.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _QUAGGA_TEST_COMMON_H
+#define _QUAGGA_TEST_COMMON_H
+
+struct vty;
+
+#define VT100_RESET "\x1b[0m"
+#define VT100_RED "\x1b[31m"
+#define VT100_GREEN "\x1b[32m"
+
+/* Checks that failed so far, which a test returns from main (). */
+extern int failed;
+
+/* Whether checks failed since oldfailed, as "OK" or "failed!", in
+   colour on a terminal, and that printed for the checks of name. */
+extern const char *result_str (int oldfailed);
+extern void result (const char *name, int oldfailed);
+
+/* Run a command line on vty, exiting if it fails. */
+extern void execute (struct vty *vty, const char *line);
+
+/* Microseconds from b to a, and n in that time as a rate per second. */
+extern unsigned long tv_usec (struct timeval *a, struct timeval *b);
+extern double rate (unsigned long n, struct timeval *end,
+		    struct timeval *start);
+
+#endif /* _QUAGGA_TEST_COMMON_H */
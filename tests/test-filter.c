@@ -0,0 +1,321 @@
+/*
+ * Test of applying access-lists through their index.
+ *
+ * Random access-lists are built through the CLI and random prefixes
+ * are applied to them both by access_list_apply(), which goes by the
+ * tries and the chain the filters are indexed on, and by trying the
+ * filters in list order, which must give the same.  Numbered lists
+ * mix cisco filters with contiguous and non-contiguous wildcards, so
+ * the first match in list order has to be found across the cisco trie
+ * and the other chain, standard or extended, with "host" and "any"
+ * ones.  Named lists have zebra filters, exact or not, and "any" ones,
+ * on IPv4 and IPv6.  Some filters are deleted and added again, coming
+ * last then, and some prefixes are of the other address family.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "command.h"
+#include "vty.h"
+#include "memory.h"
+#include "thread.h"
+#include "prefix.h"
+#include "filter.h"
+
+#include "test-common.h"
+
+struct thread_master *master;
+
+#define ROUNDS       200
+#define FILTERS_MAX  64
+#define PROBES       2000
+
+/* Kinds of list, each in a list of its own name. */
+enum list_kind
+{
+  LIST_STANDARD,	/* cisco standard filters */
+  LIST_EXTENDED,	/* cisco extended filters */
+  LIST_ZEBRA,		/* zebra filters on IPv4 */
+  LIST_IPV6,		/* zebra filters on IPv6 */
+  LIST_KINDS
+};
+
+static const char *list_names[LIST_KINDS] =
+  { "10", "110", "zebra", "zebra6" };
+
+/* The lines making up the list being tested, to show when it fails. */
+static char lines[2 * FILTERS_MAX][128];
+static int nlines;
+
+/* An IPv4 address, mostly out of a few so filters and prefixes meet. */
+static u_int32_t
+addr_make (void)
+{
+  static const u_int32_t octets[] = { 0, 1, 128, 255 };
+  u_int32_t addr;
+  int i;
+
+  addr = (random () % 4) ? 10 : 192;
+  for (i = 0; i < 3; i++)
+    addr = (addr << 8) | ((random () % 8) ? octets[random () % 4]
+			  : (u_int32_t) (random () & 0xff));
+  return addr;
+}
+
+/* Wildcard bits, contiguous or not. */
+static u_int32_t
+wild_make (void)
+{
+  static const u_int32_t wilds[] =
+    { 0x00ff00ff, 0x0000ff00, 0xff000000, 0x000000fe, 0x00ffff00 };
+  static const int lens[] = { 0, 8, 16, 24, 25, 32 };
+  int len;
+
+  switch (random () % 4)
+    {
+    case 0:
+      return wilds[random () % 5];
+    case 1:
+      return random ();
+    default:
+      len = (random () % 2) ? lens[random () % 6] : (int) (random () % 33);
+      return len == 32 ? 0 : 0xffffffff >> len;
+    }
+}
+
+static char *
+dotted (char *buf, u_int32_t addr)
+{
+  struct in_addr in;
+
+  in.s_addr = htonl (addr);
+  strcpy (buf, inet_ntoa (in));
+  return buf;
+}
+
+/* Address and wildcard words of a cisco filter, "any" and "host"
+   ones too.  A mask is a netmask when for the destination of an
+   extended filter. */
+static void
+cisco_words (char *buf, size_t size, int mask)
+{
+  static const int lens[] = { 0, 8, 16, 24, 32 };
+  char a[INET_ADDRSTRLEN], w[INET_ADDRSTRLEN];
+  struct in_addr in;
+  u_int32_t addr;
+
+  if (mask)
+    {
+      masklen2ip (lens[random () % 5], &in);
+      addr = ntohl (in.s_addr);
+    }
+  else
+    addr = addr_make ();
+
+  switch (random () % 8)
+    {
+    case 0:
+      snprintf (buf, size, "any");
+      break;
+    case 1:
+      snprintf (buf, size, "host %s", dotted (a, addr));
+      break;
+    default:
+      snprintf (buf, size, "%s %s", dotted (a, addr),
+		dotted (w, mask && random () % 2 ? 0 : wild_make ()));
+      break;
+    }
+}
+
+static void
+filter_line (char *buf, size_t size, enum list_kind kind)
+{
+  const char *name = list_names[kind];
+  const char *type = (random () % 3) ? "permit" : "deny";
+  char src[40], dst[40], a[INET_ADDRSTRLEN];
+  const char *exact = (random () % 4) ? "" : " exact-match";
+
+  switch (kind)
+    {
+    case LIST_STANDARD:
+      cisco_words (src, sizeof (src), 0);
+      if (random () % 8 == 0 && strchr (src, ' ') && strncmp (src, "host", 4))
+	*strchr (src, ' ') = '\0';
+      snprintf (buf, size, "access-list %s %s %s", name, type, src);
+      break;
+    case LIST_EXTENDED:
+      cisco_words (src, sizeof (src), 0);
+      cisco_words (dst, sizeof (dst), 1);
+      snprintf (buf, size, "access-list %s %s ip %s %s", name, type, src,
+		dst);
+      break;
+    case LIST_ZEBRA:
+      if (random () % 16 == 0)
+	snprintf (buf, size, "access-list %s %s any", name, type);
+      else
+	snprintf (buf, size, "access-list %s %s %s/%d%s", name, type,
+		  dotted (a, addr_make ()), (int) (random () % 33), exact);
+      break;
+    case LIST_IPV6:
+      if (random () % 16 == 0)
+	snprintf (buf, size, "ipv6 access-list %s %s any", name, type);
+      else
+	snprintf (buf, size, "ipv6 access-list %s %s 2001:db8:%x::%x/%d%s",
+		  name, type, (random () % 2) ? 0x8000 : (int) random () % 4,
+		  (int) random () % 2, (int) (random () % 129), exact);
+      break;
+    default:
+      break;
+    }
+}
+
+/* A prefix near the filters of the list, now and then of the other
+   address family.  Not for extended filters, which take the length of
+   any prefix for an IPv4 mask. */
+static void
+probe_make (struct prefix *p, enum list_kind kind)
+{
+  static const int lens[] = { 0, 8, 16, 24, 25, 32 };
+  int other = (kind != LIST_EXTENDED && random () % 16 == 0);
+
+  memset (p, 0, sizeof (struct prefix));
+  if ((kind == LIST_IPV6) != other)
+    {
+      p->family = AF_INET6;
+      p->prefixlen = random () % 129;
+      p->u.prefix6.s6_addr[0] = 0x20;
+      p->u.prefix6.s6_addr[1] = 0x01;
+      p->u.prefix6.s6_addr[2] = 0x0d;
+      p->u.prefix6.s6_addr[3] = 0xb8;
+      p->u.prefix6.s6_addr[4] = (random () % 2) ? 0x80 : 0;
+      p->u.prefix6.s6_addr[5] = random () % 4;
+      p->u.prefix6.s6_addr[15] = random () % 2;
+      if (random () % 8 == 0)
+	p->u.prefix6.s6_addr[random () % 16] ^= 1 << (random () % 8);
+    }
+  else
+    {
+      p->family = AF_INET;
+      p->prefixlen = (random () % 2) ? lens[random () % 6]
+				     : (int) (random () % 33);
+      p->u.prefix4.s_addr = htonl (addr_make ());
+    }
+
+  /* Cisco filters look at the whole address. */
+  if (random () % 2)
+    apply_mask (p);
+}
+
+static void
+list_dump (struct prefix *p, enum filter_type indexed,
+	   enum filter_type linear)
+{
+  char buf[INET6_ADDRSTRLEN];
+  int i;
+
+  for (i = 0; i < nlines; i++)
+    printf ("  %s\n", lines[i]);
+  printf ("  %s/%d: %s, in list order %s\n",
+	  inet_ntop (p->family, &p->u.prefix, buf, sizeof (buf)),
+	  p->prefixlen, indexed == FILTER_PERMIT ? "permit" : "deny",
+	  linear == FILTER_PERMIT ? "permit" : "deny");
+}
+
+/* Build a random list of kind, deleting some of its filters and adding
+   some of those again, and probe it. */
+static void
+test_list (struct vty *vty, enum list_kind kind)
+{
+  struct access_list *access;
+  enum filter_type indexed, linear;
+  struct prefix p;
+  char line[128];
+  int i, count;
+
+  nlines = 0;
+  count = 1 + random () % FILTERS_MAX;
+  for (i = 0; i < count; i++)
+    {
+      filter_line (lines[nlines], sizeof (lines[0]), kind);
+      execute (vty, lines[nlines++]);
+    }
+
+  for (i = 0; i < count / 4; i++)
+    {
+      snprintf (line, sizeof (line), "no %s", lines[random () % count]);
+      execute (vty, line);
+      strcpy (lines[nlines++], line);
+      if (random () % 2)
+	{
+	  strcpy (lines[nlines], line + 3);
+	  execute (vty, lines[nlines++]);
+	}
+    }
+
+  access = access_list_lookup (kind == LIST_IPV6 ? AFI_IP6 : AFI_IP,
+			       list_names[kind]);
+  for (i = 0; i < PROBES; i++)
+    {
+      probe_make (&p, kind);
+      indexed = access_list_apply (access, &p);
+      linear = access_list_apply_linear (access, &p);
+      if (indexed != linear)
+	{
+	  list_dump (&p, indexed, linear);
+	  failed++;
+	  break;
+	}
+    }
+}
+
+int
+main (void)
+{
+  static const char *names[LIST_KINDS] =
+    { "standard", "extended", "zebra", "ipv6" };
+  struct vty *vty;
+  int kind, round, oldfailed;
+
+  master = thread_master_create ();
+  cmd_init (1);
+  vty_init (master);
+  memory_init ();
+  access_list_init ();
+  sort_node ();
+
+  vty = vty_new ();
+  vty->type = VTY_TERM;
+  vty->node = CONFIG_NODE;
+
+  srandom (1);
+  for (kind = 0; kind < LIST_KINDS; kind++)
+    {
+      oldfailed = failed;
+      for (round = 0; round < ROUNDS; round++)
+	{
+	  test_list (vty, kind);
+	  access_list_reset ();
+	}
+      result (names[kind], oldfailed);
+    }
+
+  printf ("failures: %d\n", failed);
+  return failed;
+}
@@ -22,6 +22,7 @@ struct thread_master *master;
 #endif
 
 #define TIMES 10
+#define POOL_OBJECTS 10000
 
 int
 main(int argc, char **argv)
@@ -99,5 +100,34 @@ main(int argc, char **argv)
       XFREE(MTYPE_VTY, a[2]);
       /* alloc == 0, cache valid next request */
     }
+
+  printf ("pooled type, filling and emptying slabs\n\n");
+  /* a pool can't be set up while objects of its type are allocated */
+  a[0] = XMALLOC (MTYPE_VTY, 40);
+  assert (memory_pool_init (MTYPE_VTY, 40) == -1);
+  XFREE (MTYPE_VTY, a[0]);
+  assert (memory_pool_init (MTYPE_TMP, 40) == 0);
+  for (i = 0; i < TIMES; i++)
+    {
+      static void *p[POOL_OBJECTS];
+      int j;
+
+      for (j = 0; j < POOL_OBJECTS; j++)
+        {
+          p[j] = XCALLOC (MTYPE_TMP, 40);
+          assert (*(char *) p[j] == 0 && ((char *) p[j])[39] == 0);
+          memset (p[j], j, 40);
+        }
+      /* free every other object, then the rest in reverse */
+      for (j = 0; j < POOL_OBJECTS; j += 2)
+        XFREE (MTYPE_TMP, p[j]);
+      for (j = 1; j < POOL_OBJECTS; j += 2)
+        assert (*(unsigned char *) p[j] == (j & 0xff));
+      for (j = 0; j < POOL_OBJECTS; j += 2)
+        p[j] = XMALLOC (MTYPE_TMP, 40);
+      for (j = POOL_OBJECTS - 1; j >= 0; j--)
+        XFREE (MTYPE_TMP, p[j]);
+      assert (mtype_stats_alloc (MTYPE_TMP) == 0);
+    }
   return 0;
 }
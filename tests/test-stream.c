@@ -27,6 +27,58 @@ print_stream (struct stream *s)
   stream_set_getp (s, getp);
 }
 
+/* Streams sharing their data: refs, slices and fifos of them. */
+static int
+test_shared (void)
+{
+  struct stream *s, *ref, *slice;
+  struct stream_fifo *fifo[3];
+  int i, ret = 0;
+
+  s = stream_new (64);
+  stream_putl (s, 0x01020304);
+  stream_putl (s, 0x05060708);
+
+  ref = stream_ref (s);
+  slice = stream_slice (s, 2, 4);
+  print_stream (slice);
+
+  /* Own positions, same data. */
+  stream_getl (ref);
+  if (stream_get_getp (s) != 0 || stream_getw (slice) != 0x0304
+      || stream_getw_from (ref, 2) != 0x0304)
+    ret = 1;
+  stream_putc_at (s, 4, 0xff);
+  if (stream_getc (slice) != 0xff || !stream_is_shared (s))
+    ret = 1;
+
+  /* The data outlives the stream it was made with. */
+  stream_free (s);
+  for (i = 0; i < 3; i++)
+    {
+      fifo[i] = stream_fifo_new ();
+      stream_fifo_push_ref (fifo[i], ref);
+    }
+  stream_free (ref);
+  for (i = 0; i < 3; i++)
+    {
+      if (stream_getl_from (stream_fifo_head (fifo[i]), 0) != 0x01020304)
+	ret = 1;
+      stream_fifo_free (fifo[i]);
+    }
+  if (stream_is_shared (slice))
+    ret = 1;
+
+  /* Resizing takes a private copy. */
+  stream_resize (slice, 8);
+  if (slice->buf != NULL || stream_getc_from (slice, 3) != 0x06)
+    ret = 1;
+  stream_free (slice);
+
+  printf ("shared: %s\n", ret ? "FAILED" : "OK");
+  return ret;
+}
+
 int
 main (void)
 {
@@ -50,5 +102,5 @@ main (void)
   printf ("l: 0x%x\n", stream_getl (s));
   printf ("q: 0x%lx\n", stream_getq (s));
   
-  return 0;
+  return test_shared ();
 }
@@ -0,0 +1,136 @@
+/*
+ * Test of thread masters running in pthreads of their own, posting
+ * events to each other with thread_add_event_mt().
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "thread.h"
+#include "memory.h"
+
+struct thread_master *master;
+
+#define WORKERS 4
+#define PINGS 20000
+
+static struct worker
+{
+  struct thread_master *m;
+  int pings;			/* only touched in the worker pthread */
+} workers[WORKERS];
+
+static int pongs;		/* only touched in the main pthread */
+static int cancelled;
+
+/* Held by the main pthread to keep a worker busy. */
+static pthread_mutex_t hold_mtx = PTHREAD_MUTEX_INITIALIZER;
+
+static int ping (struct thread *);
+
+/* Runs in the main pthread. */
+static int
+pong (struct thread *thread)
+{
+  struct worker *w = THREAD_ARG (thread);
+
+  pongs++;
+  if (THREAD_VAL (thread) < PINGS)
+    thread_add_event_mt (w->m, ping, w, THREAD_VAL (thread) + 1);
+  return 0;
+}
+
+/* Runs in a worker pthread. */
+static int
+ping (struct thread *thread)
+{
+  struct worker *w = THREAD_ARG (thread);
+
+  w->pings++;
+  thread_add_event_mt (master, pong, w, THREAD_VAL (thread));
+  return 0;
+}
+
+static int
+hold (struct thread *thread)
+{
+  pthread_mutex_lock (&hold_mtx);
+  pthread_mutex_unlock (&hold_mtx);
+  return 0;
+}
+
+static int
+never (struct thread *thread)
+{
+  cancelled++;
+  return 0;
+}
+
+int
+main (void)
+{
+  struct thread thread;
+  int i, ret = 0;
+
+  master = thread_master_create ();
+
+  for (i = 0; i < WORKERS; i++)
+    {
+      workers[i].m = thread_master_create ();
+      if (thread_master_start (workers[i].m) < 0)
+        return 1;
+    }
+
+  /* An event posted and cancelled from another pthread never runs, if
+     the worker doesn't get to it in between.  Keep it busy meanwhile. */
+  pthread_mutex_lock (&hold_mtx);
+  thread_add_event_mt (workers[0].m, hold, NULL, 0);
+  thread_add_event_mt (workers[0].m, never, &cancelled, 0);
+  thread_cancel_event_mt (workers[0].m, &cancelled);
+  pthread_mutex_unlock (&hold_mtx);
+
+  for (i = 0; i < WORKERS; i++)
+    thread_add_event_mt (workers[i].m, ping, &workers[i], 1);
+
+  while (pongs < WORKERS * PINGS && thread_fetch (master, &thread))
+    thread_call (&thread);
+
+  for (i = 0; i < WORKERS; i++)
+    {
+      thread_master_stop (workers[i].m);
+      if (workers[i].pings != PINGS)
+        {
+          printf ("worker %d: %d pings, expected %d\n", i,
+                  workers[i].pings, PINGS);
+          ret = 1;
+        }
+      thread_master_free (workers[i].m);
+    }
+
+  if (pongs != WORKERS * PINGS || cancelled)
+    {
+      printf ("%d pongs, expected %d, %d cancelled events ran\n",
+              pongs, WORKERS * PINGS, cancelled);
+      ret = 1;
+    }
+
+  thread_master_free (master);
+  printf ("%s\n", ret ? "FAILED" : "OK");
+  return ret;
+}
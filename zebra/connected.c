@@ -63,7 +63,7 @@ connected_withdraw (struct connected *ifc)
 
   if (!CHECK_FLAG (ifc->conf, ZEBRA_IFC_CONFIGURED))
     {
-      listnode_delete (ifc->ifp->connected, ifc);
+      connected_delete (ifc->ifp, ifc);
       connected_free (ifc);
     }
 }
@@ -74,7 +74,7 @@ connected_announce (struct interface *ifp, struct connected *ifc)
   if (!ifc)
     return;
   
-  listnode_add (ifp->connected, ifc);
+  connected_add (ifp, ifc);
 
   /* Update interface address information to protocol daemon. */
   if (! CHECK_FLAG (ifc->conf, ZEBRA_IFC_REAL))
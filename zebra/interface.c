@@ -447,7 +447,7 @@ if_delete_update (struct interface *ifp)
 		  /* Remove from interface address list (unconditionally). */
 		  if (!CHECK_FLAG (ifc->conf, ZEBRA_IFC_CONFIGURED))
 		    {
-		      listnode_delete (ifp->connected, ifc);
+		      connected_delete (ifp, ifc);
 		      connected_free (ifc);
                     }
                   else
@@ -472,7 +472,7 @@ if_delete_update (struct interface *ifp)
 		last = node;
 	      else
 		{
-		  listnode_delete (ifp->connected, ifc);
+		  connected_delete (ifp, ifc);
 		  connected_free (ifc);
 		}
 	    }
@@ -490,7 +490,7 @@ if_delete_update (struct interface *ifp)
      while processing the deletion.  Each client daemon is responsible
      for setting ifindex to IFINDEX_INTERNAL after processing the
      interface deletion message. */
-  ifp->ifindex = IFINDEX_INTERNAL;
+  if_set_index (ifp, IFINDEX_INTERNAL);
 }
 
 /* Interface is up. */
@@ -1206,7 +1206,7 @@ ip_address_install (struct vty *vty, struct interface *ifp,
 	ifc->label = XSTRDUP (MTYPE_CONNECTED_LABEL, label);
 
       /* Add to linked list. */
-      listnode_add (ifp->connected, ifc);
+      connected_add (ifp, ifc);
     }
 
   /* This address is configured from zebra. */
@@ -1284,7 +1284,7 @@ ip_address_uninstall (struct vty *vty, struct interface *ifp,
   if (! CHECK_FLAG (ifc->conf, ZEBRA_IFC_REAL)
       || ! CHECK_FLAG (ifp->status, ZEBRA_INTERFACE_ACTIVE))
     {
-      listnode_delete (ifp->connected, ifc);
+      connected_delete (ifp, ifc);
       connected_free (ifc);
       return CMD_WARNING;
     }
@@ -1306,7 +1306,7 @@ ip_address_uninstall (struct vty *vty, struct interface *ifp,
   connected_down_ipv4 (ifp, ifc);
 
   /* Free address information. */
-  listnode_delete (ifp->connected, ifc);
+  connected_delete (ifp, ifc);
   connected_free (ifc);
 #endif
 
@@ -1399,7 +1399,7 @@ ipv6_address_install (struct vty *vty, struct interface *ifp,
 	ifc->label = XSTRDUP (MTYPE_CONNECTED_LABEL, label);
 
       /* Add to linked list. */
-      listnode_add (ifp->connected, ifc);
+      connected_add (ifp, ifc);
     }
 
   /* This address is configured from zebra. */
@@ -1473,7 +1473,7 @@ ipv6_address_uninstall (struct vty *vty, struct interface *ifp,
   if (! CHECK_FLAG (ifc->conf, ZEBRA_IFC_REAL)
       || ! CHECK_FLAG (ifp->status, ZEBRA_INTERFACE_ACTIVE))
     {
-      listnode_delete (ifp->connected, ifc);
+      connected_delete (ifp, ifc);
       connected_free (ifc);
       return CMD_WARNING;
     }
@@ -1494,7 +1494,7 @@ ipv6_address_uninstall (struct vty *vty, struct interface *ifp,
   connected_down_ipv6 (ifp, ifc);
 
   /* Free address information. */
-  listnode_delete (ifp->connected, ifc);
+  connected_delete (ifp, ifc);
   connected_free (ifc);
 
   return CMD_SUCCESS;
@@ -32,6 +32,8 @@
 #include "plist.h"
 #include "privs.h"
 #include "sigevent.h"
+#include "linklist.h"
+#include "table.h"
 
 #include "zebra/rib.h"
 #include "zebra/zserv.h"
@@ -39,6 +41,7 @@
 #include "zebra/router-id.h"
 #include "zebra/irdp.h"
 #include "zebra/rtadv.h"
+#include "zebra/zebra_rnh.h"
 
 /* Zebra instance */
 struct zebra_t zebrad =
@@ -227,6 +230,14 @@ main (int argc, char **argv)
   zlog_default = openzlog (progname, ZLOG_ZEBRA,
 			   LOG_CONS|LOG_NDELAY|LOG_PID, LOG_DAEMON);
 
+  /* Carve the objects a big RIB is made of out of slab pools, see
+     memory_pool_init(). */
+  memory_pool_init (MTYPE_RIB, sizeof (struct rib));
+  memory_pool_init (MTYPE_NEXTHOP, sizeof (struct nexthop));
+  memory_pool_init (MTYPE_ROUTE_NODE, sizeof (struct route_node));
+  memory_pool_init (MTYPE_LINK_NODE, sizeof (struct listnode));
+  memory_pool_init (MTYPE_THREAD, sizeof (struct thread));
+
   while (1) 
     {
       int opt;
@@ -324,6 +335,7 @@ main (int argc, char **argv)
   zebra_if_init ();
   zebra_debug_init ();
   router_id_init();
+  zebra_rnh_init ();
   zebra_vty_init ();
   access_list_init ();
   prefix_list_init ();
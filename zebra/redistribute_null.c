@@ -3,6 +3,7 @@
 #include "zebra/zserv.h"
 
 #include "zebra/redistribute.h"
+#include "zebra/zebra_rnh.h"
 
 void zebra_redistribute_add (int a, struct zserv *b, int c)
 { return; }
@@ -24,3 +25,6 @@ void zebra_interface_address_add_update (struct interface *a,
 					 	struct connected *b)
 { return; }
 #pragma weak zebra_interface_address_delete_update = zebra_interface_address_add_update
+
+void zebra_rnh_rib_changed (struct prefix *a)
+{ return; }
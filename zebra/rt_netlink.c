@@ -112,7 +112,7 @@ set_ifindex(struct interface *ifp, unsigned int ifi_index)
 	  if_delete_update(oifp);
         }
     }
-  ifp->ifindex = ifi_index;
+  if_set_index (ifp, ifi_index);
 }
 
 static int
@@ -40,6 +40,7 @@
 #include "zebra/zserv.h"
 #include "zebra/redistribute.h"
 #include "zebra/debug.h"
+#include "zebra/zebra_rnh.h"
 
 /* Default rtm_table for all clients */
 extern struct zebra_t zebrad;
@@ -1169,6 +1170,9 @@ rib_process (struct route_node *rn)
     }
 
 end:
+  /* The nexthops tracked for clients may resolve differently now. */
+  zebra_rnh_rib_changed (&rn->p);
+
   if (IS_ZEBRA_DEBUG_RIB_Q)
     zlog_debug ("%s: %s/%d: rn %p dequeued", __func__, buf, rn->p.prefixlen, rn);
 }
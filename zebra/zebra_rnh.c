@@ -0,0 +1,385 @@
+/*
+ * Nexthops tracked for the clients of zebra.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "prefix.h"
+#include "table.h"
+#include "linklist.h"
+#include "stream.h"
+#include "memory.h"
+#include "thread.h"
+#include "command.h"
+#include "vty.h"
+#include "log.h"
+#include "zclient.h"
+
+#include "zebra/rib.h"
+#include "zebra/zserv.h"
+#include "zebra/debug.h"
+#include "zebra/zebra_rnh.h"
+
+/* master zebra server structure */
+extern struct zebra_t zebrad;
+
+/* A tracked address, in the table of its family by its host prefix. */
+struct rnh
+{
+  /* The clients that registered it. */
+  struct list *clients;
+
+  /* What was last sent of it: the metric, the nexthop count and the
+     nexthops, as ZEBRA_NEXTHOP_UPDATE carries them. */
+  u_char *state;
+  size_t state_len;
+
+  u_int32_t metric;
+  u_char nexthop_num;
+};
+
+static struct route_table *rnh_table[AFI_MAX];
+
+/* To look at all tracked addresses again, once the RIB changes under
+   any of them. */
+static struct thread *t_rnh_evaluate;
+
+static struct stream *rnh_scratch;
+
+static struct route_table *
+rnh_table_get (struct prefix *p)
+{
+  switch (p->family)
+    {
+    case AF_INET:
+      return rnh_table[AFI_IP];
+#ifdef HAVE_IPV6
+    case AF_INET6:
+      return rnh_table[AFI_IP6];
+#endif /* HAVE_IPV6 */
+    default:
+      return NULL;
+    }
+}
+
+/* Puts what the address of p resolves to, in the form of the answer to
+   a nexthop lookup, with the gateway and the interface index both of
+   the nexthops that have both. */
+static void
+rnh_state_encode (struct stream *s, struct prefix *p, struct rnh *rnh)
+{
+  struct rib *rib;
+  struct nexthop *nexthop;
+  unsigned long nump;
+  u_char num = 0;
+
+#ifdef HAVE_IPV6
+  if (p->family == AF_INET6)
+    rib = rib_match_ipv6 (&p->u.prefix6);
+  else
+#endif /* HAVE_IPV6 */
+    rib = rib_match_ipv4 (p->u.prefix4);
+
+  stream_putl (s, rib ? rib->metric : 0);
+  nump = stream_get_endp (s);
+  stream_putc (s, 0);
+
+  if (rib)
+    for (nexthop = rib->nexthop; nexthop; nexthop = nexthop->next)
+      if (CHECK_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB))
+	{
+	  stream_putc (s, nexthop->type);
+	  switch (nexthop->type)
+	    {
+	    case ZEBRA_NEXTHOP_IPV4:
+	      stream_put_in_addr (s, &nexthop->gate.ipv4);
+	      break;
+	    case ZEBRA_NEXTHOP_IPV4_IFINDEX:
+	    case ZEBRA_NEXTHOP_IPV4_IFNAME:
+	      stream_put_in_addr (s, &nexthop->gate.ipv4);
+	      stream_putl (s, nexthop->ifindex);
+	      break;
+#ifdef HAVE_IPV6
+	    case ZEBRA_NEXTHOP_IPV6:
+	      stream_put (s, &nexthop->gate.ipv6, 16);
+	      break;
+	    case ZEBRA_NEXTHOP_IPV6_IFINDEX:
+	    case ZEBRA_NEXTHOP_IPV6_IFNAME:
+	      stream_put (s, &nexthop->gate.ipv6, 16);
+	      stream_putl (s, nexthop->ifindex);
+	      break;
+#endif /* HAVE_IPV6 */
+	    case ZEBRA_NEXTHOP_IFINDEX:
+	    case ZEBRA_NEXTHOP_IFNAME:
+	      stream_putl (s, nexthop->ifindex);
+	      break;
+	    default:
+	      /* do nothing */
+	      break;
+	    }
+	  num++;
+	}
+  stream_putc_at (s, nump, num);
+
+  rnh->metric = rib ? rib->metric : 0;
+  rnh->nexthop_num = num;
+}
+
+static void
+rnh_send (struct zserv *client, struct route_node *rn)
+{
+  struct rnh *rnh = rn->info;
+
+  zsend_nexthop_update (client, &rn->p, rnh->state, rnh->state_len);
+}
+
+/* Works out what the address resolves to now, and returns 1 if that
+   differs from what was last sent. */
+static int
+rnh_evaluate (struct route_node *rn)
+{
+  struct rnh *rnh = rn->info;
+  struct stream *s;
+  size_t len;
+
+  if (! rnh_scratch)
+    rnh_scratch = stream_new (ZEBRA_MAX_PACKET_SIZ);
+  s = rnh_scratch;
+  stream_reset (s);
+
+  rnh_state_encode (s, &rn->p, rnh);
+  len = stream_get_endp (s);
+
+  if (rnh->state && len == rnh->state_len
+      && memcmp (rnh->state, STREAM_DATA (s), len) == 0)
+    return 0;
+
+  if (rnh->state)
+    XFREE (MTYPE_RNH_STATE, rnh->state);
+  rnh->state = XMALLOC (MTYPE_RNH_STATE, len);
+  memcpy (rnh->state, STREAM_DATA (s), len);
+  rnh->state_len = len;
+  return 1;
+}
+
+static int
+rnh_evaluate_all (struct thread *thread)
+{
+  struct route_node *rn;
+  struct listnode *node;
+  struct zserv *client;
+  afi_t afi;
+
+  t_rnh_evaluate = NULL;
+
+  for (afi = AFI_IP; afi < AFI_MAX; afi++)
+    if (rnh_table[afi])
+      for (rn = route_top (rnh_table[afi]); rn; rn = route_next (rn))
+	if (rn->info && rnh_evaluate (rn))
+	  {
+	    if (IS_ZEBRA_DEBUG_EVENT)
+	      {
+		char buf[INET6_ADDRSTRLEN];
+
+		zlog_debug ("%s: %s changed, %d nexthops", __func__,
+			    inet_ntop (rn->p.family, &rn->p.u.prefix,
+				       buf, sizeof (buf)),
+			    ((struct rnh *) rn->info)->nexthop_num);
+	      }
+
+	    for (ALL_LIST_ELEMENTS_RO (((struct rnh *) rn->info)->clients,
+				       node, client))
+	      rnh_send (client, rn);
+	  }
+
+  return 0;
+}
+
+/* Whether any tracked address is one of those of p. */
+static int
+rnh_covered (struct route_table *table, struct prefix *p)
+{
+  struct route_node *node = table->top;
+
+  while (node && node->p.prefixlen < p->prefixlen
+	 && prefix_match (&node->p, p))
+    node = node->link[prefix_bit (&p->u.prefix, node->p.prefixlen)];
+
+  return node && prefix_match (p, &node->p);
+}
+
+void
+zebra_rnh_rib_changed (struct prefix *p)
+{
+  struct route_table *table;
+
+  if (t_rnh_evaluate)
+    return;
+
+  table = rnh_table_get (p);
+  if (table && rnh_covered (table, p))
+    t_rnh_evaluate = thread_add_event (zebrad.master, rnh_evaluate_all,
+				       NULL, 0);
+}
+
+static void
+rnh_free (struct route_node *rn)
+{
+  struct rnh *rnh = rn->info;
+
+  list_free (rnh->clients);
+  if (rnh->state)
+    XFREE (MTYPE_RNH_STATE, rnh->state);
+  XFREE (MTYPE_RNH, rnh);
+  rn->info = NULL;
+  route_unlock_node (rn);
+}
+
+void
+zebra_rnh_register (struct zserv *client, struct prefix *p)
+{
+  struct route_table *table;
+  struct route_node *rn;
+  struct rnh *rnh;
+
+  table = rnh_table_get (p);
+  if (! table)
+    return;
+
+  rn = route_node_get (table, p);
+  if (rn->info)
+    route_unlock_node (rn);
+  else
+    {
+      rnh = XCALLOC (MTYPE_RNH, sizeof (struct rnh));
+      rnh->clients = list_new ();
+      rn->info = rnh;
+      rnh_evaluate (rn);
+    }
+  rnh = rn->info;
+
+  if (! listnode_lookup (rnh->clients, client))
+    listnode_add (rnh->clients, client);
+
+  rnh_send (client, rn);
+}
+
+void
+zebra_rnh_unregister (struct zserv *client, struct prefix *p)
+{
+  struct route_table *table;
+  struct route_node *rn;
+  struct rnh *rnh;
+
+  table = rnh_table_get (p);
+  if (! table)
+    return;
+
+  rn = route_node_lookup (table, p);
+  if (! rn)
+    return;
+  route_unlock_node (rn);
+
+  if ((rnh = rn->info) == NULL)
+    return;
+  listnode_delete (rnh->clients, client);
+  if (listcount (rnh->clients) == 0)
+    rnh_free (rn);
+}
+
+void
+zebra_rnh_client_close (struct zserv *client)
+{
+  struct route_node *rn;
+  struct rnh *rnh;
+  afi_t afi;
+
+  for (afi = AFI_IP; afi < AFI_MAX; afi++)
+    if (rnh_table[afi])
+      for (rn = route_top (rnh_table[afi]); rn; rn = route_next (rn))
+	if ((rnh = rn->info) != NULL)
+	  {
+	    listnode_delete (rnh->clients, client);
+	    if (listcount (rnh->clients) == 0)
+	      rnh_free (rn);
+	  }
+}
+
+static void
+rnh_show (struct vty *vty, struct route_table *table)
+{
+  struct route_node *rn;
+  struct rnh *rnh;
+  char buf[INET6_ADDRSTRLEN];
+
+  for (rn = route_top (table); rn; rn = route_next (rn))
+    if ((rnh = rn->info) != NULL)
+      {
+	vty_out (vty, "%s", inet_ntop (rn->p.family, &rn->p.u.prefix,
+				       buf, sizeof (buf)));
+	if (rnh->nexthop_num)
+	  vty_out (vty, " resolved, %d nexthops, metric %u",
+		   rnh->nexthop_num, rnh->metric);
+	else
+	  vty_out (vty, " unresolved");
+	vty_out (vty, ", %d clients%s", listcount (rnh->clients),
+		 VTY_NEWLINE);
+      }
+}
+
+DEFUN (show_ip_nht,
+       show_ip_nht_cmd,
+       "show ip nht",
+       SHOW_STR
+       IP_STR
+       "IP nexthop tracking table\n")
+{
+  rnh_show (vty, rnh_table[AFI_IP]);
+  return CMD_SUCCESS;
+}
+
+#ifdef HAVE_IPV6
+DEFUN (show_ipv6_nht,
+       show_ipv6_nht_cmd,
+       "show ipv6 nht",
+       SHOW_STR
+       IPV6_STR
+       "IPv6 nexthop tracking table\n")
+{
+  rnh_show (vty, rnh_table[AFI_IP6]);
+  return CMD_SUCCESS;
+}
+#endif /* HAVE_IPV6 */
+
+void
+zebra_rnh_init (void)
+{
+  rnh_table[AFI_IP] = route_table_init ();
+#ifdef HAVE_IPV6
+  rnh_table[AFI_IP6] = route_table_init ();
+#endif /* HAVE_IPV6 */
+
+  install_element (VIEW_NODE, &show_ip_nht_cmd);
+  install_element (ENABLE_NODE, &show_ip_nht_cmd);
+#ifdef HAVE_IPV6
+  install_element (VIEW_NODE, &show_ipv6_nht_cmd);
+  install_element (ENABLE_NODE, &show_ipv6_nht_cmd);
+#endif /* HAVE_IPV6 */
+}
@@ -0,0 +1,42 @@
+/*
+ * Nexthops tracked for the clients of zebra.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _ZEBRA_RNH_H
+#define _ZEBRA_RNH_H
+
+#include "prefix.h"
+#include "zebra/zserv.h"
+
+/* A client registers the addresses it wants to reach, as the nexthops
+   of its routes, with ZEBRA_NEXTHOP_REGISTER.  Zebra answers with a
+   ZEBRA_NEXTHOP_UPDATE at once, with what the address resolves to as
+   ZEBRA_IPV4_NEXTHOP_LOOKUP would answer, and again whenever a change
+   to the RIB changes that.  */
+
+extern void zebra_rnh_init (void);
+extern void zebra_rnh_register (struct zserv *, struct prefix *);
+extern void zebra_rnh_unregister (struct zserv *, struct prefix *);
+extern void zebra_rnh_client_close (struct zserv *);
+
+/* The routes of the prefix were processed. */
+extern void zebra_rnh_rib_changed (struct prefix *);
+
+#endif /* _ZEBRA_RNH_H */
@@ -27,6 +27,8 @@
 #include "command.h"
 #include "table.h"
 #include "rib.h"
+#include "stream.h"
+#include "zclient.h"
 
 #include "zebra/zserv.h"
 
@@ -804,33 +806,288 @@ vty_show_ip_route (struct vty *vty, struct route_node *rn, struct rib *rib)
     }
 }
 
-DEFUN (show_ip_route,
-       show_ip_route_cmd,
-       "show ip route",
-       SHOW_STR
-       IP_STR
-       "IP routing table\n")
+/* Gives the routes of the node as a member of the "routes" object,
+   keyed by prefix. */
+static void
+rib_show_json (struct vty *vty, struct route_node *rn, int first)
 {
-  struct route_table *table;
-  struct route_node *rn;
   struct rib *rib;
-  int first = 1;
+  struct nexthop *nexthop;
+  char buf[INET6_ADDRSTRLEN];
 
-  table = vrf_table (AFI_IP, SAFI_UNICAST, 0);
-  if (! table)
-    return CMD_SUCCESS;
+  vty_out (vty, "%s%s\"%s/%d\":[", first ? "" : ",", VTY_NEWLINE,
+	   inet_ntop (rn->p.family, &rn->p.u.prefix, buf, sizeof (buf)),
+	   rn->p.prefixlen);
 
-  /* Show all IPv4 routes. */
-  for (rn = route_top (table); rn; rn = route_next (rn))
-    for (rib = rn->info; rib; rib = rib->next)
+  for (rib = rn->info; rib; rib = rib->next)
+    {
+      vty_out (vty, "%s{\"protocol\":\"%s\",\"selected\":%s,"
+	       "\"distance\":%d,\"metric\":%u,",
+	       rib == rn->info ? "" : ",", zebra_route_string (rib->type),
+	       CHECK_FLAG (rib->flags, ZEBRA_FLAG_SELECTED) ? "true" : "false",
+	       rib->distance, rib->metric);
+      if (rib->uptime)
+	vty_out (vty, "\"uptime\":%ld,", (long) (time (NULL) - rib->uptime));
+      vty_out (vty, "\"nexthops\":[");
+
+      for (nexthop = rib->nexthop; nexthop; nexthop = nexthop->next)
+	{
+	  vty_out (vty, "%s{", nexthop == rib->nexthop ? "" : ",");
+	  switch (nexthop->type)
+	    {
+	    case NEXTHOP_TYPE_IPV4:
+	    case NEXTHOP_TYPE_IPV4_IFINDEX:
+	    case NEXTHOP_TYPE_IPV4_IFNAME:
+	      vty_out (vty, "\"ip\":\"%s\",", inet_ntoa (nexthop->gate.ipv4));
+	      break;
+#ifdef HAVE_IPV6
+	    case NEXTHOP_TYPE_IPV6:
+	    case NEXTHOP_TYPE_IPV6_IFINDEX:
+	    case NEXTHOP_TYPE_IPV6_IFNAME:
+	      vty_out (vty, "\"ip\":\"%s\",",
+		       inet_ntop (AF_INET6, &nexthop->gate.ipv6, buf,
+				  sizeof (buf)));
+	      break;
+#endif /* HAVE_IPV6 */
+	    default:
+	      break;
+	    }
+	  if (nexthop->type == NEXTHOP_TYPE_BLACKHOLE)
+	    vty_out (vty, "\"interface\":\"Null0\",");
+	  else if (nexthop->ifname)
+	    {
+	      vty_out (vty, "\"interface\":");
+	      vty_out_json_string (vty, nexthop->ifname);
+	      vty_out (vty, ",");
+	    }
+	  else if (nexthop->ifindex)
+	    {
+	      vty_out (vty, "\"interface\":");
+	      vty_out_json_string (vty, ifindex2ifname (nexthop->ifindex));
+	      vty_out (vty, ",");
+	    }
+	  vty_out (vty, "\"active\":%s,\"fib\":%s}",
+		   CHECK_FLAG (nexthop->flags, NEXTHOP_FLAG_ACTIVE)
+		   ? "true" : "false",
+		   CHECK_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB)
+		   ? "true" : "false");
+	}
+      vty_out (vty, "]}");
+    }
+  vty_out (vty, "]");
+}
+
+/* Gives the routes of the node as a binary record: family and prefix
+   length of a byte each, the prefix of the family's address size and a
+   byte of route count, then for each route its type, flags, status and
+   distance of a byte each, metric and seconds up, 0 if not known, of 4
+   bytes each and a byte of nexthop count, followed by the nexthops,
+   each of type and flags of a byte, the gateway of the family's address
+   size, zero if none, and a 4 byte ifindex. */
+static void
+rib_show_binary (struct vty *vty, struct route_node *rn, struct stream *s)
+{
+  struct rib *rib;
+  struct nexthop *nexthop;
+  size_t addrlen, size, countp;
+  u_char count = 0;
+
+  addrlen = rn->p.family == AF_INET ? IPV4_MAX_BYTELEN : 16;
+
+  size = 4 + addrlen;
+  for (rib = rn->info; rib; rib = rib->next)
+    {
+      size += 13;
+      for (nexthop = rib->nexthop; nexthop; nexthop = nexthop->next)
+	size += 6 + addrlen;
+    }
+  if (STREAM_SIZE (s) < size)
+    stream_resize (s, size);
+  stream_reset (s);
+
+  stream_putc (s, rn->p.family);
+  stream_putc (s, rn->p.prefixlen);
+  stream_put (s, &rn->p.u.prefix, addrlen);
+  countp = stream_get_endp (s);
+  stream_putc (s, 0);
+
+  for (rib = rn->info; rib; rib = rib->next)
+    {
+      u_char nexthops = 0;
+      size_t nexthopp;
+
+      stream_putc (s, rib->type);
+      stream_putc (s, rib->flags);
+      stream_putc (s, rib->status);
+      stream_putc (s, rib->distance);
+      stream_putl (s, rib->metric);
+      stream_putl (s, rib->uptime ? time (NULL) - rib->uptime : 0);
+      nexthopp = stream_get_endp (s);
+      stream_putc (s, 0);
+
+      for (nexthop = rib->nexthop; nexthop; nexthop = nexthop->next)
+	{
+	  stream_putc (s, nexthop->type);
+	  stream_putc (s, nexthop->flags);
+	  switch (nexthop->type)
+	    {
+	    case NEXTHOP_TYPE_IPV4:
+	    case NEXTHOP_TYPE_IPV4_IFINDEX:
+	    case NEXTHOP_TYPE_IPV4_IFNAME:
+#ifdef HAVE_IPV6
+	    case NEXTHOP_TYPE_IPV6:
+	    case NEXTHOP_TYPE_IPV6_IFINDEX:
+	    case NEXTHOP_TYPE_IPV6_IFNAME:
+#endif /* HAVE_IPV6 */
+	      stream_put (s, &nexthop->gate, addrlen);
+	      break;
+	    default:
+	      stream_put (s, NULL, addrlen);
+	      break;
+	    }
+	  stream_putl (s, nexthop->ifindex);
+	  nexthops++;
+	}
+      stream_putc_at (s, nexthopp, nexthops);
+      count++;
+    }
+  stream_putc_at (s, countp, count);
+
+  vty_out_binary (vty, STREAM_DATA (s), stream_get_endp (s));
+}
+
+/* Where "show ip route" or "show ipv6 route" is in the table between
+   the pieces of output. */
+struct rib_show_cursor
+{
+  struct route_node *rn;	/* next to show, locked */
+  afi_t afi;
+  void (*show) (struct vty *, struct route_node *, struct rib *);
+  int first;
+  enum vty_format format;
+  struct stream *s;		/* binary record being given */
+};
+
+static void
+rib_show_cursor_free (void *arg)
+{
+  struct rib_show_cursor *cursor = arg;
+
+  if (cursor->rn)
+    route_unlock_node (cursor->rn);
+  if (cursor->s)
+    stream_free (cursor->s);
+  XFREE (MTYPE_RIB_SHOW, cursor);
+}
+
+/* Shows the routes of the next VTY_OUTPUT_ENTRIES prefixes, returning 1
+   while there are more. */
+static int
+rib_show_next (struct vty *vty, void *arg)
+{
+  struct rib_show_cursor *cursor = arg;
+  struct route_node *rn;
+  struct rib *rib;
+  int entries = 0;
+
+  for (rn = cursor->rn; rn && entries < VTY_OUTPUT_ENTRIES;
+       rn = route_next (rn))
+    if (rn->info != NULL)
       {
-	if (first)
+	entries++;
+	if (cursor->format == VTY_FORMAT_JSON)
+	  {
+	    rib_show_json (vty, rn, cursor->first);
+	    cursor->first = 0;
+	    continue;
+	  }
+	if (cursor->format == VTY_FORMAT_BINARY)
+	  {
+	    rib_show_binary (vty, rn, cursor->s);
+	    continue;
+	  }
+	for (rib = rn->info; rib; rib = rib->next)
 	  {
-	    vty_out (vty, SHOW_ROUTE_V4_HEADER);
-	    first = 0;
+	    if (cursor->first)
+	      {
+#ifdef HAVE_IPV6
+		if (cursor->afi == AFI_IP6)
+		  vty_out (vty, SHOW_ROUTE_V6_HEADER);
+		else
+#endif /* HAVE_IPV6 */
+		  vty_out (vty, SHOW_ROUTE_V4_HEADER);
+		cursor->first = 0;
+	      }
+	    (*cursor->show) (vty, rn, rib);
 	  }
-	vty_show_ip_route (vty, rn, rib);
       }
+
+  cursor->rn = rn;
+  if (rn)
+    return 1;
+
+  if (cursor->format == VTY_FORMAT_JSON)
+    vty_out (vty, "%s}}%s", VTY_NEWLINE, VTY_NEWLINE);
+  else if (cursor->format == VTY_FORMAT_BINARY)
+    vty_out_binary_end (vty);
+  return 0;
+}
+
+/* Shows all of the table, a piece at a time as the vty takes it. */
+static void
+rib_show (struct vty *vty, afi_t afi,
+	  void (*show) (struct vty *, struct route_node *, struct rib *),
+	  enum vty_format format)
+{
+  struct route_table *table;
+  struct rib_show_cursor *cursor;
+
+  table = vrf_table (afi, SAFI_UNICAST, 0);
+  if (! table)
+    return;
+
+  cursor = XCALLOC (MTYPE_RIB_SHOW, sizeof (struct rib_show_cursor));
+  cursor->rn = route_top (table);
+  cursor->afi = afi;
+  cursor->show = show;
+  cursor->first = 1;
+  cursor->format = format;
+
+  if (format == VTY_FORMAT_JSON)
+    vty_out (vty, "{\"routes\":{");
+  else if (format == VTY_FORMAT_BINARY)
+    cursor->s = stream_new (ZEBRA_MAX_PACKET_SIZ);
+
+  vty_output_set (vty, rib_show_next, rib_show_cursor_free, cursor);
+}
+
+DEFUN (show_ip_route,
+       show_ip_route_cmd,
+       "show ip route",
+       SHOW_STR
+       IP_STR
+       "IP routing table\n")
+{
+  /* Show all IPv4 routes. */
+  rib_show (vty, AFI_IP, vty_show_ip_route, VTY_FORMAT_TEXT);
+  return CMD_SUCCESS;
+}
+
+DEFUN (show_ip_route_format,
+       show_ip_route_format_cmd,
+       "show ip route (json|binary)",
+       SHOW_STR
+       IP_STR
+       "IP routing table\n"
+       "Give the table as JSON\n"
+       "Give the table as framed binary records\n")
+{
+  if (strcmp (argv[0], "json") == 0)
+    rib_show (vty, AFI_IP, vty_show_ip_route, VTY_FORMAT_JSON);
+  else if (vty_binary_ok (vty))
+    rib_show (vty, AFI_IP, vty_show_ip_route, VTY_FORMAT_BINARY);
+  else
+    return CMD_WARNING;
   return CMD_SUCCESS;
 }
 
@@ -1784,26 +2041,26 @@ DEFUN (show_ipv6_route,
        IP_STR
        "IPv6 routing table\n")
 {
-  struct route_table *table;
-  struct route_node *rn;
-  struct rib *rib;
-  int first = 1;
-
-  table = vrf_table (AFI_IP6, SAFI_UNICAST, 0);
-  if (! table)
-    return CMD_SUCCESS;
-
   /* Show all IPv6 route. */
-  for (rn = route_top (table); rn; rn = route_next (rn))
-    for (rib = rn->info; rib; rib = rib->next)
-      {
-	if (first)
-	  {
-	    vty_out (vty, SHOW_ROUTE_V6_HEADER);
-	    first = 0;
-	  }
-	vty_show_ipv6_route (vty, rn, rib);
-      }
+  rib_show (vty, AFI_IP6, vty_show_ipv6_route, VTY_FORMAT_TEXT);
+  return CMD_SUCCESS;
+}
+
+DEFUN (show_ipv6_route_format,
+       show_ipv6_route_format_cmd,
+       "show ipv6 route (json|binary)",
+       SHOW_STR
+       IP_STR
+       "IPv6 routing table\n"
+       "Give the table as JSON\n"
+       "Give the table as framed binary records\n")
+{
+  if (strcmp (argv[0], "json") == 0)
+    rib_show (vty, AFI_IP6, vty_show_ipv6_route, VTY_FORMAT_JSON);
+  else if (vty_binary_ok (vty))
+    rib_show (vty, AFI_IP6, vty_show_ipv6_route, VTY_FORMAT_BINARY);
+  else
+    return CMD_WARNING;
   return CMD_SUCCESS;
 }
 
@@ -2148,6 +2405,7 @@ zebra_vty_init (void)
   install_element (CONFIG_NODE, &no_ip_route_mask_flags_distance2_cmd);
 
   install_element (VIEW_NODE, &show_ip_route_cmd);
+  install_element (VIEW_NODE, &show_ip_route_format_cmd);
   install_element (VIEW_NODE, &show_ip_route_addr_cmd);
   install_element (VIEW_NODE, &show_ip_route_prefix_cmd);
   install_element (VIEW_NODE, &show_ip_route_prefix_longer_cmd);
@@ -2155,6 +2413,7 @@ zebra_vty_init (void)
   install_element (VIEW_NODE, &show_ip_route_supernets_cmd);
   install_element (VIEW_NODE, &show_ip_route_summary_cmd);
   install_element (ENABLE_NODE, &show_ip_route_cmd);
+  install_element (ENABLE_NODE, &show_ip_route_format_cmd);
   install_element (ENABLE_NODE, &show_ip_route_addr_cmd);
   install_element (ENABLE_NODE, &show_ip_route_prefix_cmd);
   install_element (ENABLE_NODE, &show_ip_route_prefix_longer_cmd);
@@ -2184,12 +2443,14 @@ zebra_vty_init (void)
   install_element (CONFIG_NODE, &no_ipv6_route_ifname_pref_cmd);
   install_element (CONFIG_NODE, &no_ipv6_route_ifname_flags_pref_cmd);
   install_element (VIEW_NODE, &show_ipv6_route_cmd);
+  install_element (VIEW_NODE, &show_ipv6_route_format_cmd);
   install_element (VIEW_NODE, &show_ipv6_route_summary_cmd);
   install_element (VIEW_NODE, &show_ipv6_route_protocol_cmd);
   install_element (VIEW_NODE, &show_ipv6_route_addr_cmd);
   install_element (VIEW_NODE, &show_ipv6_route_prefix_cmd);
   install_element (VIEW_NODE, &show_ipv6_route_prefix_longer_cmd);
   install_element (ENABLE_NODE, &show_ipv6_route_cmd);
+  install_element (ENABLE_NODE, &show_ipv6_route_format_cmd);
   install_element (ENABLE_NODE, &show_ipv6_route_protocol_cmd);
   install_element (ENABLE_NODE, &show_ipv6_route_addr_cmd);
   install_element (ENABLE_NODE, &show_ipv6_route_prefix_cmd);
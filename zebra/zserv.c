@@ -42,6 +42,7 @@
 #include "zebra/redistribute.h"
 #include "zebra/debug.h"
 #include "zebra/ipforward.h"
+#include "zebra/zebra_rnh.h"
 
 /* Event list of zebra. */
 enum event { ZEBRA_SERV, ZEBRA_READ, ZEBRA_WRITE };
@@ -584,6 +585,26 @@ zsend_ipv4_nexthop_lookup (struct zserv *client, struct in_addr addr)
   return zebra_server_send_message(client);
 }
 
+/* What a tracked address resolves to, encoded by zebra_rnh.c. */
+int
+zsend_nexthop_update (struct zserv *client, struct prefix *p,
+		      u_char *state, size_t len)
+{
+  struct stream *s;
+
+  s = client->obuf;
+  stream_reset (s);
+
+  zserv_create_header (s, ZEBRA_NEXTHOP_UPDATE);
+  stream_putc (s, p->family);
+  stream_put (s, &p->u.prefix, prefix_blen (p));
+  stream_put (s, state, len);
+
+  stream_putw_at (s, 0, stream_get_endp (s));
+
+  return zebra_server_send_message(client);
+}
+
 static int
 zsend_ipv4_import_lookup (struct zserv *client, struct prefix_ipv4 *p)
 {
@@ -886,6 +907,37 @@ zread_ipv4_nexthop_lookup (struct zserv *client, u_short length)
   return zsend_ipv4_nexthop_lookup (client, addr);
 }
 
+/* Register or unregister an address to be tracked. */
+static void
+zread_nexthop_register (int command, struct zserv *client, u_short length)
+{
+  struct prefix p;
+
+  memset (&p, 0, sizeof (struct prefix));
+  p.family = stream_getc (client->ibuf);
+  switch (p.family)
+    {
+    case AF_INET:
+      p.prefixlen = IPV4_MAX_BITLEN;
+      break;
+#ifdef HAVE_IPV6
+    case AF_INET6:
+      p.prefixlen = IPV6_MAX_BITLEN;
+      break;
+#endif /* HAVE_IPV6 */
+    default:
+      zlog_warn ("%s: unknown family %d from client %d", __func__,
+		 p.family, client->sock);
+      return;
+    }
+  stream_get (&p.u.prefix, client->ibuf, prefix_blen (&p));
+
+  if (command == ZEBRA_NEXTHOP_REGISTER)
+    zebra_rnh_register (client, &p);
+  else
+    zebra_rnh_unregister (client, &p);
+}
+
 /* Nexthop lookup for IPv4. */
 static int
 zread_ipv4_import_lookup (struct zserv *client, u_short length)
@@ -1123,6 +1175,9 @@ zebra_client_close (struct zserv *client)
       client->sock = -1;
     }
 
+  /* Track nothing more for it. */
+  zebra_rnh_client_close (client);
+
   /* Free stream buffers. */
   if (client->ibuf)
     stream_free (client->ibuf);
@@ -1327,6 +1382,10 @@ zebra_client_read (struct thread *thread)
     case ZEBRA_HELLO:
       zread_hello (client);
       break;
+    case ZEBRA_NEXTHOP_REGISTER:
+    case ZEBRA_NEXTHOP_UNREGISTER:
+      zread_nexthop_register (command, client, length);
+      break;
     default:
       zlog_info ("Zebra received unknown command %d", command);
       break;